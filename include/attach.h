@@ -0,0 +1,92 @@
+#ifndef ATTACH_H
+#define ATTACH_H
+
+// NOTE: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "cgroup.h"   // cgroup_context_t
+#include "seccomp.h"  // seccomp_program_t
+
+/**
+ * `minicontainer exec`: run another process inside a container that is
+ * already running, instead of starting a new one. Nothing is set up —
+ * no overlay, cgroup, veth or clone of a fresh namespace set — so a
+ * health check or a debug shell costs a fork, one setns() and an
+ * execve().
+ *
+ * container_attach_open() pins the target once:
+ *
+ *   pidfd      pidfd_open() of the container's init; checked alive
+ *              after /proc/<pid> is opened, so a recycled pid is caught
+ *   ns         which of its namespaces differ from ours (by inode), and
+ *              an fd for each (/proc/<pid>/ns/<name>, opened relative to
+ *              the /proc/<pid> dir fd)
+ *   root       /proc/<pid>/root, the pivoted rootfs
+ *   cgroup     its cgroup v2 directory, as a cgroup_context_t (dir_fd
+ *              only: the cgroup is not ours to release)
+ *   envp       its environment (/proc/<pid>/environ); until the target
+ *              has executed, that is still the runtime's
+ *
+ * container_attach_exec() may then be called any number of times. The
+ * forked child joins the cgroup, enters every namespace with a single
+ * setns(pidfd, flags) (Linux 5.8; one setns() per ns fd before that),
+ * becomes root of the container's user namespace, chroots to the
+ * container root and executes. When the PID namespace was entered, the
+ * child forks once more (setns() only moves children into it) and
+ * relays the grandchild's status.
+ *
+ * The container's seccomp filter is not inherited (nothing exports it
+ * from the target); set seccomp to install one before execve().
+ *
+ * A target is a host pid or the name of a minicontainer cgroup (slot<N>
+ * or c_<id>), which resolves to the oldest process in it: the init.
+ */
+#define ATTACH_NS_COUNT  8   // user cgroup ipc uts net pid mnt time
+
+typedef struct {
+    pid_t pid;                       // Target (host pid)
+    int   pidfd;                     // -1 once closed
+    int   proc_fd;                   // /proc/<pid>
+    int   root_fd;                   // /proc/<pid>/root
+    int   ns_flags;                  // CLONE_NEW* to enter
+    int   ns_fds[ATTACH_NS_COUNT];   // Per-namespace fallback, -1 if shared
+    cgroup_context_t cgroup;         // dir_fd -1 without a cgroup v2 path
+    char *env_buf;                   // environ contents
+    char **envp;                     // Pointers into env_buf
+    const seccomp_program_t *seccomp;  // Set by the caller; NULL = none
+} container_attach_t;
+
+/**
+ * Resolve target and pin the process behind it.
+ *
+ * @param a             Handle to populate
+ * @param target        Host pid, or a cgroup name under CGROUP_POOL_DIR
+ * @param enable_debug  Enable [attach] debug output
+ * @return              0 on success, -1 on failure (nothing left open)
+ */
+int container_attach_open(container_attach_t *a, const char *target,
+                          bool enable_debug);
+
+/**
+ * Run argv inside the pinned container and wait for it.
+ *
+ * @param a             Handle from container_attach_open()
+ * @param argv          Command (argv[0] looked up in the container's PATH)
+ * @param envp          Environment; NULL = the target's own
+ * @param status        Out: waitpid() status of the command
+ * @param enable_debug  Enable [attach] debug output
+ * @return              0 if the command ran and was waited for, -1 if
+ *                      entering the container failed
+ */
+int container_attach_exec(const container_attach_t *a, char *const argv[],
+                          char *const envp[], int *status,
+                          bool enable_debug);
+
+/**
+ * Release the handle. Idempotent.
+ */
+void container_attach_close(container_attach_t *a);
+
+#endif // ATTACH_H
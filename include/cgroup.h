@@ -6,42 +6,161 @@
 
 #include <sched.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 /**
- * Resource limits for cgroup.
+ * Resource limits for cgroup. Zero (or "") everywhere leaves a knob at the
+ * kernel default, so a zero-initialised struct limits nothing. Strings are
+ * inline so the struct travels verbatim in a serve spec.
  */
 typedef struct {
     size_t memory_limit;     // Bytes, 0 = unlimited
     long cpu_quota;          // Microseconds, 0 = unlimited
     long cpu_period;         // Microseconds, default 100000
     size_t pid_limit;        // Max processes, 0 = unlimited
+    size_t memory_high;      // memory.high (throttle + reclaim above it),
+                             // bytes, 0 = unlimited
+    size_t swap_limit;       // memory.swap.max, bytes, 0 = unlimited,
+                             // CGROUP_SWAP_NONE = no swap
+    unsigned cpu_weight;     // cpu.weight 1..10000, 0 = default (100)
+    unsigned io_weight;      // io.weight 1..10000, 0 = default (100)
+    char cpuset_cpus[64];    // cpuset.cpus list ("0-3,8"), "" = inherit
+    char cpuset_mems[64];    // cpuset.mems list, "" = inherit
+    char io_max[128];        // io.max line as the kernel prints it:
+                             // "MAJ:MIN rbps=N wbps=N riops=N wiops=N"
+                             // (each N a number or "max"), "" = none
+    bool numa_auto;          // Pin cpus + mems to the least-loaded NUMA
+                             // node (ignored unless cpuset_* are empty)
 } cgroup_limits_t;
 
+#define CGROUP_SWAP_NONE  ((size_t)-1)
+#define CGROUP_WEIGHT_MAX 10000
+#define CGROUP_ROOT       "/sys/fs/cgroup"   // cgroup v2 mount
+
+/**
+ * Cgroup pool: leaf cgroups <cgroup root>/CGROUP_POOL_DIR/slot<N>, made
+ * once and reused by one container after another instead of being
+ * mkdir'd and rmdir'd around each of them.
+ *
+ * A slot is owned through an flock() on its own directory fd (cgroup v2
+ * cannot rename a cgroup, so ownership cannot be a rename), which
+ * setup_cgroup() keeps open as ctx->dir_fd; concurrent runtimes never
+ * claim the same slot and a crashed owner releases its claim. A slot
+ * that still has processes is skipped. When every slot is busy
+ * setup_cgroup() mkdirs the next one and kicks a detached refill that
+ * keeps CGROUP_POOL_WARM idle slots ready. Controllers are enabled on
+ * the root and the parent once, when the parent is created (again only
+ * if a leaf turns out to lack them).
+ *
+ * Limits are written through dir_fd (openat), and a value is written only
+ * when the slot's current one differs: a slot keeps its previous
+ * tenant's limits, and unset limits are reset to "max". Counters
+ * (cpu.stat, memory.events, ...) are cumulative across tenants.
+ */
+#define CGROUP_POOL_DIR        "minicontainer"
+#define CGROUP_POOL_MAX_SLOTS  256   // Beyond this, per-container cgroups
+#define CGROUP_POOL_WARM       4
+
+/**
+ * Memory guard: warning before the memory.max OOM kill instead of just a
+ * SIGKILL afterwards. A PSI trigger on memory.pressure ("some" stall of
+ * stall_us within window_us) and memory.events are polled (POLLPRI) by
+ * whoever waits for the child. A trigger or a "max" event — allocations
+ * reclaiming at the hard limit — means an OOM kill is imminent; with
+ * high_pct set, the first one lowers memory.high to that share of
+ * memory.max, so the kernel throttles and reclaims the container while
+ * it is still alive. Plain memory.max OOM kill is the fallback either
+ * way.
+ */
+typedef struct {
+    bool     enable;
+    unsigned stall_us;       // PSI threshold, 0 = MEMORY_GUARD_STALL_US
+    unsigned window_us;      // PSI window (500 ms..10 s),
+                             // 0 = MEMORY_GUARD_WINDOW_US
+    unsigned high_pct;       // 1..99: throttle target, % of memory_limit;
+                             // 0 = report only
+} memory_guard_config_t;
+
+#define MEMORY_GUARD_STALL_US   100000
+#define MEMORY_GUARD_WINDOW_US  1000000
+
+typedef enum {
+    MEMORY_EVENT_PRESSURE,   // PSI trigger fired (OOM imminent)
+    MEMORY_EVENT_HIGH,       // memory.events high: throttled at memory.high
+    MEMORY_EVENT_MAX,        // max: reclaiming at memory.max (OOM imminent)
+    MEMORY_EVENT_OOM,        // oom: reclaim failed
+    MEMORY_EVENT_OOM_KILL,   // oom_kill: a process was killed
+    MEMORY_EVENT_COUNT
+} memory_event_kind_t;
+
+typedef struct {
+    memory_event_kind_t kind;
+    uint64_t count;            // Occurrences since the guard was armed
+    uint64_t memory_current;   // Bytes, when the event was read
+    uint64_t throttled_to;     // memory.high this event wrote, 0 = none
+} memory_event_t;
+
+typedef struct {
+    bool     active;
+    int      psi_fd;           // Trigger fd, -1 without PSI
+    int      events_fd;        // memory.events, -1 without the controller
+    uint64_t base[MEMORY_EVENT_COUNT];     // memory.events when armed
+    uint64_t counts[MEMORY_EVENT_COUNT];   // Since armed
+    uint64_t throttle_to;      // memory.high for the first warning, 0 = none
+    bool     throttled;
+} cgroup_guard_t;
+
 /**
  * Cgroup runtime context.
  */
 typedef struct {
+    uint64_t id;             // In: container ID a one-off cgroup is named
+                             // after (id.h); 0 = draw one
     char cgroup_path[256];
     char cgroup_name[64];
     bool created;
+    bool pooled;             // A pool slot (kept on release) vs. a
+                             // one-off cgroup (rmdir'd)
+    int  dir_fd;             // Directory fd, flock()ed for pool slots
+                             // (limit writes, cgroup.procs,
+                             // CLONE_INTO_CGROUP); valid only while created
+    int  numa_node;          // Node chosen by numa_auto, -1 if none
+    cgroup_guard_t guard;    // Memory guard; disarmed by remove_cgroup()
 } cgroup_context_t;
 
 /**
- * Create and setup cgroup for container.
- * Called by PARENT before clone().
+ * NUMA placement (cgroup_limits_t.numa_auto). A node's load is the number
+ * of running pool containers whose cpuset.mems is exactly that node; the
+ * node with the fewest wins, ties going to the most MemFree. The
+ * container gets the node's cpulist as cpuset.cpus and the node as
+ * cpuset.mems, so its threads and its page allocations stay local. A
+ * host with a single node is left unpinned.
+ */
+#define NUMA_SYSFS  "/sys/devices/system/node"
+
+/**
+ * Claim (or create) a pool slot for a container and apply limits.
+ * Called by PARENT before clone(). Also opens ctx->dir_fd so the child
+ * can be cloned straight into the cgroup (clone3 + CLONE_INTO_CGROUP).
+ * When the pool ran dry, the refill (a fork) is the caller's to kick if
+ * needs_refill is given: a caller with other threads running must only
+ * fork once they are done.
  *
- * @param ctx          Cgroup context (output — populated with path and name)
- * @param limits       Resource limits to apply
- * @param enable_debug Enable debug output
- * @return             0 on success, -1 on failure
+ * @param ctx           Cgroup context (output — populated with path and name)
+ * @param limits        Resource limits to apply
+ * @param needs_refill  Out: caller should kick cgroup_pool_refill_async();
+ *                      NULL = kick it here
+ * @param enable_debug  Enable debug output
+ * @return              0 on success, -1 on failure
  */
 int setup_cgroup(cgroup_context_t *ctx, const cgroup_limits_t *limits,
-                 bool enable_debug);
+                 bool *needs_refill, bool enable_debug);
 
 /**
  * Add PID to cgroup.
- * Called by PARENT after clone().
+ * Called by PARENT after clone() when the child was not cloned into the
+ * cgroup directly (kernels before 5.7, cgroup v1).
  *
  * @param ctx          Cgroup context
  * @param pid          PID to add
@@ -52,12 +171,65 @@ int add_pid_to_cgroup(const cgroup_context_t *ctx, pid_t pid,
                       bool enable_debug);
 
 /**
- * Remove cgroup directory.
- * Called after container exits. Cgroup must be empty (no processes).
+ * Release the container's cgroup: a pool slot is unlocked and kept for
+ * the next container, a one-off cgroup is rmdir'd (which only succeeds
+ * once it is empty). The memory guard's fds are closed (its counts stay).
+ * Called after container exits. Idempotent: clears ctx->created.
  *
  * @param ctx          Cgroup context
  * @param enable_debug Enable debug output
  */
 void remove_cgroup(cgroup_context_t *ctx, bool enable_debug);
 
+/**
+ * Arm the memory guard on a set-up cgroup: write the PSI trigger and
+ * take the memory.events baseline. Either half may be unavailable.
+ *
+ * @param ctx          Cgroup context from setup_cgroup()
+ * @param cfg          Guard configuration
+ * @param limits       The limits the cgroup was set up with
+ * @param enable_debug Enable debug output
+ * @return             0 if at least one source is armed, -1 otherwise
+ */
+int cgroup_guard_arm(cgroup_context_t *ctx, const memory_guard_config_t *cfg,
+                     const cgroup_limits_t *limits, bool enable_debug);
+
+/**
+ * Handle readiness on one of the guard's fds (or fd -1: re-read
+ * memory.events, to drain what was left when the child exited), applying
+ * the throttle on the first OOM-imminent event.
+ *
+ * @param ctx          Cgroup context with an armed guard
+ * @param fd           ctx->guard.psi_fd, ctx->guard.events_fd or -1
+ * @param events       Out: what happened
+ * @param max          Capacity of events (MEMORY_EVENT_COUNT is enough)
+ * @param enable_debug Enable debug output
+ * @return             Number of events written
+ */
+int cgroup_guard_read(cgroup_context_t *ctx, int fd, memory_event_t *events,
+                      int max, bool enable_debug);
+
+/**
+ * @return  "pressure", "high", "max", "oom" or "oom_kill"
+ */
+const char *memory_event_name(memory_event_kind_t kind);
+
+/**
+ * @return  true for the kinds that precede an OOM kill (pressure, max)
+ */
+bool memory_event_imminent(memory_event_kind_t kind);
+
+/**
+ * Create slots until CGROUP_POOL_WARM of them are idle.
+ *
+ * @return  Number of idle slots afterwards, or -1 if the pool parent
+ *          cannot be opened
+ */
+int cgroup_pool_refill(bool enable_debug);
+
+/**
+ * Run cgroup_pool_refill() in a detached grandchild, off the start path.
+ */
+void cgroup_pool_refill_async(bool enable_debug);
+
 #endif // CGROUP_H
\ No newline at end of file
@@ -0,0 +1,81 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+// NOTE: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include <stdbool.h>
+#include <stddef.h>
+#include "core.h"   // container_config_t, container_result_t
+
+/**
+ * Checkpoint/restore through CRIU: snapshot a container once it has
+ * warmed up, and start later copies from the snapshot instead of from
+ * execve().
+ *
+ *   <dir>/config.spec   spec_encode() of the container's config: argv,
+ *                       env, rootfs, cgroup limits, veth config
+ *   <dir>/state         "key value" lines restore needs beyond the
+ *                       config (the container-side veth name)
+ *   <dir>/upper/        the overlay upper dir, copied after the dump
+ *   <dir>/images/       criu dump images, dump.log, restore.log
+ *
+ * The dump stops the container (criu's default), so upper/ matches the
+ * images exactly. A restore claims a fresh cgroup slot and overlay
+ * workspace, seeds the workspace's upper dir from upper/, and runs
+ * `criu restore --root <merged>` from a child already in the cgroup, so
+ * the whole restored tree lands there. The runtime is a child subreaper,
+ * so the restored init (detached from criu) becomes its child and is
+ * waited for like a cloned one. The veth pair is recreated by criu under
+ * a new host name (--external veth[...]) and configured by
+ * net_adopt_host().
+ */
+#define CHECKPOINT_SPEC    "config.spec"
+#define CHECKPOINT_STATE   "state"
+#define CHECKPOINT_UPPER   "upper"
+#define CHECKPOINT_IMAGES  "images"
+
+/**
+ * Locate criu in /usr/sbin, /usr/local/sbin or /sbin.
+ *
+ * @return  Static path, or NULL if criu is not installed
+ */
+const char *find_criu_binary(void);
+
+/**
+ * Dump a running container into dir (created if needed). The container
+ * is stopped by the dump; the caller reaps it as usual.
+ *
+ * @param result  The running container (container_start/container_spawn)
+ * @param config  The configuration it was started with
+ * @param dir     Snapshot directory
+ * @return        0 on success, -1 on failure (the container keeps running
+ *                if criu failed before killing it)
+ */
+int container_checkpoint(const container_result_t *result,
+                         const container_config_t *config, const char *dir);
+
+/**
+ * Read the configuration a snapshot was taken with. Its strings point
+ * into buf. restore_dir is left NULL.
+ *
+ * @param dir     Snapshot directory
+ * @param config  Out: the configuration
+ * @param buf     8-byte aligned buffer, SPEC_MAX_SIZE is enough
+ * @param size    Capacity of buf
+ * @return        0 on success, -1 on failure
+ */
+int checkpoint_load_config(const char *dir, container_config_t *config,
+                           void *buf, size_t size);
+
+/**
+ * Restore config->restore_dir — container_start() for a snapshot, called
+ * by container_exec() when restore_dir is set. config supplies the
+ * cgroup limits, overlay, and veth addresses (normally those from
+ * checkpoint_load_config()).
+ *
+ * @param config  Configuration with restore_dir set
+ * @return        Result as from container_start(); child_pid < 0 on failure
+ */
+container_result_t container_restore(const container_config_t *config);
+
+#endif // CHECKPOINT_H
@@ -33,7 +33,10 @@ typedef struct {
     bool enable_network;
 
     // Filesystem
-    const char *rootfs_path;
+    const char *rootfs_path;       // Directory or erofs/squashfs image
+                                   // file; with enable_overlay, may be a
+                                   // colon-separated layer list of those
+                                   // (image_resolve)
     bool enable_overlay;
     const char *container_dir;
 
@@ -51,32 +54,102 @@ typedef struct {
     // Cgroup limits
     cgroup_limits_t cgroup_limits;
     bool enable_cgroup;
+    memory_guard_config_t memory_guard;   // Needs enable_cgroup
 
     // Network (veth)
     veth_config_t veth;
+
+    // Syscall filter (seccomp.h)
+    const char *seccomp_profile;  // SECCOMP_PROFILE_DEFAULT or a profile
+                                  // file; NULL = no filter
+
+    // Instrumentation
+    bool enable_timings;     // Fill container_result_t.timings
+
+    // Checkpoint/restore (checkpoint.h)
+    const char *restore_dir; // Start from this snapshot instead of execve()
 } container_config_t;
 
+/**
+ * Start-path phases timed when config->enable_timings is set: the
+ * numbered container_exec() steps in the parent, then child_func() steps.
+ * A phase that did not run stays 0.
+ */
+typedef enum {
+    CONTAINER_PHASE_CGROUP,        // Step 1: setup_cgroup
+    CONTAINER_PHASE_IMAGE,         // Step 2b: image-file rootfs mount
+    CONTAINER_PHASE_OVERLAY,       // Step 3: overlay (fsmount or mount)
+    CONTAINER_PHASE_CLONE,         // Step 7: clone / clone3
+    CONTAINER_PHASE_UID_MAP,       // Step 9: uid_map / gid_map writes
+    CONTAINER_PHASE_NET,           // Step 10: setup_net
+    CONTAINER_PHASE_CGROUP_ATTACH, // Step 12: cgroup.procs write
+    CONTAINER_PHASE_SYNC,          // Child 1: blocked on the sync pipe
+    CONTAINER_PHASE_HOSTNAME,      // Child 2: setup_uts
+    CONTAINER_PHASE_PIVOT_ROOT,    // Child 3: setup_rootfs (+ Step 3 open_tree)
+    CONTAINER_PHASE_MOUNT_PROC,    // Child 4: mount_proc
+    CONTAINER_PHASE_CHILD_NET,     // Child 5: configure_container_net
+    CONTAINER_PHASE_CLOSE_FDS,     // Child 6: close_inherited_fds
+    CONTAINER_PHASE_SECCOMP,       // Child 6b: seccomp_install
+    CONTAINER_PHASE_COUNT
+} container_phase_t;
+
+/**
+ * Per-phase start latency (CLOCK_MONOTONIC, nanoseconds). Child phases
+ * are written through a MAP_SHARED page and copied here by
+ * container_reap(), so they are complete only after the child exits.
+ */
+typedef struct {
+    bool     valid;
+    uint64_t phase_ns[CONTAINER_PHASE_COUNT];
+    uint64_t start_ns;   // container_exec() entry
+    uint64_t exec_ns;    // Child issued execve(); 0 if it never did
+} container_timings_t;
+
+/**
+ * @return  Short, stable name for phase ("cgroup", "pivot_root", ...),
+ *          used as the JSON key by --timings=json
+ */
+const char *container_phase_name(container_phase_t phase);
+
 /**
  * Aggregate runtime context populated during container_exec, consumed
  * by container_cleanup. Each sub-context has its own state flags so
  * cleanup is idempotent.
  */
 typedef struct {
+    uint64_t          id;            // Container ID (id.h); names the
+                                     // one-off cgroup, overlay and veths
     overlay_context_t overlay_ctx;
     cgroup_context_t  cgroup_ctx;
     net_context_t     net_ctx;
-    void             *stack_ptr;
+    container_timings_t *timings_page;   // Shared with the child
 } container_context_t;
 
+/**
+ * Draw a container ID for ctx and hand it to the sub-contexts named after
+ * it, so one container's cgroup, overlay and veth names share one ID.
+ * Call on a zeroed context before any setup step.
+ *
+ * @param ctx  Context to stamp
+ */
+void container_context_assign_id(container_context_t *ctx);
+
 /**
  * Result of container_exec. Contains exit status plus the runtime
  * context needed for cleanup.
  */
 typedef struct {
     pid_t child_pid;
+    int   pidfd;            // CLONE_PIDFD handle: pollable (POLLIN on exit),
+                            // signal via container_signal(); valid while
+                            // has_pidfd, closed by container_cleanup()
+    bool  has_pidfd;
+    bool  reaped;           // Set by container_reap(); no more signals
+    bool  cleaned;          // container_cleanup() ran (one cleanup event)
     int   exit_status;
     bool  exited_normally;
     int   signal;
+    container_timings_t timings;   // valid only with enable_timings
     container_context_t ctx;
 } container_result_t;
 
@@ -88,21 +161,205 @@ typedef struct {
  * The behavior is driven entirely by config flags. To get Phase-5
  * behavior (cgroups but no network): set enable_cgroup=true and
  * enable_network=false. To get Phase-6 behavior (cgroups + network):
- * set both true. Etc.
+ * set both true. Etc. With restore_dir set, the container is restored
+ * from that snapshot (container_restore) instead of cloned.
  *
  * @param config  Container configuration
  * @return        Result with child status and runtime context
  */
 container_result_t container_exec(const container_config_t *config);
 
+/**
+ * Event loop for running many containers from one process. Each child
+ * is watched through a pidfd (pidfd_open) registered in one epoll set;
+ * container_poll() / container_wait_any() reap whichever children have
+ * exited, so nothing blocks on a particular container.
+ */
+typedef struct container_loop container_loop_t;
+
+typedef struct container_handle container_handle_t;
+
+/**
+ * Exit callback, run by container_poll() / container_wait_any() after
+ * the child is reaped and torn down (overlay, network, cgroup).
+ * h->result holds the exit status. The handle stays valid until
+ * container_handle_free(). The loop does not touch h once the callback
+ * returns, so the callback may free it (and only it) — but then it must not
+ * also be collected through container_wait_any().
+ */
+typedef void (*container_exit_fn)(container_handle_t *h, void *user);
+
+/**
+ * Memory-guard callback (config->memory_guard), run by container_poll() /
+ * container_wait_any() for each event, after any throttle was applied.
+ * Events still pending when the child exits are delivered just before
+ * on_exit.
+ */
+typedef void (*container_memory_fn)(container_handle_t *h,
+                                    const memory_event_t *ev, void *user);
+
+/* An fd in the loop's epoll set: the pidfd or a guard fd. Its epoll data
+ * is the handle pointer with the source index in the low bits, so an
+ * event is classified without touching a handle that may be freed. */
+typedef struct {
+    int fd;
+} container_source_t;
+
+struct container_handle {
+    container_result_t result;   // result.pidfd is what the loop polls
+    bool  reaped;
+    bool  enable_debug;
+    container_exit_fn on_exit;   // May be NULL
+    container_memory_fn on_memory;   // May be NULL; set after spawn
+    void *user;                  // Passed to both callbacks
+    container_source_t sources[3];   // pidfd, PSI trigger, memory.events
+    container_loop_t *loop;      // NULL once reaped
+    container_handle_t *prev, *next;   // Loop's running list
+};
+
+/**
+ * @return  New loop, or NULL on failure (errno set)
+ */
+container_loop_t *container_loop_create(void);
+
+/**
+ * Destroy a loop. Containers still running are SIGKILLed, reaped and
+ * torn down first (their callbacks run); handles not yet freed must still
+ * be released with container_handle_free().
+ */
+void container_loop_destroy(container_loop_t *loop);
+
+/**
+ * Start config in the background: container_exec() Steps 1-12, then the
+ * child is added to loop instead of waited for.
+ *
+ * @param loop     Loop that will reap the child
+ * @param config   Container configuration
+ * @param on_exit  Called once the child is reaped (NULL for none)
+ * @param user     Passed to on_exit
+ * @return         Handle, or NULL if the container failed to start
+ */
+container_handle_t *container_spawn(container_loop_t *loop,
+                                    const container_config_t *config,
+                                    container_exit_fn on_exit, void *user);
+
+/**
+ * Reap every child that has exited within timeout_ms (-1 = wait for at
+ * least one, 0 = do not block), running teardown and callbacks.
+ *
+ * @return  Containers reaped, 0 on timeout, -1 on error
+ */
+int container_poll(container_loop_t *loop, int timeout_ms);
+
+/**
+ * Block until one child exits, reap it and run its callback.
+ *
+ * @return  That child's handle, or NULL if none are running
+ */
+container_handle_t *container_wait_any(container_loop_t *loop);
+
+/**
+ * @return  Containers spawned on loop and not yet reaped
+ */
+unsigned container_loop_running(const container_loop_t *loop);
+
+/**
+ * Release a handle. A child still running is killed and reaped first.
+ */
+void container_handle_free(container_handle_t *h);
+
+/**
+ * Send sig to a running container. Goes through the pidfd when there is
+ * one, so a child that has already been reaped gets ESRCH instead of the
+ * signal landing on a recycled pid.
+ *
+ * @param result  Result from container_exec / container_spawn
+ * @param sig     Signal number
+ * @return        0 on success, -1 on failure (errno set)
+ */
+int container_signal(const container_result_t *result, int sig);
+
+/**
+ * Record a waitpid() status in result and tear down its overlay — the
+ * tail of container_exec() after Step 13, exposed for callers that reap
+ * children themselves (the serve daemon). Follow with
+ * container_cleanup() as usual.
+ *
+ * @param result        Result of the container that exited
+ * @param status        Status from waitpid()
+ * @param enable_debug  Enable [parent] debug output
+ */
+void container_reap(container_result_t *result, int status,
+                    bool enable_debug);
+
+/**
+ * A child cloned ahead of time into a namespace set and parked on a
+ * request channel (SOCK_SEQPACKET socketpair). Launching it only does
+ * the per-request deltas — cgroup, overlay dirs, veth, then hostname,
+ * rootfs pivot and execve inside the child — so the clone() and
+ * uid/gid-map costs are off the request path.
+ */
+typedef struct {
+    pid_t pid;                 // 0 = no zygote
+    int   pidfd;               // -1 if the kernel gave none
+    int   ctl_fd;              // Parent end of the request channel
+    int   clone_flags;         // Namespace set it was cloned into
+    container_config_t key;    // Template (scalars only; pointers NULL)
+} container_zygote_t;
+
+/**
+ * Clone a zygote for tmpl's namespace set (and uid/gid maps when
+ * tmpl->enable_user_namespace). Only namespace flags and id maps are
+ * taken from tmpl; everything else comes with the launch request.
+ *
+ * @param z     Zygote to populate
+ * @param tmpl  Configuration whose namespace set to pre-create
+ * @return      0 on success, -1 on failure
+ */
+int container_zygote_spawn(container_zygote_t *z, const container_config_t *tmpl);
+
+/**
+ * True if config can be launched in z: same clone flags and, with a user
+ * namespace, the same id maps.
+ */
+bool container_zygote_matches(const container_zygote_t *z,
+                              const container_config_t *config);
+
+/**
+ * Hand config to a parked zygote. Runs the parent-side deltas (cgroup,
+ * overlay directories, veth), sends the request with stdio_fds passed
+ * over SCM_RIGHTS, and returns WITHOUT waiting: the caller reaps
+ * result->child_pid itself (container_reap + container_cleanup).
+ *
+ * The zygote is consumed either way. On success the returned fd is the
+ * request channel, which reads EOF once the child has reached execve (or
+ * died) — the "container started" signal. The caller closes it.
+ *
+ * @param z          Matching zygote (see container_zygote_matches)
+ * @param config     Full request configuration
+ * @param stdio_fds  stdin/stdout/stderr for the container
+ * @param result     Out: child pid and runtime context
+ * @return           Request channel fd on success, -1 on failure
+ */
+int container_zygote_launch(container_zygote_t *z,
+                            const container_config_t *config,
+                            const int stdio_fds[3],
+                            container_result_t *result);
+
+/**
+ * Kill and reap an unused zygote. Idempotent.
+ */
+void container_zygote_discard(container_zygote_t *z);
+
 /**
  * Tear down everything container_exec set up. Idempotent — calling on
  * a zero-initialized result is a no-op.
  *
  * Cleans up (in reverse setup order):
+ *   - pidfd (close)
  *   - Host veth + iptables NAT rule (cleanup_net)
  *   - Cgroup directory (remove_cgroup)
- *   - Clone stack (free)
+ *   - Timings page (munmap)
  *
  * Overlay teardown is performed inside container_exec (immediately
  * after waitpid) because the overlay is per-execution and not useful
@@ -0,0 +1,160 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+// NOTE: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * Container lifecycle events, for supervisors that start thousands of
+ * containers a minute and the log shippers / metrics agents watching
+ * them.
+ *
+ * A process attaches one event ring (events_attach()); core.c then
+ * records, with a CLOCK_MONOTONIC timestamp and the container ID:
+ *
+ *   created   clone() returned / the zygote took the request  (pid)
+ *   started   released towards execve(); value = start latency, ns
+ *             (0 for a restore). A zygote start is reported by whoever
+ *             watches its channel for EOF (serve.c), not by core.c
+ *   exited    reaped; status = exit status, value = signal (0 if none)
+ *   oom       memory guard event; status = memory_event_kind_t,
+ *             value = memory.current
+ *   cleanup   container_cleanup() released cgroup, veth and the rest
+ *   log       one --debug line (text, truncated to EVENT_TEXT_MAX)
+ *
+ * The ring is a power-of-two array of fixed-size slots plus a head
+ * counter. Writing one is a fetch_add on the head (so the setup threads
+ * of one start may log at once), a CAS marking the slot busy with that
+ * position (so a writer a full lap behind cannot tear it), the slot
+ * write and a release CAS publishing the slot's sequence number: no
+ * lock, no syscall, and it never waits for a reader. The newest events overwrite the oldest.
+ * Readers keep their own cursor and never write to the ring, so any
+ * number of them can tail it without slowing the launch path; one that
+ * falls a lap behind skips ahead and counts what it lost.
+ *
+ * With a path, the ring lives in a MAP_SHARED file (normally under
+ * /dev/shm), created beside the path and renamed over it, so a consumer
+ * in another process maps it read-only (event_ring_open()); without
+ * one it is anonymous shared memory.
+ *
+ * --debug output goes through the same sink: debug_log() records the
+ * line in the attached ring and appends it to a per-process buffer that
+ * reaches stdout in one write() per EVENT_SINK_SIZE bytes, at
+ * debug_flush() and at exit — instead of a locked, line-buffered stdio
+ * write per line from parent and child. After fork() or clone() the
+ * child drops the parent's pending bytes (the parent still writes them),
+ * so nothing is printed twice.
+ */
+#define EVENT_TEXT_MAX     72
+#define EVENT_RING_DEFAULT 4096    // Slots
+#define EVENT_SINK_SIZE    16384   // Bytes of debug output per write()
+
+typedef enum {
+    EVENT_CREATED,
+    EVENT_STARTED,
+    EVENT_EXITED,
+    EVENT_OOM,
+    EVENT_CLEANUP,
+    EVENT_LOG,
+    EVENT_KIND_COUNT
+} event_kind_t;
+
+typedef struct {
+    uint64_t seq;      // Position in the ring, from 0
+    uint64_t ts_ns;    // CLOCK_MONOTONIC
+    uint64_t id;       // Container ID (id.h); 0 for a log line
+    uint64_t value;    // Per kind, see above
+    int32_t  pid;      // Host pid, 0 if not known
+    int32_t  status;   // Per kind, see above
+    uint16_t kind;     // event_kind_t
+    uint16_t len;      // Bytes of text (log)
+    char     text[EVENT_TEXT_MAX];
+} event_t;
+
+typedef struct event_ring event_ring_t;
+
+typedef struct {
+    const event_ring_t *ring;
+    uint64_t next;      // seq of the next event to read
+    uint64_t dropped;   // Overwritten before this cursor reached them
+} event_cursor_t;
+
+/**
+ * Create a ring.
+ *
+ * @param path      Shared file to create or replace, or NULL for an
+ *                  anonymous mapping (shared with forked children)
+ * @param capacity  Slots; rounded up to a power of two, 0 = EVENT_RING_DEFAULT
+ * @return          Ring, or NULL on failure (errno set)
+ */
+event_ring_t *event_ring_create(const char *path, unsigned capacity);
+
+/**
+ * Map another process's ring (from event_ring_create(path)) read-only.
+ *
+ * @return  Ring, or NULL on failure (errno = EINVAL for a file that is
+ *          not a ring from this build)
+ */
+const event_ring_t *event_ring_open(const char *path);
+
+/**
+ * Unmap a ring from either call. Detach it first if it is attached.
+ */
+void event_ring_close(const event_ring_t *ring);
+
+/**
+ * Make ring the one this process records events and debug lines in;
+ * NULL stops recording.
+ */
+void events_attach(event_ring_t *ring);
+
+/**
+ * Record an event in the attached ring (a no-op without one).
+ */
+void event_emit(event_kind_t kind, uint64_t id, pid_t pid, int32_t status,
+                uint64_t value);
+
+/**
+ * Start reading ring at the oldest event it still holds, or with
+ * from_oldest false, at the next one written.
+ */
+void event_cursor_init(event_cursor_t *c, const event_ring_t *ring,
+                       bool from_oldest);
+
+/**
+ * Copy the next event. Never blocks and never writes to the ring.
+ *
+ * @return  1 with *ev filled, 0 if the cursor has caught up
+ */
+int event_next(event_cursor_t *c, event_t *ev);
+
+/**
+ * @return  "created", "started", "exited", "oom", "cleanup" or "log"
+ */
+const char *event_kind_name(event_kind_t kind);
+
+/**
+ * Format ev as one JSON object, newline included.
+ *
+ * @return  Length written (snprintf semantics)
+ */
+int event_format_json(const event_t *ev, char *buf, size_t size);
+
+/**
+ * --debug output: format one line (newline included, as for printf),
+ * record it as a log event and buffer it for stdout.
+ */
+void debug_log(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * Write out this process's buffered debug output. Called where ordering
+ * matters: before clone() and execve(), once container_exec() has
+ * started the child and when it or container_poll() returns, and at exit.
+ */
+void debug_flush(void);
+
+#endif // EVENTS_H
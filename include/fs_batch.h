@@ -0,0 +1,132 @@
+#ifndef FS_BATCH_H
+#define FS_BATCH_H
+
+// NOTE: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * Batched filesystem operations: the mkdirs, unlinks and small
+ * file writes (cgroup knobs, uid/gid maps) of container setup and
+ * teardown, queued up and then run together.
+ *
+ * With the io_uring backend a batch is ONE io_uring_enter() call:
+ * mkdirat/unlinkat become single SQEs, and a file write becomes a
+ * linked openat → write → close triple on a direct descriptor (the
+ * file never enters the fd table). The ring is raw syscalls, no
+ * liburing, just as netlink.c speaks rtnetlink without libnl. Without
+ * io_uring (kernel < 5.15, io_uring_disabled, seccomp) or with the ring
+ * busy on another thread, the same batch runs as plain syscalls in
+ * order, so callers have one code path.
+ *
+ * The ring is created on first use, one per process (a forked child
+ * makes its own), and kept until exit.
+ *
+ * Ordering: unflagged ops of one batch may run in any order and
+ * concurrently. The flags below order an op against the ones queued
+ * before it. Nothing makes an op conditional on an earlier one
+ * succeeding: io_uring does not break a link when mkdirat or unlinkat
+ * fails, so an op that must not run after a failure (a mkdir inside a
+ * directory we may not have created) belongs in a later batch.
+ */
+#define FS_BATCH_MAX      64      // Ops per batch
+#define FS_BATCH_STRBUF   16384   // Bytes of copied paths and data
+
+#define FS_OP_AFTER_PREV  0x1     // Start once the previous op is done
+#define FS_OP_BARRIER     0x2     // Start once every earlier op is done
+
+typedef enum {
+    FS_BACKEND_AUTO = 0,          // io_uring when usable, else syscalls
+    FS_BACKEND_SYSCALL,           // Never io_uring (--fs-backend syscall)
+} fs_backend_t;
+
+typedef enum {
+    FS_OP_MKDIR,
+    FS_OP_UNLINK,                 // flags AT_REMOVEDIR = rmdir
+    FS_OP_WRITE_FILE,             // open(O_WRONLY), one write, close
+} fs_op_kind_t;
+
+typedef struct {
+    fs_op_kind_t kind;
+    unsigned     order;           // FS_OP_* flags
+    int          dir_fd;          // AT_FDCWD or a directory fd
+    size_t       path;            // Offsets into strbuf
+    size_t       data;
+    size_t       data_len;
+    int          arg;             // mkdir mode / unlinkat flags
+    int          res;             // After fs_batch_run: 0 or -errno
+    const char  *failed_call;     // "open", "write", "mkdir" or "unlink"
+} fs_op_t;
+
+/**
+ * Zero-initialize (or call fs_batch_init) before use. Paths and data
+ * are copied in, so callers may reuse their buffers at once.
+ */
+typedef struct {
+    fs_op_t  ops[FS_BATCH_MAX];
+    unsigned count;
+    char     strbuf[FS_BATCH_STRBUF];
+    size_t   str_len;
+    bool     overflow;            // Set if any append did not fit
+} fs_batch_t;
+
+/**
+ * Choose the backend for this process. Call before the first batch.
+ */
+void fs_batch_set_backend(fs_backend_t backend);
+
+/**
+ * Reset a batch to empty.
+ */
+void fs_batch_init(fs_batch_t *b);
+
+/**
+ * Append mkdirat(dir_fd, path, mode).
+ *
+ * @return  Op index, or -1 if the batch is full (b->overflow)
+ */
+int fs_batch_mkdir(fs_batch_t *b, int dir_fd, const char *path, mode_t mode,
+                   unsigned order);
+
+/**
+ * Append unlinkat(dir_fd, path, flags).
+ *
+ * @return  Op index, or -1 if the batch is full (b->overflow)
+ */
+int fs_batch_unlink(fs_batch_t *b, int dir_fd, const char *path, int flags,
+                    unsigned order);
+
+/**
+ * Append a whole-file write: open(dir_fd/path, O_WRONLY), one write of
+ * the NUL-terminated data at offset 0, close. A short write fails the
+ * op with -EIO.
+ *
+ * @return  Op index, or -1 if the batch is full (b->overflow)
+ */
+int fs_batch_write_file(fs_batch_t *b, int dir_fd, const char *path,
+                        const char *data, unsigned order);
+
+/**
+ * Run every queued op and set each op's res. The batch is left as is;
+ * call fs_batch_init before reusing it.
+ *
+ * @param b             Batch to run
+ * @param enable_debug  Report the backend on first use ([fsbatch])
+ * @return              0 if every op succeeded, -1 otherwise (or if the
+ *                      batch overflowed, in which case nothing ran)
+ */
+int fs_batch_run(fs_batch_t *b, bool enable_debug);
+
+/**
+ * Path an op was queued with.
+ */
+const char *fs_batch_path(const fs_batch_t *b, unsigned i);
+
+/**
+ * perror() for a failed op: "<call>(<what>): <strerror(-res)>".
+ */
+void fs_batch_perror(const fs_batch_t *b, unsigned i, const char *what);
+
+#endif // FS_BATCH_H
@@ -0,0 +1,36 @@
+#ifndef ID_H
+#define ID_H
+
+// NOTE: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include <stdint.h>
+
+/**
+ * Container IDs. One 64-bit ID is drawn per container and every name the
+ * container needs is formatted from it:
+ *
+ *   cgroup    c_<16 hex>       the whole ID (one-off cgroups only; pool
+ *                              slots keep their slot<N> names)
+ *   overlay   <12 hex>         low 48 bits (workspace directory)
+ *   veth      veth_[hc]_<8 hex> low 32 bits (IFNAMSIZ leaves room for 8)
+ *
+ * An ID is a per-process random base (getrandom()) plus an atomic
+ * counter. Within one process the low 32 bits therefore cannot repeat
+ * before 2^32 containers, whatever the thread or the clock does; two
+ * processes collide only if their bases land within a few counts of each
+ * other. A forked child draws a fresh base on its first call, so it never
+ * replays its parent's sequence.
+ *
+ * Because creating a name cannot collide, nothing on the start path
+ * checks for or retries on EEXIST.
+ */
+
+/**
+ * Draw the next container ID. Thread-safe, lock-free after the first
+ * call in a process.
+ *
+ * @return  A non-zero ID
+ */
+uint64_t id_next(void);
+
+#endif // ID_H
@@ -0,0 +1,107 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+// NOTE: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Content-addressed layer store.
+ *
+ *   <store>/layers/sha256/<hex>/   one unpacked layer (plain directory
+ *                                  tree), named by the sha256 of the tar
+ *                                  it was imported from
+ *   <store>/images/<name>          manifest: one "sha256:<hex>" per line,
+ *                                  topmost layer first; '#' comments
+ *
+ * An image is its ordered layer list. image_resolve() turns it into an
+ * overlayfs lowerdir list ("top:...:base"), which setup_overlay() mounts
+ * as-is, so a layer shared by many images is stored once and its pages
+ * stay cached across all their containers.
+ *
+ * scripts/import_layer.sh adds layers and writes manifests.
+ */
+#define IMAGE_STORE_PATH  "/var/lib/minicontainer"
+#define IMAGE_MAX_LAYERS  32   // Keeps the mount options under one page
+#define IMAGE_DIGEST_LEN  64   // sha256, lowercase hex
+
+/**
+ * Resolve an image reference to a colon-separated lowerdir list of
+ * absolute layer paths. Every digest is validated (so a manifest cannot
+ * point outside the store) and every layer must exist.
+ *
+ * @param store         Layer store root (NULL = IMAGE_STORE_PATH)
+ * @param ref           Image name under <store>/images, or a path to a
+ *                      manifest file (contains '/')
+ * @param lowerdirs     Out: "top:...:base"
+ * @param size          Size of lowerdirs
+ * @param enable_debug  Enable [image] debug output
+ * @return              Number of layers, or -1 on failure
+ */
+int image_resolve(const char *store, const char *ref, char *lowerdirs,
+                  size_t size, bool enable_debug);
+
+/**
+ * Read-only image files (erofs, squashfs) as a rootfs or layer.
+ *
+ * A --rootfs (or lowerdir list component) that is a regular file holding
+ * an erofs or squashfs superblock is mounted read-only — erofs straight
+ * from the file where the kernel supports it (6.12+), otherwise through
+ * a LO_FLAGS_AUTOCLEAR loop device — at IMAGE_MOUNT_DIR/<key> and used
+ * as the directory in its place. <key> identifies the file (device,
+ * inode, size, mtime), so every container on the same image shares one
+ * mount and one page cache; the mount stays cached after the last
+ * container exits. flock(<key>.lock) serialises concurrent first mounts.
+ *
+ * IMAGE_MOUNT_DIR is made a shared mount, so image mounts added later
+ * still propagate into mount namespaces created before them (a parked
+ * serve zygote).
+ */
+#define IMAGE_MOUNT_DIR  "/run/minicontainer/images"
+
+/**
+ * Detect an erofs or squashfs image file.
+ *
+ * @param path    Candidate path
+ * @param fstype  Out: "erofs" or "squashfs" (static string)
+ * @return        1 if path is an image file, 0 if it is not (a
+ *                directory, say), -1 if it cannot be read
+ */
+int image_file_fstype(const char *path, const char **fstype);
+
+/**
+ * Create IMAGE_MOUNT_DIR as a shared bind mount (idempotent). Called
+ * before cloning a mount namespace that must see later image mounts.
+ *
+ * @return  0 on success, -1 on failure
+ */
+int image_mount_dir_init(bool enable_debug);
+
+/**
+ * Mount (or find the cached mount of) an image file.
+ *
+ * @param path          erofs/squashfs image file
+ * @param mountpoint    Out: IMAGE_MOUNT_DIR/<key>
+ * @param size          Size of mountpoint
+ * @param enable_debug  Enable [image] debug output
+ * @return              0 on success, -1 on failure
+ */
+int image_mount_file(const char *path, char *mountpoint, size_t size,
+                     bool enable_debug);
+
+/**
+ * Rewrite a rootfs spec — one path or a "top:...:base" list — replacing
+ * every image-file component by its mount (image_mount_file()).
+ *
+ * @param rootfs_path   config->rootfs_path
+ * @param out           Out: rewritten spec
+ * @param size          Size of out
+ * @param enable_debug  Enable [image] debug output
+ * @return              1 if any component was an image file, 0 if none
+ *                      (out is a copy), -1 on failure
+ */
+int image_resolve_rootfs(const char *rootfs_path, char *out, size_t size,
+                         bool enable_debug);
+
+#endif // IMAGE_H
@@ -0,0 +1,33 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+// NOTE: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+
+/**
+ * Interned strings, for the paths many containers have in common: the
+ * resolved rootfs (or layer list) an overlay mounts and the workspace
+ * cache of a container_dir. A context holds a pointer to one shared
+ * copy instead of a PATH_MAX buffer of its own.
+ *
+ * Strings are copied into an append-only arena of INTERN_CHUNK blocks
+ * and found again through an open-addressing hash table. Nothing is ever
+ * freed: the arena grows with the number of DISTINCT strings (images,
+ * container dirs), not with the number of containers started.
+ *
+ * Pointers are valid in this process and in children forked after the
+ * string was interned; a process cloned earlier (a serve zygote) must be
+ * sent the string itself.
+ */
+#define INTERN_CHUNK  (64 * 1024)
+
+/**
+ * Intern s. Thread-safe.
+ *
+ * @param s  NUL-terminated string
+ * @return   The shared, immutable copy of s (equal strings give the same
+ *           pointer), or NULL if out of memory
+ */
+const char *str_intern(const char *s);
+
+#endif // INTERN_H
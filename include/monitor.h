@@ -0,0 +1,126 @@
+#ifndef MONITOR_H
+#define MONITOR_H
+
+// NOTE: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * Live resource telemetry for a running container, read from its cgroup.
+ *
+ * monitor_open() opens each stat file once, relative to the cgroup's
+ * dir_fd; monitor_sample() re-reads them with pread(fd, .., 0), which
+ * makes the kernel regenerate the contents without an open/close per
+ * sample. A file that does not exist (controller not enabled, no PSI)
+ * is skipped and its fields are left out of the output.
+ *
+ * Counters (CPU time, throttling, I/O, PSI stall totals) are reported
+ * relative to monitor_open(): a pooled cgroup slot keeps its previous
+ * tenants' counts. Gauges (memory, pids, PSI averages) are absolute.
+ *
+ * Samples go into a fixed ring of MONITOR_RING_SIZE; the newest overwrite
+ * the oldest, and monitor_summary() covers whatever the ring still holds.
+ */
+#define MONITOR_RING_SIZE  256
+
+typedef enum {
+    MONITOR_FILE_MEMORY_CURRENT,
+    MONITOR_FILE_MEMORY_STAT,
+    MONITOR_FILE_CPU_STAT,
+    MONITOR_FILE_PIDS_CURRENT,
+    MONITOR_FILE_IO_STAT,
+    MONITOR_FILE_CPU_PRESSURE,
+    MONITOR_FILE_MEMORY_PRESSURE,
+    MONITOR_FILE_COUNT
+} monitor_file_t;
+
+typedef enum {
+    MONITOR_FORMAT_JSON,       // One object per line
+    MONITOR_FORMAT_LINE,       // InfluxDB line protocol
+} monitor_format_t;
+
+/**
+ * One sample. ts_ns is CLOCK_REALTIME; `present` has bit (1 << file)
+ * set for every monitor_file_t that was read.
+ */
+typedef struct {
+    uint64_t ts_ns;
+    uint32_t present;
+    uint64_t memory_current;       // Bytes
+    uint64_t memory_anon;          // memory.stat
+    uint64_t memory_file;
+    uint64_t cpu_usage_usec;       // cpu.stat
+    uint64_t cpu_user_usec;
+    uint64_t cpu_system_usec;
+    uint64_t cpu_nr_throttled;
+    uint64_t cpu_throttled_usec;
+    uint64_t pids_current;
+    uint64_t io_rbytes;            // io.stat, summed over devices
+    uint64_t io_wbytes;
+    uint64_t io_rios;
+    uint64_t io_wios;
+    double   cpu_some_avg10;       // cpu.pressure, percent
+    uint64_t cpu_some_total_usec;
+    double   memory_some_avg10;    // memory.pressure
+    double   memory_full_avg10;
+    uint64_t memory_some_total_usec;
+    uint64_t memory_full_total_usec;
+} monitor_sample_t;
+
+typedef struct {
+    char     name[64];             // Label: the cgroup name
+    pid_t    pid;
+    int      fds[MONITOR_FILE_COUNT];   // -1 where the file is missing
+    monitor_sample_t base;         // Counters at monitor_open()
+    monitor_sample_t ring[MONITOR_RING_SIZE];
+    uint64_t count;                // Samples taken (ring index = count % size)
+} container_monitor_t;
+
+/**
+ * Open the stat files of a container's cgroup and take the counter
+ * baseline.
+ *
+ * @param m       Monitor to initialise
+ * @param dir_fd  The cgroup's directory fd (cgroup_context_t.dir_fd)
+ * @param name    Label for the output (copied)
+ * @param pid     Container pid, for the output
+ * @return        0 on success, -1 if no stat file could be opened
+ */
+int monitor_open(container_monitor_t *m, int dir_fd, const char *name,
+                 pid_t pid);
+
+/**
+ * Read every open stat file into the next ring slot.
+ *
+ * @return  The new sample (valid until MONITOR_RING_SIZE more are taken)
+ */
+const monitor_sample_t *monitor_sample(container_monitor_t *m);
+
+/**
+ * Format sample s (from m's ring) as one line, newline included. CPU
+ * utilisation is derived from the sample before it, when the ring still
+ * holds one.
+ *
+ * @return  Length written (snprintf semantics)
+ */
+int monitor_format(const container_monitor_t *m, const monitor_sample_t *s,
+                   monitor_format_t fmt, char *buf, size_t size);
+
+/**
+ * Format a one-line summary over the ring: sample count, peak memory and
+ * pids, peak PSI averages, and the last counter values.
+ *
+ * @return  Length written (snprintf semantics)
+ */
+int monitor_summary(const container_monitor_t *m, monitor_format_t fmt,
+                    char *buf, size_t size);
+
+/**
+ * Close the stat files. Idempotent.
+ */
+void monitor_close(container_monitor_t *m);
+
+#endif // MONITOR_H
@@ -1,9 +1,63 @@
 #ifndef MOUNT_H
 #define MOUNT_H
 
+#include <fcntl.h>
 #include <sched.h>
 #include <stdbool.h>
 #include <sys/types.h>
+#include <sys/mount.h>
+
+/*
+ * fd-based mount API (fsopen/fsconfig/fsmount/move_mount/open_tree,
+ * Linux 5.2+). glibc < 2.36 has neither the wrappers nor the constants,
+ * so both are provided here; every *_compat() call is a raw syscall(2)
+ * and fails with ENOSYS on older kernels, which callers treat as "use
+ * mount(2)".
+ */
+#ifndef OPEN_TREE_CLONE
+#define OPEN_TREE_CLONE         1
+#endif
+#ifndef OPEN_TREE_CLOEXEC
+#define OPEN_TREE_CLOEXEC       O_CLOEXEC
+#endif
+#ifndef MOVE_MOUNT_F_EMPTY_PATH
+#define MOVE_MOUNT_F_EMPTY_PATH 0x00000004
+#endif
+#ifndef FSOPEN_CLOEXEC
+#define FSOPEN_CLOEXEC          0x00000001
+#endif
+#ifndef FSMOUNT_CLOEXEC
+#define FSMOUNT_CLOEXEC         0x00000001
+#endif
+#ifndef MOUNT_ATTR_NOSUID
+#define MOUNT_ATTR_NOSUID       0x00000002
+#endif
+#ifndef MOUNT_ATTR_NODEV
+#define MOUNT_ATTR_NODEV        0x00000004
+#endif
+#ifndef FSCONFIG_SET_STRING
+#define FSCONFIG_SET_STRING     1
+#endif
+#ifndef FSCONFIG_CMD_CREATE
+#define FSCONFIG_CMD_CREATE     6
+#endif
+
+int fsopen_compat(const char *fsname, unsigned int flags);
+int fsconfig_compat(int fs_fd, unsigned int cmd, const char *key,
+                    const void *value, int aux);
+int fsmount_compat(int fs_fd, unsigned int flags, unsigned int attr_flags);
+int move_mount_compat(int from_dfd, const char *from_path, int to_dfd,
+                      const char *to_path, unsigned int flags);
+int open_tree_compat(int dfd, const char *path, unsigned int flags);
+
+/**
+ * Print the kernel's fsconfig() error log for fs_fd (the fd API reports
+ * "overlayfs: failed to resolve ..." there instead of to dmesg).
+ *
+ * @param fs_fd   fsopen() fd
+ * @param prefix  Message prefix, e.g. "[overlay]"
+ */
+void fs_log_dump(int fs_fd, const char *prefix);
 
 
 /**
@@ -16,6 +70,31 @@
  */
 int setup_rootfs(const char *rootfs_path, bool enable_debug);
 
+/**
+ * Detached recursive clone of the tree at path (open_tree with
+ * OPEN_TREE_CLONE | AT_RECURSIVE): the fd-API form of the bind mount
+ * setup_rootfs() makes, taken in the parent before clone() so the child
+ * only has to attach it. The clone is private and belongs to no mount
+ * namespace until attached.
+ *
+ * @param path  Root filesystem directory
+ * @return      Mount fd (O_CLOEXEC), or -1 (errno ENOSYS before 5.2)
+ */
+int mount_tree_clone(const char *path);
+
+/**
+ * setup_rootfs() for a detached mount (mount_tree_clone(), or an
+ * overlay from overlay_fsmount()): attach it at rootfs_path with
+ * move_mount(), then pivot_root into it. Skips the bind mount and the
+ * propagation change setup_rootfs() makes on the new root. Closes tree_fd.
+ *
+ * @param tree_fd      Detached mount fd
+ * @param rootfs_path  Directory to attach at (becomes /)
+ * @param enable_debug Enable debug output
+ * @return             0 on success, -1 on failure
+ */
+int setup_rootfs_fd(int tree_fd, const char *rootfs_path, bool enable_debug);
+
 /**
  * Mount /proc filesystem inside container.
  *
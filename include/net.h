@@ -5,21 +5,92 @@
 // Do NOT redefine it here (Error #8 from decisions.md).
 #include <sched.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <arpa/inet.h>   // INET_ADDRSTRLEN
 #include <net/if.h>      // IFNAMSIZ
 
+/**
+ * How veth setup talks to the kernel.
+ *
+ *   NET_BACKEND_AUTO    — rtnetlink first; fall back to fork+exec of
+ *                         ip(8) if the netlink path fails (default)
+ *   NET_BACKEND_NETLINK — rtnetlink only, no fallback
+ *   NET_BACKEND_IP      — fork+exec ip(8) only (Phase 6 behavior)
+ */
+typedef enum {
+    NET_BACKEND_AUTO = 0,
+    NET_BACKEND_NETLINK,
+    NET_BACKEND_IP
+} net_backend_t;
+
+/**
+ * Pre-created network pool (net_pool.c). size == 0 disables the pool.
+ *   size       — idle netns+veth slots the refiller keeps ready
+ *   low_water  — a start that leaves fewer idle pairs than this kicks
+ *                off an asynchronous refill
+ */
+typedef struct {
+    unsigned size;
+    unsigned low_water;
+} net_pool_config_t;
+
+/**
+ * User-mode networking (net_user.c): a helper process gives the
+ * container a tap device and forwards its traffic through host sockets,
+ * instead of a veth pair. Needs no host privilege, so it is what a
+ * rootless --user --net container gets.
+ *
+ *   NET_USER_NONE        — kernel veth pair (default; needs root)
+ *   NET_USER_AUTO        — pasta if installed, else slirp4netns
+ *   NET_USER_PASTA       — pasta(1) only
+ *   NET_USER_SLIRP4NETNS — slirp4netns(1) only
+ */
+typedef enum {
+    NET_USER_NONE = 0,
+    NET_USER_AUTO,
+    NET_USER_PASTA,
+    NET_USER_SLIRP4NETNS
+} net_user_mode_t;
+
+/**
+ * One published port (--publish): host_port on the host forwards to
+ * container_port in the container, in the kernel (iptables DNAT) for a
+ * veth and through the helper in user mode.
+ */
+#define NET_PUBLISH_MAX 8
+
+typedef struct {
+    char     host_ip[INET_ADDRSTRLEN];   // "" = every local address
+    uint16_t host_port;
+    uint16_t container_port;
+    uint8_t  proto;                      // IPPROTO_TCP or IPPROTO_UDP
+} net_publish_t;
+
+/* Longest pod name, NUL included (net_pod.c). */
+#define NET_POD_NAME_MAX 32
+
 /**
  * Veth-specific configuration. Embedded inside container_config_t
  * as the `veth` field.
  * Defaults (set by main.c when --net is enabled):
- *   host_ip="10.0.0.1", container_ip="10.0.0.2", netmask="24", enable_nat=true
+ *   host_ip="10.0.0.1", container_ip="10.0.0.2", netmask="24", enable_nat=true,
+ *   backend=NET_BACKEND_AUTO
  */
 typedef struct {
     char host_ip[INET_ADDRSTRLEN];
     char container_ip[INET_ADDRSTRLEN];
     char netmask[8];                  // CIDR suffix, e.g., "24"
     bool enable_nat;                  // iptables MASQUERADE for internet access
+    net_backend_t backend;            // Zero-init = NET_BACKEND_AUTO
+    net_pool_config_t pool;           // Zero-init = no pool
+    char pod[NET_POD_NAME_MAX];       // Share this pod's netns; "" = own one
+    char bridge[IFNAMSIZ];            // Enslave the host end to this bridge
+                                      // (net_bridge.c); "" = routed veth
+    net_user_mode_t user_mode;        // Tap + user-mode helper instead of
+                                      // a veth (net_user.c)
+    net_publish_t publish[NET_PUBLISH_MAX];
+    unsigned publish_count;           // Ports forwarded from the host
 } veth_config_t;
 
 /**
@@ -29,13 +100,54 @@ typedef struct {
  * consumed by cleanup_net().
  */
 typedef struct {
-    char veth_host[IFNAMSIZ];                  // e.g., "veth_h_a1b2"
-    char veth_container[IFNAMSIZ];             // e.g., "veth_c_a1b2"
+    char veth_host[IFNAMSIZ];                  // e.g., "veth_h_1f2e3d4c"
+    char veth_container[IFNAMSIZ];             // e.g., "veth_c_1f2e3d4c"
     bool veth_created;                         // For idempotent cleanup
+    net_backend_t backend;                     // Backend that created the
+                                               // veth (NETLINK or IP)
     bool nat_added;                            // For idempotent cleanup
     char nat_source_cidr[INET_ADDRSTRLEN + 8]; // Stored so cleanup can
                                                // delete the iptables rule
                                                // without the original config
+    net_publish_t published[NET_PUBLISH_MAX];  // DNAT rules in place, kept
+    unsigned published_count;                  // for the same reason
+    char publish_dest[INET_ADDRSTRLEN];        // Their container address
+
+    // Network pool (net_pool.c). The fds are only meaningful when pooled.
+    bool pooled;                               // Slot claimed from the pool
+    unsigned pool_slot;
+    int  pool_lock_fd;                         // flock held while claimed
+    int  netns_fd;                             // Pre-built netns the child
+                                               // setns()es into
+    char pool_cidr[INET_ADDRSTRLEN + 8];       // Host address of the pair
+
+    // Pod mode (net_pod.c): one netns + veth shared by several containers
+    char pod_name[NET_POD_NAME_MAX];           // "" = not in a pod
+    bool pod_member;                           // Joined an existing pod's
+                                               // netns (via netns_fd)
+    unsigned pod_refs;                         // Members after our join
+                                               // (0: creating); the live
+                                               // count is in the pod's
+                                               // state file
+    int  pod_lock_fd;                          // flock a creating container
+                                               // holds until registered
+                                               // (only while pod_refs == 0)
+
+    // Bridge mode (net_bridge.c)
+    char bridge_ip[INET_ADDRSTRLEN];           // Leased container address;
+                                               // "" = veth.container_ip
+    int  lease_fd;                             // flock on the lease (only
+                                               // while bridge_ip is set)
+
+    // User-mode networking (net_user.c). Set before clone() so the child
+    // knows to skip the veth configuration.
+    net_user_mode_t user_mode;                 // Helper that runs (never
+                                               // AUTO once started)
+    pid_t user_helper_pid;                     // 0 = none running
+    int   user_helper_fd;                      // pasta: its pidfd;
+                                               // slirp4netns: --exit-fd
+                                               // write end (only while
+                                               // user_helper_pid != 0)
 } net_context_t;
 
 /**
@@ -51,6 +163,23 @@ typedef struct {
  */
 const char *find_ip_binary(void);
 
+/**
+ * Parse a CIDR suffix string ("24") as stored in veth_config_t.netmask.
+ *
+ * @return  Prefix length 0-32, or -1 if not a valid suffix
+ */
+int net_parse_prefix_len(const char *netmask);
+
+/**
+ * Parse a --publish value: [host_ip:]host_port:container_port[/tcp|/udp]
+ * (tcp if no protocol is given).
+ *
+ * @param arg  Value to parse
+ * @param out  Out: the parsed entry
+ * @return     0 on success, -1 if arg is malformed
+ */
+int net_parse_publish(const char *arg, net_publish_t *out);
+
 /**
  * Generate unique veth pair names. Called BEFORE clone() so the names are
  * baked into child_args (which the child reads after the sync pipe).
@@ -60,8 +189,10 @@ const char *find_ip_binary(void);
  * fields.
  *
  * @param ctx  Network context to populate
+ * @param id   Container ID the names are formatted from (id.h);
+ *             0 = draw one
  */
-void generate_veth_names(net_context_t *ctx);
+void generate_veth_names(net_context_t *ctx, uint64_t id);
 
 /**
  * Setup veth pair (host side). Called by PARENT after clone(), before
@@ -71,6 +202,24 @@ void generate_veth_names(net_context_t *ctx);
  * child's netns, configure host IP, bring host end up, (optionally)
  * enable NAT and record source CIDR in ctx->nat_source_cidr.
  *
+ * When ctx->pooled (net_pool_claim() ran before clone), the pair and the
+ * child's netns already exist and only the host subnet route is added —
+ * see net_pool_attach(). A pod member (net_pod_join()) does no host work
+ * at all; a pod's first container registers the pod once its network is
+ * up (net_pod_register()). With veth->bridge set, the host end is
+ * enslaved to that bridge (created on first use, see net_bridge.h)
+ * instead of being addressed, and no per-container NAT rule is added.
+ * Each veth->publish entry gets a DNAT rule pair (nat PREROUTING for
+ * traffic from outside, nat OUTPUT for the host's own connections), so
+ * published ports are forwarded by the kernel with no proxy process; a
+ * rule that cannot be added fails the setup.
+ *
+ * With the netlink backend the create + netns move + link up collapse
+ * into one RTM_NEWLINK (peer carries IFLA_NET_NS_PID), followed by one
+ * RTM_NEWADDR. veth->backend selects the backend; ctx->backend records
+ * the one that actually ran. With enable_debug the elapsed time is
+ * printed so the two backends can be compared.
+ *
  * @param ctx           Network context (in: veth names; out: created/nat flags)
  * @param veth          Veth configuration (IPs, netmask, NAT flag)
  * @param child_pid     PID of clone'd child (for `ip link set ... netns <pid>`)
@@ -80,12 +229,29 @@ void generate_veth_names(net_context_t *ctx);
 int setup_net(net_context_t *ctx, const veth_config_t *veth,
               pid_t child_pid, bool enable_debug);
 
+/**
+ * Take over a veth pair someone else created with ctx's names, its
+ * container end already in the container's netns (a CRIU restore):
+ * configure the host end and NAT as setup_net() would. The pair is
+ * deleted by cleanup_net() afterwards.
+ *
+ * @param ctx           Network context (in: veth names)
+ * @param veth          Veth configuration (host IP, netmask, NAT flag)
+ * @param enable_debug  Enable [network] debug output
+ * @return              0 on success, -1 on failure (pair deleted)
+ */
+int net_adopt_host(net_context_t *ctx, const veth_config_t *veth,
+                   bool enable_debug);
+
 /**
  * Configure network inside the container. Called by CHILD, after the
  * sync pipe unblocks (parent has moved veth_c into our netns).
  *
  * Steps: ip link set lo up, ip addr add to veth_c, ip link set veth_c up,
- * ip route add default via host_ip.
+ * ip route add default via host_ip. With the netlink backend all four
+ * are sent as a single rtnetlink batch, so the rootfs does not need an
+ * `ip` binary. A pooled child instead joins its pre-configured netns
+ * (net_pool_enter), and a pod member the pod's (net_pod_enter).
  *
  * @param ctx           Network context (read: veth_container name)
  * @param veth          Veth configuration (IPs, netmask)
@@ -98,8 +264,12 @@ int configure_container_net(const net_context_t *ctx,
 
 /**
  * Cleanup veth pair and NAT rules. Called after waitpid(). Self-contained:
- * uses ctx->nat_source_cidr (stored by setup_net) so it does not need the
- * original veth_config_t.
+ * uses ctx->nat_source_cidr and ctx->published (stored by setup_net) so
+ * it does not need the original veth_config_t. A pooled slot is handed back with
+ * net_pool_release(), which leaves the pair to die with its netns. A pod
+ * member only drops its reference (net_pod_leave()); the last one out
+ * deletes the pod's pair and NAT rule. A bridged container's address
+ * lease is dropped last.
  *
  * @param ctx           Network context
  * @param enable_debug  Enable [network] debug output
@@ -0,0 +1,70 @@
+#ifndef NET_BRIDGE_H
+#define NET_BRIDGE_H
+
+// NOTE: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include <stdbool.h>
+#include <stddef.h>
+#include "net.h"   // veth_config_t, net_context_t
+
+/**
+ * Host-bridge networking: every container's host veth end is enslaved
+ * to one bridge that carries veth.host_ip/netmask, instead of each end
+ * carrying its own copy of the host address.
+ *
+ * The bridge and its NAT rule are set up once, by whichever start first
+ * finds the bridge missing: one `MASQUERADE -s <subnet> ! -o <bridge>`
+ * rule covers every container on it. Starts and stops after that do no
+ * iptables work at all, so the POSTROUTING chain stays one rule long
+ * and concurrent starts never queue on the xtables lock. The bridge and
+ * the rule outlive the last container; `ip link del <bridge>` removes
+ * the bridge.
+ *
+ * Containers on one bridge share a subnet, so each needs its own
+ * address. net_bridge_lease() hands out the lowest free host address of
+ * the subnet (skipping host_ip). A lease is an flock() on
+ * NET_BRIDGE_DIR/<bridge>/<ip>.lock held for the container's lifetime,
+ * so concurrent minicontainer processes never get the same address, and
+ * a crashed owner's address frees itself.
+ *
+ * Requires the netlink backend.
+ */
+#define NET_BRIDGE_DIR      "/run/minicontainer/bridge"
+#define NET_BRIDGE_DEFAULT  "mcbr0"
+#define NET_BRIDGE_MAX_SCAN 4096   // Addresses tried per lease
+
+/**
+ * Create veth->bridge (up, addressed with host_ip/netmask) unless it
+ * already exists.
+ *
+ * @param veth          Veth configuration (bridge, host_ip, netmask)
+ * @param created       Out: this call created the bridge
+ * @param enable_debug  Enable [bridge] debug output
+ * @return              Bridge ifindex, or -1 on failure
+ */
+int net_bridge_ensure(const veth_config_t *veth, bool *created,
+                      bool enable_debug);
+
+/**
+ * The bridge's subnet in CIDR form, e.g. "10.0.0.0/24".
+ *
+ * @return  0 on success, -1 if host_ip/netmask do not parse
+ */
+int net_bridge_subnet(const veth_config_t *veth, char *out, size_t size);
+
+/**
+ * Lease a container address on veth->bridge: veth->container_ip if set,
+ * else the lowest free one. Sets ctx->bridge_ip and holds the lease in
+ * ctx->lease_fd until net_bridge_release().
+ *
+ * @return  0 on success, -1 if the address is taken or none is free
+ */
+int net_bridge_lease(net_context_t *ctx, const veth_config_t *veth,
+                     bool enable_debug);
+
+/**
+ * Drop ctx's address lease. Idempotent.
+ */
+void net_bridge_release(net_context_t *ctx);
+
+#endif // NET_BRIDGE_H
@@ -0,0 +1,97 @@
+#ifndef NET_POD_H
+#define NET_POD_H
+
+// NOTE: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include <stdbool.h>
+#include "net.h"   // net_context_t, NET_POD_NAME_MAX
+
+/**
+ * Pod mode: containers that share one network namespace.
+ *
+ * The first container started with veth.pod = "<name>" builds its netns
+ * and veth pair as usual (setup_net / configure_container_net); its
+ * netns is then pinned by a bind mount at NET_POD_DIR/<name>.ns, so it
+ * outlives that container. Later members skip generate_veth_names,
+ * setup_net and configure_container_net entirely: the child joins the
+ * pinned netns with one setns() instead of CLONE_NEWNET, the same way a
+ * pooled slot is entered (net_pool.h).
+ *
+ * NET_POD_DIR/<name>.lock holds the pod state under an flock():
+ *
+ *   refs <n>          members currently running
+ *   veth <host-end>   the pair and NAT rule the last member deletes
+ *   backend <n>
+ *   nat <cidr>
+ *
+ * The reference count lives in that file rather than in memory because
+ * members are usually separate minicontainer processes. A member that
+ * dies without cleanup_net() leaks its reference; the pod then stays up
+ * until its .ns pin is unmounted by hand.
+ *
+ * Lifecycle:
+ *   net_pod_join()     — before clone(): join a live pod, or become its
+ *                        creator (the lock stays held)
+ *   net_pod_register() — parent, end of setup_net(): pin the creator's
+ *                        netns and publish the state with refs 1
+ *   net_pod_enter()    — member's child: setns() into the pod's netns
+ *   net_pod_leave()    — from cleanup_net(): drop our reference; only the
+ *                        last member goes on to delete the pair and NAT
+ *
+ * Members share the creator's addresses: their own veth_config_t
+ * addresses are not used. Requires CAP_SYS_ADMIN over the pod's netns, so
+ * a container with its own user namespace never creates or joins a pod.
+ */
+#define NET_POD_DIR  "/run/minicontainer/pods"
+
+/**
+ * Check a pod name: 1..NET_POD_NAME_MAX-1 characters from [A-Za-z0-9_.-],
+ * not starting with '.'.
+ *
+ * @return  true when usable as a file name under NET_POD_DIR
+ */
+bool net_pod_name_valid(const char *name);
+
+/**
+ * Join pod `name`, or claim the right to create it. Member: sets
+ * ctx->pod_member, ctx->netns_fd and the pod's veth names, and bumps the
+ * reference count. Creator: leaves the pod lock held in ctx (concurrent
+ * starts of the same pod wait for it) and returns 1; the caller then
+ * generates veth names and builds the network as usual.
+ *
+ * @param ctx           Network context (out)
+ * @param name          Pod name (net_pod_name_valid)
+ * @param enable_debug  Enable [pod] debug output
+ * @return              0 joined, 1 creating, -1 on failure
+ */
+int net_pod_join(net_context_t *ctx, const char *name, bool enable_debug);
+
+/**
+ * Creator, once its network is up: pin child_pid's netns at
+ * NET_POD_DIR/<name>.ns, write the state with refs 1, drop the lock.
+ *
+ * @return  0 on success, -1 on failure (the lock is still held;
+ *          cleanup_net() releases it)
+ */
+int net_pod_register(net_context_t *ctx, pid_t child_pid, bool enable_debug);
+
+/**
+ * Member's child: join the pod's netns. Replaces CLONE_NEWNET and
+ * configure_container_net().
+ *
+ * @return  0 on success, -1 on failure
+ */
+int net_pod_enter(const net_context_t *ctx, bool enable_debug);
+
+/**
+ * Drop ctx's reference. With members left, ctx's pair/NAT flags are
+ * cleared so the caller deletes nothing. As the last member (or a
+ * creator that never registered), the pin is removed and ctx is loaded
+ * with the pod's pair and NAT rule for the caller to delete.
+ * Idempotent.
+ *
+ * @return  true if the caller should tear the network down
+ */
+bool net_pod_leave(net_context_t *ctx, bool enable_debug);
+
+#endif // NET_POD_H
@@ -0,0 +1,108 @@
+#ifndef NET_POOL_H
+#define NET_POOL_H
+
+// NOTE: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include <stdbool.h>
+#include "net.h"   // veth_config_t, net_context_t
+
+/**
+ * Pre-created network pool.
+ *
+ * Each slot is a complete container network built ahead of time: a
+ * network namespace pinned by a bind mount at NET_POOL_DIR/slot<N>.ns,
+ * holding the mcp_c_<N> end of a veth pair already addressed, up and
+ * routed (default via host_ip), with mcp_h_<N> up and addressed in the
+ * host netns. The host address is added with IFA_F_NOPREFIXROUTE so idle
+ * slots never shadow a live container's subnet route.
+ *
+ * The pool pre-builds the whole netns rather than just the pair because
+ * moving an existing device between namespaces (`ip link set netns`)
+ * costs ~10 ms in the kernel (RCU grace periods), far more than creating
+ * the pair with its peer already in place. A claimed start therefore
+ * does no link work at all: the child joins the slot's netns with one
+ * setns() instead of CLONE_NEWNET, and the parent adds one route.
+ *
+ * Slot ownership is an flock() on NET_POOL_DIR/slot<N>.lock, so
+ * concurrent minicontainer processes never claim the same slot and a
+ * crashed owner releases its claim automatically. The lock file also
+ * records the addresses the slot was built for.
+ *
+ * Lifecycle:
+ *   net_pool_claim()   — before clone(): lock an idle slot, open its
+ *                        netns, bake the names into ctx
+ *   net_pool_attach()  — parent, after clone(): add the subnet route
+ *   net_pool_enter()   — child: setns() into the slot's netns
+ *   net_pool_release() — after waitpid(): drop the route and the pin;
+ *                        the used netns (and the pair in it) is freed by
+ *                        the kernel, never handed to another container
+ *   net_pool_refill()  — rebuild empty slots (normally detached via
+ *                        net_pool_refill_async())
+ *   net_pool_drain()   — tear down every unclaimed slot
+ *
+ * Requires CAP_SYS_ADMIN over the host netns, so a container with its own
+ * user namespace cannot join a pooled netns; core.c skips the pool then.
+ */
+#define NET_POOL_DIR       "/run/minicontainer/netpool"
+#define NET_POOL_MAX_SLOTS 64
+
+/**
+ * Claim an idle slot built for veth's host_ip/container_ip/netmask.
+ * On success populates ctx->veth_host / veth_container, ctx->netns_fd
+ * and the pool fields; sets *needs_refill when fewer than pool.low_water
+ * idle slots remain after the claim (or none was available).
+ *
+ * @param ctx           Network context (out)
+ * @param veth          Veth configuration (pool sizing, addresses)
+ * @param needs_refill  Out: caller should kick net_pool_refill_async()
+ * @param enable_debug  Enable [netpool] debug output
+ * @return              0 on success, -1 if no idle slot is available
+ */
+int net_pool_claim(net_context_t *ctx, const veth_config_t *veth,
+                   bool *needs_refill, bool enable_debug);
+
+/**
+ * Parent side: install the host subnet route for the claimed slot.
+ *
+ * @return  0 on success, -1 on failure
+ */
+int net_pool_attach(net_context_t *ctx, const veth_config_t *veth,
+                    bool enable_debug);
+
+/**
+ * Child side: join the claimed slot's netns. Replaces both CLONE_NEWNET
+ * and configure_container_net()'s rtnetlink batch.
+ *
+ * @return  0 on success, -1 on failure
+ */
+int net_pool_enter(const net_context_t *ctx, bool enable_debug);
+
+/**
+ * Release a claimed slot: remove its subnet route, unpin its netns and
+ * mark it empty for the refiller. Idempotent.
+ */
+void net_pool_release(net_context_t *ctx, bool enable_debug);
+
+/**
+ * Build slots until veth->pool.size idle ones exist. Runs synchronously
+ * in the calling process (briefly unshare()s and setns()es back per
+ * slot); used by net_pool_refill_async() and for warm-up.
+ *
+ * @return  Number of idle slots after the refill, -1 on setup failure
+ */
+int net_pool_refill(const veth_config_t *veth, bool enable_debug);
+
+/**
+ * Tear down every slot not currently claimed (pairs, netns pins and
+ * state). Claimed slots are skipped; their owners release them normally.
+ */
+void net_pool_drain(bool enable_debug);
+
+/**
+ * Run net_pool_refill() in a detached grandchild so the caller's start
+ * path does not wait for it. The intermediate child is reaped here; the
+ * grandchild is reparented to init.
+ */
+void net_pool_refill_async(const veth_config_t *veth, bool enable_debug);
+
+#endif // NET_POOL_H
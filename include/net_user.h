@@ -0,0 +1,86 @@
+#ifndef NET_USER_H
+#define NET_USER_H
+
+// NOTE: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include <stdbool.h>
+#include <sys/types.h>
+#include "net.h"   // net_user_mode_t, veth_config_t, net_context_t
+
+/**
+ * Rootless networking: instead of a veth pair (root-only), a user-mode
+ * network helper joins the container's user and network namespaces,
+ * creates a tap device there, configures it and forwards the container's
+ * traffic through ordinary host sockets. Nothing on the host side needs
+ * privilege: no veth, no iptables, no route.
+ *
+ * Two helpers are supported, run by fork+execv like ip(8) and criu:
+ *
+ *   pasta        Preferred. Translates tap frames to host sockets with
+ *                batched recvmmsg/sendmmsg, and moves data between
+ *                paired sockets with splice() (no copy through user
+ *                space) where both ends are local, so throughput is not
+ *                the usual slirp bottleneck. It copies the host's
+ *                addresses and routes into the namespace and
+ *                daemonizes once configured; we keep a pidfd to it.
+ *   slirp4netns  Fallback. A libslirp stack on tap0 at 10.0.2.100/24,
+ *                gateway 10.0.2.2. Stays our child; announces itself on
+ *                --ready-fd and exits when the write end of its
+ *                --exit-fd pipe closes, so it cannot outlive a crashed
+ *                runtime.
+ *
+ * Published ports (veth.publish) are pasta -t/-u forwards; slirp4netns
+ * refuses them. The addresses come from the helper, not from
+ * veth.host_ip/container_ip. Runs in the parent after the uid/gid maps
+ * are written (the helper's tap belongs to the mapped root), before the
+ * child is released from the sync pipe.
+ */
+#define PASTA_USR_BIN           "/usr/bin/pasta"
+#define PASTA_USR_LOCAL_BIN     "/usr/local/bin/pasta"
+#define SLIRP4NETNS_USR_BIN     "/usr/bin/slirp4netns"
+#define SLIRP4NETNS_USR_LOCAL_BIN "/usr/local/bin/slirp4netns"
+#define NET_USER_READY_MS       5000   // Helper start-up budget
+#define NET_USER_SLIRP_MTU      "65520"
+
+/**
+ * Locate the helper binary for a mode.
+ *
+ * @param want  NET_USER_AUTO, NET_USER_PASTA or NET_USER_SLIRP4NETNS
+ * @param got   Out: the mode found (AUTO resolves to PASTA or SLIRP4NETNS)
+ * @return      Static path, or NULL if not installed
+ */
+const char *net_user_find(net_user_mode_t want, net_user_mode_t *got);
+
+/**
+ * @return  "pasta", "slirp4netns", "auto" or "none"
+ */
+const char *net_user_mode_name(net_user_mode_t mode);
+
+/**
+ * Start the helper for child_pid's namespaces and wait until it has the
+ * container's interface configured. Called from setup_net() when
+ * veth->user_mode is set.
+ *
+ * @param ctx           Network context (out: user_mode, helper pid/fd)
+ * @param veth          Veth configuration (user_mode)
+ * @param child_pid     Container (or zygote) whose namespaces to serve
+ * @param enable_debug  Enable [netuser] debug output
+ * @return              0 on success, -1 on failure (no helper left)
+ */
+int net_user_start(net_context_t *ctx, const veth_config_t *veth,
+                   pid_t child_pid, bool enable_debug);
+
+/**
+ * Child side, from configure_container_net(): the helper configured the
+ * tap, so only bring up lo.
+ *
+ * @return  0 on success, -1 on failure
+ */
+int net_user_enter(const net_context_t *ctx, bool enable_debug);
+
+/**
+ * Stop the helper. Idempotent; called from cleanup_net().
+ */
+void net_user_stop(net_context_t *ctx, bool enable_debug);
+
+#endif // NET_USER_H
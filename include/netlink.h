@@ -0,0 +1,116 @@
+#ifndef NETLINK_H
+#define NETLINK_H
+
+// NOTE: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <linux/netlink.h>
+
+/**
+ * Size of one rtnetlink batch. Every request we build (veth pair with
+ * nested peer info, a handful of addr/route messages) fits in well
+ * under 1 KiB; 4 KiB leaves headroom without touching the heap.
+ */
+#define NL_BATCH_SIZE 4096
+
+/**
+ * A batch of rtnetlink requests sent with ONE sendmsg() call. The
+ * kernel processes the messages in order and ACKs each one
+ * (NLM_F_ACK), so a batch replaces a sequence of `ip` invocations
+ * with a single round trip and no child processes.
+ *
+ * Zero-initialize (or call nl_batch_init) before use.
+ */
+typedef struct {
+    char     buf[NL_BATCH_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+    size_t   len;        // Bytes used in buf
+    unsigned count;      // Messages in the batch
+    bool     overflow;   // Set if any append did not fit
+} nl_batch_t;
+
+/**
+ * Open a NETLINK_ROUTE socket in the caller's network namespace.
+ * The socket is SOCK_CLOEXEC so it never leaks into execve'd children.
+ *
+ * @return  Socket fd on success, -1 on failure (errno set)
+ */
+int nl_open(void);
+
+/**
+ * Reset a batch to empty.
+ */
+void nl_batch_init(nl_batch_t *b);
+
+/**
+ * Send every message in the batch and collect one ACK per message.
+ *
+ * @param fd     Socket from nl_open()
+ * @param b      Batch to send
+ * @return       0 if every message was ACKed with error 0; otherwise
+ *               the negated errno of the FIRST failing message
+ */
+int nl_batch_exchange(int fd, const nl_batch_t *b);
+
+/**
+ * Append RTM_NEWLINK creating a veth pair. The new host end gets
+ * `host_name`; the peer gets `peer_name` and is created directly
+ * inside the network namespace of `peer_ns_pid` (IFLA_NET_NS_PID on
+ * the peer), which folds `ip link add` and `ip link set netns` into
+ * one message. With peer_ns_pid <= 0, a peer_ns_fd >= 0 names the
+ * namespace by fd instead (IFLA_NET_NS_FD); pass -1 for both to leave
+ * the peer in the caller's namespace. When `up` is true the host end
+ * is created IFF_UP.
+ */
+int rtnl_add_veth(nl_batch_t *b, const char *host_name,
+                  const char *peer_name, pid_t peer_ns_pid, int peer_ns_fd,
+                  bool up);
+
+/**
+ * Append RTM_NEWLINK creating bridge `name` (IFF_UP when `up`). Fails
+ * with EEXIST if the bridge is already there.
+ */
+int rtnl_add_bridge(nl_batch_t *b, const char *name, bool up);
+
+/**
+ * Append RTM_NEWLINK (no NLM_F_CREATE) enslaving `ifname` to the bridge
+ * at `master_ifindex` (IFLA_MASTER; `ip link set <if> master <br>`).
+ */
+int rtnl_set_master(nl_batch_t *b, const char *ifname, unsigned master_ifindex);
+
+/**
+ * Append RTM_NEWLINK (no NLM_F_CREATE) that brings `ifname` up.
+ */
+int rtnl_set_link_up(nl_batch_t *b, const char *ifname);
+
+/**
+ * Append RTM_NEWADDR assigning `ip`/`prefix_len` to interface `ifindex`.
+ * `ifa_flags` is sent as IFA_FLAGS (e.g. IFA_F_NOPREFIXROUTE); pass 0
+ * for the plain `ip addr add` behavior.
+ */
+int rtnl_add_addr(nl_batch_t *b, unsigned ifindex, const char *ip,
+                  unsigned prefix_len, unsigned ifa_flags);
+
+/**
+ * Append RTM_NEWROUTE (add=true) or RTM_DELROUTE (add=false) for the
+ * connected subnet route `ip`/`prefix_len` out of `ifindex` — the route
+ * the kernel would have installed itself without IFA_F_NOPREFIXROUTE.
+ */
+int rtnl_subnet_route(nl_batch_t *b, bool add, const char *ip,
+                      unsigned prefix_len, unsigned ifindex);
+
+/**
+ * Append RTM_NEWROUTE installing a default route via `gateway` out of
+ * interface `ifindex` in the main table.
+ */
+int rtnl_add_default_route(nl_batch_t *b, const char *gateway,
+                           unsigned ifindex);
+
+/**
+ * Append RTM_DELLINK deleting `ifname` (deleting either end of a veth
+ * removes the pair).
+ */
+int rtnl_del_link(nl_batch_t *b, const char *ifname);
+
+#endif // NETLINK_H
@@ -6,28 +6,62 @@
 
 #include <sched.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <limits.h>
 
+/**
+ * Workspace cache, kept in <container_dir>/.cache:
+ *
+ *   free/<name>   empty upper/work/merged triples, ready to claim
+ *   trash/<id>    used triples waiting for the background reaper
+ *
+ * prepare_overlay() claims a free triple with one rename() into
+ * <container_dir>/<id> and only falls back to mkdir when none is left.
+ * teardown_overlay() never walks a tree: a triple the container wrote
+ * nothing to is reset (overlayfs's work/work removed) and renamed back
+ * into free/; a dirty one is renamed into trash/ and deleted by a
+ * detached reaper, which also tops free/ up to OVERLAY_CACHE_WARM.
+ * Claims race only on rename(), so concurrent runtimes sharing a
+ * container_dir are safe; the reaper serialises on flock(.cache/.lock).
+ *
+ * The triples are empty, so one cache serves every rootfs (the lowerdir
+ * is only named in the mount options).
+ */
+#define OVERLAY_CACHE_DIR   ".cache"
+#define OVERLAY_CACHE_WARM  4
+
 /**
  * Overlay mount context (for setup and teardown).
+ *
+ * The paths are pointers, not buffers. lower_path and cache_path are
+ * interned (intern.h): every container of one image and container_dir
+ * shares them. The four workspace paths live in one exact-size block
+ * owned by the context, allocated by prepare_overlay() and freed by
+ * teardown_overlay(); container_base is NULL when there is none. A copy
+ * of the struct shares the block, so tear down only one of them.
  */
 typedef struct {
-    char container_id[13];
-    char lower_path[PATH_MAX];
-    char container_base[PATH_MAX];
-    char upper_path[PATH_MAX];
-    char work_path[PATH_MAX];
-    char merged_path[PATH_MAX];
+    uint64_t id;                 // In: container ID (id.h); 0 = draw one
+    char container_id[13];       // Its low 48 bits, in hex
+    const char *lower_path;      // One dir, or "top:...:base" layers
+    const char *cache_path;      // <container_dir>/.cache
+    char *container_base;        // Start of the block: base, then
+    const char *upper_path;      //   base/upper,
+    const char *work_path;       //   base/work and
+    const char *merged_path;     //   base/merged
+    bool from_cache;             // Triple was claimed from cache free/
     bool is_mounted;
 } overlay_context_t;
 
 /**
  * Setup overlay filesystem.
- * Creates directories and mounts overlayfs with MS_NODEV | MS_NOSUID.
+ * Claims (or creates) the directories and mounts overlayfs with
+ * MS_NODEV | MS_NOSUID.
  *
  * @param ctx          Overlay context (populated on success)
- * @param rootfs_path  Path to base image (lowerdir)
+ * @param rootfs_path  Path to base image (lowerdir), or a colon-separated
+ *                     layer list, topmost first (image_resolve())
  * @param container_dir Parent directory for overlay data
  * @param enable_debug Enable debug output
  * @return             0 on success, -1 on failure
@@ -35,9 +69,68 @@ typedef struct {
 int setup_overlay(overlay_context_t *ctx, const char *rootfs_path,
                   const char *container_dir, bool enable_debug);
 
+/**
+ * First half of setup_overlay(): resolve paths and claim a cached (or
+ * create a fresh) upper/work/merged triple, without mounting. Used when the mount
+ * has to happen in another mount namespace (a serve zygote, whose mount
+ * namespace predates the request, never sees mounts made in the
+ * daemon's). teardown_overlay() handles a never-mounted context.
+ *
+ * @param ctx          Overlay context (populated on success)
+ * @param rootfs_path  Path to base image (lowerdir), or a colon-separated
+ *                     layer list, topmost first (image_resolve())
+ * @param container_dir Parent directory for overlay data
+ * @param enable_debug Enable debug output
+ * @return             0 on success, -1 on failure
+ */
+int prepare_overlay(overlay_context_t *ctx, const char *rootfs_path,
+                    const char *container_dir, bool enable_debug);
+
+/**
+ * Point a zeroed ctx at a workspace prepared elsewhere, from its paths
+ * alone: for a process that cannot use the preparer's pointers (a serve
+ * zygote, cloned before the paths were made). Enough for
+ * mount_overlay(); the preparer keeps ownership of the directories.
+ *
+ * @param ctx   Overlay context (zero-initialized)
+ * @param lower Resolved lowerdir list (ctx->lower_path of the preparer)
+ * @param base  Workspace directory (ctx->container_base of the preparer)
+ * @return      0 on success, -1 on failure
+ */
+int overlay_context_adopt(overlay_context_t *ctx, const char *lower,
+                          const char *base);
+
+/**
+ * Second half of setup_overlay(): mount the prepared overlay at
+ * ctx->merged_path in the caller's mount namespace (overlay_fsmount() +
+ * move_mount(), or mount(2) on kernels without the fd API).
+ *
+ * @param ctx          Overlay context from prepare_overlay
+ * @param enable_debug Enable debug output
+ * @return             0 on success, -1 on failure
+ */
+int mount_overlay(overlay_context_t *ctx, bool enable_debug);
+
+/**
+ * Build the prepared overlay as a detached mount (fsopen/fsconfig/
+ * fsmount) without attaching it anywhere. The caller attaches it with
+ * move_mount() — in any mount namespace, e.g. a child's, via
+ * setup_rootfs_fd() — or closes it. A never-attached overlay is gone
+ * once the last fd is closed, so teardown_overlay() still sees
+ * is_mounted == false.
+ *
+ * @param ctx          Overlay context from prepare_overlay
+ * @param enable_debug Enable debug output
+ * @return             Mount fd (O_CLOEXEC), or -1 (errno ENOSYS: no fd
+ *                     mount API, use mount_overlay())
+ */
+int overlay_fsmount(overlay_context_t *ctx, bool enable_debug);
+
 /**
  * Teardown overlay filesystem.
- * Unmounts overlayfs and removes directories.
+ * Unmounts overlayfs and hands the directories back to the workspace
+ * cache (recycled if clean, else queued for the reaper). Idempotent:
+ * frees the workspace paths and clears ctx->container_base.
  *
  * @param ctx          Overlay context from setup_overlay
  * @param enable_debug Enable debug output
@@ -0,0 +1,70 @@
+#ifndef SECCOMP_H
+#define SECCOMP_H
+
+// NOTE: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include <stdbool.h>
+#include <stdint.h>
+#include <linux/filter.h>   // struct sock_filter
+
+/**
+ * Syscall filtering (--seccomp): a profile is compiled to a classic BPF
+ * program in the parent, before clone(), and child_func() installs it
+ * with SECCOMP_SET_MODE_FILTER | SECCOMP_FILTER_FLAG_TSYNC as the last
+ * step before execve(). No libseccomp; the filter is built here, just as
+ * netlink.c speaks rtnetlink without libnl.
+ *
+ * A profile is text, one rule per line ('#' starts a comment):
+ *
+ *   default <action>            Action for every syscall not listed
+ *   <action> <name> [<name>..]  Action for the named syscalls
+ *
+ * with <action> one of allow, errno (fails with EPERM), log (allowed
+ * and audit-logged) or kill (the whole process). A later rule for the
+ * same syscall wins. An unknown name is an error unless written ?name,
+ * which is skipped on architectures without that call. A default-deny
+ * profile must allow execve itself.
+ *
+ * SECCOMP_PROFILE_DEFAULT names the built-in profile: allow everything
+ * except kernel/module/clock administration, mount and namespace
+ * changes, tracing, keyrings and the like (close to Docker's default).
+ *
+ * The compiled program dispatches on the syscall number by binary
+ * search over runs of equal action — O(log runs) comparisons for any
+ * call, so a hot read/write/futex pays a handful of instructions. A
+ * foreign audit arch (32-bit compat entry) and x32 numbers are killed.
+ *
+ * Programs are cached by a hash of the profile text for the life of the
+ * process: a daemon compiles each profile once, and its zygotes get the
+ * compiled program in their request.
+ */
+#define SECCOMP_PROFILE_DEFAULT "default"
+#define SECCOMP_MAX_INSNS       1024   // Per program (kernel limit: 4096)
+#define SECCOMP_PROFILE_MAX     65536  // Bytes of profile text
+
+typedef struct {
+    uint16_t len;                      // Instructions used
+    struct sock_filter insns[SECCOMP_MAX_INSNS];
+} seccomp_program_t;
+
+/**
+ * Compile a profile, or return the cached program for the same text.
+ *
+ * @param profile       SECCOMP_PROFILE_DEFAULT or a profile file path
+ * @param enable_debug  Report compile/cache hits ([seccomp])
+ * @return              Program valid until exit, or NULL on a bad
+ *                      profile (reported on stderr)
+ */
+const seccomp_program_t *seccomp_compile(const char *profile,
+                                         bool enable_debug);
+
+/**
+ * Install prog on the calling process (and, with TSYNC, all its
+ * threads). Root in the container's user namespace may install it
+ * without no_new_privs; otherwise no_new_privs is set first.
+ *
+ * @return  0 on success, -1 on failure
+ */
+int seccomp_install(const seccomp_program_t *prog, bool enable_debug);
+
+#endif // SECCOMP_H
@@ -0,0 +1,129 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+// NOTE: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include <stdbool.h>
+#include <stdint.h>
+#include "core.h"   // container_config_t, container_zygote_t
+
+/**
+ * `minicontainer serve`: a long-running daemon that starts containers on
+ * behalf of `minicontainer --connect` clients.
+ *
+ * A client sends one RUN request — the spec_encode()d config plus its
+ * stdin/stdout/stderr over SCM_RIGHTS — on a SOCK_SEQPACKET connection,
+ * gets a STARTED reply once the container reaches execve(), and an EXITED
+ * reply with its status. Closing the connection early kills the
+ * container. A STATS request returns start-latency percentiles.
+ *
+ * The daemon keeps up to `zygotes` children pre-cloned into the namespace
+ * sets recently asked for (container_zygote_spawn), so a warm start skips
+ * the process bootstrap, clone() and uid/gid mapping. Start latency is
+ * measured from request receipt to the zygote's exec signal.
+ *
+ * The socket is created mode 0600 and peers must have the daemon's uid:
+ * a request is a root-equivalent operation.
+ */
+#define SERVE_SOCKET_PATH   "/run/minicontainer/serve.sock"
+#define SERVE_MAX_ZYGOTES   16
+#define SERVE_MAX_CLIENTS   256
+#define SERVE_STATS_WINDOW  1024   // Latency samples kept for percentiles
+
+#define SERVE_MAGIC         0x5653434dU   // "MCSV" little-endian
+
+typedef enum {
+    SERVE_MSG_RUN = 1,      // client -> daemon: spec blob follows
+    SERVE_MSG_STATS,        // client -> daemon: no payload
+    SERVE_MSG_STARTED,      // daemon -> client: start_ns valid
+    SERVE_MSG_EXITED,       // daemon -> client: status fields valid
+    SERVE_MSG_STATS_REPLY,  // daemon -> client: stats valid
+    SERVE_MSG_ERROR         // daemon -> client: request failed
+} serve_msg_type_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t type;          // serve_msg_type_t
+} serve_msg_hdr_t;
+
+/**
+ * Start-latency summary over the last SERVE_STATS_WINDOW starts.
+ */
+typedef struct {
+    uint64_t count;         // Starts since the daemon came up
+    uint32_t window;        // Samples the percentiles are computed over
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t max_ns;
+    uint64_t zygote_hits;   // Starts served by an already-parked zygote
+} serve_stats_t;
+
+/**
+ * Every daemon -> client message.
+ */
+typedef struct {
+    serve_msg_hdr_t hdr;
+    int32_t  exit_status;
+    int32_t  signal;
+    bool     exited_normally;
+    bool     warm;          // Served by a parked zygote
+    uint64_t start_ns;      // Request receipt -> execve
+    serve_stats_t stats;
+} serve_reply_t;
+
+typedef struct {
+    const char *socket_path;   // NULL = SERVE_SOCKET_PATH
+    unsigned    zygotes;       // Parked zygotes to keep (<= SERVE_MAX_ZYGOTES)
+    const char *events_path;   // Lifecycle event ring file (events.h);
+                               // NULL = none. Left in place on exit
+    bool        enable_debug;
+} serve_config_t;
+
+/**
+ * Run the daemon until SIGINT/SIGTERM. Running containers are killed and
+ * cleaned up on the way out.
+ *
+ * @param config  Daemon configuration
+ * @return        0 on clean shutdown, -1 if the socket could not be set up
+ */
+int serve_run(const serve_config_t *config);
+
+/**
+ * Client: run config in the daemon at socket_path with this process's
+ * stdio and wait for it to exit. config->rootfs_path and
+ * config->container_dir must be absolute (the daemon's cwd is not ours).
+ *
+ * @param socket_path  Daemon socket (NULL = SERVE_SOCKET_PATH)
+ * @param config       Container configuration
+ * @param reply        Out: the EXITED reply
+ * @return             0 on success, -1 if the daemon is unreachable or
+ *                     refused the request
+ */
+int serve_client_exec(const char *socket_path, const container_config_t *config,
+                      serve_reply_t *reply);
+
+/**
+ * Client: as serve_client_exec(), with a spec already encoded (a
+ * spec_map() of a compiled spec file), sent as is.
+ *
+ * @param socket_path  Daemon socket (NULL = SERVE_SOCKET_PATH)
+ * @param spec         Encoded spec, not decoded
+ * @param spec_len     Its length
+ * @param reply        Out: the EXITED reply
+ * @return             0 on success, -1 if the daemon is unreachable or
+ *                     refused the request
+ */
+int serve_client_exec_spec(const char *socket_path, const void *spec,
+                           size_t spec_len, serve_reply_t *reply);
+
+/**
+ * Client: fetch start-latency statistics.
+ *
+ * @param socket_path  Daemon socket (NULL = SERVE_SOCKET_PATH)
+ * @param stats        Out: statistics
+ * @return             0 on success, -1 on failure
+ */
+int serve_client_stats(const char *socket_path, serve_stats_t *stats);
+
+#endif // SERVE_H
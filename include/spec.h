@@ -0,0 +1,110 @@
+#ifndef SPEC_H
+#define SPEC_H
+
+// NOTE: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include <stddef.h>
+#include <stdint.h>
+#include "core.h"   // container_config_t
+
+/**
+ * Flat, position-independent encoding of a container_config_t — the wire
+ * format between `minicontainer --connect` clients, the `serve` daemon
+ * and its zygotes.
+ *
+ * Layout: spec_header_t, then the argv and envp slot tables (8-byte
+ * aligned, one uintptr_t per entry plus a terminating 0), then the
+ * string table. Every pointer is stored as a byte offset from the start
+ * of the blob (0 = NULL); spec_decode() rewrites the offsets into real
+ * pointers IN PLACE, so decoding needs no allocation and the decoded
+ * config points straight into the buffer.
+ *
+ * Both ends must be the same minicontainer build: the scalar part of
+ * container_config_t is copied verbatim (SPEC_VERSION guards the rest).
+ */
+#define SPEC_MAGIC    0x5053434dU   // "MCSP" little-endian
+#define SPEC_VERSION  8   // 2: cgroup_limits_t grew cpuset/io/weights
+                          // 3: memory_guard, restore_dir (snapshots on disk)
+                          // 4: veth.pod
+                          // 5: veth.bridge
+                          // 6: veth.user_mode
+                          // 7: veth.publish
+                          // 8: seccomp_profile
+#define SPEC_MAX_SIZE (64 * 1024)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;            // Total encoded bytes, header included
+    uint32_t argc;
+    uint32_t envc;
+    uint32_t program;         // String offsets; 0 = NULL
+    uint32_t rootfs_path;
+    uint32_t container_dir;
+    uint32_t hostname;
+    uint32_t seccomp_profile;
+    uint32_t argv;            // Offset of (argc + 1) uintptr_t slots
+    uint32_t envp;            // Offset of (envc + 1) slots; 0 = NULL envp
+    container_config_t config;  // Pointer members zeroed on the wire
+} spec_header_t;
+
+/**
+ * Encode config into buf.
+ *
+ * @param config  Configuration to encode (program and argv required)
+ * @param buf     Output buffer; should be 8-byte aligned
+ * @param size    Capacity of buf
+ * @return        Encoded length, or 0 if config is invalid or does not
+ *                fit (errno = EINVAL / E2BIG)
+ */
+size_t spec_encode(const container_config_t *config, void *buf, size_t size);
+
+/**
+ * Validate an encoded blob and fix it up in place. Every offset and
+ * string is bounds-checked against len before any pointer is formed, so
+ * a blob from an untrusted peer cannot point outside buf.
+ *
+ * Destructive: offsets are replaced by pointers, so a blob decodes once.
+ * buf must be 8-byte aligned and outlive the decoded config.
+ *
+ * @param buf     Encoded blob (from spec_encode)
+ * @param len     Bytes available in buf
+ * @param config  Out: decoded configuration pointing into buf
+ * @return        0 on success, -1 on a malformed blob (errno = EINVAL)
+ */
+int spec_decode(void *buf, size_t len, container_config_t *config);
+
+/**
+ * Compile config into a spec file: spec_encode() written to a temporary
+ * file beside path and renamed over it, so a concurrent spec_map() sees
+ * the old spec or the new one, never half of one. Paths inside config
+ * are stored as given; make them absolute if the spec is run from
+ * elsewhere (or by a daemon).
+ *
+ * @param config  Configuration to compile
+ * @param path    Spec file to create or replace
+ * @return        0 on success, -1 on failure (errno set)
+ */
+int spec_save(const container_config_t *config, const char *path);
+
+/**
+ * Map a spec file MAP_PRIVATE, ready for spec_decode() in place or for
+ * sending unchanged to a daemon. Decoding rewrites only the header and
+ * the slot tables, so just those pages are copied on write; the strings
+ * stay in the shared page cache across every launch of the same spec.
+ * Nothing is parsed or allocated per field. The header's magic, version
+ * and size are checked here; spec_decode() checks the rest.
+ *
+ * @param path  Spec file (from spec_save)
+ * @param len   Out: the encoded length (the header's size)
+ * @return      The mapping, or NULL on failure (errno = EINVAL for a
+ *              file that is not a spec from this build)
+ */
+void *spec_map(const char *path, size_t *len);
+
+/**
+ * Unmap a spec_map() result. A config decoded from it is invalid after.
+ */
+void spec_unmap(void *map, size_t len);
+
+#endif // SPEC_H
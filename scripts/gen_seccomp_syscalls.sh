@@ -0,0 +1,36 @@
+#!/bin/bash
+# Regenerate include/seccomp_syscalls.h, the syscall name table the
+# --seccomp profile parser (src/seccomp.c) looks names up in.
+#
+#   scripts/gen_seccomp_syscalls.sh > include/seccomp_syscalls.h
+#
+# Names come from the x86_64 and asm-generic (aarch64, riscv64) unistd
+# headers; each entry is guarded by its __NR_ macro, so the table only
+# holds the calls the target architecture has.
+set -euo pipefail
+
+INC="${INC:-/usr/include}"
+HEADERS=("$INC"/x86_64-linux-gnu/asm/unistd_64.h "$INC"/asm-generic/unistd.h)
+
+cat <<'HDR'
+#ifndef SECCOMP_SYSCALLS_H
+#define SECCOMP_SYSCALLS_H
+
+// Generated by scripts/gen_seccomp_syscalls.sh. Do not edit.
+// Included by src/seccomp.c only.
+#include <sys/syscall.h>
+
+static const struct { const char *name; int nr; } seccomp_syscalls[] = {
+HDR
+cat "${HEADERS[@]}" 2>/dev/null |
+    sed -n 's/^#define __NR\(3264\)\{0,1\}_\([a-z0-9_]*\)[[:space:]].*/\2/p' |
+    grep -Ev '^(syscalls|arch_specific_syscall)$' | sort -u |
+    while read -r name; do
+        printf '#ifdef __NR_%s\n    { "%s", __NR_%s },\n#endif\n' \
+            "$name" "$name" "$name"
+    done
+cat <<'HDR'
+};
+
+#endif // SECCOMP_SYSCALLS_H
+HDR
@@ -0,0 +1,89 @@
+#!/bin/bash
+# Import layers into the content-addressed store read by --image
+# (include/image.h) and optionally write an image manifest.
+#
+#   scripts/import_layer.sh [-s store] [-n image] <layer>...
+#
+# Each <layer> is a tar archive or a directory, topmost first. A
+# directory is tarred deterministically first, so the same tree always
+# gets the same digest. A layer already in the store is not unpacked
+# again. OCI whiteouts (.wh.<name>, .wh..wh..opq) are converted to
+# overlayfs ones. Prints one "sha256:<hex>" per layer.
+#
+# Example: split ./rootfs into a shared base and a small app layer:
+#   scripts/import_layer.sh -n app ./app-layer ./rootfs
+#   sudo ./minicontainer --image app /bin/sh
+set -euo pipefail
+
+STORE=/var/lib/minicontainer
+IMAGE=""
+
+usage() {
+    echo "Usage: $0 [-s store] [-n image] <layer.tar|dir>..." >&2
+    exit 1
+}
+
+while getopts "s:n:h" opt; do
+    case "$opt" in
+        s) STORE="$OPTARG" ;;
+        n) IMAGE="$OPTARG" ;;
+        *) usage ;;
+    esac
+done
+shift $((OPTIND - 1))
+[ $# -ge 1 ] || usage
+case "$IMAGE" in
+    */*) echo "Error: image name must not contain '/'" >&2; exit 1 ;;
+esac
+
+mkdir -p "$STORE/layers/sha256" "$STORE/images"
+TMP=$(mktemp -d "$STORE/.import.XXXXXX")
+trap 'rm -rf "$TMP"' EXIT
+
+# overlayfs whiteouts: .wh.<name> -> 0/0 char device, .wh..wh..opq ->
+# trusted.overlay.opaque on its directory.
+convert_whiteouts() {
+    local root="$1" wh dir name
+    while IFS= read -r -d '' wh; do
+        dir=$(dirname "$wh")
+        name=$(basename "$wh")
+        rm -f "$wh"
+        if [ "$name" = ".wh..wh..opq" ]; then
+            setfattr -n trusted.overlay.opaque -v y "$dir"
+        else
+            mknod "$dir/${name#.wh.}" c 0 0
+        fi
+    done < <(find "$root" -name '.wh.*' -print0)
+}
+
+DIGESTS=()
+for layer in "$@"; do
+    tarball="$layer"
+    if [ -d "$layer" ]; then
+        tarball="$TMP/layer.tar"
+        tar -C "$layer" --sort=name --mtime=@0 --owner=0 --group=0 \
+            --numeric-owner -cf "$tarball" .
+    fi
+    hex=$(sha256sum "$tarball" | cut -d' ' -f1)
+    dest="$STORE/layers/sha256/$hex"
+
+    if [ ! -d "$dest" ]; then
+        # Unpack beside the store and rename into place: a half-extracted
+        # layer is never visible under its digest. Losing the race to a
+        # concurrent import of the same layer is fine.
+        unpack="$TMP/$hex"
+        mkdir "$unpack"
+        tar -C "$unpack" --numeric-owner -xpf "$tarball"
+        convert_whiteouts "$unpack"
+        mv -T "$unpack" "$dest" 2>/dev/null || [ -d "$dest" ]
+    fi
+    rm -f "$TMP/layer.tar"
+    DIGESTS+=("sha256:$hex")
+    echo "sha256:$hex"
+done
+
+if [ -n "$IMAGE" ]; then
+    printf '%s\n' "${DIGESTS[@]}" > "$TMP/manifest"
+    mv "$TMP/manifest" "$STORE/images/$IMAGE"
+    echo "Wrote image $IMAGE (${#DIGESTS[@]} layers)" >&2
+fi
@@ -0,0 +1,433 @@
+// Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include "attach.h"
+#include "events.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <grp.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+
+#ifndef CLONE_NEWTIME
+#define CLONE_NEWTIME 0x00000080
+#endif
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
+#endif
+
+#define ATTACH_ENV_MAX (256 * 1024)   // Bytes of /proc/<pid>/environ
+
+extern char **environ;
+
+/* Entry order for the per-fd fallback (nsenter's): the user namespace
+ * first, so the rest are entered with its capabilities; mnt late, since
+ * it changes how /proc paths resolve (the fds are open already). */
+static const struct {
+    const char *name;
+    int flag;
+} ns_table[ATTACH_NS_COUNT] = {
+    { "user",   CLONE_NEWUSER },
+    { "cgroup", CLONE_NEWCGROUP },
+    { "ipc",    CLONE_NEWIPC },
+    { "uts",    CLONE_NEWUTS },
+    { "net",    CLONE_NEWNET },
+    { "pid",    CLONE_NEWPID },
+    { "mnt",    CLONE_NEWNS },
+    { "time",   CLONE_NEWTIME },
+};
+
+static int pidfd_open_compat(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+static long elapsed_us(const struct timespec *t0) {
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) * 1000000L +
+           (t1.tv_nsec - t0->tv_nsec) / 1000L;
+}
+
+/* Read a whole (small, procfs or cgroupfs) file into a NUL-terminated
+ * heap buffer. */
+static char *read_all(int dir_fd, const char *path, size_t max, size_t *len) {
+    int fd = openat(dir_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    size_t cap = 4096, used = 0;
+    char *buf = malloc(cap);
+    while (buf) {
+        if (used + 1 == cap) {
+            char *grown = cap < max ? realloc(buf, cap * 2) : NULL;
+            if (!grown) {
+                free(buf);
+                buf = NULL;
+                errno = E2BIG;
+                break;
+            }
+            buf = grown;
+            cap *= 2;
+        }
+        ssize_t n = read(fd, buf + used, cap - 1 - used);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            free(buf);
+            buf = NULL;
+            break;
+        }
+        if (n == 0) {
+            buf[used] = '\0';
+            if (len) *len = used;
+            break;
+        }
+        used += (size_t)n;
+    }
+    close(fd);
+    return buf;
+}
+
+/* Field 22 of /proc/<pid>/stat (start time in clock ticks), or 0. */
+static unsigned long long start_time(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    char *stat = read_all(AT_FDCWD, path, 4096, NULL);
+    if (!stat) return 0;
+    unsigned long long t = 0;
+    char *p = strrchr(stat, ')');   // comm may contain spaces and ')'
+    for (int field = 2; p && field < 22; field++) p = strchr(p + 1, ' ');
+    if (p) t = strtoull(p + 1, NULL, 10);
+    free(stat);
+    return t;
+}
+
+/* A cgroup name resolves to the oldest process in it — the init, since
+ * everything else in the container (exec'd processes included) started
+ * later. */
+static pid_t resolve_cgroup(const char *name) {
+    if (!name[0] || strchr(name, '/') || strcmp(name, ".") == 0 ||
+        strcmp(name, "..") == 0) {
+        fprintf(stderr, "[attach] Invalid container '%s'\n", name);
+        return -1;
+    }
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s/%s/cgroup.procs", CGROUP_ROOT,
+             CGROUP_POOL_DIR, name);
+    char *procs = read_all(AT_FDCWD, path, 1 << 20, NULL);
+    if (!procs) {
+        fprintf(stderr, "[attach] No container '%s' (%s: %s)\n", name, path,
+                strerror(errno));
+        return -1;
+    }
+    pid_t best = -1;
+    unsigned long long best_start = 0;
+    char *save = NULL;
+    for (char *line = strtok_r(procs, "\n", &save); line;
+         line = strtok_r(NULL, "\n", &save)) {
+        pid_t pid = (pid_t)atoi(line);
+        unsigned long long t = pid > 0 ? start_time(pid) : 0;
+        if (t > 0 && (best < 0 || t < best_start)) {
+            best = pid;
+            best_start = t;
+        }
+    }
+    free(procs);
+    if (best < 0) fprintf(stderr, "[attach] Container '%s' is not running\n", name);
+    return best;
+}
+
+/* The target's cgroup, if it is one of ours: its v2 path ("0::/...")
+ * must lie under CGROUP_POOL_DIR. Anything else (no cgroup limits, a v1
+ * host) leaves dir_fd at -1 and the exec'd process where it is. */
+static void open_cgroup(container_attach_t *a, bool enable_debug) {
+    a->cgroup.dir_fd = -1;
+    char *lines = read_all(a->proc_fd, "cgroup", 64 * 1024, NULL);
+    if (!lines) return;
+    const char *prefix = "/" CGROUP_POOL_DIR "/";
+    char *save = NULL;
+    for (char *line = strtok_r(lines, "\n", &save); line;
+         line = strtok_r(NULL, "\n", &save)) {
+        if (strncmp(line, "0::", 3) != 0) continue;
+        const char *rel = line + 3;
+        if (strncmp(rel, prefix, strlen(prefix)) != 0) break;
+        snprintf(a->cgroup.cgroup_path, sizeof(a->cgroup.cgroup_path), "%s%s",
+                 CGROUP_ROOT, rel);
+        snprintf(a->cgroup.cgroup_name, sizeof(a->cgroup.cgroup_name), "%s",
+                 strrchr(rel, '/') + 1);
+        a->cgroup.dir_fd = open(a->cgroup.cgroup_path,
+                                O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (a->cgroup.dir_fd < 0) {
+            fprintf(stderr, "[attach] open %s: %s\n", a->cgroup.cgroup_path,
+                    strerror(errno));
+        } else if (enable_debug) {
+            debug_log("[attach] Cgroup %s\n", a->cgroup.cgroup_name);
+        }
+        break;
+    }
+    free(lines);
+}
+
+static int load_env(container_attach_t *a) {
+    size_t len = 0;
+    a->env_buf = read_all(a->proc_fd, "environ", ATTACH_ENV_MAX, &len);
+    if (!a->env_buf) {
+        perror("[attach] read environ");
+        return -1;
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < len; i++) count += a->env_buf[i] == '\0';
+    a->envp = calloc(count + 2, sizeof(char *));
+    if (!a->envp) return -1;
+    size_t n = 0;
+    for (size_t i = 0; i < len; i += strlen(a->env_buf + i) + 1) {
+        if (a->env_buf[i]) a->envp[n++] = a->env_buf + i;
+    }
+    a->envp[n] = NULL;
+    return 0;
+}
+
+int container_attach_open(container_attach_t *a, const char *target,
+                          bool enable_debug) {
+    memset(a, 0, sizeof(*a));
+    a->pidfd = a->proc_fd = a->root_fd = a->cgroup.dir_fd = -1;
+    for (int i = 0; i < ATTACH_NS_COUNT; i++) a->ns_fds[i] = -1;
+
+    char *end = NULL;
+    long pid = strtol(target, &end, 10);
+    a->pid = end != target && *end == '\0' ? (pid_t)pid : resolve_cgroup(target);
+    if (a->pid <= 0) {
+        if (end != target && *end == '\0') {
+            fprintf(stderr, "[attach] Invalid pid '%s'\n", target);
+        }
+        return -1;
+    }
+
+    /* pidfd first, /proc/<pid> second, then the pidfd must still be
+     * live: the pid was not reaped (and reused) in between, so proc_fd
+     * is the same process. */
+    a->pidfd = pidfd_open_compat(a->pid);
+    if (a->pidfd < 0 && errno != ENOSYS) {
+        fprintf(stderr, "[attach] PID %d: %s\n", (int)a->pid, strerror(errno));
+        return -1;
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d", (int)a->pid);
+    a->proc_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (a->proc_fd < 0 ||
+        (a->pidfd >= 0 &&
+         syscall(SYS_pidfd_send_signal, a->pidfd, 0, NULL, 0) < 0)) {
+        fprintf(stderr, "[attach] PID %d: %s\n", (int)a->pid, strerror(errno));
+        container_attach_close(a);
+        return -1;
+    }
+
+    for (int i = 0; i < ATTACH_NS_COUNT; i++) {
+        char ns[32], self[32];
+        snprintf(ns, sizeof(ns), "ns/%s", ns_table[i].name);
+        snprintf(self, sizeof(self), "/proc/self/ns/%s", ns_table[i].name);
+        struct stat theirs, ours;
+        int fd = openat(a->proc_fd, ns, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            if (errno == ENOENT) continue;   // Kernel without it
+            fprintf(stderr, "[attach] open %s/%s: %s\n", path, ns, strerror(errno));
+            container_attach_close(a);
+            return -1;
+        }
+        if (fstat(fd, &theirs) == 0 && stat(self, &ours) == 0 &&
+            theirs.st_dev == ours.st_dev && theirs.st_ino == ours.st_ino) {
+            close(fd);   // Shared with us: setns() would refuse a user ns
+            continue;
+        }
+        a->ns_fds[i] = fd;
+        a->ns_flags |= ns_table[i].flag;
+    }
+
+    a->root_fd = openat(a->proc_fd, "root", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (a->root_fd < 0) {
+        fprintf(stderr, "[attach] open %s/root: %s\n", path, strerror(errno));
+        container_attach_close(a);
+        return -1;
+    }
+    open_cgroup(a, enable_debug);
+    if (load_env(a) < 0) {
+        container_attach_close(a);
+        return -1;
+    }
+
+    if (enable_debug) {
+        char names[64] = "";
+        size_t used = 0;
+        for (int i = 0; i < ATTACH_NS_COUNT; i++) {
+            if (a->ns_fds[i] >= 0) {
+                used += (size_t)snprintf(names + used, sizeof(names) - used,
+                                         " %s", ns_table[i].name);
+            }
+        }
+        debug_log("[attach] PID %d:%s\n", (int)a->pid,
+                  a->ns_flags ? names : " (no namespaces of its own)");
+    }
+    return 0;
+}
+
+/* In the forked child: everything but the execve(). */
+static int enter(const container_attach_t *a, bool enable_debug) {
+    // Same root as ours (no rootfs): no chroot, which needs CAP_SYS_CHROOT
+    struct stat theirs, ours;
+    bool pivoted = fstat(a->root_fd, &theirs) == 0 && stat("/", &ours) == 0 &&
+                    (theirs.st_dev != ours.st_dev || theirs.st_ino != ours.st_ino);
+
+    if (a->cgroup.dir_fd >= 0 &&
+        add_pid_to_cgroup(&a->cgroup, getpid(), enable_debug) < 0) {
+        return -1;
+    }
+
+    if (a->ns_flags) {
+        int rc = a->pidfd >= 0 ? setns(a->pidfd, a->ns_flags) : -1;
+        if (rc < 0 && (a->pidfd < 0 || errno == EINVAL)) {
+            // Before 5.8, setns() takes namespace fds only
+            for (int i = 0; i < ATTACH_NS_COUNT; i++) {
+                if (a->ns_fds[i] < 0) continue;
+                if (setns(a->ns_fds[i], ns_table[i].flag) < 0) {
+                    fprintf(stderr, "[attach] setns(%s): %s\n",
+                            ns_table[i].name, strerror(errno));
+                    return -1;
+                }
+            }
+        } else if (rc < 0) {
+            perror("[attach] setns");
+            return -1;
+        }
+    }
+
+    if (a->ns_flags & CLONE_NEWUSER) {
+        // Root of the container's user namespace, as its init is
+        setgroups(0, NULL);   // EPERM where setgroups is denied: harmless
+        if (setresgid(0, 0, 0) < 0 || setresuid(0, 0, 0) < 0) {
+            perror("[attach] setresuid(0) in the user namespace");
+            return -1;
+        }
+    }
+
+    if (pivoted &&
+        (fchdir(a->root_fd) < 0 || chroot(".") < 0 || chdir("/") < 0)) {
+        perror("[attach] chroot");
+        return -1;
+    }
+    return 0;
+}
+
+/* Tell the parent why we are not going to exec, then die. */
+static void fail(int err_fd) {
+    int err = errno ? errno : EINVAL;
+    debug_flush();
+    ssize_t n = write(err_fd, &err, sizeof(err));
+    (void)n;
+    _exit(127);
+}
+
+int container_attach_exec(const container_attach_t *a, char *const argv[],
+                          char *const envp[], int *status,
+                          bool enable_debug) {
+    /* EOF on the pipe (it is O_CLOEXEC) means the command was executed;
+     * an errno in it means the child failed before getting there. */
+    int err_pipe[2];
+    if (pipe2(err_pipe, O_CLOEXEC) < 0) {
+        perror("[attach] pipe");
+        return -1;
+    }
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    fflush(NULL);
+    debug_flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("[attach] fork");
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(err_pipe[0]);
+        if (enter(a, enable_debug) < 0) fail(err_pipe[1]);
+        if (a->ns_flags & CLONE_NEWPID) {
+            // setns() placed our children, not us, in the PID namespace
+            debug_flush();
+            pid_t inner = fork();
+            if (inner < 0) fail(err_pipe[1]);
+            if (inner > 0) {
+                close(err_pipe[1]);
+                int st;
+                while (waitpid(inner, &st, 0) < 0 && errno == EINTR) {}
+                if (WIFSIGNALED(st)) {
+                    signal(WTERMSIG(st), SIG_DFL);
+                    kill(getpid(), WTERMSIG(st));
+                }
+                _exit(WIFEXITED(st) ? WEXITSTATUS(st) : 128 + WTERMSIG(st));
+            }
+        }
+        if (a->seccomp && seccomp_install(a->seccomp, enable_debug) < 0) {
+            fail(err_pipe[1]);
+        }
+        environ = (char **)(envp ? envp : a->envp);
+        debug_flush();
+        execvp(argv[0], argv);
+        int err = errno;
+        fprintf(stderr, "[attach] execvp(%s): %s\n", argv[0], strerror(err));
+        errno = err;
+        fail(err_pipe[1]);
+    }
+
+    close(err_pipe[1]);
+    int err = 0;
+    ssize_t n;
+    while ((n = read(err_pipe[0], &err, sizeof(err))) < 0 && errno == EINTR) {}
+    close(err_pipe[0]);
+    if (enable_debug && n == 0) {
+        debug_log("[attach] %s running in PID %d's namespaces after %ld us\n",
+               argv[0], (int)a->pid, elapsed_us(&t0));
+    }
+
+    int st;
+    while (waitpid(pid, &st, 0) < 0) {
+        if (errno != EINTR) {
+            perror("[attach] waitpid");
+            return -1;
+        }
+    }
+    if (n > 0) {
+        errno = err;
+        return -1;
+    }
+    if (status) *status = st;
+    return 0;
+}
+
+void container_attach_close(container_attach_t *a) {
+    if (!a) return;
+    for (int i = 0; i < ATTACH_NS_COUNT; i++) {
+        if (a->ns_fds[i] >= 0) close(a->ns_fds[i]);
+        a->ns_fds[i] = -1;
+    }
+    int *fds[] = { &a->pidfd, &a->proc_fd, &a->root_fd, &a->cgroup.dir_fd };
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+        if (*fds[i] >= 0) close(*fds[i]);
+        *fds[i] = -1;
+    }
+    free(a->envp);
+    free(a->env_buf);
+    a->envp = NULL;
+    a->env_buf = NULL;
+    a->ns_flags = 0;
+}
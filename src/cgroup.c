@@ -1,6 +1,10 @@
 // Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
 // Do NOT redefine it here (Error #8 from decisions.md).
 #include "cgroup.h"
+#include "id.h"
+#include "fs_batch.h"
+#include "events.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -9,30 +13,31 @@
 #include <string.h>
 #include <time.h>
 #include <fcntl.h>
+#include <sys/file.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <dirent.h>
 
-#define CGROUP_ROOT "/sys/fs/cgroup"
-#define CGROUP_PREFIX "minicontainer"
+#define CGROUP_CONTROLLERS "+cpu +memory +pids +cpuset +io"
+#define NUMA_MAX_NODES 64
 
-/**
- * Generate unique cgroup name using timestamp + nanoseconds.
- */
-static void generate_cgroup_name(char *name, size_t size) {
-    struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
-    snprintf(name, size, "%s_%ld_%ld", CGROUP_PREFIX, ts.tv_sec, ts.tv_nsec);
-}
+/* The pool parent, opened once per process (reset by the refiller,
+ * which closes every inherited fd). */
+static int pool_fd = -1;
 
 /**
- * Write string to a cgroup file.
+ * Write string to a cgroup file relative to dir_fd.
  * Returns 0 on success, -1 on failure.
  */
-static int write_cgroup_file(const char *path, const char *content,
+static int write_cgroup_file(int dir_fd, const char *file, const char *content,
                              bool enable_debug) {
-    int fd = open(path, O_WRONLY);
+    int fd = openat(dir_fd, file, O_WRONLY | O_CLOEXEC);
     if (fd < 0) {
         if (enable_debug) {
             fprintf(stderr, "[cgroup] Failed to open %s: %s\n",
-                    path, strerror(errno));
+                    file, strerror(errno));
         }
         return -1;
     }
@@ -41,7 +46,7 @@ static int write_cgroup_file(const char *path, const char *content,
     if (write(fd, content, len) != len) {
         if (enable_debug) {
             fprintf(stderr, "[cgroup] Failed to write to %s: %s\n",
-                    path, strerror(errno));
+                    file, strerror(errno));
         }
         close(fd);
         return -1;
@@ -52,96 +57,573 @@ static int write_cgroup_file(const char *path, const char *content,
 }
 
 /**
- * Create and setup cgroup.
- *
- * Steps:
- * 1. Generate unique name
- * 2. Create directory in /sys/fs/cgroup/
- * 3. Enable controllers in parent (may fail if already enabled — that's fine)
- * 4. Write limits to memory.max, cpu.max, pids.max
+ * Read a cgroup file relative to dir_fd, without the trailing newline.
+ * Returns 0 on success, -1 on failure.
  */
-int setup_cgroup(cgroup_context_t *ctx, const cgroup_limits_t *limits,
-                 bool enable_debug) {
-    // Generate unique name
-    generate_cgroup_name(ctx->cgroup_name, sizeof(ctx->cgroup_name));
-    snprintf(ctx->cgroup_path, sizeof(ctx->cgroup_path),
-             "%s/%s", CGROUP_ROOT, ctx->cgroup_name);
+static int read_cgroup_file(int dir_fd, const char *file, char *buf,
+                            size_t size) {
+    int fd = openat(dir_fd, file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    if (n < 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
 
-    if (enable_debug) {
-        printf("[cgroup] Creating cgroup: %s\n", ctx->cgroup_path);
+/**
+ * Limit writes collected by apply_limits() and run as one batch;
+ * what[i] names op i's limit in the error message.
+ */
+typedef struct {
+    fs_batch_t  batch;
+    const char *what[FS_BATCH_MAX];
+} limit_writes_t;
+
+/**
+ * Queue a limit write unless the leaf already has it. `current` is the
+ * value as the kernel reads it back (memory.max is rounded down to
+ * pages), which is also what a fresh leaf reports for an unset limit
+ * ("max"). Resetting an unset limit needs no controller: a missing file
+ * means nothing to reset.
+ */
+static void set_cgroup_limit(limit_writes_t *w, int dir_fd, const char *file,
+                             const char *value, const char *current,
+                             bool unset, const char *what) {
+    char have[64];
+    if (read_cgroup_file(dir_fd, file, have, sizeof(have)) == 0) {
+        if (strcmp(have, current) == 0) {
+            return;
+        }
+    } else if (unset && errno == ENOENT) {
+        return;
     }
+    int i = fs_batch_write_file(&w->batch, dir_fd, file, value, 0);
+    if (i >= 0) w->what[i] = what;
+}
 
-    // Create cgroup directory
-    if (mkdir(ctx->cgroup_path, 0755) < 0) {
-        perror("mkdir(cgroup)");
+/**
+ * Enable the limit controllers for the pool's leaves: in the root's
+ * subtree_control (may fail if already enabled, or on a delegated root
+ * we cannot write — both fine) and in the parent's. One write per
+ * controller, since one the kernel lacks (io, say) fails the whole write.
+ */
+static void enable_controllers(int root_fd, int parent_fd, bool enable_debug) {
+    char list[] = CGROUP_CONTROLLERS;
+    char *save = NULL;
+    fs_batch_t batch;
+    fs_batch_init(&batch);
+    for (char *c = strtok_r(list, " ", &save); c; c = strtok_r(NULL, " ", &save)) {
+        fs_batch_write_file(&batch, root_fd, "cgroup.subtree_control", c, 0);
+        fs_batch_write_file(&batch, parent_fd, "cgroup.subtree_control", c,
+                            FS_OP_AFTER_PREV);   // Parent needs the root's
+    }
+    if (fs_batch_run(&batch, enable_debug) < 0 && enable_debug) {
+        for (unsigned i = 0; i < batch.count; i++) {
+            if (batch.ops[i].res < 0) {
+                fprintf(stderr, "[cgroup] Failed to enable %s in the %s: %s\n",
+                        batch.strbuf + batch.ops[i].data,
+                        i % 2 ? "pool parent" : "root", strerror(-batch.ops[i].res));
+            }
+        }
+    }
+}
+
+/**
+ * Whether a knob that limits asks for lives in a controller the leaf
+ * does not have (a parent made by an older runtime, or controllers
+ * disabled since).
+ */
+static bool missing_controller(int dir_fd, const cgroup_limits_t *l) {
+    const struct { bool wanted; const char *file; } knobs[] = {
+        { l->memory_limit || l->memory_high || l->swap_limit, "memory.max" },
+        { l->cpu_quota > 0 || l->cpu_weight, "cpu.max" },
+        { l->pid_limit > 0, "pids.max" },
+        { l->cpuset_cpus[0] || l->cpuset_mems[0], "cpuset.cpus" },
+        { l->io_max[0] || l->io_weight, "io.max" },
+    };
+    for (size_t i = 0; i < sizeof(knobs) / sizeof(knobs[0]); i++) {
+        if (knobs[i].wanted && faccessat(dir_fd, knobs[i].file, F_OK, 0) < 0 &&
+            errno == ENOENT) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Read a whole (small) file into buf, NUL-terminated. Returns the length,
+ * or -1.
+ */
+static ssize_t read_whole_file(int dir_fd, const char *file, char *buf,
+                               size_t size) {
+    int fd = openat(dir_fd, file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    if (n < 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+/**
+ * Parse a kernel list ("0-3,8") into ids[]. Returns the count.
+ */
+static int parse_id_list(const char *list, int *ids, int max) {
+    int count = 0;
+    const char *p = list;
+    while (*p && *p != '\n' && count < max) {
+        char *end;
+        long lo = strtol(p, &end, 10), hi = lo;
+        if (end == p) break;
+        if (*end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+        }
+        for (long id = lo; id <= hi && count < max; id++) {
+            ids[count++] = (int)id;
+        }
+        p = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+/**
+ * Pick the NUMA node for a new container (see NUMA_SYSFS in cgroup.h)
+ * and copy its cpulist into cpus. Returns the node, or -1 to leave the
+ * container unpinned.
+ */
+static int numa_pick_node(int pool, char *cpus, size_t size,
+                          bool enable_debug) {
+    char buf[4096];
+    int nodes[NUMA_MAX_NODES];
+    if (read_whole_file(AT_FDCWD, NUMA_SYSFS "/online", buf, sizeof(buf)) < 0) {
+        return -1;
+    }
+    int count = parse_id_list(buf, nodes, NUMA_MAX_NODES);
+    if (count < 2) {
         return -1;
     }
-    ctx->created = true;
 
-    // Enable controllers in root cgroup (may fail if already enabled)
-    char subtree_path[512];
-    snprintf(subtree_path, sizeof(subtree_path),
-             "%s/cgroup.subtree_control", CGROUP_ROOT);
-    write_cgroup_file(subtree_path, "+cpu +memory +pids", enable_debug);
-    // Ignore errors — controllers might already be enabled
+    // Load: running containers in the pool parent pinned to one node
+    unsigned load[NUMA_MAX_NODES] = {0};
+    int scan_fd = dup(pool);
+    DIR *dir = scan_fd >= 0 ? fdopendir(scan_fd) : NULL;
+    if (!dir && scan_fd >= 0) close(scan_fd);
+    for (struct dirent *de; dir && (de = readdir(dir)); ) {
+        if (de->d_type != DT_DIR || de->d_name[0] == '.') continue;
+        int fd = openat(pool, de->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) continue;
+        char events[256], mems[64];
+        if (read_cgroup_file(fd, "cgroup.events", events, sizeof(events)) == 0 &&
+            strstr(events, "populated 1") &&
+            read_cgroup_file(fd, "cpuset.mems", mems, sizeof(mems)) == 0) {
+            char *end;
+            long node = strtol(mems, &end, 10);
+            if (end != mems && *end == '\0' && node >= 0 &&
+                node < NUMA_MAX_NODES) {
+                load[node]++;
+            }
+        }
+        close(fd);
+    }
+    if (dir) closedir(dir);
+
+    int best = -1;
+    unsigned long long best_free = 0;
+    for (int i = 0; i < count; i++) {
+        int node = nodes[i];
+        if (node >= NUMA_MAX_NODES) continue;
+        char path[96];
+        unsigned long long free_kb = 0;
+        snprintf(path, sizeof(path), NUMA_SYSFS "/node%d/meminfo", node);
+        if (read_whole_file(AT_FDCWD, path, buf, sizeof(buf)) > 0) {
+            const char *p = strstr(buf, "MemFree:");
+            if (p) free_kb = strtoull(p + strlen("MemFree:"), NULL, 10);
+        }
+        if (best < 0 || load[node] < load[best] ||
+            (load[node] == load[best] && free_kb > best_free)) {
+            best = node;
+            best_free = free_kb;
+        }
+    }
+    if (best < 0) {
+        return -1;
+    }
 
-    // Set memory limit
-    if (limits->memory_limit > 0) {
-        char path[512];
-        char content[64];
+    char path[96];
+    snprintf(path, sizeof(path), NUMA_SYSFS "/node%d/cpulist", best);
+    if (read_cgroup_file(AT_FDCWD, path, cpus, size) < 0 || !cpus[0]) {
+        return -1;   // A memory-only node: nothing to pin the threads to
+    }
+    if (enable_debug) {
+        debug_log("[cgroup] NUMA node %d (%u running, %llu kB free): cpus %s\n",
+               best, load[best], best_free, cpus);
+    }
+    return best;
+}
 
-        snprintf(path, sizeof(path), "%s/memory.max", ctx->cgroup_path);
-        snprintf(content, sizeof(content), "%zu", limits->memory_limit);
+/**
+ * Open (creating it on first use) the pool parent.
+ */
+static int open_pool(bool enable_debug) {
+    if (pool_fd >= 0) {
+        return pool_fd;
+    }
+
+    int root_fd = open(CGROUP_ROOT, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (root_fd < 0) {
+        perror("open(" CGROUP_ROOT ")");
+        return -1;
+    }
+    struct statfs sfs;
+    if (fstatfs(root_fd, &sfs) < 0 || sfs.f_type != CGROUP2_SUPER_MAGIC) {
+        fprintf(stderr, "[cgroup] %s is not a cgroup v2 mount\n", CGROUP_ROOT);
+        close(root_fd);
+        return -1;
+    }
+    bool created = mkdirat(root_fd, CGROUP_POOL_DIR, 0755) == 0;
+    if (!created && errno != EEXIST) {
+        perror("mkdir(cgroup pool)");
+        close(root_fd);
+        return -1;
+    }
+    pool_fd = openat(root_fd, CGROUP_POOL_DIR,
+                     O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (pool_fd >= 0 && created) {
+        enable_controllers(root_fd, pool_fd, enable_debug);
+    }
+    close(root_fd);
+    if (pool_fd < 0) {
+        perror("open(cgroup pool)");
+    }
+    return pool_fd;
+}
 
-        if (write_cgroup_file(path, content, enable_debug) < 0) {
-            fprintf(stderr, "[cgroup] Failed to set memory limit\n");
+/**
+ * Open and try-lock slot<N>. Returns the locked directory fd, or -1 if
+ * the slot does not exist, is owned elsewhere, or still has processes
+ * (whoever ran there escaped teardown; leave it alone).
+ */
+static int lock_slot(int pool, int slot) {
+    char name[32], events[256];
+    snprintf(name, sizeof(name), "slot%d", slot);
+    int fd = openat(pool, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) < 0 ||
+        read_cgroup_file(fd, "cgroup.events", events, sizeof(events)) < 0 ||
+        strstr(events, "populated 0") == NULL) {
+        close(fd);
+        errno = EBUSY;   // Not ENOENT: the slot exists
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Claim an idle slot, or mkdir the first missing one and claim that.
+ * Returns the slot number (ctx->dir_fd set), or -1 if all are busy.
+ */
+static int claim_slot(cgroup_context_t *ctx, int pool, bool *made) {
+    int first_missing = -1;
+    *made = false;
+    for (int slot = 0; slot < CGROUP_POOL_MAX_SLOTS; slot++) {
+        int fd = lock_slot(pool, slot);
+        if (fd >= 0) {
+            ctx->dir_fd = fd;
+            return slot;
+        }
+        if (errno == ENOENT && first_missing < 0) {
+            first_missing = slot;
+        }
+    }
+
+    // Pool exhausted: grow it. Losing the new slot's lock to a claimer
+    // that found it first just moves on to the next hole.
+    for (int slot = first_missing; slot >= 0 && slot < CGROUP_POOL_MAX_SLOTS;
+         slot++) {
+        char name[32];
+        snprintf(name, sizeof(name), "slot%d", slot);
+        if (mkdirat(pool, name, 0755) < 0 && errno != EEXIST) {
             return -1;
         }
+        int fd = lock_slot(pool, slot);
+        if (fd >= 0) {
+            ctx->dir_fd = fd;
+            *made = true;
+            return slot;
+        }
+    }
+    return -1;
+}
 
-        if (enable_debug) {
-            printf("[cgroup] Memory limit: %zu bytes\n", limits->memory_limit);
+/**
+ * A memory knob's value to write and as it reads back (rounded down to
+ * pages); 0 bytes is "max".
+ */
+static void memory_value(size_t bytes, char *value, char *current,
+                         size_t size) {
+    long page = sysconf(_SC_PAGESIZE);
+    if (bytes > 0) {
+        snprintf(value, size, "%zu", bytes);
+        snprintf(current, size, "%zu", bytes / page * page);
+    } else {
+        snprintf(value, size, "max");
+        snprintf(current, size, "max");
+    }
+}
+
+/**
+ * io.max holds one line per throttled device. Every device other than
+ * the requested one (a previous tenant's) is reset to max; the requested
+ * line is written unless it already reads back identically.
+ */
+static int apply_io_max(limit_writes_t *w, int dir_fd, const char *want) {
+    char have[1024];
+    bool present = false;
+    if (read_whole_file(dir_fd, "io.max", have, sizeof(have)) < 0) {
+        return (!want[0] && errno == ENOENT) ? 0 : -1;
+    }
+    size_t dev_len = strcspn(want, " ");
+    char *save = NULL;
+    for (char *line = strtok_r(have, "\n", &save); line;
+         line = strtok_r(NULL, "\n", &save)) {
+        if (want[0] && strcmp(line, want) == 0) {
+            present = true;
+            continue;
+        }
+        size_t len = strcspn(line, " ");
+        if (want[0] && len == dev_len && strncmp(line, want, len) == 0) {
+            continue;   // Overwritten below
         }
+        char reset[64];
+        snprintf(reset, sizeof(reset),
+                 "%.*s rbps=max wbps=max riops=max wiops=max", (int)len, line);
+        int i = fs_batch_write_file(&w->batch, dir_fd, "io.max", reset, 0);
+        if (i >= 0) w->what[i] = "io.max";
     }
+    if (want[0] && !present) {
+        int i = fs_batch_write_file(&w->batch, dir_fd, "io.max", want, 0);
+        if (i >= 0) w->what[i] = "io.max";
+    }
+    return 0;
+}
 
-    // Set CPU limit
+/**
+ * Apply limits to a claimed leaf. Only values that differ from the
+ * leaf's current ones are written, all in one fs_batch_run(): each knob
+ * is its own file, so the writes need no order.
+ */
+static int apply_limits(const cgroup_context_t *ctx,
+                        const cgroup_limits_t *limits, bool enable_debug) {
+    char value[160], current[160], swap[160];
+    limit_writes_t w;
+    fs_batch_init(&w.batch);
+
+    // Memory limit
+    memory_value(limits->memory_limit, value, current, sizeof(value));
+    set_cgroup_limit(&w, ctx->dir_fd, "memory.max", value, current,
+                     limits->memory_limit == 0, "memory limit");
+
+    // CPU limit
+    long period = limits->cpu_period > 0 ? limits->cpu_period : 100000;
     if (limits->cpu_quota > 0) {
-        char path[512];
-        char content[64];
-        long period = limits->cpu_period > 0 ? limits->cpu_period : 100000;
+        snprintf(value, sizeof(value), "%ld %ld", limits->cpu_quota, period);
+    } else {
+        strcpy(value, "max 100000");   // A fresh cgroup's cpu.max
+    }
+    set_cgroup_limit(&w, ctx->dir_fd, "cpu.max", value, value,
+                     limits->cpu_quota <= 0, "CPU limit");
 
-        snprintf(path, sizeof(path), "%s/cpu.max", ctx->cgroup_path);
-        snprintf(content, sizeof(content), "%ld %ld",
-                 limits->cpu_quota, period);
+    // PID limit
+    if (limits->pid_limit > 0) {
+        snprintf(value, sizeof(value), "%zu", limits->pid_limit);
+    } else {
+        strcpy(value, "max");
+    }
+    set_cgroup_limit(&w, ctx->dir_fd, "pids.max", value, value,
+                     limits->pid_limit == 0, "PID limit");
+
+    // Soft memory limit and swap
+    memory_value(limits->memory_high, value, current, sizeof(value));
+    set_cgroup_limit(&w, ctx->dir_fd, "memory.high", value, current,
+                     limits->memory_high == 0, "memory.high");
+    if (limits->swap_limit == CGROUP_SWAP_NONE) {
+        strcpy(value, "0");
+        strcpy(swap, "0");
+    } else {
+        memory_value(limits->swap_limit, value, swap, sizeof(value));
+    }
+    set_cgroup_limit(&w, ctx->dir_fd, "memory.swap.max", value, swap,
+                     limits->swap_limit == 0, "swap limit");
+
+    // Weights (kernel default 100)
+    snprintf(value, sizeof(value), "%u",
+             limits->cpu_weight ? limits->cpu_weight : 100);
+    set_cgroup_limit(&w, ctx->dir_fd, "cpu.weight", value, value,
+                     limits->cpu_weight == 0, "CPU weight");
+    snprintf(value, sizeof(value), "default %u",
+             limits->io_weight ? limits->io_weight : 100);
+    set_cgroup_limit(&w, ctx->dir_fd, "io.weight", value, value,
+                     limits->io_weight == 0, "I/O weight");
+
+    // CPU and memory-node pinning: "" reads back for an inherited set,
+    // and a bare newline writes one
+    const struct { const char *file, *list; } sets[] = {
+        { "cpuset.cpus", limits->cpuset_cpus },
+        { "cpuset.mems", limits->cpuset_mems },
+    };
+    for (size_t i = 0; i < sizeof(sets) / sizeof(sets[0]); i++) {
+        set_cgroup_limit(&w, ctx->dir_fd, sets[i].file,
+                         sets[i].list[0] ? sets[i].list : "\n",
+                         sets[i].list, !sets[i].list[0], sets[i].file);
+    }
 
-        if (write_cgroup_file(path, content, enable_debug) < 0) {
-            fprintf(stderr, "[cgroup] Failed to set CPU limit\n");
+    if (apply_io_max(&w, ctx->dir_fd, limits->io_max) < 0) {
+        fprintf(stderr, "[cgroup] Failed to set io.max\n");
+        return -1;
+    }
+
+    if (fs_batch_run(&w.batch, enable_debug) < 0) {
+        if (w.batch.overflow) {
+            fprintf(stderr, "[cgroup] Too many limit writes\n");
             return -1;
         }
-
-        if (enable_debug) {
-            printf("[cgroup] CPU limit: %ld/%ld µs\n",
-                   limits->cpu_quota, period);
+        for (unsigned i = 0; i < w.batch.count; i++) {
+            if (w.batch.ops[i].res == 0) continue;
+            if (enable_debug) {
+                fprintf(stderr, "[cgroup] Failed to %s %s: %s\n",
+                        w.batch.ops[i].failed_call, fs_batch_path(&w.batch, i),
+                        strerror(-w.batch.ops[i].res));
+            }
+            fprintf(stderr, "[cgroup] Failed to set %s\n", w.what[i]);
         }
+        return -1;
     }
 
-    // Set PID limit
-    if (limits->pid_limit > 0) {
-        char path[512];
-        char content[64];
+    if (enable_debug) {
+        if (limits->memory_limit > 0)
+            debug_log("[cgroup] Memory limit: %zu bytes\n", limits->memory_limit);
+        if (limits->cpu_quota > 0)
+            debug_log("[cgroup] CPU limit: %ld/%ld µs\n", limits->cpu_quota, period);
+        if (limits->pid_limit > 0)
+            debug_log("[cgroup] PID limit: %zu\n", limits->pid_limit);
+        if (limits->memory_high > 0)
+            debug_log("[cgroup] memory.high: %zu bytes\n", limits->memory_high);
+        if (limits->swap_limit > 0)
+            debug_log("[cgroup] Swap limit: %s\n", swap);
+        if (limits->cpu_weight > 0)
+            debug_log("[cgroup] CPU weight: %u\n", limits->cpu_weight);
+        if (limits->io_weight > 0)
+            debug_log("[cgroup] I/O weight: %u\n", limits->io_weight);
+        if (limits->cpuset_cpus[0] || limits->cpuset_mems[0])
+            debug_log("[cgroup] cpuset: cpus '%s' mems '%s'\n",
+                   limits->cpuset_cpus, limits->cpuset_mems);
+        if (limits->io_max[0])
+            debug_log("[cgroup] io.max: %s\n", limits->io_max);
+    }
+
+    return 0;
+}
 
-        snprintf(path, sizeof(path), "%s/pids.max", ctx->cgroup_path);
-        snprintf(content, sizeof(content), "%zu", limits->pid_limit);
+/**
+ * Create and setup cgroup.
+ *
+ * Steps:
+ * 1. Open the pool parent (created, controllers enabled, on first use)
+ * 2. Claim an idle slot, or mkdir one (wanting a refill); with every
+ *    slot busy, mkdir a uniquely named one-off cgroup (ctx->dir_fd)
+ * 3. With numa_auto, pick the node to pin cpus and mems to
+ * 4. Write the limits that differ (memory, cpu, pids, cpuset, io),
+ *    enabling the controllers first if the leaf lacks one it needs
+ */
+int setup_cgroup(cgroup_context_t *ctx, const cgroup_limits_t *limits,
+                 bool *needs_refill, bool enable_debug) {
+    ctx->dir_fd = -1;
+    ctx->created = false;
+    ctx->pooled = false;
+    ctx->numa_node = -1;
+    ctx->guard.active = false;
 
-        if (write_cgroup_file(path, content, enable_debug) < 0) {
-            fprintf(stderr, "[cgroup] Failed to set PID limit\n");
+    int pool = open_pool(enable_debug);
+    if (pool < 0) {
+        return -1;
+    }
+
+    bool made;
+    int slot = claim_slot(ctx, pool, &made);
+    if (slot >= 0) {
+        ctx->pooled = true;
+        snprintf(ctx->cgroup_name, sizeof(ctx->cgroup_name), "slot%d", slot);
+    } else {
+        // Every slot busy: a one-off cgroup, removed on release
+        if (ctx->id == 0) ctx->id = id_next();
+        snprintf(ctx->cgroup_name, sizeof(ctx->cgroup_name), "c_%016" PRIx64,
+                 ctx->id);
+        if (mkdirat(pool, ctx->cgroup_name, 0755) < 0) {
+            perror("mkdir(cgroup)");
             return -1;
         }
+        ctx->dir_fd = openat(pool, ctx->cgroup_name,
+                             O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+    snprintf(ctx->cgroup_path, sizeof(ctx->cgroup_path), "%s/%s/%s",
+             CGROUP_ROOT, CGROUP_POOL_DIR, ctx->cgroup_name);
+    ctx->created = true;
 
-        if (enable_debug) {
-            printf("[cgroup] PID limit: %zu\n", limits->pid_limit);
+    if (enable_debug) {
+        debug_log("[cgroup] %s cgroup: %s\n",
+               !ctx->pooled ? "Creating one-off" :
+               made ? "Created pool" : "Claimed pooled", ctx->cgroup_path);
+    }
+
+    if (ctx->dir_fd < 0) {
+        perror("open(cgroup)");
+        remove_cgroup(ctx, enable_debug);
+        return -1;
+    }
+
+    cgroup_limits_t placed;
+    if (limits->numa_auto && !limits->cpuset_cpus[0] &&
+        !limits->cpuset_mems[0]) {
+        placed = *limits;
+        ctx->numa_node = numa_pick_node(pool, placed.cpuset_cpus,
+                                        sizeof(placed.cpuset_cpus),
+                                        enable_debug);
+        if (ctx->numa_node >= 0) {
+            snprintf(placed.cpuset_mems, sizeof(placed.cpuset_mems), "%d",
+                     ctx->numa_node);
+            limits = &placed;
+        }
+    }
+
+    if (missing_controller(ctx->dir_fd, limits)) {
+        int root_fd = open(CGROUP_ROOT, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (root_fd >= 0) {
+            enable_controllers(root_fd, pool, enable_debug);
+            close(root_fd);
         }
     }
 
+    if (apply_limits(ctx, limits, enable_debug) < 0) {
+        remove_cgroup(ctx, enable_debug);
+        return -1;
+    }
+    if (!ctx->pooled || made) {                   // Pool ran dry: warm it up
+        if (needs_refill) *needs_refill = true;
+        else cgroup_pool_refill_async(enable_debug);
+    }
     return 0;
 }
 
@@ -153,46 +635,282 @@ int setup_cgroup(cgroup_context_t *ctx, const cgroup_limits_t *limits,
  */
 int add_pid_to_cgroup(const cgroup_context_t *ctx, pid_t pid,
                       bool enable_debug) {
-    char path[512];
     char content[32];
-
-    snprintf(path, sizeof(path), "%s/cgroup.procs", ctx->cgroup_path);
     snprintf(content, sizeof(content), "%d", pid);
 
-    if (write_cgroup_file(path, content, enable_debug) < 0) {
+    if (write_cgroup_file(ctx->dir_fd, "cgroup.procs", content,
+                          enable_debug) < 0) {
         fprintf(stderr, "[cgroup] Failed to add PID %d to cgroup\n", pid);
         return -1;
     }
 
     if (enable_debug) {
-        printf("[cgroup] Added PID %d to cgroup\n", pid);
+        debug_log("[cgroup] Added PID %d to cgroup\n", pid);
+    }
+
+    return 0;
+}
+
+/* ---- Memory guard -------------------------------------------------- */
+
+static const char *const memory_event_names[MEMORY_EVENT_COUNT] = {
+    "pressure", "high", "max", "oom", "oom_kill",
+};
+
+const char *memory_event_name(memory_event_kind_t kind) {
+    return kind < MEMORY_EVENT_COUNT ? memory_event_names[kind] : "?";
+}
+
+bool memory_event_imminent(memory_event_kind_t kind) {
+    return kind == MEMORY_EVENT_PRESSURE || kind == MEMORY_EVENT_MAX;
+}
+
+/**
+ * Read the memory.events counters we report (by memory_event_kind_t;
+ * the pressure slot is left 0). pread() at 0 also re-arms the POLLPRI
+ * notification.
+ */
+static int read_memory_events(int fd, uint64_t out[MEMORY_EVENT_COUNT]) {
+    char buf[512];
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n < 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+    memset(out, 0, MEMORY_EVENT_COUNT * sizeof(out[0]));
+    char *save = NULL;
+    for (char *line = strtok_r(buf, "\n", &save); line;
+         line = strtok_r(NULL, "\n", &save)) {
+        char key[32];
+        unsigned long long value;
+        if (sscanf(line, "%31s %llu", key, &value) != 2) continue;
+        for (int k = MEMORY_EVENT_HIGH; k < MEMORY_EVENT_COUNT; k++) {
+            if (strcmp(key, memory_event_names[k]) == 0) out[k] = value;
+        }
+    }
+    return 0;
+}
+
+int cgroup_guard_arm(cgroup_context_t *ctx, const memory_guard_config_t *cfg,
+                     const cgroup_limits_t *limits, bool enable_debug) {
+    cgroup_guard_t *g = &ctx->guard;
+    memset(g, 0, sizeof(*g));
+    g->psi_fd = g->events_fd = -1;
+    if (!ctx->created || ctx->dir_fd < 0) {
+        return -1;
     }
 
+    // The trigger is bound to this open file: it fires until the fd
+    // closes. Without CAP_SYS_RESOURCE the kernel only takes windows in
+    // whole multiples of 2 s (EINVAL otherwise), so retry with the window
+    // rounded up and the stall scaled to match.
+    unsigned stall = cfg->stall_us ? cfg->stall_us : MEMORY_GUARD_STALL_US;
+    unsigned window = cfg->window_us ? cfg->window_us : MEMORY_GUARD_WINDOW_US;
+    char trigger[64];
+    snprintf(trigger, sizeof(trigger), "some %u %u", stall, window);
+    g->psi_fd = openat(ctx->dir_fd, "memory.pressure",
+                       O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    ssize_t w = g->psi_fd >= 0 ? write(g->psi_fd, trigger, strlen(trigger) + 1)
+                               : 0;
+    if (w < 0 && errno == EINVAL && window % 2000000) {
+        unsigned rounded = (window / 2000000 + 1) * 2000000;
+        snprintf(trigger, sizeof(trigger), "some %llu %u",
+                 (unsigned long long)stall * rounded / window, rounded);
+        w = write(g->psi_fd, trigger, strlen(trigger) + 1);
+    }
+    if (w < 0) {
+        if (enable_debug) {
+            fprintf(stderr, "[cgroup] PSI trigger '%s' rejected: %s\n",
+                    trigger, strerror(errno));
+        }
+        close(g->psi_fd);
+        g->psi_fd = -1;
+    }
+
+    g->events_fd = openat(ctx->dir_fd, "memory.events", O_RDONLY | O_CLOEXEC);
+    if (g->events_fd >= 0 && read_memory_events(g->events_fd, g->base) < 0) {
+        close(g->events_fd);
+        g->events_fd = -1;
+    }
+
+    if (g->psi_fd < 0 && g->events_fd < 0) {
+        fprintf(stderr, "[cgroup] Memory guard unavailable: no PSI trigger "
+                        "and no memory.events\n");
+        return -1;
+    }
+    // An explicit memory.high is the caller's choice; leave it alone
+    if (cfg->high_pct > 0 && cfg->high_pct < 100 &&
+        limits->memory_limit > 0 && limits->memory_high == 0) {
+        g->throttle_to = limits->memory_limit / 100 * cfg->high_pct;
+    }
+    g->active = true;
+
+    if (enable_debug) {
+        debug_log("[cgroup] Memory guard armed: %s%s%s, throttle %s\n",
+               g->psi_fd >= 0 ? "psi " : "", g->psi_fd >= 0 ? trigger : "",
+               g->events_fd >= 0 ? " + memory.events" : "",
+               g->throttle_to ? "on" : "off");
+    }
     return 0;
 }
 
+int cgroup_guard_read(cgroup_context_t *ctx, int fd, memory_event_t *events,
+                      int max, bool enable_debug) {
+    cgroup_guard_t *g = &ctx->guard;
+    bool fired[MEMORY_EVENT_COUNT] = {false};
+    if (!g->active) {
+        return 0;
+    }
+
+    if (fd >= 0 && fd == g->psi_fd) {
+        g->counts[MEMORY_EVENT_PRESSURE]++;
+        fired[MEMORY_EVENT_PRESSURE] = true;
+    } else if (g->events_fd >= 0 && (fd < 0 || fd == g->events_fd)) {
+        uint64_t now[MEMORY_EVENT_COUNT];
+        if (read_memory_events(g->events_fd, now) == 0) {
+            for (int k = MEMORY_EVENT_HIGH; k < MEMORY_EVENT_COUNT; k++) {
+                uint64_t c = now[k] > g->base[k] ? now[k] - g->base[k] : 0;
+                if (c > g->counts[k]) {
+                    g->counts[k] = c;
+                    fired[k] = true;
+                }
+            }
+        }
+    }
+
+    char current[32] = "0";
+    read_cgroup_file(ctx->dir_fd, "memory.current", current, sizeof(current));
+    int n = 0;
+    for (int k = 0; k < MEMORY_EVENT_COUNT && n < max; k++) {
+        if (!fired[k]) continue;
+        memory_event_t *ev = &events[n++];
+        ev->kind = (memory_event_kind_t)k;
+        ev->count = g->counts[k];
+        ev->memory_current = strtoull(current, NULL, 10);
+        ev->throttled_to = 0;
+
+        if (memory_event_imminent(ev->kind) && g->throttle_to &&
+            !g->throttled) {
+            char value[32];
+            snprintf(value, sizeof(value), "%llu",
+                     (unsigned long long)g->throttle_to);
+            g->throttled = true;   // Once, even if the write fails
+            if (write_cgroup_file(ctx->dir_fd, "memory.high", value,
+                                  enable_debug) == 0) {
+                ev->throttled_to = g->throttle_to;
+            }
+        }
+        if (enable_debug) {
+            debug_log("[cgroup] Memory %s #%llu at %llu bytes%s\n",
+                   memory_event_name(ev->kind),
+                   (unsigned long long)ev->count,
+                   (unsigned long long)ev->memory_current,
+                   ev->throttled_to ? ", memory.high lowered" : "");
+        }
+        event_emit(EVENT_OOM, ctx->id, 0, (int32_t)ev->kind, ev->memory_current);
+    }
+    return n;
+}
+
 /**
- * Remove cgroup directory.
+ * Release the cgroup.
  *
- * Only succeeds when the cgroup is empty (no processes). This is why
- * we call it after waitpid() — the child has already exited.
+ * A pool slot is only unlocked (closing dir_fd drops the flock); the
+ * next claim rewrites whatever limits differ. A one-off cgroup is
+ * rmdir'd, which only succeeds once it is empty — why we call this
+ * after waitpid().
  */
 void remove_cgroup(cgroup_context_t *ctx, bool enable_debug) {
     if (!ctx->created) {
         return;
     }
 
-    if (enable_debug) {
-        printf("[cgroup] Removing cgroup: %s\n", ctx->cgroup_path);
+    if (ctx->guard.active) {
+        if (ctx->guard.psi_fd >= 0) close(ctx->guard.psi_fd);
+        if (ctx->guard.events_fd >= 0) close(ctx->guard.events_fd);
+        ctx->guard.psi_fd = ctx->guard.events_fd = -1;
+        ctx->guard.active = false;
+    }
+
+    if (ctx->dir_fd >= 0) {
+        close(ctx->dir_fd);
+        ctx->dir_fd = -1;
     }
 
-    if (rmdir(ctx->cgroup_path) < 0) {
+    if (ctx->pooled) {
         if (enable_debug) {
-            fprintf(stderr, "[cgroup] Failed to remove cgroup: %s\n",
-                    strerror(errno));
+            debug_log("[cgroup] Released pool cgroup: %s\n", ctx->cgroup_path);
+        }
+    } else {
+        if (enable_debug) {
+            debug_log("[cgroup] Removing cgroup: %s\n", ctx->cgroup_path);
+        }
+        if (rmdir(ctx->cgroup_path) < 0) {
+            if (enable_debug) {
+                fprintf(stderr, "[cgroup] Failed to remove cgroup: %s\n",
+                        strerror(errno));
+            }
         }
     }
 
     ctx->created = false;
 }
 
+/**
+ * Make slots until CGROUP_POOL_WARM are idle. Idle is "exists and can be
+ * locked right now"; racing refillers can overshoot by a few slots.
+ */
+int cgroup_pool_refill(bool enable_debug) {
+    int pool = open_pool(enable_debug);
+    if (pool < 0) {
+        return -1;
+    }
+
+    int idle = 0;
+    for (int slot = 0; slot < CGROUP_POOL_MAX_SLOTS && idle < CGROUP_POOL_WARM;
+         slot++) {
+        int fd = lock_slot(pool, slot);
+        if (fd < 0 && errno == ENOENT) {
+            char name[32];
+            snprintf(name, sizeof(name), "slot%d", slot);
+            if (mkdirat(pool, name, 0755) < 0 && errno != EEXIST) {
+                if (enable_debug) perror("[cgroup] mkdir(pool slot)");
+                break;
+            }
+            fd = lock_slot(pool, slot);
+        }
+        if (fd >= 0) {
+            idle++;
+            close(fd);
+        }
+    }
+    return idle;
+}
+
+void cgroup_pool_refill_async(bool enable_debug) {
+    fflush(NULL);   // don't let the grandchild replay our buffered output
+    debug_flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        if (enable_debug) perror("[cgroup] fork(refill)");
+        return;
+    }
+    if (pid == 0) {
+        if (fork() == 0) {
+            /* Grandchild: drop every inherited fd (a pipe end would hold
+             * the caller's pipe open), our cached pool fd included. */
+            if (syscall(SYS_close_range, 3U, ~0U, 0U) < 0) {
+                for (int fd = 3; fd < 1024; fd++) close(fd);
+            }
+            pool_fd = -1;
+            setsid();   // outlive the caller's terminal session (SIGHUP)
+            int idle = cgroup_pool_refill(enable_debug);
+            if (enable_debug) debug_log("[cgroup] Pool refill done: %d idle\n", idle);
+            fflush(NULL);
+            debug_flush();
+            _exit(idle < 0 ? 1 : 0);
+        }
+        _exit(0);
+    }
+    waitpid(pid, NULL, 0);
+}
@@ -5,7 +5,17 @@
 #include "uts.h"
 #include "cgroup.h"
 #include "net.h"
+#include "net_pool.h"
+#include "net_pod.h"
+#include "net_bridge.h"
+#include "spec.h"
+#include "seccomp.h"
+#include "image.h"
+#include "checkpoint.h"
+#include "id.h"
+#include "events.h"
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -14,10 +24,19 @@
 #include <signal.h>
 #include <sys/wait.h>
 #include <sys/mount.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/prctl.h>
+#include <sys/epoll.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/syscall.h>
 #include <dirent.h>
+#include <time.h>
 
-#define STACK_SIZE (1024 * 1024)
+#define STACK_SIZE  (1024 * 1024)
+#define STACK_GUARD 4096          // PROT_NONE page below the clone() stack
 
 /* Child-side argument struct. File-local to core.c — every helper that
  * needs to talk to the child does so through this struct.
@@ -32,73 +51,276 @@ typedef struct {
     char *const *envp;
     bool enable_debug;
     const char *rootfs_path;
+    int  rootfs_fd;              // Detached root mount to attach at
+                                 // rootfs_path; -1 = bind-mount it
     const char *hostname;
     int  sync_fd;                // -1 if no sync needed
     bool user_namespace_active;  // For /proc graceful degradation
     bool network_active;         // Gates configure_container_net()
     veth_config_t veth;          // Snapshot of veth config
     net_context_t net_ctx;       // Snapshot of net context (veth names)
+    int  request_fd;             // Zygote request channel; -1 otherwise
+    container_timings_t *timings; // Shared page; NULL unless enable_timings
+    const seccomp_program_t *seccomp;  // Compiled in the parent; NULL =
+                                       // no filter
 } child_args_t;
 
-/**
- * Close every inherited file descriptor above stderr (except the
- * `/proc/self/fd` directory we're iterating). Mitigates
- * CVE-2024-21626 / CVE-2016-9962 (mount-namespace escapes via
- * surviving fds). See Phase 3 §3.5.
- *
- * Falls back to brute-force close of [3..RLIMIT_NOFILE) when `/proc`
- * isn't mounted — graceful-degradation case from Phase 4b.
- */
-static void close_inherited_fds(bool enable_debug) {
-    DIR *dir = opendir("/proc/self/fd");
-    if (!dir) {
-        struct rlimit rl;
-        int max_fd = 1024;
-        if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
-            max_fd = (int)rl.rlim_cur;
-        }
-        if (enable_debug) {
-            printf("[child] /proc/self/fd not available, closing fds 3-%d\n",
-                   max_fd);
-        }
-        for (int fd = 3; fd < max_fd; fd++) {
-            close(fd);
+/* --timings: phase clocks are no-ops unless a timings page exists. */
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t phase_begin(const container_timings_t *tm) {
+    return tm ? mono_ns() : 0;
+}
+
+static void phase_end(container_timings_t *tm, container_phase_t phase,
+                      uint64_t t0) {
+    if (tm) tm->phase_ns[phase] += mono_ns() - t0;
+}
+
+const char *container_phase_name(container_phase_t phase) {
+    static const char *const names[CONTAINER_PHASE_COUNT] = {
+        [CONTAINER_PHASE_CGROUP]        = "cgroup",
+        [CONTAINER_PHASE_IMAGE]         = "image",
+        [CONTAINER_PHASE_OVERLAY]       = "overlay",
+        [CONTAINER_PHASE_CLONE]         = "clone",
+        [CONTAINER_PHASE_UID_MAP]       = "uid_map",
+        [CONTAINER_PHASE_NET]           = "setup_net",
+        [CONTAINER_PHASE_CGROUP_ATTACH] = "cgroup_attach",
+        [CONTAINER_PHASE_SYNC]          = "sync",
+        [CONTAINER_PHASE_HOSTNAME]      = "hostname",
+        [CONTAINER_PHASE_PIVOT_ROOT]    = "pivot_root",
+        [CONTAINER_PHASE_MOUNT_PROC]    = "mount_proc",
+        [CONTAINER_PHASE_CHILD_NET]     = "child_net",
+        [CONTAINER_PHASE_CLOSE_FDS]     = "close_fds",
+        [CONTAINER_PHASE_SECCOMP]       = "seccomp",
+    };
+    return (unsigned)phase < CONTAINER_PHASE_COUNT ? names[phase] : "unknown";
+}
+
+void container_context_assign_id(container_context_t *ctx) {
+    ctx->id = id_next();
+    ctx->cgroup_ctx.id = ctx->id;
+    ctx->overlay_ctx.id = ctx->id;
+}
+
+#ifndef SYS_close_range
+#define SYS_close_range 436
+#endif
+
+/* close_range(2) (Linux 5.9+) over [3, ~0U] minus keep_fd: one or two
+ * syscalls regardless of RLIMIT_NOFILE. -1 (ENOSYS) on older kernels. */
+static int close_fds_range(int keep_fd) {
+    unsigned first = STDERR_FILENO + 1;
+    if (keep_fd >= (int)first) {
+        if ((unsigned)keep_fd > first &&
+            syscall(SYS_close_range, first, (unsigned)keep_fd - 1, 0) < 0) {
+            return -1;
         }
-        return;
+        first = (unsigned)keep_fd + 1;
     }
+    return (int)syscall(SYS_close_range, first, ~0U, 0);
+}
+
+/* Walk /proc/self/fd, skipping the directory's own fd. -1 without /proc. */
+static int close_fds_procfs(int keep_fd, bool enable_debug) {
+    DIR *dir = opendir("/proc/self/fd");
+    if (!dir) return -1;
 
     int dir_fd = dirfd(dir);
     struct dirent *entry;
     while ((entry = readdir(dir)) != NULL) {
         if (entry->d_name[0] == '.') continue;
         int fd = atoi(entry->d_name);
-        if (fd <= STDERR_FILENO || fd == dir_fd) continue;
-        if (enable_debug) printf("[child] Closing inherited fd %d\n", fd);
+        if (fd <= STDERR_FILENO || fd == dir_fd || fd == keep_fd) continue;
+        if (enable_debug) debug_log("[child] Closing inherited fd %d\n", fd);
         close(fd);
     }
     closedir(dir);
+    return 0;
+}
+
+/* Last resort: close() every fd in [3, RLIMIT_NOFILE). */
+static void close_fds_brute(int keep_fd) {
+    struct rlimit rl;
+    int max_fd = 1024;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        max_fd = (int)rl.rlim_cur;
+    }
+    for (int fd = STDERR_FILENO + 1; fd < max_fd; fd++) {
+        if (fd != keep_fd) close(fd);
+    }
+}
+
+/**
+ * Close every inherited file descriptor above stderr (except keep_fd,
+ * -1 for none — a parked zygote keeps its request channel). Mitigates
+ * CVE-2024-21626 / CVE-2016-9962 (mount-namespace escapes via
+ * surviving fds). See Phase 3 §3.5.
+ *
+ * Strategies, cheapest first: close_range(2); a `/proc/self/fd` walk on
+ * kernels before 5.9; brute-force close of [3..RLIMIT_NOFILE) when
+ * `/proc` isn't mounted either — graceful-degradation case from Phase 4b.
+ * The last one is a syscall per possible fd (a million with nofile=1M).
+ */
+static void close_inherited_fds(int keep_fd, bool enable_debug) {
+    uint64_t t0 = enable_debug ? mono_ns() : 0;
+    const char *how = "close_range";
+
+    if (close_fds_range(keep_fd) < 0) {
+        how = "/proc/self/fd";
+        if (close_fds_procfs(keep_fd, enable_debug) < 0) {
+            how = "brute force";
+            close_fds_brute(keep_fd);
+        }
+    }
+    if (enable_debug) {
+        debug_log("[child] Closed inherited fds via %s in %.1f us\n", how,
+               (mono_ns() - t0) / 1000.0);
+    }
+}
+
+/* Parent -> zygote request: the parent-side state the child needs, then
+ * the spec blob (second iovec). SCM_RIGHTS carries stdin/stdout/stderr,
+ * for a pooled network slot or a pod its netns fd, then the detached root mount
+ * if the parent built one. */
+typedef struct {
+    net_context_t     net_ctx;
+    char              overlay_lower[PATH_MAX];  // Prepared overlay, not yet
+    char              overlay_base[PATH_MAX];   // mounted; "" = none
+    bool              mount_overlay; // Child mounts it in its own mount ns
+    bool              has_netns;     // Next fd is net_ctx.netns_fd
+    bool              has_rootfs_fd; // Last fd is the detached root mount
+    seccomp_program_t seccomp;       // Compiled by the daemon; len 0 = none
+} zygote_request_t;
+
+#define ZYGOTE_MAX_FDS 5
+
+/**
+ * Zygote park: block on the request channel, then turn args into the
+ * request's container. Everything the request points at lives in static
+ * storage — this process execs (or exits) right after.
+ *
+ * The parent has already written the id maps, created the veth and added
+ * us to the cgroup, so the request replaces the sync pipe.
+ */
+static int zygote_receive(child_args_t *args) {
+    static zygote_request_t req;
+    static uint64_t spec_buf[SPEC_MAX_SIZE / sizeof(uint64_t)];
+    static container_config_t config;
+
+    /* Die with the daemon while parked; the daemon's other fds (client
+     * sockets, sibling zygotes) must not stay open in here. */
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    close_inherited_fds(args->request_fd, false);
+
+    struct iovec iov[2] = {
+        { .iov_base = &req,     .iov_len = sizeof(req) },
+        { .iov_base = spec_buf, .iov_len = sizeof(spec_buf) },
+    };
+    union {
+        char buf[CMSG_SPACE(ZYGOTE_MAX_FDS * sizeof(int))];
+        struct cmsghdr align;
+    } cmsg_buf;
+    struct msghdr msg = {
+        .msg_iov = iov, .msg_iovlen = 2,
+        .msg_control = cmsg_buf.buf, .msg_controllen = sizeof(cmsg_buf.buf),
+    };
+    ssize_t n = recvmsg(args->request_fd, &msg, MSG_CMSG_CLOEXEC);
+    if (n <= 0) return -1;   // EOF: discarded before use
+
+    int fds[ZYGOTE_MAX_FDS];
+    size_t nfds = 0;
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    if (cm && cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS) {
+        nfds = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        memcpy(fds, CMSG_DATA(cm), nfds * sizeof(int));
+    }
+    if ((size_t)n < sizeof(req) || (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) ||
+        nfds != 3u + (req.has_netns ? 1u : 0u) + (req.has_rootfs_fd ? 1u : 0u) ||
+        spec_decode(spec_buf, (size_t)n - sizeof(req), &config) < 0) {
+        fprintf(stderr, "[child] Malformed zygote request\n");
+        return -1;
+    }
+
+    args->program      = config.program;
+    args->argv         = config.argv;
+    args->envp         = config.envp;
+    args->enable_debug = config.enable_debug;
+    args->hostname     = config.hostname;
+    args->network_active = config.enable_network;
+    args->veth         = config.veth;
+    args->net_ctx      = req.net_ctx;
+    if (req.seccomp.len > 0 && req.seccomp.len <= SECCOMP_MAX_INSNS) {
+        args->seccomp = &req.seccomp;
+    }
+    if (req.has_netns) args->net_ctx.netns_fd = fds[3];
+    if (req.has_rootfs_fd) args->rootfs_fd = fds[nfds - 1];
+
+    /* Overlay: attached from the received mount fd by setup_rootfs_fd(),
+     * or mounted here when we have our own mount namespace (a mount made
+     * in the daemon's after our clone() would not propagate). */
+    args->rootfs_path = config.rootfs_path;
+    if (req.overlay_base[0]) {
+        overlay_context_t ov = {0};   // Paths are heap; outlive ov
+        if (overlay_context_adopt(&ov, req.overlay_lower, req.overlay_base) < 0 ||
+            (req.mount_overlay && mount_overlay(&ov, args->enable_debug) < 0)) {
+            fprintf(stderr, "[child] Failed to mount overlay\n");
+            return -1;
+        }
+        args->rootfs_path = ov.merged_path;
+    }
+
+    /* The client's stdio becomes ours; the received copies are CLOEXEC
+     * and go away in close_inherited_fds()/execve(). */
+    for (int i = 0; i < 3; i++) {
+        if (fds[i] != i && dup2(fds[i], i) < 0) {
+            perror("dup2");
+            return -1;
+        }
+    }
+
+    /* The daemon blocks the signals it reads through a signalfd. */
+    sigset_t none;
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, NULL);
+    return 0;
 }
 
 /**
  * Child process entry point.
  *
  * Lifecycle:
+ *   0. Zygote only: park until the request arrives (zygote_receive)
  *   1. Wait on sync pipe (if active)
  *   2. setup_uts(hostname) if hostname set
- *   3. setup_rootfs(rootfs_path) if rootfs_path set
+ *   3. setup_rootfs(rootfs_path) if rootfs_path set (setup_rootfs_fd()
+ *      when the parent passed a detached mount)
  *   4. mount_proc() with graceful degradation under user namespace
  *   5. configure_container_net() if network active
  *   6. close_inherited_fds() — CVE-2024-21626/CVE-2016-9962 mitigation
+ *   6b. seccomp_install() if a filter was compiled
  *   7. execve(program, argv, envp)
  */
-static int child_func(void *arg) {
-    child_args_t *args = (child_args_t *)arg;
+static int child_run(child_args_t *args) {
+
+    /* 0. Zygote: the request doubles as the sync signal. */
+    if (args->request_fd >= 0 && zygote_receive(args) < 0) {
+        return 1;
+    }
+
+    container_timings_t *tm = args->timings;
+    uint64_t t;
 
     /* 1. Sync wait (parent signals when UID/GID maps + veth setup done). */
     if (args->sync_fd >= 0) {
+        t = phase_begin(tm);
         char buf;
         if (args->enable_debug) {
-            printf("[child] Waiting on sync pipe...\n");
+            debug_log("[child] Waiting on sync pipe...\n");
         }
         ssize_t n = read(args->sync_fd, &buf, 1);
         close(args->sync_fd);
@@ -106,30 +328,39 @@ static int child_func(void *arg) {
             fprintf(stderr, "[child] Sync pipe read failed\n");
             return 1;
         }
+        phase_end(tm, CONTAINER_PHASE_SYNC, t);
         if (args->enable_debug) {
-            printf("[child] Sync complete, proceeding\n");
+            debug_log("[child] Sync complete, proceeding\n");
         }
     }
 
     if (args->enable_debug) {
-        printf("[child] PID: %d, UID: %d, GID: %d\n",
+        debug_log("[child] PID: %d, UID: %d, GID: %d\n",
                getpid(), getuid(), getgid());
     }
 
     /* 2. Hostname. */
     if (args->hostname) {
+        t = phase_begin(tm);
         if (setup_uts(args->hostname, args->enable_debug) < 0) {
             fprintf(stderr, "[child] Failed to setup UTS\n");
             return 1;
         }
+        phase_end(tm, CONTAINER_PHASE_HOSTNAME, t);
     }
 
     /* 3+4. Rootfs + /proc. */
     if (args->rootfs_path) {
-        if (setup_rootfs(args->rootfs_path, args->enable_debug) < 0) {
+        t = phase_begin(tm);
+        int rc = args->rootfs_fd >= 0
+            ? setup_rootfs_fd(args->rootfs_fd, args->rootfs_path, args->enable_debug)
+            : setup_rootfs(args->rootfs_path, args->enable_debug);
+        if (rc < 0) {
             fprintf(stderr, "[child] Failed to setup rootfs\n");
             return 1;
         }
+        phase_end(tm, CONTAINER_PHASE_PIVOT_ROOT, t);
+        t = phase_begin(tm);
         if (mount_proc(args->enable_debug) < 0) {
             if (args->user_namespace_active) {
                 fprintf(stderr,
@@ -140,30 +371,517 @@ static int child_func(void *arg) {
                 return 1;
             }
         }
+        phase_end(tm, CONTAINER_PHASE_MOUNT_PROC, t);
     }
 
     /* 5. Network configuration (Phase 6). */
     if (args->network_active) {
+        t = phase_begin(tm);
         if (configure_container_net(&args->net_ctx, &args->veth,
                                     args->enable_debug) < 0) {
             fprintf(stderr, "[child] Failed to configure container network\n");
             return 1;
         }
+        phase_end(tm, CONTAINER_PHASE_CHILD_NET, t);
     }
 
     /* 6. Close inherited fds. */
-    close_inherited_fds(args->enable_debug);
+    t = phase_begin(tm);
+    close_inherited_fds(-1, args->enable_debug);
+    phase_end(tm, CONTAINER_PHASE_CLOSE_FDS, t);
+
+    /* 6b. Syscall filter: last, so none of the setup above is filtered. */
+    if (args->seccomp) {
+        t = phase_begin(tm);
+        if (seccomp_install(args->seccomp, args->enable_debug) < 0) {
+            fprintf(stderr, "[child] Failed to install seccomp filter\n");
+            return 1;
+        }
+        phase_end(tm, CONTAINER_PHASE_SECCOMP, t);
+    }
 
     /* 7. Execute target program. */
+    if (tm) tm->exec_ns = mono_ns();
+    debug_flush();
     execve(args->program, args->argv, args->envp);
+    if (tm) tm->exec_ns = 0;
     perror("execve");
     return 127;
 }
 
-container_result_t container_exec(const container_config_t *config) {
+/* clone() entry: a failed setup returns instead of exiting, so the
+ * buffered debug lines would be lost without the flush. */
+static int child_func(void *arg) {
+    int rc = child_run((child_args_t *)arg);
+    debug_flush();
+    return rc;
+}
+
+/* Clone flags for config's namespace set. A pooled network slot or a
+ * pod's netns is joined with setns() by the child, so it needs no
+ * CLONE_NEWNET. */
+static int clone_flags_for(const container_config_t *config, bool net_joined) {
+    int flags = SIGCHLD;
+    if (config->enable_user_namespace) {
+        flags |= CLONE_NEWUSER;
+        if (config->enable_debug) debug_log("[parent] Creating user namespace\n");
+    }
+    if (config->enable_pid_namespace)   flags |= CLONE_NEWPID;
+    if (config->enable_mount_namespace) flags |= CLONE_NEWNS;
+    if (config->enable_uts_namespace) {
+        flags |= CLONE_NEWUTS;
+        if (config->enable_debug) debug_log("[parent] Creating UTS namespace\n");
+    }
+    if (config->enable_ipc_namespace) {
+        flags |= CLONE_NEWIPC;
+        if (config->enable_debug) debug_log("[parent] Creating IPC namespace\n");
+    }
+    if (config->enable_network && !net_joined) {
+        flags |= CLONE_NEWNET;
+        if (config->enable_debug) debug_log("[parent] Creating network namespace\n");
+    }
+    return flags;
+}
+
+/* clone3(2) arguments (Linux 5.3+; the cgroup field is 5.7+). Declared
+ * here because <linux/sched.h> clashes with glibc's <sched.h>. */
+struct clone3_args {
+    uint64_t flags;
+    uint64_t pidfd;
+    uint64_t child_tid;
+    uint64_t parent_tid;
+    uint64_t exit_signal;
+    uint64_t stack;
+    uint64_t stack_size;
+    uint64_t tls;
+    uint64_t set_tid;
+    uint64_t set_tid_size;
+    uint64_t cgroup;
+};
+
+#ifndef CLONE_INTO_CGROUP
+#define CLONE_INTO_CGROUP 0x200000000ULL
+#endif
+#ifndef CLONE_PIDFD
+#define CLONE_PIDFD 0x00001000
+#endif
+#ifndef SYS_clone3
+#define SYS_clone3 435
+#endif
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
+#endif
+
+static int pidfd_send_signal_compat(int pidfd, int sig) {
+    return (int)syscall(SYS_pidfd_send_signal, pidfd, sig, NULL, 0);
+}
+
+/* Kill paths for a child whose setup failed: signal through the pidfd
+ * when there is one, reap, and drop the pidfd. */
+static void kill_child(pid_t pid, int *pidfd) {
+    if (*pidfd >= 0) {
+        pidfd_send_signal_compat(*pidfd, SIGKILL);
+    } else {
+        kill(pid, SIGKILL);
+    }
+    waitpid(pid, NULL, 0);
+    if (*pidfd >= 0) {
+        close(*pidfd);
+        *pidfd = -1;
+    }
+}
+
+/* Step 7: clone. Always asks for a pidfd (CLONE_PIDFD) so later kills
+ * cannot hit a recycled pid and the exit is pollable; *pidfd is -1 on
+ * kernels before 5.2.
+ *
+ * With a cgroup directory fd, clone3(CLONE_INTO_CGROUP) creates the child
+ * inside its cgroup, so limits apply from its first instruction and Step
+ * 12's cgroup.procs write is skipped (*into_cgroup). Any clone3 failure —
+ * ENOSYS before 5.3, E2BIG before 5.7, EBADF for a cgroup v1 directory —
+ * falls back to clone() + Step 12.
+ *
+ * clone3 without CLONE_VM is fork-like: the child runs on a copy of this
+ * thread's stack, so the clone3 path (tried with or without a cgroup)
+ * needs no stack of its own. Only the clone() fallback maps one, and
+ * unmaps it as soon as clone() returns: the child has its own
+ * copy-on-write copy by then, so no container keeps a stack. The guard
+ * page makes an overrun fault instead of landing in whatever the mapping
+ * below it is. */
+static pid_t clone_child(int flags, child_args_t *args, int cgroup_fd,
+                         bool *into_cgroup, int *pidfd) {
+    *into_cgroup = false;
+    *pidfd = -1;
+    int fd = -1;
+    pid_t pid;
+
+    struct clone3_args ca = {
+        .flags       = ((uint64_t)(unsigned)flags & ~(uint64_t)CSIGNAL) |
+                       CLONE_PIDFD |
+                       (cgroup_fd >= 0 ? CLONE_INTO_CGROUP : 0),
+        .pidfd       = (uint64_t)(uintptr_t)&fd,
+        .exit_signal = (uint64_t)(flags & CSIGNAL),
+        .cgroup      = cgroup_fd >= 0 ? (uint64_t)cgroup_fd : 0,
+    };
+    pid = (pid_t)syscall(SYS_clone3, &ca, sizeof(ca));
+    if (pid == 0) _exit(child_func(args));
+    if (pid > 0) {
+        *into_cgroup = cgroup_fd >= 0;
+        *pidfd = fd;
+        if (args->enable_debug && cgroup_fd >= 0) {
+            debug_log("[parent] Cloned directly into cgroup (clone3)\n");
+        }
+        return pid;
+    }
+    if (args->enable_debug) {
+        debug_log("[parent] clone3(%s) unavailable (%s), falling back to "
+               "clone()\n", cgroup_fd >= 0 ? "CLONE_INTO_CGROUP" : "CLONE_PIDFD",
+               strerror(errno));
+    }
+
+    char *map = mmap(NULL, STACK_GUARD + STACK_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK,
+                     -1, 0);
+    if (map == MAP_FAILED) return -1;
+    if (mprotect(map, STACK_GUARD, PROT_NONE) < 0) {
+        munmap(map, STACK_GUARD + STACK_SIZE);
+        return -1;
+    }
+    char *top = map + STACK_GUARD + STACK_SIZE;
+
+    pid = clone(child_func, top, flags | CLONE_PIDFD, args, &fd);
+    if (pid > 0) {
+        *pidfd = fd;
+    } else if (errno == EINVAL) {
+        pid = clone(child_func, top, flags, args);   // < 5.2
+    }
+    int saved = errno;
+    munmap(map, STACK_GUARD + STACK_SIZE);
+    errno = saved;
+    return pid;
+}
+
+/* Step 4b. Veth names are generated BEFORE clone (see Phase 6 §3.4.1).
+ * With --net-pool, claim a pre-built netns + pair instead; its names
+ * are fixed by the slot. With --pod, join the pod's netns when it is
+ * already up (no names needed), else create it like a private one. A
+ * child in its own user namespace cannot join a host-owned netns, so
+ * --user never uses the pool or a pod. No idle slot falls back to a
+ * fresh pair. On a bridge, the container's address is leased here too,
+ * since the child configures it. Returns -1 only when no address is
+ * free. */
+static int assign_veth(net_context_t *net_ctx, const container_config_t *config,
+                       uint64_t id, bool *pool_refill) {
+    if (config->veth.user_mode != NET_USER_NONE) {
+        net_ctx->user_mode = config->veth.user_mode;   // No veth at all
+        return 0;
+    }
+    if (config->veth.pod[0] && !config->enable_user_namespace) {
+        int rc = net_pod_join(net_ctx, config->veth.pod, config->enable_debug);
+        if (rc == 0) return 0;
+        if (rc < 0) {
+            fprintf(stderr, "[parent] Pod %s unavailable; using a private "
+                            "network\n", config->veth.pod);
+        }
+    } else if (config->veth.pool.size > 0 &&
+        config->veth.backend != NET_BACKEND_IP &&
+        !config->enable_user_namespace &&
+        net_pool_claim(net_ctx, &config->veth, pool_refill,
+                       config->enable_debug) == 0) {
+        if (config->enable_debug) {
+            debug_log("[parent] Claimed pooled veth: %s <-> %s\n",
+                   net_ctx->veth_host, net_ctx->veth_container);
+        }
+        return 0;
+    }
+    generate_veth_names(net_ctx, id);
+    if (config->enable_debug) {
+        debug_log("[parent] Generated veth names: %s <-> %s\n",
+               net_ctx->veth_host, net_ctx->veth_container);
+    }
+    if (config->veth.bridge[0]) {
+        return net_bridge_lease(net_ctx, &config->veth, config->enable_debug);
+    }
+    return 0;
+}
+
+/* Step 9: write uid_map/gid_map for a child in a new user namespace. */
+static int map_user_namespace(pid_t pid, const container_config_t *config) {
+    user_ns_mapping_t mapping = {
+        .uid_map_inside  = config->uid_map_inside,
+        .uid_map_outside = config->uid_map_outside,
+        .uid_map_range   = config->uid_map_range,
+        .gid_map_inside  = config->gid_map_inside,
+        .gid_map_outside = config->gid_map_outside,
+        .gid_map_range   = config->gid_map_range,
+        .enable_debug    = config->enable_debug
+    };
+    return setup_user_namespace_mapping(pid, &mapping);
+}
+
+/* ---- Parallel setup stages ---------------------------------------- */
+
+#define SETUP_STAGES_MAX 8
+
+/* One parent-side setup step of container_start(). A stage runs once
+ * every stage in its deps mask has succeeded; stages that become ready
+ * together run concurrently (run_stages). run() undoes its own partial
+ * work on failure; undo() reverts a successful run and is idempotent. */
+typedef struct {
+    const char *name;             // For [parent] debug output
+    bool        enabled;          // Disabled stages count as done
+    unsigned    deps;             // Bitmask of stage indices
+    int       (*run)(void *arg);  // 0 on success, -1 on failure
+    void      (*undo)(void *arg); // NULL = nothing to revert
+    int         rc;
+} setup_stage_t;
+
+typedef struct {
+    setup_stage_t *stage;
+    void *arg;
+} stage_job_t;
+
+static void *stage_job(void *p) {
+    stage_job_t *job = p;
+    job->stage->rc = job->stage->run(job->arg);
+    return NULL;
+}
+
+/* Undo every enabled stage, last first. */
+static void undo_stages(setup_stage_t *stages, int n, void *arg) {
+    for (int i = n - 1; i >= 0; i--) {
+        if (stages[i].enabled && stages[i].undo) stages[i].undo(arg);
+    }
+}
+
+/* Run stages in dependency waves: each wave is every stage whose deps
+ * are done, the first on this thread and the rest on their own threads
+ * (inline if pthread_create fails). Each stage mostly sleeps in a
+ * different kernel subsystem (cgroupfs, overlayfs, rtnetlink), so a
+ * wave takes as long as its slowest stage rather than their sum. There
+ * are no threads left when this returns, so clone() and fork() after
+ * it see a single-threaded parent.
+ *
+ * On failure the stages that succeeded are undone, last first — the
+ * same rollback the step-by-step path did — and -1 is returned. */
+static int run_stages(setup_stage_t *stages, int n, void *arg, bool debug) {
+    unsigned all = (1u << n) - 1, done = 0, failed = 0;
+    for (int i = 0; i < n; i++) {
+        if (!stages[i].enabled) done |= 1u << i;
+    }
+    while (done != all && !failed) {
+        int ready[SETUP_STAGES_MAX], nready = 0;
+        for (int i = 0; i < n; i++) {
+            if (!(done & (1u << i)) && (stages[i].deps & ~done) == 0) {
+                ready[nready++] = i;
+            }
+        }
+        if (nready == 0) {            // Unsatisfiable deps: a bug, not I/O
+            failed = all & ~done;
+            break;
+        }
+
+        if (debug && nready > 1) {
+            char names[256] = "";
+            size_t used = 0;
+            for (int k = 0; k < nready && used < sizeof(names); k++) {
+                used += (size_t)snprintf(names + used, sizeof(names) - used,
+                                         " %s", stages[ready[k]].name);
+            }
+            debug_log("[parent] Running concurrently:%s\n", names);
+        }
+        stage_job_t jobs[SETUP_STAGES_MAX];
+        pthread_t threads[SETUP_STAGES_MAX];
+        bool spawned[SETUP_STAGES_MAX] = {false};
+        for (int k = 0; k < nready; k++) {
+            jobs[k] = (stage_job_t){ &stages[ready[k]], arg };
+        }
+        for (int k = 1; k < nready; k++) {
+            spawned[k] = pthread_create(&threads[k], NULL, stage_job,
+                                        &jobs[k]) == 0;
+            if (!spawned[k]) stage_job(&jobs[k]);
+        }
+        stage_job(&jobs[0]);
+        for (int k = 1; k < nready; k++) {
+            if (spawned[k]) pthread_join(threads[k], NULL);
+        }
+        for (int k = 0; k < nready; k++) {
+            unsigned bit = 1u << ready[k];
+            if (stages[ready[k]].rc == 0) done |= bit; else failed |= bit;
+        }
+    }
+    if (!failed) return 0;
+    for (int i = n - 1; i >= 0; i--) {
+        if (stages[i].enabled && (done & (1u << i)) && stages[i].undo) {
+            stages[i].undo(arg);
+        }
+    }
+    return -1;
+}
+
+/* State shared by the container_start() stages. Concurrent stages write
+ * disjoint fields: cgroup_ctx + cgroup_refill / overlay_ctx + rootfs
+ * fields / net_ctx + pool_refill. Both refills fork, so they are kicked
+ * after run_stages(). */
+typedef struct {
+    const container_config_t *config;
+    container_result_t *result;
+    container_timings_t *tm;
+    const char *effective_rootfs;
+    char image_rootfs[PATH_MAX];
+    int  rootfs_fd;               // Detached root for the child, or -1
+    bool overlay_active;
+    bool pool_refill;             // Veth pool below low-water
+    bool cgroup_refill;           // Cgroup pool ran dry
+    pid_t pid;                    // Post-clone stages
+} start_state_t;
+
+enum { START_CGROUP, START_ROOTFS, START_VETH, START_PRE_CLONE };
+enum { START_UID_MAP, START_NET, START_POST_CLONE };
+
+/* Step 1: cgroup */
+static int stage_cgroup(void *arg) {
+    start_state_t *s = arg;
+    const container_config_t *config = s->config;
+    uint64_t t = phase_begin(s->tm);
+    if (setup_cgroup(&s->result->ctx.cgroup_ctx, &config->cgroup_limits,
+                     &s->cgroup_refill, config->enable_debug) < 0) {
+        fprintf(stderr, "[parent] Failed to setup cgroup\n");
+        return -1;
+    }
+    /* Advisory: without it the container still gets memory.max. */
+    if (config->memory_guard.enable) {
+        cgroup_guard_arm(&s->result->ctx.cgroup_ctx, &config->memory_guard,
+                         &config->cgroup_limits, config->enable_debug);
+    }
+    phase_end(s->tm, CONTAINER_PHASE_CGROUP, t);
+    return 0;
+}
+
+static void undo_cgroup(void *arg) {
+    start_state_t *s = arg;
+    remove_cgroup(&s->result->ctx.cgroup_ctx, s->config->enable_debug);
+}
+
+/* Steps 2b-3: image-file rootfs (erofs/squashfs) -> its shared mount,
+ * then the overlay, or a detached clone of the rootfs. Without a user
+ * namespace the child's root is built here as a detached mount
+ * (fsmount / open_tree) and the child only attaches it — the overlay
+ * then never appears in our mount namespace. Otherwise, or without
+ * the fd mount API, the overlay is mounted here and the child
+ * bind-mounts its root itself. */
+static int stage_rootfs(void *arg) {
+    start_state_t *s = arg;
+    const container_config_t *config = s->config;
+    overlay_context_t *ov = &s->result->ctx.overlay_ctx;
+    uint64_t t = phase_begin(s->tm);
+    int images = image_resolve_rootfs(config->rootfs_path, s->image_rootfs,
+                                      sizeof(s->image_rootfs),
+                                      config->enable_debug);
+    if (images < 0) {
+        fprintf(stderr, "[parent] Failed to mount rootfs image\n");
+        return -1;
+    }
+    if (images > 0) s->effective_rootfs = s->image_rootfs;
+    phase_end(s->tm, CONTAINER_PHASE_IMAGE, t);
+
+    bool detached_root = config->enable_mount_namespace &&
+                         !config->enable_user_namespace;
+    if (config->enable_overlay) {
+        t = phase_begin(s->tm);
+        int rc = prepare_overlay(ov, s->effective_rootfs,
+                                 config->container_dir, config->enable_debug);
+        if (rc == 0) {
+            if (detached_root) {
+                s->rootfs_fd = overlay_fsmount(ov, config->enable_debug);
+            }
+            if (s->rootfs_fd < 0 && (!detached_root || errno == ENOSYS)) {
+                rc = mount_overlay(ov, config->enable_debug);
+            } else if (s->rootfs_fd < 0) {
+                rc = -1;
+            }
+            if (rc < 0) teardown_overlay(ov, config->enable_debug);
+        }
+        if (rc < 0) {
+            fprintf(stderr, "[parent] Failed to setup overlay\n");
+            return -1;
+        }
+        phase_end(s->tm, CONTAINER_PHASE_OVERLAY, t);
+        s->overlay_active = true;
+        s->effective_rootfs = ov->merged_path;
+        if (config->enable_debug) {
+            debug_log("[parent] Using merged rootfs: %s\n", s->effective_rootfs);
+        }
+    } else if (detached_root) {
+        t = phase_begin(s->tm);
+        s->rootfs_fd = mount_tree_clone(s->effective_rootfs);   // -1: child binds
+        phase_end(s->tm, CONTAINER_PHASE_PIVOT_ROOT, t);
+    }
+    return 0;
+}
+
+static void undo_rootfs(void *arg) {
+    start_state_t *s = arg;
+    if (s->rootfs_fd >= 0) {
+        close(s->rootfs_fd);
+        s->rootfs_fd = -1;
+    }
+    if (s->overlay_active) {
+        teardown_overlay(&s->result->ctx.overlay_ctx, s->config->enable_debug);
+    }
+}
+
+/* Step 4b: veth names (or a pooled slot) BEFORE clone (§3.4.1) */
+static int stage_veth(void *arg) {
+    start_state_t *s = arg;
+    net_context_t *net_ctx = &s->result->ctx.net_ctx;
+    if (assign_veth(net_ctx, s->config, s->result->ctx.id,
+                    &s->pool_refill) < 0) {
+        cleanup_net(net_ctx, s->config->enable_debug);
+        return -1;
+    }
+    return 0;
+}
+
+static void undo_veth(void *arg) {
+    start_state_t *s = arg;
+    cleanup_net(&s->result->ctx.net_ctx, s->config->enable_debug);   // Pool/pod claim
+}
+
+/* Step 9: user-ns mapping */
+static int stage_uid_map(void *arg) {
+    start_state_t *s = arg;
+    uint64_t t = phase_begin(s->tm);
+    if (map_user_namespace(s->pid, s->config) < 0) {
+        fprintf(stderr, "[parent] Failed to setup user namespace mapping\n");
+        return -1;
+    }
+    phase_end(s->tm, CONTAINER_PHASE_UID_MAP, t);
+    return 0;
+}
+
+/* Step 10: setup_net (Phase 6). Independent of Step 9 for a veth: the
+ * child blocks on the sync pipe until both are done, and neither reads
+ * the other's results. A user-mode helper runs after Step 9. */
+static int stage_net(void *arg) {
+    start_state_t *s = arg;
+    uint64_t t = phase_begin(s->tm);
+    if (setup_net(&s->result->ctx.net_ctx, &s->config->veth, s->pid,
+                  s->config->enable_debug) < 0) {
+        fprintf(stderr, "[parent] Failed to setup network\n");
+        return -1;
+    }
+    phase_end(s->tm, CONTAINER_PHASE_NET, t);
+    return 0;
+}
+
+/* Steps 1-12 of container_exec(): everything up to the wait. On success
+ * the child is running in its cgroup with its network configured; on
+ * failure child_pid is -1 and everything set up so far is undone. */
+static container_result_t container_start(const container_config_t *config) {
     container_result_t result = {0};
-    bool overlay_active = false;
     int sync_pipe[2] = {-1, -1};
+    uint64_t t_entry = mono_ns();   // Reported with EVENT_STARTED
 
     /* Validate */
     if (!config || !config->program || !config->argv) {
@@ -173,94 +891,99 @@ container_result_t container_exec(const container_config_t *config) {
     }
 
     if (config->enable_debug) {
-        printf("[parent] Executing: %s", config->program);
-        for (int i = 0; config->argv[i]; i++) printf(" %s", config->argv[i]);
-        printf("\n");
-        if (config->rootfs_path) printf("[parent] Rootfs: %s\n", config->rootfs_path);
-        if (config->enable_overlay) printf("[parent] Overlay: enabled\n");
+        char args[1024] = "";
+        size_t used = 0;
+        for (int i = 0; config->argv[i] && used < sizeof(args); i++) {
+            used += (size_t)snprintf(args + used, sizeof(args) - used, " %s",
+                                     config->argv[i]);
+        }
+        debug_log("[parent] Executing: %s%s\n", config->program, args);
+        if (config->rootfs_path) debug_log("[parent] Rootfs: %s\n", config->rootfs_path);
+        if (config->enable_overlay) debug_log("[parent] Overlay: enabled\n");
         if (config->enable_network) {
-            printf("[parent] Network: enabled (%s <-> %s/%s)\n",
+            debug_log("[parent] Network: enabled (%s <-> %s/%s)\n",
                    config->veth.host_ip, config->veth.container_ip,
                    config->veth.netmask);
         }
     }
 
-    /* Phase 6 carry-forward: fail loudly here if --net is enabled but
-     * no `ip` binary exists on the host. Without this early check the
-     * failure surfaces mid-clone-and-sync with confusing diagnostics. */
-    if (config->enable_network && !find_ip_binary()) {
+    /* Phase 6 carry-forward: fail loudly here if --net is pinned to the
+     * ip(8) backend but no `ip` binary exists on the host. Without this
+     * early check the failure surfaces mid-clone-and-sync with confusing
+     * diagnostics. The netlink backends need no external binary. */
+    if (config->enable_network && config->veth.backend == NET_BACKEND_IP &&
+        !find_ip_binary()) {
         fprintf(stderr, "[parent] --net requires /sbin/ip or /usr/sbin/ip; "
                         "install the `iproute2` package\n");
         result.child_pid = -1;
         return result;
     }
 
-    /* Step 1: cgroup */
-    if (config->enable_cgroup) {
-        if (setup_cgroup(&result.ctx.cgroup_ctx, &config->cgroup_limits,
-                         config->enable_debug) < 0) {
-            fprintf(stderr, "[parent] Failed to setup cgroup\n");
-            result.child_pid = -1;
-            return result;
-        }
+    /* A bad profile fails here, before anything is built. The program
+     * is cached, so repeated starts of one profile compile it once. */
+    const seccomp_program_t *filter = NULL;
+    if (config->seccomp_profile &&
+        !(filter = seccomp_compile(config->seccomp_profile,
+                                   config->enable_debug))) {
+        fprintf(stderr, "[parent] Failed to compile seccomp profile %s\n",
+                config->seccomp_profile);
+        result.child_pid = -1;
+        return result;
     }
 
-    /* Step 2: sync pipe if user-ns OR network */
-    bool needs_sync = config->enable_user_namespace || config->enable_network;
-    if (needs_sync) {
-        if (pipe(sync_pipe) < 0) {
-            perror("pipe");
-            if (config->enable_cgroup) {
-                remove_cgroup(&result.ctx.cgroup_ctx, config->enable_debug);
-            }
-            result.child_pid = -1;
-            return result;
+    /* Step 0: timings page, shared with the child (MAP_SHARED survives
+     * clone without CLONE_VM). Released by container_cleanup(). */
+    container_timings_t *tm = NULL;
+    if (config->enable_timings) {
+        uint64_t t0 = mono_ns();
+        tm = mmap(NULL, sizeof(*tm), PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (tm == MAP_FAILED) {
+            perror("mmap(timings)");
+            tm = NULL;
+        } else {
+            tm->start_ns = t0;
+            result.ctx.timings_page = tm;
         }
     }
+    uint64_t t;
+    container_context_assign_id(&result.ctx);
 
-    /* Step 3: overlay */
-    const char *effective_rootfs = config->rootfs_path;
-    if (config->enable_overlay && config->rootfs_path) {
-        if (setup_overlay(&result.ctx.overlay_ctx, config->rootfs_path,
-                          config->container_dir, config->enable_debug) < 0) {
-            fprintf(stderr, "[parent] Failed to setup overlay\n");
-            if (sync_pipe[0] >= 0) { close(sync_pipe[0]); close(sync_pipe[1]); }
-            if (config->enable_cgroup) {
-                remove_cgroup(&result.ctx.cgroup_ctx, config->enable_debug);
-            }
-            result.child_pid = -1;
-            return result;
-        }
-        overlay_active = true;
-        effective_rootfs = result.ctx.overlay_ctx.merged_path;
-        if (config->enable_debug) {
-            printf("[parent] Using merged rootfs: %s\n", effective_rootfs);
-        }
+    /* Step 2: sync pipe if user-ns OR network */
+    bool needs_sync = config->enable_user_namespace || config->enable_network;
+    if (needs_sync && pipe(sync_pipe) < 0) {
+        perror("pipe");
+        result.child_pid = -1;
+        return result;
     }
 
-    /* Step 4: clone stack */
-    char *stack = malloc(STACK_SIZE);
-    if (!stack) {
-        perror("malloc");
-        if (overlay_active) teardown_overlay(&result.ctx.overlay_ctx, config->enable_debug);
+    /* Steps 1, 2b-3 and 4b touch disjoint kernel state (cgroupfs, the
+     * mount table, rtnetlink / pool locks), so they run as one wave. */
+    start_state_t st = {
+        .config = config,
+        .result = &result,
+        .tm = tm,
+        .effective_rootfs = config->rootfs_path,
+        .rootfs_fd = -1,
+    };
+    setup_stage_t pre[START_PRE_CLONE] = {
+        [START_CGROUP] = { "cgroup", config->enable_cgroup, 0,
+                           stage_cgroup, undo_cgroup, 0 },
+        [START_ROOTFS] = { "rootfs", config->rootfs_path != NULL, 0,
+                           stage_rootfs, undo_rootfs, 0 },
+        [START_VETH]   = { "veth", config->enable_network, 0,
+                           stage_veth, undo_veth, 0 },
+    };
+    if (run_stages(pre, START_PRE_CLONE, &st, config->enable_debug) < 0) {
         if (sync_pipe[0] >= 0) { close(sync_pipe[0]); close(sync_pipe[1]); }
-        if (config->enable_cgroup) {
-            remove_cgroup(&result.ctx.cgroup_ctx, config->enable_debug);
-        }
         result.child_pid = -1;
         return result;
     }
-    result.ctx.stack_ptr = stack;
+    const char *effective_rootfs = st.effective_rootfs;
+    int rootfs_fd = st.rootfs_fd;
 
-    /* Step 4b: generate veth names BEFORE clone (see Phase 6 §3.4.1) */
-    if (config->enable_network) {
-        generate_veth_names(&result.ctx.net_ctx);
-        if (config->enable_debug) {
-            printf("[parent] Generated veth names: %s <-> %s\n",
-                   result.ctx.net_ctx.veth_host,
-                   result.ctx.net_ctx.veth_container);
-        }
-    }
+    /* Step 4 (the clone stack) is clone_child()'s: mapped only on the
+     * clone() fallback, and gone again before it returns. */
 
     /* Step 5: child_args */
     child_args_t child_args = {
@@ -269,52 +992,49 @@ container_result_t container_exec(const container_config_t *config) {
         .envp = config->envp,
         .enable_debug = config->enable_debug,
         .rootfs_path = effective_rootfs,
+        .rootfs_fd = rootfs_fd,
         .hostname = config->hostname,
         .sync_fd = sync_pipe[0],
         .user_namespace_active = config->enable_user_namespace,
         .network_active = config->enable_network,
         .veth = config->veth,
-        .net_ctx = result.ctx.net_ctx
+        .net_ctx = result.ctx.net_ctx,
+        .request_fd = -1,
+        .timings = tm,
+        .seccomp = filter
     };
 
     /* Step 6: clone flags */
-    int flags = SIGCHLD;
-    if (config->enable_user_namespace) {
-        flags |= CLONE_NEWUSER;
-        if (config->enable_debug) printf("[parent] Creating user namespace\n");
-    }
-    if (config->enable_pid_namespace)   flags |= CLONE_NEWPID;
-    if (config->enable_mount_namespace) flags |= CLONE_NEWNS;
-    if (config->enable_uts_namespace) {
-        flags |= CLONE_NEWUTS;
-        if (config->enable_debug) printf("[parent] Creating UTS namespace\n");
-    }
-    if (config->enable_ipc_namespace) {
-        flags |= CLONE_NEWIPC;
-        if (config->enable_debug) printf("[parent] Creating IPC namespace\n");
-    }
-    if (config->enable_network) {
-        flags |= CLONE_NEWNET;
-        if (config->enable_debug) printf("[parent] Creating network namespace\n");
-    }
+    int flags = clone_flags_for(config, result.ctx.net_ctx.pooled ||
+                                        result.ctx.net_ctx.pod_member);
 
-    /* Step 7: clone */
-    pid_t pid = clone(child_func, stack + STACK_SIZE, flags, &child_args);
+    /* Step 7: clone (into the cgroup when the kernel allows) */
+    bool into_cgroup = false;
+    int pidfd = -1;
+    t = phase_begin(tm);
+    debug_flush();
+    pid_t pid = clone_child(flags, &child_args,
+                            config->enable_cgroup ? result.ctx.cgroup_ctx.dir_fd : -1,
+                            &into_cgroup, &pidfd);
+    phase_end(tm, CONTAINER_PHASE_CLONE, t);
+    /* The child has its own copy; ours would keep a never-attached
+     * overlay (and its upper/work) alive past the container. */
+    if (st.rootfs_fd >= 0) {
+        close(st.rootfs_fd);
+        st.rootfs_fd = -1;
+    }
     if (pid < 0) {
         perror("clone");
-        free(stack);
-        if (overlay_active) teardown_overlay(&result.ctx.overlay_ctx, config->enable_debug);
+        undo_stages(pre, START_PRE_CLONE, &st);
         if (sync_pipe[0] >= 0) { close(sync_pipe[0]); close(sync_pipe[1]); }
-        if (config->enable_cgroup) {
-            remove_cgroup(&result.ctx.cgroup_ctx, config->enable_debug);
-        }
         result.child_pid = -1;
-        result.ctx.stack_ptr = NULL;
         return result;
     }
     result.child_pid = pid;
+    st.pid = pid;
+    event_emit(EVENT_CREATED, result.ctx.id, pid, 0, 0);
 
-    if (config->enable_debug) printf("[parent] Child PID: %d\n", pid);
+    if (config->enable_debug) debug_log("[parent] Child PID: %d\n", pid);
 
     /* Step 8: close read end in parent */
     if (sync_pipe[0] >= 0) {
@@ -322,51 +1042,23 @@ container_result_t container_exec(const container_config_t *config) {
         sync_pipe[0] = -1;
     }
 
-    /* Step 9: user-ns mapping */
-    if (config->enable_user_namespace) {
-        user_ns_mapping_t mapping = {
-            .uid_map_inside  = config->uid_map_inside,
-            .uid_map_outside = config->uid_map_outside,
-            .uid_map_range   = config->uid_map_range,
-            .gid_map_inside  = config->gid_map_inside,
-            .gid_map_outside = config->gid_map_outside,
-            .gid_map_range   = config->gid_map_range,
-            .enable_debug    = config->enable_debug
-        };
-        if (setup_user_namespace_mapping(pid, &mapping) < 0) {
-            fprintf(stderr, "[parent] Failed to setup user namespace mapping\n");
-            if (sync_pipe[1] >= 0) close(sync_pipe[1]);
-            kill(pid, SIGKILL);
-            waitpid(pid, NULL, 0);
-            free(stack);
-            if (overlay_active) teardown_overlay(&result.ctx.overlay_ctx, config->enable_debug);
-            if (config->enable_cgroup) {
-                remove_cgroup(&result.ctx.cgroup_ctx, config->enable_debug);
-            }
-            result.child_pid = -1;
-            result.ctx.stack_ptr = NULL;
-            return result;
-        }
-    }
-
-    /* Step 10: setup_net (Phase 6) */
-    if (config->enable_network) {
-        if (setup_net(&result.ctx.net_ctx, &config->veth, pid,
-                      config->enable_debug) < 0) {
-            fprintf(stderr, "[parent] Failed to setup network\n");
-            if (sync_pipe[1] >= 0) close(sync_pipe[1]);
-            kill(pid, SIGKILL);
-            waitpid(pid, NULL, 0);
-            free(stack);
-            if (overlay_active) teardown_overlay(&result.ctx.overlay_ctx, config->enable_debug);
-            cleanup_net(&result.ctx.net_ctx, config->enable_debug);
-            if (config->enable_cgroup) {
-                remove_cgroup(&result.ctx.cgroup_ctx, config->enable_debug);
-            }
-            result.child_pid = -1;
-            result.ctx.stack_ptr = NULL;
-            return result;
-        }
+    /* Steps 9-10, concurrently: the child waits on the sync pipe for both.
+     * A user-mode network helper builds its tap as the namespace's
+     * mapped root, so it waits for the maps. */
+    unsigned net_deps = config->veth.user_mode != NET_USER_NONE
+                      ? 1u << START_UID_MAP : 0;
+    setup_stage_t post[START_POST_CLONE] = {
+        [START_UID_MAP] = { "uid_map", config->enable_user_namespace, 0,
+                            stage_uid_map, NULL, 0 },
+        [START_NET]     = { "setup_net", config->enable_network, net_deps,
+                            stage_net, NULL, 0 },
+    };
+    if (run_stages(post, START_POST_CLONE, &st, config->enable_debug) < 0) {
+        if (sync_pipe[1] >= 0) close(sync_pipe[1]);
+        kill_child(pid, &pidfd);
+        undo_stages(pre, START_PRE_CLONE, &st);
+        result.child_pid = -1;
+        return result;
     }
 
     /* Step 11: signal child */
@@ -376,63 +1068,641 @@ container_result_t container_exec(const container_config_t *config) {
         }
         close(sync_pipe[1]);
         sync_pipe[1] = -1;
-        if (config->enable_debug) printf("[parent] Signaled child to proceed\n");
+        if (config->enable_debug) debug_log("[parent] Signaled child to proceed\n");
     }
 
-    /* Step 12: add_pid_to_cgroup AFTER sync (cgroup checks mapped UID) */
-    if (config->enable_cgroup) {
+    /* Step 11b: top the veth and cgroup pools back up off the start path */
+    if (st.pool_refill) net_pool_refill_async(&config->veth, config->enable_debug);
+    if (st.cgroup_refill) cgroup_pool_refill_async(config->enable_debug);
+
+    /* Step 12: add_pid_to_cgroup AFTER sync (cgroup checks mapped UID),
+     * unless clone3 already placed the child */
+    if (config->enable_cgroup && !into_cgroup) {
+        t = phase_begin(tm);
         if (add_pid_to_cgroup(&result.ctx.cgroup_ctx, pid,
                               config->enable_debug) < 0) {
             fprintf(stderr, "[parent] Failed to add PID to cgroup\n");
-            kill(pid, SIGKILL);
-            waitpid(pid, NULL, 0);
-            free(stack);
-            if (overlay_active) teardown_overlay(&result.ctx.overlay_ctx, config->enable_debug);
-            cleanup_net(&result.ctx.net_ctx, config->enable_debug);
-            remove_cgroup(&result.ctx.cgroup_ctx, config->enable_debug);
+            kill_child(pid, &pidfd);
+            undo_stages(pre, START_PRE_CLONE, &st);
             result.child_pid = -1;
-            result.ctx.stack_ptr = NULL;
             return result;
         }
+        phase_end(tm, CONTAINER_PHASE_CGROUP_ATTACH, t);
     }
 
-    /* Step 13: waitpid */
+    result.pidfd = pidfd;
+    result.has_pidfd = pidfd >= 0;
+    event_emit(EVENT_STARTED, result.ctx.id, pid, 0, mono_ns() - t_entry);
+    return result;
+}
+
+/* Poll the pidfd and the guard's fds until the child exits; events are
+ * acted on (throttling) and logged, and their counts stay in the guard. */
+static void wait_guarded(container_result_t *result, bool debug) {
+    cgroup_context_t *cg = &result->ctx.cgroup_ctx;
+    memory_event_t events[MEMORY_EVENT_COUNT];
+    struct pollfd fds[3] = {
+        { .fd = result->pidfd,       .events = POLLIN },
+        { .fd = cg->guard.psi_fd,    .events = POLLPRI },   // -1: skipped
+        { .fd = cg->guard.events_fd, .events = POLLPRI },
+    };
+    for (;;) {
+        if (poll(fds, 3, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("poll");
+            return;
+        }
+        if (fds[0].revents) break;
+        for (int i = 1; i < 3; i++) {
+            if (fds[i].revents) {
+                cgroup_guard_read(cg, fds[i].fd, events, MEMORY_EVENT_COUNT,
+                                  debug);
+            }
+        }
+    }
+    cgroup_guard_read(cg, -1, events, MEMORY_EVENT_COUNT, debug);
+}
+
+container_result_t container_exec(const container_config_t *config) {
+    container_result_t result = config->restore_dir ? container_restore(config)
+                                                    : container_start(config);
+    debug_flush();
+    if (result.child_pid < 0) return result;
+
+    /* Step 13: waitpid, watching the memory guard meanwhile */
+    if (result.ctx.cgroup_ctx.guard.active && result.has_pidfd) {
+        wait_guarded(&result, config->enable_debug);
+    }
     int status;
-    if (waitpid(pid, &status, 0) < 0) {
+    if (waitpid(result.child_pid, &status, 0) < 0) {
         perror("waitpid");
         result.exit_status = -1;
-        if (overlay_active) teardown_overlay(&result.ctx.overlay_ctx, config->enable_debug);
+        if (result.ctx.overlay_ctx.container_base) {
+            teardown_overlay(&result.ctx.overlay_ctx, config->enable_debug);
+        }
         cleanup_net(&result.ctx.net_ctx, config->enable_debug);
         return result;
     }
 
-    /* Step 14: parse status */
+    /* Step 14+15: parse status, teardown overlay (cgroup + net deferred
+     * to container_cleanup) */
+    container_reap(&result, status, config->enable_debug);
+    debug_flush();
+
+    return result;
+}
+
+void container_reap(container_result_t *result, int status,
+                    bool enable_debug) {
+    if (!result) return;
+    result->reaped = true;
+
     if (WIFEXITED(status)) {
-        result.exited_normally = true;
-        result.exit_status = WEXITSTATUS(status);
-        if (config->enable_debug) printf("[parent] Child exited: %d\n", result.exit_status);
+        result->exited_normally = true;
+        result->exit_status = WEXITSTATUS(status);
+        if (enable_debug) debug_log("[parent] Child exited: %d\n", result->exit_status);
     } else if (WIFSIGNALED(status)) {
-        result.exited_normally = false;
-        result.signal = WTERMSIG(status);
-        result.exit_status = 128 + result.signal;
-        if (config->enable_debug) {
-            printf("[parent] Child killed by signal: %d\n", result.signal);
+        result->exited_normally = false;
+        result->signal = WTERMSIG(status);
+        result->exit_status = 128 + result->signal;
+        if (enable_debug) {
+            debug_log("[parent] Child killed by signal: %d\n", result->signal);
         }
     }
 
-    /* Step 15: teardown overlay (cgroup + net deferred to container_cleanup) */
-    if (overlay_active) teardown_overlay(&result.ctx.overlay_ctx, config->enable_debug);
+    if (result->ctx.overlay_ctx.container_base) {
+        teardown_overlay(&result->ctx.overlay_ctx, enable_debug);
+    }
 
-    return result;
+    /* The child is gone, so its half of the timings page is final. */
+    if (result->ctx.timings_page) {
+        result->timings = *result->ctx.timings_page;
+        result->timings.valid = true;
+    }
+    event_emit(EVENT_EXITED, result->ctx.id, result->child_pid,
+               result->exit_status, (uint64_t)result->signal);
+}
+
+int container_signal(const container_result_t *result, int sig) {
+    if (!result || result->child_pid <= 0 || result->reaped) {
+        errno = ESRCH;
+        return -1;
+    }
+    if (result->has_pidfd) return pidfd_send_signal_compat(result->pidfd, sig);
+    return kill(result->child_pid, sig);
 }
 
 void container_cleanup(container_result_t *result) {
     if (!result) return;
 
+    if (result->has_pidfd) {
+        close(result->pidfd);
+        result->has_pidfd = false;
+        result->pidfd = -1;
+    }
+
+    if (result->ctx.timings_page) {
+        munmap(result->ctx.timings_page, sizeof(*result->ctx.timings_page));
+        result->ctx.timings_page = NULL;
+    }
     cleanup_net(&result->ctx.net_ctx, false);
     remove_cgroup(&result->ctx.cgroup_ctx, false);
-    if (result->ctx.stack_ptr) {
-        free(result->ctx.stack_ptr);
-        result->ctx.stack_ptr = NULL;
+
+    if (result->child_pid > 0 && !result->cleaned) {
+        event_emit(EVENT_CLEANUP, result->ctx.id, result->child_pid, 0, 0);
+    }
+    result->cleaned = true;
+}
+int container_zygote_spawn(container_zygote_t *z, const container_config_t *tmpl) {
+    if (!z || !tmpl) return -1;
+    memset(z, 0, sizeof(*z));
+    z->ctl_fd = -1;
+    z->pidfd = -1;
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0) {
+        perror("socketpair");
+        return -1;
+    }
+    child_args_t child_args = {
+        .enable_debug = tmpl->enable_debug,
+        .rootfs_fd = -1,
+        .sync_fd = -1,
+        .user_namespace_active = tmpl->enable_user_namespace,
+        .request_fd = sv[1]
+    };
+    z->clone_flags = clone_flags_for(tmpl, false);
+
+    /* Image-file rootfs mounts made after this clone must still reach the
+     * zygote's mount namespace: set up the shared IMAGE_MOUNT_DIR first. */
+    if ((z->clone_flags & CLONE_NEWNS) && geteuid() == 0) {
+        image_mount_dir_init(tmpl->enable_debug);
+    }
+
+    bool into_cgroup;
+    debug_flush();
+    pid_t pid = clone_child(z->clone_flags, &child_args, -1,
+                            &into_cgroup, &z->pidfd);
+    close(sv[1]);
+    if (pid < 0) {
+        perror("clone");
+        close(sv[0]);
+        return -1;
+    }
+
+    z->pid = pid;
+    z->ctl_fd = sv[0];
+    z->key = *tmpl;
+    z->key.program = NULL;
+    z->key.argv = NULL;
+    z->key.envp = NULL;
+    z->key.rootfs_path = NULL;
+    z->key.container_dir = NULL;
+    z->key.hostname = NULL;
+
+    if (tmpl->enable_user_namespace && map_user_namespace(pid, tmpl) < 0) {
+        fprintf(stderr, "[parent] Failed to setup zygote user namespace mapping\n");
+        container_zygote_discard(z);
+        return -1;
+    }
+
+    if (tmpl->enable_debug) debug_log("[parent] Zygote parked: PID %d\n", pid);
+    return 0;
+}
+
+bool container_zygote_matches(const container_zygote_t *z,
+                              const container_config_t *config) {
+    if (!z || z->pid <= 0 || !config) return false;
+
+    container_config_t quiet = *config;
+    quiet.enable_debug = false;
+    if (clone_flags_for(&quiet, false) != z->clone_flags) return false;
+    if (!(z->clone_flags & CLONE_NEWUSER)) return true;
+
+    return config->uid_map_inside  == z->key.uid_map_inside &&
+           config->uid_map_outside == z->key.uid_map_outside &&
+           config->uid_map_range   == z->key.uid_map_range &&
+           config->gid_map_inside  == z->key.gid_map_inside &&
+           config->gid_map_outside == z->key.gid_map_outside &&
+           config->gid_map_range   == z->key.gid_map_range;
+}
+
+int container_zygote_launch(container_zygote_t *z,
+                            const container_config_t *config,
+                            const int stdio_fds[3],
+                            container_result_t *result) {
+    if (!result) return -1;
+    memset(result, 0, sizeof(*result));
+    result->child_pid = -1;
+    if (!z || z->pid <= 0 || !config || !config->program || !config->argv ||
+        !stdio_fds) {
+        fprintf(stderr, "container_zygote_launch: invalid arguments\n");
+        return -1;
+    }
+
+    bool debug = config->enable_debug;
+    zygote_request_t req = {0};
+    bool pool_refill = false;
+    bool cgroup_refill = false;
+    void *spec = NULL;
+    int rootfs_fd = -1;
+    container_context_assign_id(&result->ctx);
+
+    /* Step 0: the filter, compiled (once per profile) by the daemon and
+     * handed over in the request. */
+    if (config->seccomp_profile) {
+        const seccomp_program_t *filter =
+            seccomp_compile(config->seccomp_profile, debug);
+        if (!filter) {
+            fprintf(stderr, "[parent] Failed to compile seccomp profile %s\n",
+                    config->seccomp_profile);
+            goto fail;
+        }
+        req.seccomp = *filter;
+    }
+
+    /* Step 1: cgroup */
+    if (config->enable_cgroup &&
+        setup_cgroup(&result->ctx.cgroup_ctx, &config->cgroup_limits,
+                     &cgroup_refill, debug) < 0) {
+        fprintf(stderr, "[parent] Failed to setup cgroup\n");
+        goto fail;
+    }
+
+    /* Step 1b: image-file rootfs -> its shared mount, which propagates
+     * into the zygote's mount namespace (image_mount_dir_init at spawn).
+     * The request carries the resolved path. */
+    container_config_t resolved = *config;
+    char image_rootfs[PATH_MAX];
+    if (config->rootfs_path) {
+        int images = image_resolve_rootfs(config->rootfs_path, image_rootfs,
+                                          sizeof(image_rootfs), debug);
+        if (images < 0) {
+            fprintf(stderr, "[parent] Failed to mount rootfs image\n");
+            goto fail;
+        }
+        if (images > 0) resolved.rootfs_path = image_rootfs;
+    }
+    config = &resolved;
+
+    /* Step 2: overlay directories; the mount follows the zygote's mount
+     * namespace (see zygote_receive). As in container_start(), a zygote
+     * without a user namespace gets its root as a detached mount. */
+    bool detached_root = config->rootfs_path &&
+                         (z->clone_flags & CLONE_NEWNS) &&
+                         !(z->clone_flags & CLONE_NEWUSER);
+    if (config->enable_overlay && config->rootfs_path) {
+        if (prepare_overlay(&result->ctx.overlay_ctx, config->rootfs_path,
+                            config->container_dir, debug) < 0) {
+            fprintf(stderr, "[parent] Failed to setup overlay\n");
+            goto fail;
+        }
+        if (detached_root) {
+            rootfs_fd = overlay_fsmount(&result->ctx.overlay_ctx, debug);
+            if (rootfs_fd < 0 && errno != ENOSYS) {
+                fprintf(stderr, "[parent] Failed to build overlay\n");
+                goto fail;
+            }
+        }
+        if (rootfs_fd >= 0) {
+            // Attached by the zygote
+        } else if (z->clone_flags & CLONE_NEWNS) {
+            req.mount_overlay = true;
+        } else if (mount_overlay(&result->ctx.overlay_ctx, debug) < 0) {
+            fprintf(stderr, "[parent] Failed to mount overlay\n");
+            goto fail;
+        }
+    } else if (detached_root) {
+        rootfs_fd = mount_tree_clone(config->rootfs_path);   // -1: zygote binds
+    }
+
+    /* Step 3: veth into the zygote's netns, then cgroup membership — both
+     * before the request, so the program starts fully placed. */
+    if (config->enable_network) {
+        if (assign_veth(&result->ctx.net_ctx, config, result->ctx.id,
+                        &pool_refill) < 0 ||
+            setup_net(&result->ctx.net_ctx, &config->veth, z->pid, debug) < 0) {
+            fprintf(stderr, "[parent] Failed to setup network\n");
+            goto fail;
+        }
+    }
+    if (config->enable_cgroup &&
+        add_pid_to_cgroup(&result->ctx.cgroup_ctx, z->pid, debug) < 0) {
+        fprintf(stderr, "[parent] Failed to add PID to cgroup\n");
+        goto fail;
+    }
+
+    /* Step 4: the request */
+    spec = malloc(SPEC_MAX_SIZE);
+    size_t spec_len = spec ? spec_encode(config, spec, SPEC_MAX_SIZE) : 0;
+    if (spec_len == 0) {
+        fprintf(stderr, "[parent] Failed to encode container spec\n");
+        goto fail;
+    }
+    req.net_ctx = result->ctx.net_ctx;
+    if (result->ctx.overlay_ctx.container_base) {
+        snprintf(req.overlay_lower, sizeof(req.overlay_lower), "%s",
+                 result->ctx.overlay_ctx.lower_path);
+        snprintf(req.overlay_base, sizeof(req.overlay_base), "%s",
+                 result->ctx.overlay_ctx.container_base);
+    }
+    req.has_netns = result->ctx.net_ctx.pooled || result->ctx.net_ctx.pod_member;
+    req.has_rootfs_fd = rootfs_fd >= 0;
+
+    int fds[ZYGOTE_MAX_FDS] = { stdio_fds[0], stdio_fds[1], stdio_fds[2] };
+    size_t nfds = 3;
+    if (req.has_netns) fds[nfds++] = result->ctx.net_ctx.netns_fd;
+    if (req.has_rootfs_fd) fds[nfds++] = rootfs_fd;
+    struct iovec iov[2] = {
+        { .iov_base = &req, .iov_len = sizeof(req) },
+        { .iov_base = spec, .iov_len = spec_len },
+    };
+    union {
+        char buf[CMSG_SPACE(ZYGOTE_MAX_FDS * sizeof(int))];
+        struct cmsghdr align;
+    } cmsg_buf;
+    memset(&cmsg_buf, 0, sizeof(cmsg_buf));
+    struct msghdr msg = {
+        .msg_iov = iov, .msg_iovlen = 2,
+        .msg_control = cmsg_buf.buf,
+        .msg_controllen = CMSG_SPACE(nfds * sizeof(int)),
+    };
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(nfds * sizeof(int));
+    memcpy(CMSG_DATA(cm), fds, nfds * sizeof(int));
+
+    debug_flush();
+    if (sendmsg(z->ctl_fd, &msg, MSG_NOSIGNAL) < 0) {
+        perror("sendmsg(zygote)");
+        goto fail;
+    }
+    free(spec);
+    if (rootfs_fd >= 0) close(rootfs_fd);   // The zygote holds its own now
+
+    /* The zygote is now the container. */
+    int ctl_fd = z->ctl_fd;
+    result->child_pid = z->pid;
+    result->pidfd = z->pidfd;
+    result->has_pidfd = z->pidfd >= 0;
+    z->pid = 0;
+    z->pidfd = -1;
+    z->ctl_fd = -1;
+    event_emit(EVENT_CREATED, result->ctx.id, result->child_pid, 0, 0);
+    if (debug) debug_log("[parent] Launched in zygote PID %d\n", result->child_pid);
+
+    /* Step 5: top the veth and cgroup pools back up off the start path */
+    if (pool_refill) net_pool_refill_async(&config->veth, debug);
+    if (cgroup_refill) cgroup_pool_refill_async(debug);
+    return ctl_fd;
+
+fail:
+    free(spec);
+    if (rootfs_fd >= 0) close(rootfs_fd);
+    container_zygote_discard(z);
+    if (result->ctx.overlay_ctx.container_base) {
+        teardown_overlay(&result->ctx.overlay_ctx, debug);
+    }
+    cleanup_net(&result->ctx.net_ctx, debug);
+    remove_cgroup(&result->ctx.cgroup_ctx, debug);
+    result->child_pid = -1;
+    return -1;
+}
+
+void container_zygote_discard(container_zygote_t *z) {
+    if (!z) return;
+    if (z->pid > 0) {
+        kill_child(z->pid, &z->pidfd);
+        z->pid = 0;
+    }
+    if (z->pidfd >= 0) {
+        close(z->pidfd);
+        z->pidfd = -1;
+    }
+    if (z->ctl_fd >= 0) {
+        close(z->ctl_fd);
+        z->ctl_fd = -1;
+    }
+}
+
+/* ---- Event loop (container_spawn / container_poll) ---------------- */
+
+struct container_loop {
+    int      epoll_fd;
+    unsigned running;
+    container_handle_t *head;   // Running handles, for loop_destroy
+};
+
+static int pidfd_open_compat(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+container_loop_t *container_loop_create(void) {
+    container_loop_t *loop = calloc(1, sizeof(*loop));
+    if (!loop) return NULL;
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd < 0) {
+        free(loop);
+        return NULL;
+    }
+    return loop;
+}
+
+/* Epoll data of h->sources[idx]: calloc'd handles are aligned far past
+ * the two low bits the index needs. */
+static uint64_t source_tag(container_handle_t *h, unsigned idx) {
+    return (uint64_t)(uintptr_t)h | idx;
+}
+
+static unsigned source_index(uint64_t tag) {
+    return (unsigned)(tag & 3);
+}
+
+static container_handle_t *source_handle(uint64_t tag) {
+    return (container_handle_t *)(uintptr_t)(tag & ~(uint64_t)3);
+}
+
+container_handle_t *container_spawn(container_loop_t *loop,
+                                    const container_config_t *config,
+                                    container_exit_fn on_exit, void *user) {
+    if (!loop) return NULL;
+    container_handle_t *h = calloc(1, sizeof(*h));
+    if (!h) {
+        perror("calloc");
+        return NULL;
+    }
+
+    h->result = config->restore_dir ? container_restore(config)
+                                    : container_start(config);
+    if (h->result.child_pid < 0) {
+        free(h);
+        return NULL;
+    }
+    h->enable_debug = config->enable_debug;
+    h->on_exit = on_exit;
+    h->user = user;
+
+    /* Normally the pidfd comes from CLONE_PIDFD. Otherwise open one: we
+     * are the parent, so the pid cannot be recycled before we reap it. */
+    if (!h->result.has_pidfd) {
+        h->result.pidfd = pidfd_open_compat(h->result.child_pid);
+        h->result.has_pidfd = h->result.pidfd >= 0;
+    }
+    h->sources[0] = (container_source_t){ h->result.pidfd };
+    struct epoll_event ev = { .events = EPOLLIN, .data.u64 = source_tag(h, 0) };
+    if (!h->result.has_pidfd ||
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, h->result.pidfd, &ev) < 0) {
+        perror("[parent] pidfd_open/epoll_ctl");
+        int status = 0;
+        container_signal(&h->result, SIGKILL);
+        waitpid(h->result.child_pid, &status, 0);
+        container_reap(&h->result, status, false);
+        container_cleanup(&h->result);
+        free(h);
+        return NULL;
+    }
+    /* Guard fds signal POLLPRI; one that cannot be added just goes unwatched. */
+    const cgroup_guard_t *g = &h->result.ctx.cgroup_ctx.guard;
+    int guard_fds[2] = { g->active ? g->psi_fd : -1, g->active ? g->events_fd : -1 };
+    for (int i = 0; i < 2; i++) {
+        h->sources[i + 1] = (container_source_t){ guard_fds[i] };
+        struct epoll_event gev = { .events = EPOLLPRI,
+                                   .data.u64 = source_tag(h, i + 1) };
+        if (guard_fds[i] >= 0 &&
+            epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, guard_fds[i], &gev) < 0) {
+            perror("[parent] epoll_ctl(memory guard)");
+            h->sources[i + 1].fd = -1;
+        }
+    }
+    h->loop = loop;
+    h->next = loop->head;
+    if (loop->head) loop->head->prev = h;
+    loop->head = h;
+    loop->running++;
+    return h;
+}
+
+/* Read a guard fd (-1: drain memory.events) and run on_memory. */
+static void guard_dispatch(container_handle_t *h, int fd) {
+    memory_event_t events[MEMORY_EVENT_COUNT];
+    int n = cgroup_guard_read(&h->result.ctx.cgroup_ctx, fd, events,
+                              MEMORY_EVENT_COUNT, h->enable_debug);
+    for (int i = 0; i < n && h->on_memory; i++) {
+        h->on_memory(h, &events[i], h->user);
     }
-}
\ No newline at end of file
+}
+
+/* The reap callback: status, then teardown (overlay in container_reap,
+ * network + cgroup in container_cleanup), then the user's hook. */
+static int reap_handle(container_handle_t *h, int wait_flags) {
+    int status;
+    pid_t r = waitpid(h->result.child_pid, &status, wait_flags);
+    if (r == 0) return 0;   // Spurious wakeup
+    if (r < 0) {
+        perror("waitpid");
+        h->result.exit_status = -1;
+    } else {
+        container_reap(&h->result, status, h->enable_debug);
+    }
+    for (int i = 0; i < 3; i++) {
+        if (h->sources[i].fd >= 0) {
+            epoll_ctl(h->loop->epoll_fd, EPOLL_CTL_DEL, h->sources[i].fd, NULL);
+        }
+    }
+    guard_dispatch(h, -1);   // The oom_kill that ended it, usually
+    container_cleanup(&h->result);   // Closes the pidfd and guard fds
+
+    h->reaped = true;
+    if (h->prev) h->prev->next = h->next;
+    else h->loop->head = h->next;
+    if (h->next) h->next->prev = h->prev;
+    h->prev = h->next = NULL;
+    h->loop->running--;
+    h->loop = NULL;
+
+    if (h->on_exit) h->on_exit(h, h->user);
+    return 1;
+}
+
+#define CONTAINER_POLL_BATCH 64
+
+int container_poll(container_loop_t *loop, int timeout_ms) {
+    if (!loop) return -1;
+    struct epoll_event evs[CONTAINER_POLL_BATCH];
+    int n;
+    do {
+        n = epoll_wait(loop->epoll_fd, evs, CONTAINER_POLL_BATCH, timeout_ms);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        perror("epoll_wait");
+        return -1;
+    }
+
+    /* Guard events first: an on_exit callback may free its handle, so
+     * the reap pass reads only the tags, never a guard event's handle. */
+    for (int i = 0; i < n; i++) {
+        unsigned idx = source_index(evs[i].data.u64);
+        container_handle_t *h = source_handle(evs[i].data.u64);
+        if (idx != 0) guard_dispatch(h, h->sources[idx].fd);
+    }
+    int reaped = 0;
+    for (int i = 0; i < n; i++) {
+        if (source_index(evs[i].data.u64) == 0) {
+            reaped += reap_handle(source_handle(evs[i].data.u64), WNOHANG);
+        }
+    }
+    debug_flush();
+    return reaped;
+}
+
+container_handle_t *container_wait_any(container_loop_t *loop) {
+    while (loop && loop->running > 0) {
+        struct epoll_event ev;
+        int n = epoll_wait(loop->epoll_fd, &ev, 1, -1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            perror("epoll_wait");
+            return NULL;
+        }
+        unsigned idx = source_index(ev.data.u64);
+        container_handle_t *h = source_handle(ev.data.u64);
+        if (idx != 0) {
+            guard_dispatch(h, h->sources[idx].fd);
+        } else if (reap_handle(h, WNOHANG)) {
+            return h;
+        }
+    }
+    return NULL;
+}
+
+unsigned container_loop_running(const container_loop_t *loop) {
+    return loop ? loop->running : 0;
+}
+
+void container_handle_free(container_handle_t *h) {
+    if (!h) return;
+    if (!h->reaped && h->loop) {
+        container_signal(&h->result, SIGKILL);
+        h->on_exit = NULL;
+        reap_handle(h, 0);
+    }
+    free(h);
+}
+
+void container_loop_destroy(container_loop_t *loop) {
+    if (!loop) return;
+    while (loop->head) {
+        container_handle_t *h = loop->head;
+        container_signal(&h->result, SIGKILL);
+        reap_handle(h, 0);
+    }
+    close(loop->epoll_fd);
+    free(loop);
+}
@@ -1,5 +1,6 @@
 // Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
 #include "env.h"
+#include "events.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -57,9 +58,9 @@ char **build_container_env(char *const *custom_env, bool enable_debug) {
     env[count] = NULL;
 
     if (enable_debug) {
-        printf("[parent] Container environment:\n");
+        debug_log("[parent] Container environment:\n");
         for (int i = 0; env[i]; i++) {
-            printf("[parent]   %s\n", env[i]);
+            debug_log("[parent]   %s\n", env[i]);
         }
     }
 
@@ -0,0 +1,327 @@
+// Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include "events.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define EVENT_RING_MAGIC    0x5645434dU   // "MCEV" little-endian
+#define EVENT_RING_VERSION  1
+#define EVENT_RING_MIN      16
+#define EVENT_RING_MAX      (1U << 20)
+#define EVENT_LINE_MAX      4096          // One debug_log() line
+#define SLOT_BUSY           (1ULL << 63)
+#define SLOT_SPIN_MAX       1024
+
+/* seq is the event's position + 1 once it is complete (0: never
+ * written); SLOT_BUSY is set on it while that position's writer fills
+ * the slot. A writer claims its slot with a CAS, so one a full lap
+ * behind (preempted mid-event) cannot write the same slot at once: the
+ * later one waits for it, up to SLOT_SPIN_MAX yields (in case it died
+ * there), and a stale writer that lost its slot skips its event. */
+typedef struct {
+    _Atomic uint64_t seq;
+    event_t ev;
+} event_slot_t;
+
+_Static_assert(sizeof(event_slot_t) == 128, "event slot is two cache lines");
+
+struct event_ring {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;          // Power of two
+    uint32_t slot_size;
+    uint64_t size;              // Bytes mapped
+    char     pad0[40];
+    _Atomic uint64_t head;      // Next position; alone on its cache line
+    char     pad1[56];
+    event_slot_t slots[];
+};
+
+static event_ring_t *attached;
+
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+event_ring_t *event_ring_create(const char *path, unsigned capacity) {
+    unsigned cap = EVENT_RING_MIN;
+    if (capacity == 0) capacity = EVENT_RING_DEFAULT;
+    while (cap < capacity && cap < EVENT_RING_MAX) cap <<= 1;
+    size_t size = sizeof(event_ring_t) + (size_t)cap * sizeof(event_slot_t);
+
+    char tmp[PATH_MAX];
+    int fd = -1;
+    if (path) {
+        if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path) >= (int)sizeof(tmp)) {
+            errno = ENAMETOOLONG;
+            return NULL;
+        }
+        fd = mkostemp(tmp, O_CLOEXEC);
+        if (fd < 0) return NULL;
+        if (fchmod(fd, 0644) < 0 || ftruncate(fd, (off_t)size) < 0) {
+            int err = errno;
+            close(fd);
+            unlink(tmp);
+            errno = err;
+            return NULL;
+        }
+    }
+    event_ring_t *r = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                           path ? MAP_SHARED : MAP_SHARED | MAP_ANONYMOUS,
+                           fd, 0);
+    int err = errno;
+    if (fd >= 0) close(fd);
+    if (r == MAP_FAILED) {
+        if (path) unlink(tmp);
+        errno = err;
+        return NULL;
+    }
+    /* Both mappings start zeroed: head 0, every slot unwritten. */
+    r->capacity = cap;
+    r->slot_size = sizeof(event_slot_t);
+    r->size = size;
+    r->version = EVENT_RING_VERSION;
+    r->magic = EVENT_RING_MAGIC;
+    if (path && rename(tmp, path) < 0) {
+        err = errno;
+        unlink(tmp);
+        munmap(r, size);
+        errno = err;
+        return NULL;
+    }
+    return r;
+}
+
+const event_ring_t *event_ring_open(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(event_ring_t)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    event_ring_t *r = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (r == MAP_FAILED) return NULL;
+    if (r->magic != EVENT_RING_MAGIC || r->version != EVENT_RING_VERSION ||
+        r->slot_size != sizeof(event_slot_t) || r->size != (uint64_t)st.st_size ||
+        r->capacity == 0 || (r->capacity & (r->capacity - 1)) ||
+        sizeof(event_ring_t) + (uint64_t)r->capacity * sizeof(event_slot_t) != r->size) {
+        munmap(r, (size_t)st.st_size);
+        errno = EINVAL;
+        return NULL;
+    }
+    return r;
+}
+
+void event_ring_close(const event_ring_t *ring) {
+    if (ring) munmap((void *)ring, ring->size);
+}
+
+void events_attach(event_ring_t *ring) {
+    attached = ring;
+}
+
+static void publish(event_ring_t *r, event_kind_t kind, uint64_t id, pid_t pid,
+                    int32_t status, uint64_t value, const char *text,
+                    size_t len) {
+    uint64_t seq = atomic_fetch_add_explicit(&r->head, 1, memory_order_relaxed);
+    event_slot_t *s = &r->slots[seq & (r->capacity - 1)];
+    uint64_t busy = (seq + 1) | SLOT_BUSY;
+    uint64_t cur = atomic_load_explicit(&s->seq, memory_order_relaxed);
+    for (int spins = 0;; spins++) {
+        if ((cur & ~SLOT_BUSY) > seq + 1) return;   // A later lap has it
+        if ((cur & SLOT_BUSY) && spins < SLOT_SPIN_MAX) {
+            sched_yield();
+            cur = atomic_load_explicit(&s->seq, memory_order_relaxed);
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(&s->seq, &cur, busy,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+            break;
+        }
+    }
+    atomic_thread_fence(memory_order_release);
+
+    s->ev.seq = seq;
+    s->ev.ts_ns = mono_ns();
+    s->ev.id = id;
+    s->ev.value = value;
+    s->ev.pid = pid;
+    s->ev.status = status;
+    s->ev.kind = (uint16_t)kind;
+    if (len > EVENT_TEXT_MAX) len = EVENT_TEXT_MAX;
+    s->ev.len = (uint16_t)len;
+    if (len) memcpy(s->ev.text, text, len);
+
+    /* Fails only if a later writer took the slot over meanwhile. */
+    atomic_compare_exchange_strong_explicit(&s->seq, &busy, seq + 1,
+                                            memory_order_release,
+                                            memory_order_relaxed);
+}
+
+void event_emit(event_kind_t kind, uint64_t id, pid_t pid, int32_t status,
+                uint64_t value) {
+    if (attached) publish(attached, kind, id, pid, status, value, NULL, 0);
+}
+
+void event_cursor_init(event_cursor_t *c, const event_ring_t *ring,
+                       bool from_oldest) {
+    uint64_t head = atomic_load_explicit(&((event_ring_t *)ring)->head,
+                                         memory_order_acquire);
+    c->ring = ring;
+    c->dropped = 0;
+    c->next = !from_oldest ? head : head > ring->capacity ? head - ring->capacity : 0;
+}
+
+int event_next(event_cursor_t *c, event_t *ev) {
+    event_ring_t *r = (event_ring_t *)c->ring;   // Loads only
+    for (;;) {
+        uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+        if (c->next >= head) return 0;
+        if (head - c->next > r->capacity) {
+            c->dropped += head - r->capacity - c->next;
+            c->next = head - r->capacity;
+        }
+        event_slot_t *s = &r->slots[c->next & (r->capacity - 1)];
+        uint64_t seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+        if (seq == c->next + 1) {
+            *ev = s->ev;
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&s->seq, memory_order_relaxed) == seq) {
+                c->next++;
+                return 1;
+            }
+            continue;   // Rewritten while we copied: look again
+        }
+        /* Not yet complete: unwritten, an earlier lap's event, or
+         * being written (this one or an earlier lap's). */
+        if ((seq & ~SLOT_BUSY) <= c->next + 1) return 0;
+        c->dropped++;   // Already overwritten by a later lap
+        c->next++;
+    }
+}
+
+static const char *const kind_names[EVENT_KIND_COUNT] = {
+    "created", "started", "exited", "oom", "cleanup", "log",
+};
+
+const char *event_kind_name(event_kind_t kind) {
+    return kind < EVENT_KIND_COUNT ? kind_names[kind] : "?";
+}
+
+int event_format_json(const event_t *ev, char *buf, size_t size) {
+    char text[EVENT_TEXT_MAX * 6 + 1];
+    size_t n = 0;
+    for (size_t i = 0; i < ev->len && i < EVENT_TEXT_MAX; i++) {
+        unsigned char ch = (unsigned char)ev->text[i];
+        if (ch == '"' || ch == '\\') {
+            text[n++] = '\\';
+            text[n++] = (char)ch;
+        } else if (ch < 0x20) {
+            n += (size_t)snprintf(text + n, sizeof(text) - n, "\\u%04x", ch);
+        } else {
+            text[n++] = (char)ch;
+        }
+    }
+    text[n] = '\0';
+    return snprintf(buf, size,
+                    "{\"seq\":%llu,\"ts_ns\":%llu,\"kind\":\"%s\","
+                    "\"id\":\"%016llx\",\"pid\":%d,\"status\":%d,"
+                    "\"value\":%llu%s%s%s}\n",
+                    (unsigned long long)ev->seq, (unsigned long long)ev->ts_ns,
+                    event_kind_name(ev->kind), (unsigned long long)ev->id,
+                    ev->pid, ev->status, (unsigned long long)ev->value,
+                    ev->len ? ",\"text\":\"" : "", text, ev->len ? "\"" : "");
+}
+
+/* ---- Debug sink ---------------------------------------------------- */
+
+static struct {
+    _Atomic pid_t owner;        // Process whose output buf holds; 0 = unused
+    size_t used;
+    pthread_mutex_t lock;
+    char buf[EVENT_SINK_SIZE];
+} sink = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static void sink_write(const char *p, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(STDOUT_FILENO, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return;
+        p += w;
+        n -= (size_t)w;
+    }
+}
+
+static void sink_lock(void) {
+    pid_t self = getpid();
+    pid_t owner = atomic_load(&sink.owner);
+    if (owner != 0 && owner != self) {
+        /* A forked child, single-threaded here: the bytes are the
+         * parent's to write, and the lock may have been held by one of
+         * its threads at the fork. */
+        pthread_mutex_init(&sink.lock, NULL);
+        sink.used = 0;
+        atomic_store(&sink.owner, self);
+    }
+    pthread_mutex_lock(&sink.lock);
+    if (atomic_load(&sink.owner) == 0) {
+        atomic_store(&sink.owner, self);
+        atexit(debug_flush);
+    }
+}
+
+void debug_log(const char *fmt, ...) {
+    char line[EVENT_LINE_MAX];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n <= 0) return;
+    size_t len = (size_t)n < sizeof(line) ? (size_t)n : sizeof(line) - 1;
+    if (len == sizeof(line) - 1) line[len - 1] = '\n';
+
+    if (attached) {
+        size_t text = len;
+        while (text > 0 && line[text - 1] == '\n') text--;
+        publish(attached, EVENT_LOG, 0, getpid(), 0, 0, line, text);
+    }
+
+    sink_lock();
+    if (sink.used + len > sizeof(sink.buf)) {
+        sink_write(sink.buf, sink.used);
+        sink.used = 0;
+    }
+    memcpy(sink.buf + sink.used, line, len);
+    sink.used += len;
+    pthread_mutex_unlock(&sink.lock);
+}
+
+void debug_flush(void) {
+    if (atomic_load(&sink.owner) == 0) return;   // Nothing logged yet
+    sink_lock();
+    sink_write(sink.buf, sink.used);
+    sink.used = 0;
+    pthread_mutex_unlock(&sink.lock);
+}
@@ -0,0 +1,385 @@
+// Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include "fs_batch.h"
+#include "events.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define RING_ENTRIES 256   // >= 3 SQEs per op * FS_BATCH_MAX
+
+typedef struct {
+    int fd;
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void  *ring_mem, *sqe_mem;
+    size_t ring_len, sqe_len;
+} ring_t;
+
+static fs_backend_t backend = FS_BACKEND_AUTO;
+
+/* One ring per process. ring_busy is taken with an exchange, never
+ * waited on: a second thread (concurrent setup stages, run_stages() in
+ * core.c) runs its batch as syscalls instead. A forked child may
+ * inherit ring_busy set by another thread of its parent; it then simply
+ * never uses the ring. */
+static atomic_bool ring_busy;
+static pid_t ring_pid;     // Process the ring below belongs to
+static bool  ring_ok;
+static ring_t ring;
+
+void fs_batch_set_backend(fs_backend_t b) {
+    backend = b;
+}
+
+void fs_batch_init(fs_batch_t *b) {
+    b->count = 0;
+    b->str_len = 0;
+    b->overflow = false;
+}
+
+/* Copy s (with its NUL) into strbuf; offset, or (size_t)-1. */
+static size_t batch_str(fs_batch_t *b, const char *s, size_t len) {
+    if (b->str_len + len + 1 > sizeof(b->strbuf)) {
+        b->overflow = true;
+        return (size_t)-1;
+    }
+    size_t off = b->str_len;
+    memcpy(b->strbuf + off, s, len);
+    b->strbuf[off + len] = '\0';
+    b->str_len += len + 1;
+    return off;
+}
+
+static int batch_add(fs_batch_t *b, fs_op_kind_t kind, int dir_fd,
+                     const char *path, const char *data, int arg,
+                     unsigned order) {
+    if (b->overflow || b->count >= FS_BATCH_MAX) {
+        b->overflow = true;
+        return -1;
+    }
+    fs_op_t *op = &b->ops[b->count];
+    memset(op, 0, sizeof(*op));
+    op->kind = kind;
+    op->order = order;
+    op->dir_fd = dir_fd;
+    op->arg = arg;
+    op->path = batch_str(b, path, strlen(path));
+    if (data) {
+        op->data_len = strlen(data);
+        op->data = batch_str(b, data, op->data_len);
+    }
+    if (b->overflow) return -1;
+    return (int)b->count++;
+}
+
+int fs_batch_mkdir(fs_batch_t *b, int dir_fd, const char *path, mode_t mode,
+                   unsigned order) {
+    return batch_add(b, FS_OP_MKDIR, dir_fd, path, NULL, (int)mode, order);
+}
+
+int fs_batch_unlink(fs_batch_t *b, int dir_fd, const char *path, int flags,
+                    unsigned order) {
+    return batch_add(b, FS_OP_UNLINK, dir_fd, path, NULL, flags, order);
+}
+
+int fs_batch_write_file(fs_batch_t *b, int dir_fd, const char *path,
+                        const char *data, unsigned order) {
+    return batch_add(b, FS_OP_WRITE_FILE, dir_fd, path, data, 0, order);
+}
+
+const char *fs_batch_path(const fs_batch_t *b, unsigned i) {
+    return b->strbuf + b->ops[i].path;
+}
+
+void fs_batch_perror(const fs_batch_t *b, unsigned i, const char *what) {
+    const fs_op_t *op = &b->ops[i];
+    fprintf(stderr, "%s(%s): %s\n", op->failed_call ? op->failed_call : "?",
+            what, strerror(-op->res));
+}
+
+static const char *op_call(fs_op_kind_t kind) {
+    return kind == FS_OP_MKDIR ? "mkdir" : kind == FS_OP_UNLINK ? "unlink"
+                                                                : "open";
+}
+
+/* ---- Syscall backend ---------------------------------------------- */
+
+static void run_sync(fs_batch_t *b) {
+    for (unsigned i = 0; i < b->count; i++) {
+        fs_op_t *op = &b->ops[i];
+        const char *path = b->strbuf + op->path;
+        op->failed_call = op_call(op->kind);
+        switch (op->kind) {
+        case FS_OP_MKDIR:
+            op->res = mkdirat(op->dir_fd, path, (mode_t)op->arg) < 0 ? -errno : 0;
+            break;
+        case FS_OP_UNLINK:
+            op->res = unlinkat(op->dir_fd, path, op->arg) < 0 ? -errno : 0;
+            break;
+        case FS_OP_WRITE_FILE: {
+            int fd = openat(op->dir_fd, path, O_WRONLY | O_CLOEXEC);
+            if (fd < 0) {
+                op->res = -errno;
+                break;
+            }
+            op->failed_call = "write";
+            ssize_t n = write(fd, b->strbuf + op->data, op->data_len);
+            op->res = n < 0 ? -errno : (size_t)n != op->data_len ? -EIO : 0;
+            close(fd);
+            break;
+        }
+        }
+    }
+}
+
+/* ---- io_uring backend --------------------------------------------- */
+
+static bool ring_supports(int fd) {
+    static const unsigned char needed[] = {
+        IORING_OP_MKDIRAT, IORING_OP_UNLINKAT, IORING_OP_OPENAT,
+        IORING_OP_WRITE, IORING_OP_CLOSE,
+    };
+    size_t len = sizeof(struct io_uring_probe) +
+                 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, len);
+    if (!probe) return false;
+    bool ok = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE,
+                      probe, 256) == 0;
+    for (size_t i = 0; ok && i < sizeof(needed); i++) {
+        ok = needed[i] <= probe->last_op &&
+             (probe->ops[needed[i]].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    return ok;
+}
+
+static int ring_init(ring_t *r) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(r, 0, sizeof(*r));
+    r->fd = (int)syscall(__NR_io_uring_setup, RING_ENTRIES, &p);   // O_CLOEXEC
+    if (r->fd < 0) return -1;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !ring_supports(r->fd)) {
+        errno = EOPNOTSUPP;
+        goto fail;
+    }
+
+    size_t sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->ring_len = sq_len > cq_len ? sq_len : cq_len;
+    r->ring_mem = mmap(NULL, r->ring_len, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if (r->ring_mem == MAP_FAILED) goto fail;
+    r->sqe_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqe_mem = mmap(NULL, r->sqe_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sqe_mem == MAP_FAILED) {
+        munmap(r->ring_mem, r->ring_len);
+        goto fail;
+    }
+    char *m = r->ring_mem;
+    r->sq_tail  = (unsigned *)(m + p.sq_off.tail);
+    r->sq_mask  = (unsigned *)(m + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(m + p.sq_off.array);
+    r->cq_head  = (unsigned *)(m + p.cq_off.head);
+    r->cq_tail  = (unsigned *)(m + p.cq_off.tail);
+    r->cq_mask  = (unsigned *)(m + p.cq_off.ring_mask);
+    r->cqes     = (struct io_uring_cqe *)(m + p.cq_off.cqes);
+    r->sqes     = r->sqe_mem;
+
+    /* Sparse direct-descriptor table: slot i belongs to op i */
+    int fds[FS_BATCH_MAX];
+    for (int i = 0; i < FS_BATCH_MAX; i++) fds[i] = -1;
+    if (syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_FILES, fds,
+                FS_BATCH_MAX) < 0) {
+        munmap(r->sqe_mem, r->sqe_len);
+        munmap(r->ring_mem, r->ring_len);
+        goto fail;
+    }
+    return 0;
+
+fail:
+    close(r->fd);
+    r->fd = -1;
+    return -1;
+}
+
+/* The ring, or NULL to use syscalls. Pair with ring_release(). */
+static ring_t *ring_acquire(bool enable_debug) {
+    if (atomic_exchange(&ring_busy, true)) return NULL;
+    pid_t pid = getpid();
+    if (ring_pid != pid) {
+        /* First use, or a forked child holding its parent's mappings:
+         * drop those (never the fd — its number may have been reused
+         * since) and build our own. */
+        if (ring_pid != 0 && ring_ok) {
+            munmap(ring.sqe_mem, ring.sqe_len);
+            munmap(ring.ring_mem, ring.ring_len);
+        }
+        ring_pid = pid;
+        ring_ok = ring_init(&ring) == 0;
+        if (enable_debug) {
+            if (ring_ok) {
+                debug_log("[fsbatch] io_uring ring ready (%d entries)\n",
+                       RING_ENTRIES);
+            } else {
+                debug_log("[fsbatch] io_uring unavailable (%s); using syscalls\n",
+                       strerror(errno));
+            }
+        }
+    }
+    if (!ring_ok) {
+        atomic_store(&ring_busy, false);
+        return NULL;
+    }
+    return &ring;
+}
+
+static void ring_release(void) {
+    atomic_store(&ring_busy, false);
+}
+
+static struct io_uring_sqe *ring_sqe(ring_t *r, unsigned *tail) {
+    unsigned idx = (*tail)++ & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    r->sq_array[idx] = idx;
+    return sqe;
+}
+
+static void ring_complete(fs_batch_t *b, const struct io_uring_cqe *cqe,
+                          unsigned char *pending) {
+    unsigned i = (unsigned)(cqe->user_data >> 2), part = cqe->user_data & 3;
+    fs_op_t *op = &b->ops[i];
+    pending[i]--;
+    if (op->res < 0) return;   // First failure wins
+    static const char *const parts[] = { "open", "write", "close" };
+    if (op->kind != FS_OP_WRITE_FILE) {
+        op->res = cqe->res < 0 ? cqe->res : 0;
+    } else if (cqe->res < 0) {
+        op->res = cqe->res;
+        op->failed_call = parts[part];
+    } else if (part == 1 && (size_t)cqe->res != op->data_len) {
+        op->res = -EIO;
+        op->failed_call = "write";
+    }
+}
+
+/* Queue the whole batch, submit it with one io_uring_enter() and reap
+ * every completion. Returns -1 if the ring itself failed (ops that did
+ * not complete are marked -EIO and the ring is retired). */
+static int run_ring(ring_t *r, fs_batch_t *b) {
+    unsigned tail = *r->sq_tail, nsqe = 0;
+    unsigned char pending[FS_BATCH_MAX];   // CQEs still due per op
+    struct io_uring_sqe *last = NULL;
+    for (unsigned i = 0; i < b->count; i++) {
+        fs_op_t *op = &b->ops[i];
+        op->failed_call = op_call(op->kind);
+        pending[i] = op->kind == FS_OP_WRITE_FILE ? 3 : 1;
+        if (last && (op->order & FS_OP_AFTER_PREV)) {
+            last->flags |= IOSQE_IO_HARDLINK;
+        }
+        const char *path = b->strbuf + op->path;
+        struct io_uring_sqe *sqe = ring_sqe(r, &tail);
+        sqe->user_data = (uint64_t)i << 2;
+        sqe->fd = op->dir_fd;
+        sqe->addr = (uintptr_t)path;
+        if (op->order & FS_OP_BARRIER) sqe->flags |= IOSQE_IO_DRAIN;
+        nsqe++;
+        switch (op->kind) {
+        case FS_OP_MKDIR:
+            sqe->opcode = IORING_OP_MKDIRAT;
+            sqe->len = (unsigned)op->arg;
+            break;
+        case FS_OP_UNLINK:
+            sqe->opcode = IORING_OP_UNLINKAT;
+            sqe->unlink_flags = (unsigned)op->arg;
+            break;
+        case FS_OP_WRITE_FILE:
+            /* Hard links: the write and close run even if the open
+             * failed (they then see an empty slot), so a slot is never
+             * left holding a file. */
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->open_flags = O_WRONLY;   // Direct descriptors reject O_CLOEXEC
+            sqe->file_index = i + 1;
+            sqe->flags |= IOSQE_IO_HARDLINK;
+            sqe = ring_sqe(r, &tail);
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->user_data = ((uint64_t)i << 2) | 1;
+            sqe->fd = (int)i;
+            sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+            sqe->addr = (uintptr_t)(b->strbuf + op->data);
+            sqe->len = (unsigned)op->data_len;
+            sqe->off = 0;
+            sqe = ring_sqe(r, &tail);
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->user_data = ((uint64_t)i << 2) | 2;
+            sqe->file_index = i + 1;
+            nsqe += 2;
+            break;
+        }
+        last = sqe;
+    }
+    __atomic_store_n(r->sq_tail, tail, __ATOMIC_RELEASE);
+
+    unsigned to_submit = nsqe, reaped = 0;
+    while (reaped < nsqe) {
+        long n = syscall(__NR_io_uring_enter, r->fd, to_submit,
+                         nsqe - reaped, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            for (unsigned i = 0; i < b->count; i++) {
+                if (pending[i] && b->ops[i].res == 0) b->ops[i].res = -EIO;
+            }
+            ring_ok = false;   // Unknown ring state: syscalls from now on
+            return -1;
+        }
+        to_submit -= (unsigned)n;
+        unsigned head = *r->cq_head;
+        unsigned ctail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != ctail; head++, reaped++) {
+            ring_complete(b, &r->cqes[head & *r->cq_mask], pending);
+        }
+        __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+int fs_batch_run(fs_batch_t *b, bool enable_debug) {
+    if (b->overflow) {
+        errno = E2BIG;
+        return -1;
+    }
+    unsigned syscalls = 0;
+    for (unsigned i = 0; i < b->count; i++) {
+        b->ops[i].res = 0;
+        syscalls += b->ops[i].kind == FS_OP_WRITE_FILE ? 3 : 1;
+    }
+
+    /* A lone mkdir or unlink costs one syscall either way */
+    ring_t *r = backend == FS_BACKEND_AUTO && syscalls > 1
+              ? ring_acquire(enable_debug) : NULL;
+    if (r) {
+        run_ring(r, b);
+        ring_release();
+    } else {
+        run_sync(b);
+    }
+
+    for (unsigned i = 0; i < b->count; i++) {
+        if (b->ops[i].res < 0) return -1;
+    }
+    return 0;
+}
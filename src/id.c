@@ -0,0 +1,45 @@
+// Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include "id.h"
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/random.h>
+
+/* PID the sequence below was seeded for; -PID while seeding, so other
+ * threads of that process wait instead of drawing from a stale base. */
+static _Atomic pid_t id_owner;
+static _Atomic uint64_t id_seq;
+
+static uint64_t random_base(pid_t pid) {
+    uint64_t base;
+    if (getrandom(&base, sizeof(base), GRND_NONBLOCK) != sizeof(base)) {
+        /* Early boot without entropy: still distinct per process */
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        base = ((uint64_t)ts.tv_nsec << 32) ^ (uint64_t)ts.tv_sec ^
+               ((uint64_t)pid << 48);
+    }
+    return base;
+}
+
+uint64_t id_next(void) {
+    pid_t pid = getpid();
+    pid_t owner = atomic_load(&id_owner);
+    while (owner != pid) {
+        if (owner != -pid &&
+            atomic_compare_exchange_weak(&id_owner, &owner, -pid)) {
+            atomic_store(&id_seq, random_base(pid));
+            atomic_store(&id_owner, pid);
+            break;
+        }
+        if (owner == -pid) sched_yield();
+        owner = atomic_load(&id_owner);
+    }
+    uint64_t id;
+    do {
+        id = atomic_fetch_add(&id_seq, 1);
+    } while (id == 0);   // 0 means "draw one" in the contexts
+    return id;
+}
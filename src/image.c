@@ -0,0 +1,346 @@
+// Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include "image.h"
+#include "events.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/loop.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+
+#ifndef STATX_ATTR_MOUNT_ROOT
+#define STATX_ATTR_MOUNT_ROOT 0x00002000
+#endif
+
+#define EROFS_SUPER_OFFSET  1024
+#define EROFS_SUPER_MAGIC   0xE0F5E1E2U
+#define SQUASHFS_MAGIC      0x73717368U   // "hsqs"
+
+/* "sha256:<64 lowercase hex>" — anything else could name a path. */
+static bool valid_digest(const char *s) {
+    if (strncmp(s, "sha256:", 7) != 0) return false;
+    s += 7;
+    for (int i = 0; i < IMAGE_DIGEST_LEN; i++) {
+        if (!isxdigit((unsigned char)s[i]) || isupper((unsigned char)s[i])) {
+            return false;
+        }
+    }
+    return s[IMAGE_DIGEST_LEN] == '\0';
+}
+
+/* Strip leading/trailing whitespace and a '#' comment in place. */
+static char *trim_line(char *line) {
+    char *hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+    while (isspace((unsigned char)*line)) line++;
+    char *end = line + strlen(line);
+    while (end > line && isspace((unsigned char)end[-1])) *--end = '\0';
+    return line;
+}
+
+int image_resolve(const char *store, const char *ref, char *lowerdirs,
+                  size_t size, bool enable_debug) {
+    if (!ref || !lowerdirs || size == 0) {
+        fprintf(stderr, "image_resolve: invalid arguments\n");
+        return -1;
+    }
+    if (!store) store = IMAGE_STORE_PATH;
+
+    char manifest[PATH_MAX];
+    int n = strchr(ref, '/')
+        ? snprintf(manifest, sizeof(manifest), "%s", ref)
+        : snprintf(manifest, sizeof(manifest), "%s/images/%s", store, ref);
+    if (n < 0 || (size_t)n >= sizeof(manifest)) {
+        fprintf(stderr, "image_resolve: manifest path truncated\n");
+        return -1;
+    }
+
+    FILE *f = fopen(manifest, "re");
+    if (!f) {
+        perror(manifest);
+        return -1;
+    }
+
+    int layers = 0;
+    size_t used = 0;
+    char line[256];
+    lowerdirs[0] = '\0';
+    while (fgets(line, sizeof(line), f)) {
+        char *digest = trim_line(line);
+        if (!*digest) continue;
+        if (!valid_digest(digest)) {
+            fprintf(stderr, "[image] %s: invalid layer digest '%s'\n",
+                    manifest, digest);
+            goto fail;
+        }
+        if (++layers > IMAGE_MAX_LAYERS) {
+            fprintf(stderr, "[image] %s: more than %d layers\n",
+                    manifest, IMAGE_MAX_LAYERS);
+            goto fail;
+        }
+
+        char layer[PATH_MAX];
+        if (snprintf(layer, sizeof(layer), "%s/layers/sha256/%s", store,
+                     digest + 7) >= (int)sizeof(layer)) {
+            fprintf(stderr, "[image] layer path truncated\n");
+            goto fail;
+        }
+        struct stat st;
+        if (stat(layer, &st) < 0 || !S_ISDIR(st.st_mode)) {
+            fprintf(stderr, "[image] Layer %s not in store (%s)\n",
+                    digest, layer);
+            goto fail;
+        }
+
+        n = snprintf(lowerdirs + used, size - used, "%s%s",
+                     used ? ":" : "", layer);
+        if (n < 0 || (size_t)n >= size - used) {
+            fprintf(stderr, "[image] Lowerdir list too long\n");
+            goto fail;
+        }
+        used += (size_t)n;
+        if (enable_debug) debug_log("[image] Layer %d: %s\n", layers, digest);
+    }
+    fclose(f);
+
+    if (layers == 0) {
+        fprintf(stderr, "[image] %s lists no layers\n", manifest);
+        return -1;
+    }
+    return layers;
+
+fail:
+    fclose(f);
+    return -1;
+}
+
+int image_file_fstype(const char *path, const char **fstype) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    int rc = 0;
+    struct stat st;
+    uint32_t magic;
+    if (fstat(fd, &st) < 0) {
+        rc = -1;
+    } else if (S_ISREG(st.st_mode)) {
+        if (pread(fd, &magic, sizeof(magic), 0) == sizeof(magic) &&
+            magic == SQUASHFS_MAGIC) {
+            *fstype = "squashfs";
+            rc = 1;
+        } else if (pread(fd, &magic, sizeof(magic), EROFS_SUPER_OFFSET) ==
+                       sizeof(magic) && magic == EROFS_SUPER_MAGIC) {
+            *fstype = "erofs";
+            rc = 1;
+        }
+    }
+    close(fd);
+    return rc;
+}
+
+/* True if path is the root of a mount (bind mounts share st_dev, so
+ * comparing with the parent is not enough). */
+static bool is_mount_root(const char *path) {
+    struct statx stx;
+    if (statx(AT_FDCWD, path, AT_SYMLINK_NOFOLLOW, STATX_BASIC_STATS, &stx) < 0) {
+        return false;
+    }
+    return (stx.stx_attributes_mask & STATX_ATTR_MOUNT_ROOT) &&
+           (stx.stx_attributes & STATX_ATTR_MOUNT_ROOT);
+}
+
+int image_mount_dir_init(bool enable_debug) {
+    if (is_mount_root(IMAGE_MOUNT_DIR)) return 0;
+
+    if (mkdir("/run/minicontainer", 0755) < 0 && errno != EEXIST) {
+        perror("mkdir(/run/minicontainer)");
+        return -1;
+    }
+    if (mkdir(IMAGE_MOUNT_DIR, 0755) < 0 && errno != EEXIST) {
+        perror("mkdir(" IMAGE_MOUNT_DIR ")");
+        return -1;
+    }
+    if (mount(IMAGE_MOUNT_DIR, IMAGE_MOUNT_DIR, NULL, MS_BIND, NULL) < 0 ||
+        mount(NULL, IMAGE_MOUNT_DIR, NULL, MS_SHARED, NULL) < 0) {
+        perror("mount(" IMAGE_MOUNT_DIR ")");
+        return -1;
+    }
+    if (enable_debug) debug_log("[image] Shared mount at %s\n", IMAGE_MOUNT_DIR);
+    return 0;
+}
+
+/* Attach file_fd to a free loop device, read-only and autoclear (the
+ * device goes away with its last mount). Returns the loop fd. */
+static int attach_loop(int file_fd, char *dev, size_t size) {
+    int ctl = open("/dev/loop-control", O_RDWR | O_CLOEXEC);
+    if (ctl < 0) {
+        perror("open(/dev/loop-control)");
+        return -1;
+    }
+
+    int loop_fd = -1;
+    for (int tries = 0; tries < 8 && loop_fd < 0; tries++) {
+        int n = ioctl(ctl, LOOP_CTL_GET_FREE);
+        if (n < 0) {
+            perror("LOOP_CTL_GET_FREE");
+            break;
+        }
+        snprintf(dev, size, "/dev/loop%d", n);
+        loop_fd = open(dev, O_RDONLY | O_CLOEXEC);
+        if (loop_fd < 0) {
+            perror(dev);
+            break;
+        }
+
+        struct loop_config lc;
+        memset(&lc, 0, sizeof(lc));
+        lc.fd = (uint32_t)file_fd;
+        lc.info.lo_flags = LO_FLAGS_READ_ONLY | LO_FLAGS_AUTOCLEAR;
+        if (ioctl(loop_fd, LOOP_CONFIGURE, &lc) == 0) break;
+
+        /* LOOP_CONFIGURE is 5.8+; before that, SET_FD + SET_STATUS64. */
+        if (errno == EINVAL || errno == ENOTTY) {
+            struct loop_info64 info;
+            memset(&info, 0, sizeof(info));
+            info.lo_flags = LO_FLAGS_READ_ONLY | LO_FLAGS_AUTOCLEAR;
+            if (ioctl(loop_fd, LOOP_SET_FD, file_fd) == 0) {
+                if (ioctl(loop_fd, LOOP_SET_STATUS64, &info) == 0) break;
+                ioctl(loop_fd, LOOP_CLR_FD, 0);
+            }
+        }
+        /* EBUSY: another process took this device first; try again. */
+        int err = errno;
+        close(loop_fd);
+        loop_fd = -1;
+        if (err != EBUSY) {
+            fprintf(stderr, "[image] LOOP_CONFIGURE(%s): %s\n", dev, strerror(err));
+            break;
+        }
+    }
+    close(ctl);
+    return loop_fd;
+}
+
+int image_mount_file(const char *path, char *mountpoint, size_t size,
+                     bool enable_debug) {
+    const char *fstype = NULL;
+    if (image_file_fstype(path, &fstype) != 1) {
+        fprintf(stderr, "[image] %s is not an erofs/squashfs image\n", path);
+        return -1;
+    }
+    int file_fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (file_fd < 0 || fstat(file_fd, &st) < 0) {
+        perror(path);
+        if (file_fd >= 0) close(file_fd);
+        return -1;
+    }
+    if (image_mount_dir_init(enable_debug) < 0) {
+        close(file_fd);
+        return -1;
+    }
+
+    int n = snprintf(mountpoint, size, IMAGE_MOUNT_DIR "/%llx-%llx-%llx-%llx",
+                     (unsigned long long)st.st_dev, (unsigned long long)st.st_ino,
+                     (unsigned long long)st.st_size,
+                     (unsigned long long)st.st_mtim.tv_sec * 1000000000ull +
+                         (unsigned long long)st.st_mtim.tv_nsec);
+    char lock_path[PATH_MAX];
+    if (n < 0 || (size_t)n >= size ||
+        snprintf(lock_path, sizeof(lock_path), "%s.lock", mountpoint) >=
+            (int)sizeof(lock_path)) {
+        fprintf(stderr, "[image] mountpoint path truncated\n");
+        close(file_fd);
+        return -1;
+    }
+
+    int lock_fd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (lock_fd < 0 || flock(lock_fd, LOCK_EX) < 0) {
+        perror(lock_path);
+        if (lock_fd >= 0) close(lock_fd);
+        close(file_fd);
+        return -1;
+    }
+
+    int rc = 0;
+    if (is_mount_root(mountpoint)) {
+        if (enable_debug) debug_log("[image] Reusing %s mount %s\n", fstype, mountpoint);
+        goto out;
+    }
+    if (mkdir(mountpoint, 0755) < 0 && errno != EEXIST) {
+        perror("mkdir(image mountpoint)");
+        rc = -1;
+        goto out;
+    }
+
+    unsigned long flags = MS_RDONLY | MS_NODEV | MS_NOSUID;
+    /* erofs can be backed by the file itself (6.12+): no loop device. */
+    if (strcmp(fstype, "erofs") == 0 &&
+        mount(path, mountpoint, fstype, flags, NULL) == 0) {
+        if (enable_debug) debug_log("[image] Mounted %s (file-backed erofs) at %s\n",
+                                 path, mountpoint);
+        goto out;
+    }
+
+    char dev[32];
+    int loop_fd = attach_loop(file_fd, dev, sizeof(dev));
+    if (loop_fd < 0) {
+        rc = -1;
+        goto out;
+    }
+    if (mount(dev, mountpoint, fstype, flags, NULL) < 0) {
+        fprintf(stderr, "[image] mount(%s on %s, %s): %s\n", dev, mountpoint,
+                fstype, strerror(errno));
+        rc = -1;
+    } else if (enable_debug) {
+        debug_log("[image] Mounted %s via %s at %s\n", path, dev, mountpoint);
+    }
+    close(loop_fd);   // Autoclear: the device now lives as long as the mount
+
+out:
+    close(lock_fd);
+    close(file_fd);
+    return rc;
+}
+
+int image_resolve_rootfs(const char *rootfs_path, char *out, size_t size,
+                         bool enable_debug) {
+    char spec[PATH_MAX];
+    if (snprintf(spec, sizeof(spec), "%s", rootfs_path) >= (int)sizeof(spec)) {
+        fprintf(stderr, "[image] rootfs path too long\n");
+        return -1;
+    }
+
+    int images = 0;
+    size_t used = 0;
+    char *save = NULL;
+    out[0] = '\0';
+    for (char *part = strtok_r(spec, ":", &save); part;
+         part = strtok_r(NULL, ":", &save)) {
+        const char *fstype;
+        char mnt[PATH_MAX];
+        const char *dir = part;
+        if (image_file_fstype(part, &fstype) == 1) {
+            if (image_mount_file(part, mnt, sizeof(mnt), enable_debug) < 0) {
+                return -1;
+            }
+            dir = mnt;
+            images++;
+        }
+        int n = snprintf(out + used, size - used, "%s%s", used ? ":" : "", dir);
+        if (n < 0 || (size_t)n >= size - used) {
+            fprintf(stderr, "[image] rootfs list too long\n");
+            return -1;
+        }
+        used += (size_t)n;
+    }
+    return images > 0 ? 1 : 0;
+}
@@ -0,0 +1,86 @@
+// Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include "intern.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static pthread_mutex_t intern_lock = PTHREAD_MUTEX_INITIALIZER;
+static const char **table;        // Open addressing, power-of-two size
+static size_t table_size;
+static size_t table_used;
+static char *chunk;               // Current arena block
+static size_t chunk_used;
+
+static uint64_t hash_str(const char *s) {
+    uint64_t h = 0xcbf29ce484222325ULL;   // FNV-1a
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/* Slot holding s, or the empty slot where it belongs. */
+static size_t probe(const char **t, size_t size, const char *s) {
+    size_t i = (size_t)hash_str(s) & (size - 1);
+    while (t[i] && strcmp(t[i], s) != 0) {
+        i = (i + 1) & (size - 1);
+    }
+    return i;
+}
+
+/* Keep the table at most 3/4 full. */
+static int grow_table(void) {
+    if (table && (table_used + 1) * 4 <= table_size * 3) return 0;
+    size_t size = table_size ? table_size * 2 : 64;
+    const char **t = calloc(size, sizeof(*t));
+    if (!t) return -1;
+    for (size_t i = 0; i < table_size; i++) {
+        if (table[i]) t[probe(t, size, table[i])] = table[i];
+    }
+    free(table);
+    table = t;
+    table_size = size;
+    return 0;
+}
+
+/* Copy s into the arena. A string too big to share a block gets its
+ * own; a full block is left behind (its strings stay in use). */
+static char *arena_copy(const char *s, size_t len) {
+    if (len + 1 > INTERN_CHUNK / 4) {
+        char *p = malloc(len + 1);
+        if (p) memcpy(p, s, len + 1);
+        return p;
+    }
+    if (!chunk || chunk_used + len + 1 > INTERN_CHUNK) {
+        char *c = malloc(INTERN_CHUNK);
+        if (!c) return NULL;
+        chunk = c;
+        chunk_used = 0;
+    }
+    char *p = chunk + chunk_used;
+    memcpy(p, s, len + 1);
+    chunk_used += len + 1;
+    return p;
+}
+
+const char *str_intern(const char *s) {
+    if (!s) return NULL;
+    pthread_mutex_lock(&intern_lock);
+    const char *out = NULL;
+    if (grow_table() == 0) {
+        size_t i = probe(table, table_size, s);
+        if (!table[i]) {
+            char *copy = arena_copy(s, strlen(s));
+            if (copy) {
+                table[i] = copy;
+                table_used++;
+            }
+        }
+        out = table[i];
+    }
+    pthread_mutex_unlock(&intern_lock);
+    return out;
+}
@@ -1,12 +1,31 @@
 // Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
 #include "core.h" // Phase 7
 #include "env.h"  // Phase 7
+#include "net_pool.h" // NET_POOL_MAX_SLOTS
+#include "net_pod.h"  // net_pod_name_valid
+#include "net_bridge.h" // NET_BRIDGE_DEFAULT
+#include "serve.h"    // serve_run, serve_client_*
+#include "image.h"    // image_resolve, IMAGE_STORE_PATH
+#include "monitor.h"  // container_monitor_t
+#include "checkpoint.h" // container_checkpoint, checkpoint_load_config
+#include "spec.h"     // SPEC_MAX_SIZE, spec_save, spec_map
+#include "fs_batch.h" // fs_batch_set_backend
+#include "seccomp.h"  // SECCOMP_PROFILE_DEFAULT
+#include "attach.h"   // container_attach_*
+#include "events.h"   // event_ring_open, event_next
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <getopt.h>
 #include <stdbool.h>
 #include <unistd.h>
 #include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/wait.h>
+#include <time.h>
 
 /**
  * Parse memory limit string (e.g., "100M", "1G", "512K").
@@ -36,11 +55,18 @@ static long parse_cpu_limit(const char *str) {
 
 static void usage(const char *progname) {
     fprintf(stderr, "Usage: %s [OPTIONS] <command> [args...]\n", progname);
+    fprintf(stderr, "       %s --restore <dir> [--debug] [--stats[=..]]\n", progname);
+    fprintf(stderr, "       %s serve [--socket <path>] [--zygotes <n>] [--events <file>] [--debug]\n", progname);
+    fprintf(stderr, "       %s stats [--socket <path>]\n", progname);
+    fprintf(stderr, "       %s exec [--seccomp <p>] [--debug] <pid|cgroup> <cmd>...\n", progname);
+    fprintf(stderr, "       %s events [--follow] [--new] <file>\n", progname);
     fprintf(stderr, "\nOptions:\n");
     fprintf(stderr, "  --debug                  Enable debug output\n");
     fprintf(stderr, "  --pid                    Enable PID namespace\n");
-    fprintf(stderr, "  --rootfs <path>          Path to root filesystem\n");
+    fprintf(stderr, "  --rootfs <path>          Root filesystem: directory or erofs/squashfs image\n");
     fprintf(stderr, "  --overlay                Enable copy-on-write overlay\n");
+    fprintf(stderr, "  --image <name>           Run a layered image (implies --overlay)\n");
+    fprintf(stderr, "  --image-store <path>     Layer store (default %s)\n", IMAGE_STORE_PATH);
     fprintf(stderr, "  --container-dir <p>      Directory for overlay data\n");
     fprintf(stderr, "  --hostname <name>        Set container hostname\n");
     fprintf(stderr, "  --user                   Enable user namespace (run without sudo)\n");
@@ -48,21 +74,590 @@ static void usage(const char *progname) {
     fprintf(stderr, "  --memory <limit>         Memory limit (e.g., 100M, 1G)\n");
     fprintf(stderr, "  --cpus <fraction>        CPU limit (e.g., 0.5 = 50%%)\n");
     fprintf(stderr, "  --pids <max>             Max processes\n");
+    fprintf(stderr, "  --memory-high <size>     Throttle and reclaim above this (memory.high)\n");
+    fprintf(stderr, "  --memory-swap <size>     Swap limit (0 = no swap)\n");
+    fprintf(stderr, "  --cpu-weight <1-10000>   Relative CPU share (default 100)\n");
+    fprintf(stderr, "  --io-weight <1-10000>    Relative I/O share (default 100)\n");
+    fprintf(stderr, "  --cpuset-cpus <list>     Pin to CPUs, e.g. 0-3,8\n");
+    fprintf(stderr, "  --cpuset-mems <list>     Allocate memory on these NUMA nodes\n");
+    fprintf(stderr, "  --io-max <dev>,<k>=<v>.. Throttle a block device (rbps/wbps/riops/wiops)\n");
+    fprintf(stderr, "  --numa auto              Pin CPUs + memory to the least-loaded NUMA node\n");
+    fprintf(stderr, "  --memory-guard[=<pct>]   Report memory pressure / OOM events to stderr;\n");
+    fprintf(stderr, "                           with pct, throttle at pct%% of --memory first\n");
     fprintf(stderr, "  --net                    Enable network namespace + veth pair\n");
     fprintf(stderr, "  --net-host-ip <addr>     Host-side veth IP\n");
     fprintf(stderr, "  --net-container-ip <a>   Container-side veth IP\n");
     fprintf(stderr, "  --net-netmask <cidr>     CIDR suffix\n");
     fprintf(stderr, "  --no-nat                 Disable iptables MASQUERADE\n");
+    fprintf(stderr, "  --net-backend <b>        auto (default), netlink, or ip\n");
+    fprintf(stderr, "  --net-pool <n>           Keep n pre-created veth pairs warm\n");
+    fprintf(stderr, "  --net-pool-low <n>       Refill below n idle pairs (default n/2)\n");
+    fprintf(stderr, "  --pod <name>             Share one netns + veth with the pod's other containers\n");
+    fprintf(stderr, "  --net-bridge[=<name>]    Attach to a shared bridge (default %s) with one\n"
+                    "                           NAT rule; the address is leased unless given\n",
+            NET_BRIDGE_DEFAULT);
+    fprintf(stderr, "  --net-user[=<helper>]    Rootless network via auto (default), pasta or\n"
+                    "                           slirp4netns; implied by --net without root\n");
+    fprintf(stderr, "  --publish <[ip:]h:c>     Forward host port h to container port c (repeatable;\n"
+                    "                           /udp suffix for UDP); in-kernel DNAT, pasta rootless\n");
+    fprintf(stderr, "  --seccomp <profile>      Syscall filter: default (built in) or a profile file\n");
+    fprintf(stderr, "  --fs-backend <b>         auto (default, io_uring when usable) or syscall\n");
     fprintf(stderr, "  --env KEY=VALUE          Set environment variable (repeatable)\n");
+    fprintf(stderr, "  --connect <socket>       Run via a `serve` daemon\n");
+    fprintf(stderr, "  --spec-out <file>        Compile the options and command into a spec file\n"
+                    "                           instead of running them\n");
+    fprintf(stderr, "  --spec <file>            Run a compiled spec (no command; with --connect,\n"
+                    "                           sent to the daemon as is)\n");
+    fprintf(stderr, "  --timings=json           Print per-phase start latency to stderr\n");
+    fprintf(stderr, "  --stats[=json|line]      Stream cgroup usage to stderr (implies a cgroup)\n");
+    fprintf(stderr, "  --stats-interval <ms>    Sampling interval (default 1000)\n");
+    fprintf(stderr, "  --checkpoint <dir>       Snapshot the container with criu once warm\n");
+    fprintf(stderr, "  --checkpoint-after <ms>  Warm-up time before the snapshot (default 5000)\n");
+    fprintf(stderr, "  --restore <dir>          Start from a snapshot instead of a command\n");
     fprintf(stderr, "  --help                   Show this help\n");
     fprintf(stderr, "\nExamples:\n");
     fprintf(stderr, "  sudo %s --pid --rootfs ./rootfs --hostname web /bin/sh\n", progname);
     fprintf(stderr, "  %s --user --pid --ipc --hostname test /bin/sh  # No sudo needed\n", progname);
     fprintf(stderr, "  sudo %s --pid --memory 100M --cpus 0.5 --pids 20 /bin/sh\n", progname);
     fprintf(stderr, "  sudo %s --pid --rootfs ./rootfs --net /bin/sh  # With network\n", progname);
+    fprintf(stderr, "  sudo %s serve --zygotes 4 &  # Then: %s --connect %s ...\n",
+            progname, progname, SERVE_SOCKET_PATH);
+    fprintf(stderr, "  sudo %s --pid --rootfs ./rootfs --overlay --checkpoint ./snap app\n",
+            progname);
+    fprintf(stderr, "  sudo %s exec slot0 /bin/sh  # Shell in the container on slot0\n",
+            progname);
+    fprintf(stderr, "  %s events --follow /dev/shm/minicontainer.events  # JSON lines\n",
+            progname);
+}
+
+/**
+ * `minicontainer serve` / `minicontainer stats`: the daemon and its
+ * latency report. Both take --socket (default SERVE_SOCKET_PATH).
+ */
+static int serve_main(int argc, char *argv[], bool stats_only) {
+    serve_config_t config = { .socket_path = NULL, .zygotes = 2 };
+
+    static struct option serve_options[] = {
+        {"socket",  required_argument, NULL, 's'},
+        {"zygotes", required_argument, NULL, 'z'},
+        {"events",  required_argument, NULL, 'e'},
+        {"debug",   no_argument,       NULL, 'd'},
+        {"help",    no_argument,       NULL, 'h'},
+        {0, 0, 0, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "+s:z:e:dh", serve_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                config.socket_path = optarg;
+                break;
+            case 'z': {
+                int n = atoi(optarg);
+                if (stats_only || n < 0 || n > SERVE_MAX_ZYGOTES) {
+                    fprintf(stderr, "Error: --zygotes must be 0..%d "
+                                    "(serve only)\n", SERVE_MAX_ZYGOTES);
+                    return 1;
+                }
+                config.zygotes = (unsigned)n;
+                break;
+            }
+            case 'e':
+                if (stats_only) {
+                    fprintf(stderr, "Error: --events is a serve option\n");
+                    return 1;
+                }
+                config.events_path = optarg;
+                break;
+            case 'd':
+                config.enable_debug = true;
+                break;
+            case 'h':
+                usage("minicontainer");
+                return 0;
+            default:
+                usage("minicontainer");
+                return 1;
+        }
+    }
+    if (optind < argc) {
+        fprintf(stderr, "Error: unexpected argument '%s'\n", argv[optind]);
+        return 1;
+    }
+
+    if (!stats_only) return serve_run(&config) < 0 ? 1 : 0;
+
+    serve_stats_t stats;
+    if (serve_client_stats(config.socket_path, &stats) < 0) return 1;
+    printf("starts:       %llu (%llu from parked zygotes)\n",
+           (unsigned long long)stats.count,
+           (unsigned long long)stats.zygote_hits);
+    printf("window:       last %u\n", stats.window);
+    printf("p50:          %.1f us\n", stats.p50_ns / 1000.0);
+    printf("p90:          %.1f us\n", stats.p90_ns / 1000.0);
+    printf("p99:          %.1f us\n", stats.p99_ns / 1000.0);
+    printf("max:          %.1f us\n", stats.max_ns / 1000.0);
+    return 0;
+}
+
+/**
+ * `minicontainer exec <target> cmd...`: run cmd inside a running
+ * container (attach.h). The target is the container's host pid or its
+ * cgroup name; the exit code is cmd's, as for a container. The
+ * container's --seccomp filter is not inherited: pass it again.
+ */
+static int exec_main(int argc, char *argv[]) {
+    bool enable_debug = false;
+    const char *seccomp_profile = NULL;
+    static struct option exec_options[] = {
+        {"debug",   no_argument,       NULL, 'd'},
+        {"seccomp", required_argument, NULL, 's'},
+        {"help",  no_argument, NULL, 'h'},
+        {0, 0, 0, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "+ds:h", exec_options, NULL)) != -1) {
+        switch (opt) {
+            case 'd':
+                enable_debug = true;
+                break;
+            case 's':
+                seccomp_profile = optarg;
+                break;
+            case 'h':
+                usage("minicontainer");
+                return 0;
+            default:
+                usage("minicontainer");
+                return 1;
+        }
+    }
+    if (argc - optind < 2) {
+        fprintf(stderr, "Error: exec needs a container and a command\n");
+        return 1;
+    }
+
+    const seccomp_program_t *filter = NULL;
+    if (seccomp_profile) {
+        filter = seccomp_compile(seccomp_profile, enable_debug);
+        if (!filter) return 1;
+    }
+    container_attach_t target;
+    if (container_attach_open(&target, argv[optind], enable_debug) < 0) return 1;
+    target.seccomp = filter;
+    int status = 0;
+    int rc = container_attach_exec(&target, &argv[optind + 1], NULL, &status,
+                                   enable_debug);
+    container_attach_close(&target);
+    if (rc < 0) return 1;
+    if (WIFSIGNALED(status)) {
+        fprintf(stderr, "Process killed by signal %d\n", WTERMSIG(status));
+        return 128 + WTERMSIG(status);
+    }
+    return WEXITSTATUS(status);
+}
+
+/**
+ * `minicontainer events <file>`: print the lifecycle events in a ring
+ * written by `serve --events <file>` as JSON lines, oldest first (--new:
+ * only those written from now on). --follow keeps tailing; events the
+ * ring overwrote before they were read are counted on stderr. The ring
+ * is mapped read-only, so this never slows the daemon down.
+ */
+static int events_main(int argc, char *argv[]) {
+    bool follow = false;
+    bool from_oldest = true;
+    static struct option events_options[] = {
+        {"follow", no_argument, NULL, 'f'},
+        {"new",    no_argument, NULL, 'n'},
+        {"help",   no_argument, NULL, 'h'},
+        {0, 0, 0, 0}
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "+fnh", events_options, NULL)) != -1) {
+        switch (opt) {
+            case 'f':
+                follow = true;
+                break;
+            case 'n':
+                from_oldest = false;
+                break;
+            case 'h':
+                usage("minicontainer");
+                return 0;
+            default:
+                usage("minicontainer");
+                return 1;
+        }
+    }
+    if (argc - optind != 1) {
+        fprintf(stderr, "Error: events needs the ring file\n");
+        return 1;
+    }
+
+    const event_ring_t *ring = event_ring_open(argv[optind]);
+    if (!ring) {
+        fprintf(stderr, "Error: %s: %s\n", argv[optind], strerror(errno));
+        return 1;
+    }
+    event_cursor_t cur;
+    event_cursor_init(&cur, ring, from_oldest);
+    uint64_t reported = 0;
+    for (;;) {
+        event_t ev;
+        char line[512];
+        while (event_next(&cur, &ev)) {
+            event_format_json(&ev, line, sizeof(line));
+            fputs(line, stdout);
+        }
+        if (fflush(stdout) == EOF) break;   // Reader went away
+        if (cur.dropped != reported) {
+            fprintf(stderr, "events: %llu dropped (ring overwrote them)\n",
+                    (unsigned long long)(cur.dropped - reported));
+            reported = cur.dropped;
+        }
+        if (!follow) break;
+        nanosleep(&(struct timespec){ .tv_nsec = 10 * 1000000L }, NULL);
+    }
+    event_ring_close(ring);
+    return 0;
+}
+
+/**
+ * Parse an --io-max spec, "<device> key=value..." separated by spaces or
+ * commas, into the line io.max reads back: "MAJ:MIN rbps=N wbps=N
+ * riops=N wiops=N" with unset keys "max". <device> is a block device
+ * path or MAJ:MIN; the bps values take K/M/G suffixes.
+ */
+static int parse_io_max(const char *spec, char *out, size_t size) {
+    char buf[256];
+    if (snprintf(buf, sizeof(buf), "%s", spec) >= (int)sizeof(buf)) {
+        fprintf(stderr, "Error: --io-max spec too long\n");
+        return -1;
+    }
+    static const char *keys[] = { "rbps", "wbps", "riops", "wiops" };
+    char vals[4][24] = { "max", "max", "max", "max" };
+    char *save = NULL;
+    char *dev = strtok_r(buf, " ,", &save);
+    if (!dev) {
+        fprintf(stderr, "Error: --io-max needs a device\n");
+        return -1;
+    }
+
+    unsigned maj, min;
+    char extra;
+    if (sscanf(dev, "%u:%u%c", &maj, &min, &extra) != 2) {
+        struct stat st;
+        if (stat(dev, &st) < 0) {
+            perror(dev);
+            return -1;
+        }
+        if (!S_ISBLK(st.st_mode)) {
+            fprintf(stderr, "Error: --io-max: %s is not a block device\n", dev);
+            return -1;
+        }
+        maj = major(st.st_rdev);
+        min = minor(st.st_rdev);
+    }
+
+    for (char *kv = strtok_r(NULL, " ,", &save); kv;
+         kv = strtok_r(NULL, " ,", &save)) {
+        char *eq = strchr(kv, '=');
+        int k = -1;
+        for (int i = 0; eq && i < 4; i++) {
+            if ((size_t)(eq - kv) == strlen(keys[i]) &&
+                strncmp(kv, keys[i], eq - kv) == 0) {
+                k = i;
+            }
+        }
+        if (k < 0 || !eq[1]) {
+            fprintf(stderr, "Error: --io-max: bad limit '%s' (want "
+                            "rbps|wbps|riops|wiops=N)\n", kv);
+            return -1;
+        }
+        if (strcmp(eq + 1, "max") == 0) continue;
+        unsigned long long v = k < 2 ? parse_memory_limit(eq + 1)
+                                     : strtoull(eq + 1, NULL, 10);
+        if (v == 0) {
+            fprintf(stderr, "Error: --io-max: %s must be positive\n", kv);
+            return -1;
+        }
+        snprintf(vals[k], sizeof(vals[k]), "%llu", v);
+    }
+    snprintf(out, size, "%u:%u rbps=%s wbps=%s riops=%s wiops=%s",
+             maj, min, vals[0], vals[1], vals[2], vals[3]);
+    return 0;
+}
+
+/* Copy a cpuset list flag into its cgroup_limits_t buffer. */
+static int copy_cpuset(const char *flag, const char *list, char *out,
+                       size_t size) {
+    if (!list[0] || strspn(list, "0123456789,-") != strlen(list) ||
+        strlen(list) >= size) {
+        fprintf(stderr, "Error: %s must be a list like 0-3,8 (got '%s')\n",
+                flag, list);
+        return -1;
+    }
+    strcpy(out, list);
+    return 0;
+}
+
+/* --cpu-weight / --io-weight: the kernel's 1..10000 range. */
+static int parse_weight(const char *flag, const char *str, unsigned *out) {
+    char *end;
+    long w = strtol(str, &end, 10);
+    if (*end || w < 1 || w > CGROUP_WEIGHT_MAX) {
+        fprintf(stderr, "Error: %s must be 1..%d (got '%s')\n", flag,
+                CGROUP_WEIGHT_MAX, str);
+        return -1;
+    }
+    *out = (unsigned)w;
+    return 0;
+}
+
+/* --timings=json: one object on stderr, nanoseconds throughout. total_ns
+ * runs from container_exec() entry to the child's execve(). */
+static void print_timings_json(const container_timings_t *tm) {
+    uint64_t total = tm->exec_ns > tm->start_ns ? tm->exec_ns - tm->start_ns : 0;
+    fprintf(stderr, "{\"total_ns\":%llu,\"phases\":{", (unsigned long long)total);
+    for (int i = 0; i < CONTAINER_PHASE_COUNT; i++) {
+        fprintf(stderr, "%s\"%s\":%llu", i ? "," : "",
+                container_phase_name((container_phase_t)i),
+                (unsigned long long)tm->phase_ns[i]);
+    }
+    fprintf(stderr, "}}\n");
+}
+
+/* --memory-guard: one JSON object per memory event on stderr. */
+static void print_memory_event(container_handle_t *h, const memory_event_t *ev,
+                               void *user) {
+    (void)user;
+    fprintf(stderr, "{\"memory_event\":\"%s\",\"oom_imminent\":%s,"
+                    "\"cgroup\":\"%s\",\"pid\":%d,\"count\":%llu,"
+                    "\"memory_current\":%llu,\"throttled_to\":%llu}\n",
+            memory_event_name(ev->kind),
+            memory_event_imminent(ev->kind) ? "true" : "false",
+            h->result.ctx.cgroup_ctx.cgroup_name, h->result.child_pid,
+            (unsigned long long)ev->count,
+            (unsigned long long)ev->memory_current,
+            (unsigned long long)ev->throttled_to);
+}
+
+/* What exec_supervised() does while the child runs. */
+typedef struct {
+    bool stats;
+    monitor_format_t fmt;
+    int interval_ms;
+    const char *checkpoint_dir;   // NULL: no snapshot
+    int checkpoint_after_ms;
+    bool checkpointed;            // Out: the dump succeeded
+} supervise_t;
+
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/* --stats / --memory-guard / --checkpoint: container_spawn() instead of
+ * container_exec(), so the loop can act on the child while it runs.
+ * With stats, one cgroup sample per interval until the child is reaped,
+ * then a summary over the monitor's ring. All lines go to stderr. With
+ * a checkpoint dir, the child is dumped once checkpoint_after_ms have
+ * passed; the dump stops it and the loop reaps it as usual. */
+static container_result_t exec_supervised(const container_config_t *config,
+                                          supervise_t *sv) {
+    container_result_t result = { .child_pid = -1 };
+    container_loop_t *loop = container_loop_create();
+    if (!loop) {
+        perror("container_loop_create");
+        return result;
+    }
+    container_handle_t *h = container_spawn(loop, config, NULL, NULL);
+    if (!h) {
+        container_loop_destroy(loop);
+        return result;
+    }
+    h->on_memory = print_memory_event;
+
+    static container_monitor_t mon;   // The ring is ~40 KiB
+    char line[2048];
+    bool monitoring = sv->stats &&
+                      monitor_open(&mon, h->result.ctx.cgroup_ctx.dir_fd,
+                                   h->result.ctx.cgroup_ctx.cgroup_name,
+                                   h->result.child_pid) == 0;
+    if (sv->stats && !monitoring) {
+        fprintf(stderr, "[monitor] No cgroup stat files readable; "
+                        "--stats disabled\n");
+    }
+    uint64_t now = monotonic_ms(), next_sample = now + (uint64_t)sv->interval_ms;
+    uint64_t checkpoint_at = sv->checkpoint_dir
+        ? now + (uint64_t)sv->checkpoint_after_ms : UINT64_MAX;
+    int n;
+    for (;;) {
+        uint64_t deadline = monitoring ? next_sample : UINT64_MAX;
+        if (checkpoint_at < deadline) deadline = checkpoint_at;
+        int timeout = deadline == UINT64_MAX ? -1
+                    : deadline > now ? (int)(deadline - now) : 0;
+        if ((n = container_poll(loop, timeout)) != 0) break;
+        now = monotonic_ms();
+        if (now >= checkpoint_at) {
+            checkpoint_at = UINT64_MAX;
+            sv->checkpointed = container_checkpoint(&h->result, config,
+                                                    sv->checkpoint_dir) == 0;
+            if (!sv->checkpointed) {
+                fprintf(stderr, "[checkpoint] Snapshot failed; the container "
+                                "keeps running\n");
+            }
+        }
+        if (monitoring && now >= next_sample) {
+            next_sample = now + (uint64_t)sv->interval_ms;
+            monitor_format(&mon, monitor_sample(&mon), sv->fmt, line,
+                           sizeof(line));
+            fputs(line, stderr);
+        }
+    }
+    if (monitoring) {
+        monitor_summary(&mon, sv->fmt, line, sizeof(line));
+        fputs(line, stderr);
+        monitor_close(&mon);
+    }
+
+    /* n < 0: epoll failed with the child still running; destroying the
+     * loop kills and reaps it. */
+    container_loop_destroy(loop);
+    result = h->result;
+    container_handle_free(h);
+    return result;
+}
+
+/* Run config in this process (Phase 7: unified execution via config
+ * struct) and turn the result into an exit code. A container stopped by
+ * a successful checkpoint exits 0. */
+static int run_local(const container_config_t *config, supervise_t *sv,
+                     bool enable_timings) {
+    container_result_t result = sv->stats || sv->checkpoint_dir ||
+                                config->memory_guard.enable
+        ? exec_supervised(config, sv)
+        : container_exec(config);
+
+    if (enable_timings && result.timings.valid) {
+        print_timings_json(&result.timings);
+    }
+    container_cleanup(&result);
+
+    // Handle result
+    if (result.child_pid < 0) {
+        fprintf(stderr, "Failed to spawn process\n");
+        return 1;
+    }
+    if (sv->checkpointed) {
+        fprintf(stderr, "Checkpointed to %s\n", sv->checkpoint_dir);
+        return 0;
+    }
+
+    if (!result.exited_normally) {
+        fprintf(stderr, "Process killed by signal %d%s\n", result.signal,
+                result.ctx.cgroup_ctx.guard.counts[MEMORY_EVENT_OOM_KILL]
+                    ? " (OOM kill at the memory limit)" : "");
+        return 128 + result.signal;
+    }
+
+    return result.exit_status;
+}
+
+/* Turn a serve_client_exec*() outcome into this process's exit code. */
+static int connected_exit(int rc, const serve_reply_t *reply,
+                          bool enable_debug) {
+    if (rc < 0) {
+        fprintf(stderr, "Failed to spawn process\n");
+        return 1;
+    }
+    if (enable_debug) {
+        fprintf(stderr, "[client] Started in %.1f us (%s)\n",
+                reply->start_ns / 1000.0, reply->warm ? "warm" : "cold");
+    }
+    if (!reply->exited_normally) {
+        fprintf(stderr, "Process killed by signal %d\n", reply->signal);
+        return 128 + reply->signal;
+    }
+    return reply->exit_status;
+}
+
+/* The daemon resolves paths against its own cwd, so a --connect client
+ * sends absolute ones. The overlay's "./containers" default becomes
+ * <cwd>/containers for the same reason. */
+static int absolutize(const char *path, const char *fallback, bool must_exist,
+                      char *out, size_t size) {
+    if (!path) path = fallback;
+    if (!path) return 0;
+    if (must_exist) {
+        char resolved[PATH_MAX];
+        if (!realpath(path, resolved)) {
+            perror(path);
+            return -1;
+        }
+        snprintf(out, size, "%s", resolved);
+        return 1;
+    }
+    if (path[0] == '/') {
+        snprintf(out, size, "%s", path);
+        return 1;
+    }
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) {
+        perror("getcwd");
+        return -1;
+    }
+    if ((size_t)snprintf(out, size, "%s/%s", cwd, path) >= size) {
+        fprintf(stderr, "Error: path too long: %s\n", path);
+        return -1;
+    }
+    return 1;
+}
+
+/* absolutize() for a rootfs spec: each component of a "top:...:base"
+ * layer list (image files included) is resolved on its own. */
+static int absolutize_rootfs(const char *spec, char *out, size_t size) {
+    if (!spec) return 0;
+    char buf[PATH_MAX];
+    if (snprintf(buf, sizeof(buf), "%s", spec) >= (int)sizeof(buf)) {
+        fprintf(stderr, "Error: path too long: %s\n", spec);
+        return -1;
+    }
+    size_t used = 0;
+    char *save = NULL;
+    out[0] = '\0';
+    for (char *part = strtok_r(buf, ":", &save); part;
+         part = strtok_r(NULL, ":", &save)) {
+        char abs_part[PATH_MAX];
+        if (absolutize(part, NULL, true, abs_part, sizeof(abs_part)) < 0) {
+            return -1;
+        }
+        int n = snprintf(out + used, size - used, "%s%s", used ? ":" : "",
+                         abs_part);
+        if (n < 0 || (size_t)n >= size - used) {
+            fprintf(stderr, "Error: path too long: %s\n", spec);
+            return -1;
+        }
+        used += (size_t)n;
+    }
+    return 1;
 }
 
 int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "serve") == 0) {
+        return serve_main(argc - 1, argv + 1, false);
+    }
+    if (argc > 1 && strcmp(argv[1], "stats") == 0) {
+        return serve_main(argc - 1, argv + 1, true);
+    }
+    if (argc > 1 && strcmp(argv[1], "exec") == 0) {
+        return exec_main(argc - 1, argv + 1);
+    }
+    if (argc > 1 && strcmp(argv[1], "events") == 0) {
+        return events_main(argc - 1, argv + 1);
+    }
+
     bool enable_debug = false;
     bool enable_pid_namespace = false;
     bool enable_overlay = false;
@@ -81,6 +676,29 @@ int main(int argc, char *argv[]) {
     char *net_container_ip = NULL;
     char *net_netmask = NULL;
     bool no_nat = false;
+    char *net_backend = NULL;
+    char *fs_backend = NULL;
+    char *net_user = NULL;
+    net_publish_t publish[NET_PUBLISH_MAX];
+    unsigned publish_count = 0;
+    int net_pool_size = -1;
+    int net_pool_low = -1;
+    char *connect_path = NULL;
+    bool enable_timings = false;
+    char *image = NULL;
+    char *image_store = NULL;
+    bool enable_stats = false;
+    monitor_format_t stats_format = MONITOR_FORMAT_JSON;
+    int stats_interval = 1000;
+    memory_guard_config_t memory_guard = {0};
+    char *checkpoint_dir = NULL;
+    char *spec_path = NULL;
+    char *spec_out = NULL;
+    char *seccomp_profile = NULL;
+    int checkpoint_after = 5000;
+    char *restore_dir = NULL;
+    char *pod = NULL;
+    const char *net_bridge = NULL;
 
     // Phase 3 correction: collect --env flags
     char *custom_env[MAX_ENV_ENTRIES];
@@ -106,6 +724,35 @@ int main(int argc, char *argv[]) {
         {"net-container-ip", required_argument, NULL,  2 },
         {"net-netmask",      required_argument, NULL,  3 },
         {"no-nat",           no_argument,       NULL,  4 },
+        {"net-backend",      required_argument, NULL,  5 },
+        {"net-pool",         required_argument, NULL,  6 },
+        {"net-pool-low",     required_argument, NULL,  7 },
+        {"connect",          required_argument, NULL,  8 },
+        {"timings",          required_argument, NULL,  9 },
+        {"image",            required_argument, NULL, 10 },
+        {"image-store",      required_argument, NULL, 11 },
+        {"stats",            optional_argument, NULL, 12 },
+        {"stats-interval",   required_argument, NULL, 13 },
+        {"memory-high",      required_argument, NULL, 14 },
+        {"memory-swap",      required_argument, NULL, 15 },
+        {"cpu-weight",       required_argument, NULL, 16 },
+        {"io-weight",        required_argument, NULL, 17 },
+        {"cpuset-cpus",      required_argument, NULL, 18 },
+        {"cpuset-mems",      required_argument, NULL, 19 },
+        {"io-max",           required_argument, NULL, 20 },
+        {"numa",             required_argument, NULL, 21 },
+        {"memory-guard",     optional_argument, NULL, 22 },
+        {"checkpoint",       required_argument, NULL, 23 },
+        {"checkpoint-after", required_argument, NULL, 24 },
+        {"restore",          required_argument, NULL, 25 },
+        {"pod",              required_argument, NULL, 26 },
+        {"net-bridge",       optional_argument, NULL, 27 },
+        {"fs-backend",       required_argument, NULL, 28 },
+        {"net-user",         optional_argument, NULL, 29 },
+        {"publish",          required_argument, NULL, 30 },
+        {"spec",             required_argument, NULL, 31 },
+        {"spec-out",         required_argument, NULL, 32 },
+        {"seccomp",          required_argument, NULL, 33 },
         {"env",              required_argument, NULL, 'e'},
         {"help",             no_argument,       NULL, 'h'},
         {0, 0, 0, 0}
@@ -169,6 +816,173 @@ int main(int argc, char *argv[]) {
             case 4:
                 no_nat = true;
                 break;
+            case 5:
+                net_backend = optarg;
+                break;
+            case 6:
+                net_pool_size = atoi(optarg);
+                break;
+            case 7:
+                net_pool_low = atoi(optarg);
+                break;
+            case 8:
+                connect_path = optarg;
+                break;
+            case 9:
+                if (strcmp(optarg, "json") != 0) {
+                    fprintf(stderr, "Error: --timings supports only 'json' "
+                                    "(got '%s')\n", optarg);
+                    return 1;
+                }
+                enable_timings = true;
+                break;
+            case 10:
+                image = optarg;
+                break;
+            case 11:
+                image_store = optarg;
+                break;
+            case 12:
+                if (!optarg || strcmp(optarg, "json") == 0) {
+                    stats_format = MONITOR_FORMAT_JSON;
+                } else if (strcmp(optarg, "line") == 0) {
+                    stats_format = MONITOR_FORMAT_LINE;
+                } else {
+                    fprintf(stderr, "Error: --stats must be json or line "
+                                    "(got '%s')\n", optarg);
+                    return 1;
+                }
+                enable_stats = true;
+                enable_cgroup = true;   // The stat files live there
+                break;
+            case 13:
+                stats_interval = atoi(optarg);
+                if (stats_interval < 1) {
+                    fprintf(stderr, "Error: --stats-interval must be a "
+                                    "positive number of ms\n");
+                    return 1;
+                }
+                break;
+            case 14:
+                limits.memory_high = parse_memory_limit(optarg);
+                enable_cgroup = true;
+                break;
+            case 15:
+                limits.swap_limit = parse_memory_limit(optarg);
+                if (limits.swap_limit == 0) {
+                    limits.swap_limit = CGROUP_SWAP_NONE;   // "0": no swap
+                }
+                enable_cgroup = true;
+                break;
+            case 16:
+                if (parse_weight("--cpu-weight", optarg,
+                                 &limits.cpu_weight) < 0) return 1;
+                enable_cgroup = true;
+                break;
+            case 17:
+                if (parse_weight("--io-weight", optarg,
+                                 &limits.io_weight) < 0) return 1;
+                enable_cgroup = true;
+                break;
+            case 18:
+                if (copy_cpuset("--cpuset-cpus", optarg, limits.cpuset_cpus,
+                                sizeof(limits.cpuset_cpus)) < 0) return 1;
+                enable_cgroup = true;
+                break;
+            case 19:
+                if (copy_cpuset("--cpuset-mems", optarg, limits.cpuset_mems,
+                                sizeof(limits.cpuset_mems)) < 0) return 1;
+                enable_cgroup = true;
+                break;
+            case 20:
+                if (parse_io_max(optarg, limits.io_max,
+                                 sizeof(limits.io_max)) < 0) return 1;
+                enable_cgroup = true;
+                break;
+            case 21:
+                if (strcmp(optarg, "auto") != 0) {
+                    fprintf(stderr, "Error: --numa supports only 'auto' "
+                                    "(got '%s')\n", optarg);
+                    return 1;
+                }
+                limits.numa_auto = true;
+                enable_cgroup = true;
+                break;
+            case 22:
+                if (optarg) {
+                    char *end;
+                    long pct = strtol(optarg, &end, 10);
+                    if (*end || pct < 1 || pct > 99) {
+                        fprintf(stderr, "Error: --memory-guard takes a "
+                                        "throttle percentage 1..99 (got "
+                                        "'%s')\n", optarg);
+                        return 1;
+                    }
+                    memory_guard.high_pct = (unsigned)pct;
+                }
+                memory_guard.enable = true;
+                enable_cgroup = true;
+                break;
+            case 23:
+                checkpoint_dir = optarg;
+                break;
+            case 24:
+                checkpoint_after = atoi(optarg);
+                if (checkpoint_after < 0) {
+                    fprintf(stderr, "Error: --checkpoint-after must be >= 0 "
+                                    "ms (got '%s')\n", optarg);
+                    return 1;
+                }
+                break;
+            case 25:
+                restore_dir = optarg;
+                break;
+            case 26:
+                if (!net_pod_name_valid(optarg)) {
+                    fprintf(stderr, "Error: --pod name must be 1..%d of "
+                                    "[A-Za-z0-9_.-] (got '%s')\n",
+                            NET_POD_NAME_MAX - 1, optarg);
+                    return 1;
+                }
+                pod = optarg;
+                break;
+            case 27:
+                net_bridge = optarg ? optarg : NET_BRIDGE_DEFAULT;
+                if (!net_bridge[0] || strlen(net_bridge) >= IFNAMSIZ) {
+                    fprintf(stderr, "Error: --net-bridge name must be 1..%d "
+                                    "characters\n", IFNAMSIZ - 1);
+                    return 1;
+                }
+                break;
+            case 28:
+                fs_backend = optarg;
+                break;
+            case 29:
+                net_user = optarg ? optarg : "auto";
+                break;
+            case 30:
+                if (publish_count >= NET_PUBLISH_MAX) {
+                    fprintf(stderr, "Error: at most %d --publish entries\n",
+                            NET_PUBLISH_MAX);
+                    return 1;
+                }
+                if (net_parse_publish(optarg, &publish[publish_count]) < 0) {
+                    fprintf(stderr, "Error: --publish must be "
+                                    "[host_ip:]host_port:container_port"
+                                    "[/tcp|/udp] (got '%s')\n", optarg);
+                    return 1;
+                }
+                publish_count++;
+                break;
+            case 31:
+                spec_path = optarg;
+                break;
+            case 32:
+                spec_out = optarg;
+                break;
+            case 33:
+                seccomp_profile = optarg;
+                break;
             case 'e':
                 if (env_count >= MAX_ENV_ENTRIES - 1) {
                     fprintf(stderr, "Too many --env entries\n");
@@ -185,12 +999,117 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    /* A snapshot is dumped and restored by this process, not a daemon. */
+    if ((checkpoint_dir || restore_dir) && connect_path) {
+        fprintf(stderr, "Error: --checkpoint / --restore cannot be used "
+                        "with --connect\n");
+        return 1;
+    }
+    supervise_t sv = {
+        .stats = enable_stats,
+        .fmt = stats_format,
+        .interval_ms = stats_interval,
+        .checkpoint_dir = checkpoint_dir,
+        .checkpoint_after_ms = checkpoint_after,
+    };
+
+    /* A compiled spec is run, not recompiled or restored. */
+    if (spec_path && (spec_out || restore_dir)) {
+        fprintf(stderr, "Error: --spec cannot be combined with --spec-out "
+                        "or --restore\n");
+        return 1;
+    }
+    /* Compiling runs nothing, so there is no daemon, snapshot or
+     * stream to attach to. */
+    if (spec_out && (connect_path || restore_dir || checkpoint_dir ||
+                     enable_stats)) {
+        fprintf(stderr, "Error: --spec-out cannot be combined with "
+                        "--connect, --restore, --checkpoint or --stats\n");
+        return 1;
+    }
+
+    /* --restore: the snapshot carries the command and every container
+     * setting; only how to run it (debug, stats, a new checkpoint)
+     * comes from this command line. */
+    if (restore_dir) {
+        if (optind < argc) {
+            fprintf(stderr, "Error: --restore takes no command (got '%s')\n",
+                    argv[optind]);
+            return 1;
+        }
+        static char spec[SPEC_MAX_SIZE] __attribute__((aligned(8)));
+        container_config_t config;
+        if (checkpoint_load_config(restore_dir, &config, spec,
+                                   sizeof(spec)) < 0) {
+            return 1;
+        }
+        config.enable_debug = enable_debug;
+        config.restore_dir = restore_dir;
+        return run_local(&config, &sv, enable_timings);
+    }
+
+    /* --spec: likewise everything comes from the compiled file. It is
+     * mapped and decoded in place (or sent to the daemon untouched): no
+     * option parsing, no environment rebuild, no per-field allocation. */
+    if (spec_path) {
+        if (optind < argc) {
+            fprintf(stderr, "Error: --spec takes no command (got '%s')\n",
+                    argv[optind]);
+            return 1;
+        }
+        size_t spec_len;
+        void *map = spec_map(spec_path, &spec_len);
+        if (!map) {
+            fprintf(stderr, "Error: %s: %s\n", spec_path,
+                    errno == EINVAL ? "not a spec from this build"
+                                    : strerror(errno));
+            return 1;
+        }
+        int rc;
+        container_config_t config;
+        if (connect_path) {
+            serve_reply_t reply;
+            rc = connected_exit(serve_client_exec_spec(connect_path, map,
+                                                       spec_len, &reply),
+                                &reply, enable_debug);
+        } else if (spec_decode(map, spec_len, &config) < 0) {
+            fprintf(stderr, "Error: %s: not a spec from this build\n",
+                    spec_path);
+            rc = 1;
+        } else {
+            if (enable_debug) config.enable_debug = true;
+            rc = run_local(&config, &sv, enable_timings);
+        }
+        spec_unmap(map, spec_len);
+        return rc;
+    }
+
     if (optind >= argc) {
         fprintf(stderr, "Error: No command specified\n");
         usage(argv[0]);
         return 1;
     }
 
+    /* --image stands in for --rootfs: its layers become the overlay's
+     * lowerdir list, so it always runs with --overlay. */
+    static char image_lowerdirs[PATH_MAX];
+    if (image_store && !image) {
+        fprintf(stderr, "Error: --image-store requires --image\n");
+        return 1;
+    }
+    if (image) {
+        if (rootfs_path) {
+            fprintf(stderr, "Error: --image and --rootfs are mutually exclusive\n");
+            return 1;
+        }
+        if (image_resolve(image_store, image, image_lowerdirs,
+                          sizeof(image_lowerdirs), enable_debug) < 0) {
+            return 1;
+        }
+        rootfs_path = image_lowerdirs;
+        enable_overlay = true;
+    }
+
     /* Phase 3 invariant: --overlay requires --rootfs. The overlay filesystem
      * needs a lowerdir (base image), which only exists when --rootfs is
      * provided. Without this check, setup_overlay() would fail with a
@@ -201,13 +1120,138 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    /* --numa picks both sets itself; a pinned one would be ignored. */
+    if (limits.numa_auto && (limits.cpuset_cpus[0] || limits.cpuset_mems[0])) {
+        fprintf(stderr, "Error: --numa cannot be combined with "
+                        "--cpuset-cpus / --cpuset-mems\n");
+        return 1;
+    }
+
+    /* The daemon owns a --connect container's cgroup, so there is no
+     * dir_fd on this side to sample. */
+    if ((enable_stats || memory_guard.enable) && connect_path) {
+        fprintf(stderr, "Error: --stats / --memory-guard cannot be used "
+                        "with --connect\n");
+        return 1;
+    }
+    /* The throttle target is a share of memory.max. */
+    if (memory_guard.high_pct && limits.memory_limit == 0) {
+        fprintf(stderr, "Error: --memory-guard=<pct> requires --memory\n");
+        return 1;
+    }
+
     /* Phase 6 invariant: --net sub-flags require --net. Without this check
      * the IPs/netmask/no-nat would be silently ignored if --net is missing,
      * which is confusing. Fail loudly instead. */
-    if ((net_host_ip || net_container_ip || net_netmask || no_nat)
-        && !enable_network) {
+    if ((net_host_ip || net_container_ip || net_netmask || no_nat ||
+         net_backend || net_pool_size >= 0 || net_pool_low >= 0 || pod ||
+         net_bridge || net_user || publish_count) && !enable_network) {
         fprintf(stderr, "Error: --net-host-ip / --net-container-ip / "
-                        "--net-netmask / --no-nat require --net\n");
+                        "--net-netmask / --no-nat / --net-backend / "
+                        "--net-pool / --net-pool-low / --pod / --net-bridge / "
+                        "--net-user / --publish require --net\n");
+        return 1;
+    }
+
+    /* Without root a veth cannot be built at all: rootless --net means
+     * a user-mode helper. */
+    net_user_mode_t user_mode = NET_USER_NONE;
+    if (enable_network && !net_user && geteuid() != 0) net_user = "auto";
+    if (net_user) {
+        if (strcmp(net_user, "auto") == 0) {
+            user_mode = NET_USER_AUTO;
+        } else if (strcmp(net_user, "pasta") == 0) {
+            user_mode = NET_USER_PASTA;
+        } else if (strcmp(net_user, "slirp4netns") == 0) {
+            user_mode = NET_USER_SLIRP4NETNS;
+        } else {
+            fprintf(stderr, "Error: --net-user must be auto, pasta, or "
+                            "slirp4netns (got '%s')\n", net_user);
+            return 1;
+        }
+        /* The helper owns the interface: there is no veth to pool, share
+         * or enslave, and criu cannot recreate a helper's tap. */
+        if (net_pool_size >= 0 || pod || net_bridge || checkpoint_dir) {
+            fprintf(stderr, "Error: --net-user (implied without root) cannot "
+                            "be combined with --net-pool, --pod, --net-bridge "
+                            "or --checkpoint\n");
+            return 1;
+        }
+    }
+
+    /* A pod's netns is either shared or a pooled slot's, not both, and a
+     * user namespace cannot join a host-owned one. */
+    if (pod && (net_pool_size >= 0 || enable_user_namespace)) {
+        fprintf(stderr, "Error: --pod cannot be combined with --net-pool "
+                        "or --user\n");
+        return 1;
+    }
+    /* A pooled slot's address is picked at claim time and a pod's rules
+     * would need to outlive the member that added them. */
+    if (publish_count && (net_pool_size >= 0 || pod)) {
+        fprintf(stderr, "Error: --publish cannot be combined with "
+                        "--net-pool or --pod\n");
+        return 1;
+    }
+    /* Bridge ports are plain pairs built over rtnetlink; a pooled slot is
+     * pre-addressed, and a pod's address lease would end with its first
+     * member. */
+    if (net_bridge && (net_pool_size >= 0 || pod)) {
+        fprintf(stderr, "Error: --net-bridge cannot be combined with "
+                        "--net-pool or --pod\n");
+        return 1;
+    }
+
+    net_backend_t backend = NET_BACKEND_AUTO;
+    if (net_backend) {
+        if (strcmp(net_backend, "auto") == 0) {
+            backend = NET_BACKEND_AUTO;
+        } else if (strcmp(net_backend, "netlink") == 0) {
+            backend = NET_BACKEND_NETLINK;
+        } else if (strcmp(net_backend, "ip") == 0) {
+            backend = NET_BACKEND_IP;
+        } else {
+            fprintf(stderr, "Error: --net-backend must be auto, netlink, "
+                            "or ip (got '%s')\n", net_backend);
+            return 1;
+        }
+    }
+
+    if (fs_backend) {
+        if (strcmp(fs_backend, "syscall") == 0) {
+            fs_batch_set_backend(FS_BACKEND_SYSCALL);
+        } else if (strcmp(fs_backend, "auto") != 0) {
+            fprintf(stderr, "Error: --fs-backend must be auto or syscall "
+                            "(got '%s')\n", fs_backend);
+            return 1;
+        }
+    }
+
+    /* The pool speaks rtnetlink only (pairs are moved between netns, not
+     * recreated), so it cannot honour a pinned ip(8) backend. */
+    if (net_pool_low >= 0 && net_pool_size < 0) {
+        fprintf(stderr, "Error: --net-pool-low requires --net-pool\n");
+        return 1;
+    }
+    if (net_pool_size >= 0) {
+        if (net_pool_size < 1 || net_pool_size > NET_POOL_MAX_SLOTS) {
+            fprintf(stderr, "Error: --net-pool must be 1..%d (got %d)\n",
+                    NET_POOL_MAX_SLOTS, net_pool_size);
+            return 1;
+        }
+        if (net_pool_low > net_pool_size) {
+            fprintf(stderr, "Error: --net-pool-low must not exceed "
+                            "--net-pool\n");
+            return 1;
+        }
+        if (backend == NET_BACKEND_IP) {
+            fprintf(stderr, "Error: --net-pool requires the netlink "
+                            "backend\n");
+            return 1;
+        }
+    }
+    if (net_bridge && backend == NET_BACKEND_IP) {
+        fprintf(stderr, "Error: --net-bridge requires the netlink backend\n");
         return 1;
     }
 
@@ -225,12 +1269,38 @@ int main(int argc, char *argv[]) {
         // Phase 5: added "--memory", "--cpus", "--pids"
         // Phase 6: added "--net", "--net-host-ip", "--net-container-ip",
         //                "--net-netmask", "--no-nat"
+        // Netlink backend: added "--net-backend"
+        // veth pool: added "--net-pool", "--net-pool-low"
+        // serve daemon: added "--connect"
+        // start-latency tracing: added "--timings"
+        // layer store: added "--image", "--image-store"
+        // telemetry: added "--stats", "--stats-interval"
+        // cgroup knobs: added "--memory-high", "--memory-swap",
+        //               "--cpu-weight", "--io-weight", "--cpuset-cpus",
+        //               "--cpuset-mems", "--io-max", "--numa"
+        // memory guard: added "--memory-guard"
+        // checkpoint/restore: added "--checkpoint", "--checkpoint-after",
+        //                     "--restore"
+        // pod mode: added "--pod"
+        // bridge mode: added "--net-bridge"
+        // io_uring batching: added "--fs-backend"
+        // rootless networking: added "--net-user"
+        // port publishing: added "--publish"
+        // compiled specs: added "--spec", "--spec-out"
+        // syscall filter: added "--seccomp"
         static const char *known_flags[] = {
             "--debug", "--pid", "--rootfs", "--overlay",
             "--container-dir", "--hostname", "--user",
             "--ipc", "--memory", "--cpus", "--pids",
             "--net", "--net-host-ip", "--net-container-ip",
-            "--net-netmask", "--no-nat",
+            "--net-netmask", "--no-nat", "--net-backend",
+            "--net-pool", "--net-pool-low", "--connect", "--timings",
+            "--image", "--image-store", "--stats", "--stats-interval",
+            "--memory-high", "--memory-swap", "--cpu-weight", "--io-weight",
+            "--cpuset-cpus", "--cpuset-mems", "--io-max", "--numa",
+            "--memory-guard", "--checkpoint", "--checkpoint-after",
+            "--restore", "--pod", "--net-bridge", "--fs-backend",
+            "--net-user", "--publish", "--spec", "--spec-out", "--seccomp",
             "--env", "--help", NULL
         };
 
@@ -283,11 +1353,22 @@ int main(int argc, char *argv[]) {
         .gid_map_range = 1,
         .cgroup_limits = limits,
         .enable_cgroup = enable_cgroup,
+        .memory_guard = memory_guard,
+        .enable_timings = enable_timings,
+        .seccomp_profile = seccomp_profile,
         .veth = {
             .host_ip      = "",
             .container_ip = "",
             .netmask      = "",
             .enable_nat   = !no_nat,
+            .backend      = backend,
+            .user_mode    = user_mode,
+            .pool = {
+                .size      = net_pool_size > 0 ? (unsigned)net_pool_size : 0,
+                .low_water = net_pool_low >= 0 ? (unsigned)net_pool_low
+                           : net_pool_size > 0 ? (unsigned)net_pool_size / 2
+                           : 0,
+            },
         }
     };
 
@@ -298,31 +1379,66 @@ int main(int argc, char *argv[]) {
         strncpy(config.veth.host_ip,
                 net_host_ip ? net_host_ip : "10.0.0.1",
                 sizeof(config.veth.host_ip) - 1);
+        /* On a bridge an unset container address is leased per start. */
         strncpy(config.veth.container_ip,
-                net_container_ip ? net_container_ip : "10.0.0.2",
+                net_container_ip ? net_container_ip
+                : net_bridge ? "" : "10.0.0.2",
                 sizeof(config.veth.container_ip) - 1);
         strncpy(config.veth.netmask,
                 net_netmask ? net_netmask : "24",
                 sizeof(config.veth.netmask) - 1);
+        if (pod) strncpy(config.veth.pod, pod, sizeof(config.veth.pod) - 1);
+        if (net_bridge) {
+            strncpy(config.veth.bridge, net_bridge,
+                    sizeof(config.veth.bridge) - 1);
+        }
+        memcpy(config.veth.publish, publish, publish_count * sizeof(publish[0]));
+        config.veth.publish_count = publish_count;
     }
 
-    // Execute (Phase 7: Unified execution via config struct)
-     container_result_t result = container_exec(&config);
-
-    
-    container_cleanup(&result);
-    free(container_env);
+    /* serve daemon: same config, started by the daemon's zygotes. A
+     * compiled spec may be run from anywhere, so it gets the same
+     * absolute paths. */
+    if (connect_path || spec_out) {
+        char abs_rootfs[PATH_MAX], abs_container_dir[PATH_MAX];
+        char abs_seccomp[PATH_MAX];
+        /* An image's layer list is already absolute. */
+        int have_rootfs = image ? 0 : absolutize_rootfs(rootfs_path, abs_rootfs,
+                                                        sizeof(abs_rootfs));
+        int have_dir = absolutize(container_dir,
+                                  enable_overlay ? "containers" : NULL, false,
+                                  abs_container_dir, sizeof(abs_container_dir));
+        int have_seccomp = seccomp_profile &&
+                           strcmp(seccomp_profile, SECCOMP_PROFILE_DEFAULT) != 0
+            ? absolutize(seccomp_profile, NULL, true, abs_seccomp,
+                         sizeof(abs_seccomp))
+            : 0;
+        if (have_rootfs < 0 || have_dir < 0 || have_seccomp < 0) {
+            free(container_env);
+            return 1;
+        }
+        if (have_rootfs) config.rootfs_path = abs_rootfs;
+        if (have_dir) config.container_dir = abs_container_dir;
+        if (have_seccomp) config.seccomp_profile = abs_seccomp;
 
-    // Handle result
-    if (result.child_pid < 0) {
-        fprintf(stderr, "Failed to spawn process\n");
-        return 1;
-    }
+        if (spec_out) {
+            int rc = spec_save(&config, spec_out);
+            free(container_env);
+            if (rc < 0) {
+                fprintf(stderr, "Error: cannot write %s: %s\n", spec_out,
+                        errno == E2BIG ? "spec too large" : strerror(errno));
+                return 1;
+            }
+            return 0;
+        }
 
-    if (!result.exited_normally) {
-        fprintf(stderr, "Process killed by signal %d\n", result.signal);
-        return 128 + result.signal;
+        serve_reply_t reply;
+        int rc = serve_client_exec(connect_path, &config, &reply);
+        free(container_env);
+        return connected_exit(rc, &reply, enable_debug);
     }
 
-    return result.exit_status;
+    int rc = run_local(&config, &sv, enable_timings);
+    free(container_env);
+    return rc;
 }
\ No newline at end of file
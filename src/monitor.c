@@ -0,0 +1,343 @@
+// Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include "monitor.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BIT(f) (1u << (f))
+
+static const char *const monitor_files[MONITOR_FILE_COUNT] = {
+    [MONITOR_FILE_MEMORY_CURRENT]  = "memory.current",
+    [MONITOR_FILE_MEMORY_STAT]     = "memory.stat",
+    [MONITOR_FILE_CPU_STAT]        = "cpu.stat",
+    [MONITOR_FILE_PIDS_CURRENT]    = "pids.current",
+    [MONITOR_FILE_IO_STAT]         = "io.stat",
+    [MONITOR_FILE_CPU_PRESSURE]    = "cpu.pressure",
+    [MONITOR_FILE_MEMORY_PRESSURE] = "memory.pressure",
+};
+
+/**
+ * pread the whole file at offset 0 into buf (NUL-terminated). memory.stat
+ * is ~1.5 KiB; io.stat grows with the device count, and whatever does
+ * not fit is dropped.
+ */
+static int read_at0(int fd, char *buf, size_t size) {
+    ssize_t n = pread(fd, buf, size - 1, 0);
+    if (n < 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+    return 0;
+}
+
+/* "key value" line lookup (memory.stat, cpu.stat). */
+static uint64_t flat_keyed(const char *buf, const char *key) {
+    size_t len = strlen(key);
+    const char *p = buf;
+    while (*p) {
+        if (strncmp(p, key, len) == 0 && p[len] == ' ') {
+            return strtoull(p + len + 1, NULL, 10);
+        }
+        const char *nl = strchr(p, '\n');
+        if (!nl) break;
+        p = nl + 1;
+    }
+    return 0;
+}
+
+/* io.stat: "MAJ:MIN rbytes=N wbytes=N rios=N wios=N ..." per device. */
+static uint64_t nested_sum(const char *buf, const char *key) {
+    char pat[32];
+    snprintf(pat, sizeof(pat), " %s=", key);
+    uint64_t sum = 0;
+    for (const char *p = strstr(buf, pat); p; p = strstr(p + 1, pat)) {
+        sum += strtoull(p + strlen(pat), NULL, 10);
+    }
+    return sum;
+}
+
+/* PSI: "some avg10=0.12 avg60=.. avg300=.. total=N" then a "full" line. */
+static void pressure_line(const char *buf, const char *kind, double *avg10,
+                          uint64_t *total) {
+    const char *p = strstr(buf, kind);
+    if (!p) {
+        return;
+    }
+    const char *a = strstr(p, "avg10=");
+    const char *t = strstr(p, "total=");
+    if (a) *avg10 = strtod(a + 6, NULL);
+    if (t) *total = strtoull(t + 6, NULL, 10);
+}
+
+static void read_sample(const container_monitor_t *m, monitor_sample_t *s) {
+    static char buf[8192];
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    memset(s, 0, sizeof(*s));
+    s->ts_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+
+    for (int f = 0; f < MONITOR_FILE_COUNT; f++) {
+        if (m->fds[f] < 0 || read_at0(m->fds[f], buf, sizeof(buf)) < 0) {
+            continue;
+        }
+        s->present |= BIT(f);
+        switch ((monitor_file_t)f) {
+        case MONITOR_FILE_MEMORY_CURRENT:
+            s->memory_current = strtoull(buf, NULL, 10);
+            break;
+        case MONITOR_FILE_MEMORY_STAT:
+            s->memory_anon = flat_keyed(buf, "anon");
+            s->memory_file = flat_keyed(buf, "file");
+            break;
+        case MONITOR_FILE_CPU_STAT:
+            s->cpu_usage_usec     = flat_keyed(buf, "usage_usec");
+            s->cpu_user_usec      = flat_keyed(buf, "user_usec");
+            s->cpu_system_usec    = flat_keyed(buf, "system_usec");
+            s->cpu_nr_throttled   = flat_keyed(buf, "nr_throttled");
+            s->cpu_throttled_usec = flat_keyed(buf, "throttled_usec");
+            break;
+        case MONITOR_FILE_PIDS_CURRENT:
+            s->pids_current = strtoull(buf, NULL, 10);
+            break;
+        case MONITOR_FILE_IO_STAT:
+            s->io_rbytes = nested_sum(buf, "rbytes");
+            s->io_wbytes = nested_sum(buf, "wbytes");
+            s->io_rios   = nested_sum(buf, "rios");
+            s->io_wios   = nested_sum(buf, "wios");
+            break;
+        case MONITOR_FILE_CPU_PRESSURE:
+            pressure_line(buf, "some", &s->cpu_some_avg10,
+                          &s->cpu_some_total_usec);
+            break;
+        case MONITOR_FILE_MEMORY_PRESSURE:
+            pressure_line(buf, "some", &s->memory_some_avg10,
+                          &s->memory_some_total_usec);
+            pressure_line(buf, "full", &s->memory_full_avg10,
+                          &s->memory_full_total_usec);
+            break;
+        case MONITOR_FILE_COUNT:
+            break;
+        }
+    }
+}
+
+static uint64_t delta(uint64_t now, uint64_t base) {
+    return now > base ? now - base : 0;
+}
+
+int monitor_open(container_monitor_t *m, int dir_fd, const char *name,
+                 pid_t pid) {
+    memset(m, 0, sizeof(*m));
+    snprintf(m->name, sizeof(m->name), "%s", name ? name : "");
+    m->pid = pid;
+
+    int opened = 0;
+    for (int f = 0; f < MONITOR_FILE_COUNT; f++) {
+        m->fds[f] = dir_fd < 0 ? -1 :
+                    openat(dir_fd, monitor_files[f], O_RDONLY | O_CLOEXEC);
+        if (m->fds[f] >= 0) opened++;
+    }
+    if (opened == 0) {
+        fprintf(stderr, "[monitor] No cgroup stat files for %s\n", m->name);
+        monitor_close(m);
+        return -1;
+    }
+
+    read_sample(m, &m->base);
+    return 0;
+}
+
+const monitor_sample_t *monitor_sample(container_monitor_t *m) {
+    monitor_sample_t *s = &m->ring[m->count % MONITOR_RING_SIZE];
+    read_sample(m, s);
+
+    // Counters relative to the baseline; gauges stay as read
+    const monitor_sample_t *b = &m->base;
+    s->cpu_usage_usec         = delta(s->cpu_usage_usec, b->cpu_usage_usec);
+    s->cpu_user_usec          = delta(s->cpu_user_usec, b->cpu_user_usec);
+    s->cpu_system_usec        = delta(s->cpu_system_usec, b->cpu_system_usec);
+    s->cpu_nr_throttled       = delta(s->cpu_nr_throttled, b->cpu_nr_throttled);
+    s->cpu_throttled_usec     = delta(s->cpu_throttled_usec, b->cpu_throttled_usec);
+    s->io_rbytes              = delta(s->io_rbytes, b->io_rbytes);
+    s->io_wbytes              = delta(s->io_wbytes, b->io_wbytes);
+    s->io_rios                = delta(s->io_rios, b->io_rios);
+    s->io_wios                = delta(s->io_wios, b->io_wios);
+    s->cpu_some_total_usec    = delta(s->cpu_some_total_usec, b->cpu_some_total_usec);
+    s->memory_some_total_usec = delta(s->memory_some_total_usec,
+                                      b->memory_some_total_usec);
+    s->memory_full_total_usec = delta(s->memory_full_total_usec,
+                                      b->memory_full_total_usec);
+    m->count++;
+    return s;
+}
+
+/* --- Formatting: one field list, two syntaxes ------------------------- */
+
+typedef struct {
+    char *buf;
+    size_t size;
+    int len;
+    monitor_format_t fmt;
+    bool first;
+} line_t;
+
+static void emit(line_t *l, const char *fmt, ...) {
+    size_t off = (size_t)l->len < l->size ? (size_t)l->len : l->size;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(l->buf + off, l->size - off, fmt, ap);
+    va_end(ap);
+    if (n > 0) l->len += n;
+}
+
+static void field_u64(line_t *l, const char *key, uint64_t v) {
+    if (l->fmt == MONITOR_FORMAT_JSON) {
+        emit(l, ",\"%s\":%llu", key, (unsigned long long)v);
+    } else {
+        emit(l, "%s%s=%llui", l->first ? " " : ",", key, (unsigned long long)v);
+    }
+    l->first = false;
+}
+
+static void field_f64(line_t *l, const char *key, double v) {
+    if (l->fmt == MONITOR_FORMAT_JSON) {
+        emit(l, ",\"%s\":%.2f", key, v);
+    } else {
+        emit(l, "%s%s=%.2f", l->first ? " " : ",", key, v);
+    }
+    l->first = false;
+}
+
+/* JSON: {"cgroup":..,"pid":..  Line protocol: minicontainer,cgroup=.. pid=..i
+ * (measurement minicontainer_summary for the summary). */
+static void line_begin(line_t *l, bool summary, const container_monitor_t *m) {
+    if (l->fmt == MONITOR_FORMAT_JSON) {
+        emit(l, "{%s\"cgroup\":\"%s\",\"pid\":%d",
+             summary ? "\"summary\":true," : "", m->name, (int)m->pid);
+    } else {
+        emit(l, "minicontainer%s,cgroup=%s", summary ? "_summary" : "", m->name);
+        field_u64(l, "pid", (uint64_t)m->pid);
+    }
+}
+
+static void line_end(line_t *l, uint64_t ts_ns) {
+    if (l->fmt == MONITOR_FORMAT_JSON) {
+        emit(l, ",\"ts_ns\":%llu}\n", (unsigned long long)ts_ns);
+    } else {
+        emit(l, " %llu\n", (unsigned long long)ts_ns);
+    }
+}
+
+int monitor_format(const container_monitor_t *m, const monitor_sample_t *s,
+                   monitor_format_t fmt, char *buf, size_t size) {
+    line_t l = { .buf = buf, .size = size, .fmt = fmt, .first = true };
+    if (size) buf[0] = '\0';
+    line_begin(&l, false, m);
+
+    if (s->present & BIT(MONITOR_FILE_MEMORY_CURRENT)) {
+        field_u64(&l, "memory_current", s->memory_current);
+    }
+    if (s->present & BIT(MONITOR_FILE_MEMORY_STAT)) {
+        field_u64(&l, "memory_anon", s->memory_anon);
+        field_u64(&l, "memory_file", s->memory_file);
+    }
+    if (s->present & BIT(MONITOR_FILE_CPU_STAT)) {
+        field_u64(&l, "cpu_usage_usec", s->cpu_usage_usec);
+        field_u64(&l, "cpu_user_usec", s->cpu_user_usec);
+        field_u64(&l, "cpu_system_usec", s->cpu_system_usec);
+        field_u64(&l, "cpu_nr_throttled", s->cpu_nr_throttled);
+        field_u64(&l, "cpu_throttled_usec", s->cpu_throttled_usec);
+
+        // Utilisation over the interval since the previous sample
+        size_t idx = (size_t)(s - m->ring);
+        const monitor_sample_t *p =
+            &m->ring[(idx + MONITOR_RING_SIZE - 1) % MONITOR_RING_SIZE];
+        if (idx < MONITOR_RING_SIZE && m->count > 1 && p->ts_ns &&
+            p->ts_ns < s->ts_ns) {
+            double wall_us = (s->ts_ns - p->ts_ns) / 1000.0;
+            field_f64(&l, "cpu_pct",
+                      100.0 * delta(s->cpu_usage_usec, p->cpu_usage_usec) / wall_us);
+        }
+    }
+    if (s->present & BIT(MONITOR_FILE_PIDS_CURRENT)) {
+        field_u64(&l, "pids_current", s->pids_current);
+    }
+    if (s->present & BIT(MONITOR_FILE_IO_STAT)) {
+        field_u64(&l, "io_rbytes", s->io_rbytes);
+        field_u64(&l, "io_wbytes", s->io_wbytes);
+        field_u64(&l, "io_rios", s->io_rios);
+        field_u64(&l, "io_wios", s->io_wios);
+    }
+    if (s->present & BIT(MONITOR_FILE_CPU_PRESSURE)) {
+        field_f64(&l, "cpu_some_avg10", s->cpu_some_avg10);
+        field_u64(&l, "cpu_some_total_usec", s->cpu_some_total_usec);
+    }
+    if (s->present & BIT(MONITOR_FILE_MEMORY_PRESSURE)) {
+        field_f64(&l, "memory_some_avg10", s->memory_some_avg10);
+        field_f64(&l, "memory_full_avg10", s->memory_full_avg10);
+        field_u64(&l, "memory_some_total_usec", s->memory_some_total_usec);
+        field_u64(&l, "memory_full_total_usec", s->memory_full_total_usec);
+    }
+
+    line_end(&l, s->ts_ns);
+    return l.len;
+}
+
+int monitor_summary(const container_monitor_t *m, monitor_format_t fmt,
+                    char *buf, size_t size) {
+    line_t l = { .buf = buf, .size = size, .fmt = fmt, .first = true };
+    if (size) buf[0] = '\0';
+    uint64_t held = m->count < MONITOR_RING_SIZE ? m->count : MONITOR_RING_SIZE;
+
+    uint64_t mem_peak = 0, pids_peak = 0;
+    double cpu_some = 0, mem_some = 0, mem_full = 0;
+    for (uint64_t i = 0; i < held; i++) {
+        const monitor_sample_t *s = &m->ring[i];
+        if (s->memory_current > mem_peak) mem_peak = s->memory_current;
+        if (s->pids_current > pids_peak) pids_peak = s->pids_current;
+        if (s->cpu_some_avg10 > cpu_some) cpu_some = s->cpu_some_avg10;
+        if (s->memory_some_avg10 > mem_some) mem_some = s->memory_some_avg10;
+        if (s->memory_full_avg10 > mem_full) mem_full = s->memory_full_avg10;
+    }
+    const monitor_sample_t *last = held ?
+        &m->ring[(m->count - 1) % MONITOR_RING_SIZE] : &m->base;
+
+    line_begin(&l, true, m);
+    field_u64(&l, "samples", m->count);
+    if (last->present & BIT(MONITOR_FILE_MEMORY_CURRENT)) {
+        field_u64(&l, "memory_peak", mem_peak);
+    }
+    if (last->present & BIT(MONITOR_FILE_PIDS_CURRENT)) {
+        field_u64(&l, "pids_peak", pids_peak);
+    }
+    if (last->present & BIT(MONITOR_FILE_CPU_STAT)) {
+        field_u64(&l, "cpu_usage_usec", held ? last->cpu_usage_usec : 0);
+        field_u64(&l, "cpu_throttled_usec", held ? last->cpu_throttled_usec : 0);
+    }
+    if (last->present & BIT(MONITOR_FILE_IO_STAT)) {
+        field_u64(&l, "io_rbytes", held ? last->io_rbytes : 0);
+        field_u64(&l, "io_wbytes", held ? last->io_wbytes : 0);
+    }
+    if (last->present & BIT(MONITOR_FILE_CPU_PRESSURE)) {
+        field_f64(&l, "cpu_some_avg10_max", cpu_some);
+    }
+    if (last->present & BIT(MONITOR_FILE_MEMORY_PRESSURE)) {
+        field_f64(&l, "memory_some_avg10_max", mem_some);
+        field_f64(&l, "memory_full_avg10_max", mem_full);
+    }
+    line_end(&l, last->ts_ns);
+    return l.len;
+}
+
+void monitor_close(container_monitor_t *m) {
+    for (int f = 0; f < MONITOR_FILE_COUNT; f++) {
+        if (m->fds[f] >= 0) close(m->fds[f]);
+        m->fds[f] = -1;
+    }
+}
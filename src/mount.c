@@ -1,4 +1,5 @@
 #include "mount.h"
+#include "events.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -9,6 +10,103 @@
 #include <string.h>
 #include <limits.h>
 
+#ifndef SYS_open_tree
+#define SYS_open_tree   428
+#endif
+#ifndef SYS_move_mount
+#define SYS_move_mount  429
+#endif
+#ifndef SYS_fsopen
+#define SYS_fsopen      430
+#endif
+#ifndef SYS_fsconfig
+#define SYS_fsconfig    431
+#endif
+#ifndef SYS_fsmount
+#define SYS_fsmount     432
+#endif
+
+int fsopen_compat(const char *fsname, unsigned int flags){
+    return (int)syscall(SYS_fsopen, fsname, flags);
+}
+
+int fsconfig_compat(int fs_fd, unsigned int cmd, const char *key,
+                    const void *value, int aux){
+    return (int)syscall(SYS_fsconfig, fs_fd, cmd, key, value, aux);
+}
+
+int fsmount_compat(int fs_fd, unsigned int flags, unsigned int attr_flags){
+    return (int)syscall(SYS_fsmount, fs_fd, flags, attr_flags);
+}
+
+int move_mount_compat(int from_dfd, const char *from_path, int to_dfd,
+                      const char *to_path, unsigned int flags){
+    return (int)syscall(SYS_move_mount, from_dfd, from_path, to_dfd,
+                        to_path, flags);
+}
+
+int open_tree_compat(int dfd, const char *path, unsigned int flags){
+    return (int)syscall(SYS_open_tree, dfd, path, flags);
+}
+
+/**
+ * Each read() returns one "e|w|i <message>" line until ENODATA.
+ */
+void fs_log_dump(int fs_fd, const char *prefix){
+    char msg[512];
+    ssize_t n;
+    while((n = read(fs_fd, msg, sizeof(msg) - 1)) > 0){
+        msg[n] = '\0';
+        fprintf(stderr, "%s %s\n", prefix, msg);
+    }
+}
+
+/**
+ * Shared tail of setup_rootfs()/setup_rootfs_fd(): abs_path is already a
+ * private mount point in this namespace.
+ */
+static int pivot_into(const char *abs_path, bool enable_debug){
+    if(chdir(abs_path) < 0){
+        perror("chdir(new_root)");
+        return -1;
+    }
+
+    const char *put_old = "old_root";
+    if(mkdir(put_old, 0700) < 0 && errno != EEXIST){
+        perror("mkdir(old_root)");
+        return -1;
+    }
+
+    if(syscall(SYS_pivot_root, ".", put_old) < 0){
+        perror("pivot_root");
+        return -1;
+    }
+
+    if (enable_debug) {
+        debug_log("[child] pivot_root successful\n");
+    }
+
+    if (chdir("/") < 0) {
+        perror("chdir(/)");
+        return -1;
+    }
+
+    // MNT_DETACH: lazy unmount so in-flight references drain gracefully
+    if(umount2("/old_root", MNT_DETACH) < 0){
+        perror("umount2(old_root)");
+        return -1;
+    }
+
+    if(enable_debug){
+        debug_log("[child] Unmounted old root\n");
+    }
+
+    // Best-effort cleanup; isolation is already complete at this point
+    rmdir("/old_root");
+
+    return 0;
+}
+
 /**
  * Setup rootfs using pivot_root.
  *
@@ -23,7 +121,7 @@ int setup_rootfs(const char *rootfs_path, bool enable_debug){
     }
 
     if(enable_debug){
-        printf("[child] Setting up rootfs: %s\n", rootfs_path);
+        debug_log("[child] Setting up rootfs: %s\n", rootfs_path);
     }
 
     char abs_path[PATH_MAX];
@@ -53,48 +151,56 @@ int setup_rootfs(const char *rootfs_path, bool enable_debug){
     }
 
     if (enable_debug) {
-        printf("[child] Bind mounted %s\n", abs_path);
+        debug_log("[child] Bind mounted %s\n", abs_path);
     }
 
-    if(chdir(abs_path) < 0){
-        perror("chdir(new_root)");
-        return -1;
-    }
+    return pivot_into(abs_path, enable_debug);
+}
 
-    const char *put_old = "old_root";
-    if(mkdir(put_old, 0700) < 0 && errno != EEXIST){
-        perror("mkdir(old_root)");
-        return -1;
-    }
+int mount_tree_clone(const char *path){
+    return open_tree_compat(AT_FDCWD, path,
+                            OPEN_TREE_CLONE | OPEN_TREE_CLOEXEC | AT_RECURSIVE);
+}
 
-    if(syscall(SYS_pivot_root, ".", put_old) < 0){
-        perror("pivot_root");
-        return -1;
+/**
+ * Setup rootfs from a detached mount fd.
+ *
+ * The detached tree is already private and a mount in its own right, so
+ * attaching it replaces both the MS_BIND and the per-root MS_PRIVATE
+ * calls of setup_rootfs(). / still has to be made private for pivot_root.
+ */
+int setup_rootfs_fd(int tree_fd, const char *rootfs_path, bool enable_debug){
+    if(enable_debug){
+        debug_log("[child] Setting up rootfs from mount fd %d: %s\n",
+               tree_fd, rootfs_path);
     }
 
-    if (enable_debug) {
-        printf("[child] pivot_root successful\n");
+    char abs_path[PATH_MAX];
+    if(!realpath(rootfs_path, abs_path)){
+        perror("realpath");
+        close(tree_fd);
+        return -1;
     }
 
-    if (chdir("/") < 0) {
-        perror("chdir(/)");
+    if(mount("", "/", NULL, MS_PRIVATE | MS_REC, NULL) < 0){
+        perror("mount(MS_PRIVATE /)");
+        close(tree_fd);
         return -1;
     }
 
-    // MNT_DETACH: lazy unmount so in-flight references drain gracefully
-    if(umount2("/old_root", MNT_DETACH) < 0){
-        perror("umount2(old_root)");
+    if(move_mount_compat(tree_fd, "", AT_FDCWD, abs_path,
+                         MOVE_MOUNT_F_EMPTY_PATH) < 0){
+        perror("move_mount(rootfs)");
+        close(tree_fd);
         return -1;
     }
+    close(tree_fd);
 
     if(enable_debug){
-        printf("[child] Unmounted old root\n");
+        debug_log("[child] Attached detached rootfs at %s\n", abs_path);
     }
 
-    // Best-effort cleanup; isolation is already complete at this point
-    rmdir("/old_root");
-
-    return 0;
+    return pivot_into(abs_path, enable_debug);
 }
 
 /**
@@ -104,7 +210,7 @@ int mount_proc(bool enable_debug){
     struct stat st;
     if(stat("/proc", &st) < 0 || !S_ISDIR(st.st_mode)){
         if(enable_debug){
-            printf("[child] /proc doesn't exist or is not a directory, skipping mount\n");
+            debug_log("[child] /proc doesn't exist or is not a directory, skipping mount\n");
         }
         return 0;
     }
@@ -118,7 +224,7 @@ int mount_proc(bool enable_debug){
     }
 
     if(enable_debug){
-        printf("[child] Mounted /proc\n");
+        debug_log("[child] Mounted /proc\n");
     }
 
     return 0;
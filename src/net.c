@@ -1,6 +1,14 @@
 // Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
 // Do NOT redefine it here (Error #8 from decisions.md).
 #include "net.h"
+#include "netlink.h"
+#include "net_pool.h"
+#include "net_pod.h"
+#include "net_bridge.h"
+#include "net_user.h"
+#include "id.h"
+#include "events.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,6 +20,69 @@
 #include <sys/wait.h>
 
 #define MAX_IP_ARGS 16
+#define PUBLISH_RULES_MAX (NET_PUBLISH_MAX * 2 * 192)   // Both DNAT lines per port
+
+/* Microseconds elapsed since `start` on CLOCK_MONOTONIC. Used by the
+ * --debug timing lines so the netlink and ip(8) backends can be
+ * compared on the same host. */
+static long elapsed_us(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000L +
+           (now.tv_nsec - start->tv_nsec) / 1000L;
+}
+
+static const char *backend_name(net_backend_t backend) {
+    return backend == NET_BACKEND_IP ? "ip(8)" : "netlink";
+}
+
+/* Parse the CIDR suffix stored in veth_config_t.netmask ("24"). */
+int net_parse_prefix_len(const char *netmask) {
+    char *end;
+    long v = strtol(netmask, &end, 10);
+    if (end == netmask || *end != '\0' || v < 0 || v > 32) return -1;
+    return (int)v;
+}
+
+static int parse_port(const char *s, uint16_t *out) {
+    char *end;
+    long v = strtol(s, &end, 10);
+    if (end == s || *end != '\0' || v < 1 || v > 65535) return -1;
+    *out = (uint16_t)v;
+    return 0;
+}
+
+int net_parse_publish(const char *arg, net_publish_t *out) {
+    char buf[INET_ADDRSTRLEN + 24];
+    if (!arg || !out || strlen(arg) >= sizeof(buf)) return -1;
+    snprintf(buf, sizeof(buf), "%s", arg);
+    memset(out, 0, sizeof(*out));
+    out->proto = IPPROTO_TCP;
+
+    char *proto = strchr(buf, '/');
+    if (proto) {
+        *proto++ = '\0';
+        if (strcmp(proto, "udp") == 0) out->proto = IPPROTO_UDP;
+        else if (strcmp(proto, "tcp") != 0) return -1;
+    }
+    char *container_port = strrchr(buf, ':');
+    if (!container_port) return -1;
+    *container_port++ = '\0';
+    char *host_port = strrchr(buf, ':');
+    if (host_port) {
+        *host_port++ = '\0';
+        struct in_addr addr;
+        if (inet_pton(AF_INET, buf, &addr) != 1) return -1;
+        inet_ntop(AF_INET, &addr, out->host_ip, sizeof(out->host_ip));
+    } else {
+        host_port = buf;
+    }
+    if (parse_port(host_port, &out->host_port) < 0 ||
+        parse_port(container_port, &out->container_port) < 0) {
+        return -1;
+    }
+    return 0;
+}
 
 /* Path to the `ip` binary. Discovered at runtime via find_ip_binary().
  * Three paths are checked: /sbin/ip and /usr/sbin/ip cover the typical
@@ -37,10 +108,37 @@
  * binary by accident.
  */
 const char *find_ip_binary(void) {
-    if (access(IP_BIN_SBIN, X_OK) == 0) return IP_BIN_SBIN;
-    if (access(IP_BIN_USR_SBIN, X_OK) == 0) return IP_BIN_USR_SBIN;
-    if (access(IP_BIN_BIN, X_OK) == 0) return IP_BIN_BIN;
-    return NULL;
+    /* Found once per process: a launcher running many starts (a daemon,
+     * a zygote) searches once, and a container child, which always has
+     * another PID, still searches its own rootfs. A miss is not cached,
+     * so installing iproute2 under a running daemon takes effect. */
+    static pid_t found_pid;
+    static const char *found;
+    pid_t self = getpid();
+    if (found && found_pid == self) return found;
+
+    const char *path = NULL;
+    if (access(IP_BIN_SBIN, X_OK) == 0) path = IP_BIN_SBIN;
+    else if (access(IP_BIN_USR_SBIN, X_OK) == 0) path = IP_BIN_USR_SBIN;
+    else if (access(IP_BIN_BIN, X_OK) == 0) path = IP_BIN_BIN;
+    if (path) {
+        found = path;
+        found_pid = self;
+    }
+    return path;
+}
+
+/* --debug trace of one helper run, logged as a single line; the buffered
+ * sink is flushed so it precedes anything the helper prints. */
+static void debug_exec(const char *label, const char *const argv[]) {
+    char line[1024] = "";
+    size_t used = 0;
+    for (int i = 0; argv[i] && used < sizeof(line); i++) {
+        used += (size_t)snprintf(line + used, sizeof(line) - used, " %s",
+                                 argv[i]);
+    }
+    debug_log("[network] %s:%s\n", label, line);
+    debug_flush();
 }
 
 /**
@@ -72,11 +170,7 @@ static int run_ip_command(bool enable_debug, ...) {
     va_end(ap);
     args[argc] = NULL;
 
-    if (enable_debug) {
-        fprintf(stderr, "[network] exec:");
-        for (int i = 0; args[i]; i++) fprintf(stderr, " %s", args[i]);
-        fprintf(stderr, "\n");
-    }
+    if (enable_debug) debug_exec("exec", args);
 
     pid_t pid = fork();
     if (pid < 0) {
@@ -130,11 +224,7 @@ static void run_ip_command_ignore(bool enable_debug, ...) {
     va_end(ap);
     args[argc] = NULL;
 
-    if (enable_debug) {
-        fprintf(stderr, "[network] exec (ignore-fail):");
-        for (int i = 0; args[i]; i++) fprintf(stderr, " %s", args[i]);
-        fprintf(stderr, "\n");
-    }
+    if (enable_debug) debug_exec("exec (ignore-fail)", args);
 
     pid_t pid = fork();
     if (pid < 0) return;
@@ -172,11 +262,7 @@ static int run_iptables_command(bool enable_debug, char *const argv[]) {
         return -1;
     }
 
-    if (enable_debug) {
-        fprintf(stderr, "[network] exec:");
-        for (int i = 0; argv[i]; i++) fprintf(stderr, " %s", argv[i]);
-        fprintf(stderr, "\n");
-    }
+    if (enable_debug) debug_exec("exec", (const char *const *)argv);
 
     pid_t pid = fork();
     if (pid < 0) { perror("fork"); return -1; }
@@ -195,46 +281,97 @@ static int run_iptables_command(bool enable_debug, char *const argv[]) {
 }
 
 /**
- * Generate unique veth pair names using the low 16 bits of nanoseconds.
+ * Name the veth pair after the low 32 bits of the container ID.
  *
  * CALLED BEFORE clone() so the names are visible to the child via its
  * copy of child_args.net_ctx. See §3.4.1.
  *
- * Format: veth_h_<4hex> and veth_c_<4hex>. IFNAMSIZ is 16 chars
- * including NUL; "veth_h_" (7 chars) + 4 hex chars = 11 chars, fits
- * comfortably. 65 536 unique names per millisecond.
+ * Format: veth_h_<8hex> and veth_c_<8hex>. IFNAMSIZ is 16 chars
+ * including NUL; "veth_h_" (7 chars) + 8 hex chars = 15 chars, exactly
+ * the limit. Unique per process for 2^32 containers (id.h).
  */
-void generate_veth_names(net_context_t *ctx) {
+void generate_veth_names(net_context_t *ctx, uint64_t id) {
     if (!ctx) return;
-    struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
-    unsigned int id = (unsigned int)(ts.tv_nsec & 0xFFFF);
-    snprintf(ctx->veth_host,      sizeof(ctx->veth_host),      "veth_h_%04x", id);
-    snprintf(ctx->veth_container, sizeof(ctx->veth_container), "veth_c_%04x", id);
+    if (id == 0) id = id_next();
+    uint32_t suffix = (uint32_t)id;
+    snprintf(ctx->veth_host,      sizeof(ctx->veth_host),      "veth_h_%08" PRIx32, suffix);
+    snprintf(ctx->veth_container, sizeof(ctx->veth_container), "veth_c_%08" PRIx32, suffix);
 }
 
 /**
- * Setup the veth pair from the parent side. Uses names already in ctx
- * (populated by generate_veth_names() before clone — see §3.4.1).
+ * Host-side setup over rtnetlink. Two round trips, no child processes:
+ *   1. RTM_NEWLINK — create the pair with the host end IFF_UP and the
+ *      peer created directly inside the child's netns (IFLA_NET_NS_PID)
+ *   2. RTM_NEWADDR — host address; needs the ifindex, which the kernel
+ *      only assigns once (1) has been processed
  */
-int setup_net(net_context_t *ctx, const veth_config_t *veth,
-              pid_t child_pid, bool enable_debug) {
-    if (!ctx || !veth) return -1;
+static int netlink_setup_host(net_context_t *ctx, const veth_config_t *veth,
+                              pid_t child_pid, int bridge_ifindex,
+                              bool enable_debug) {
+    int prefix = net_parse_prefix_len(veth->netmask);
+    if (prefix < 0) {
+        fprintf(stderr, "[network] Invalid netmask: %s\n", veth->netmask);
+        return -1;
+    }
 
-    /* Defensive: if the caller forgot to call generate_veth_names first,
-     * the names will be zero-init empty. Fail loudly rather than create
-     * an interface named "". */
-    if (ctx->veth_host[0] == '\0' || ctx->veth_container[0] == '\0') {
-        fprintf(stderr, "[network] setup_net: veth names not generated "
-                        "(call generate_veth_names before clone)\n");
+    int fd = nl_open();
+    if (fd < 0) {
+        if (enable_debug) perror("[network] socket(NETLINK_ROUTE)");
         return -1;
     }
 
-    if (enable_debug) {
-        printf("[network] Creating veth pair: %s <-> %s\n",
-               ctx->veth_host, ctx->veth_container);
+    nl_batch_t batch;
+    nl_batch_init(&batch);
+    rtnl_add_veth(&batch, ctx->veth_host, ctx->veth_container,
+                  child_pid, -1, true);
+    /* Bridged: the host end carries no address, so enslaving it in the
+     * same batch is the whole host side. */
+    if (bridge_ifindex > 0) {
+        rtnl_set_master(&batch, ctx->veth_host, (unsigned)bridge_ifindex);
+    }
+    int err = nl_batch_exchange(fd, &batch);
+    if (err < 0) {
+        fprintf(stderr, "[network] RTM_NEWLINK %s: %s\n",
+                ctx->veth_host, strerror(-err));
+        close(fd);
+        /* The pair may exist with only the enslave failed. */
+        if (bridge_ifindex > 0 && if_nametoindex(ctx->veth_host) != 0) {
+            ctx->veth_created = true;
+            ctx->backend = NET_BACKEND_NETLINK;
+        }
+        return -1;
+    }
+    ctx->veth_created = true;
+    ctx->backend = NET_BACKEND_NETLINK;
+    if (bridge_ifindex > 0) {
+        close(fd);
+        return 0;
     }
 
+    unsigned ifindex = if_nametoindex(ctx->veth_host);
+    nl_batch_init(&batch);
+    if (ifindex == 0 ||
+        rtnl_add_addr(&batch, ifindex, veth->host_ip, (unsigned)prefix, 0) < 0) {
+        fprintf(stderr, "[network] Cannot address %s\n", ctx->veth_host);
+        close(fd);
+        return -1;
+    }
+    err = nl_batch_exchange(fd, &batch);
+    close(fd);
+    if (err < 0) {
+        fprintf(stderr, "[network] RTM_NEWADDR %s/%s on %s: %s\n",
+                veth->host_ip, veth->netmask, ctx->veth_host, strerror(-err));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Host-side setup via fork+exec of ip(8) — the Phase 6 sequence, kept
+ * as the fallback backend.
+ */
+static int ip_setup_host(net_context_t *ctx, const veth_config_t *veth,
+                         pid_t child_pid, bool enable_debug) {
     /* 1. Create the veth pair (both ends in host netns) */
     if (run_ip_command(enable_debug,
             "link", "add", ctx->veth_host,
@@ -244,6 +381,7 @@ int setup_net(net_context_t *ctx, const veth_config_t *veth,
         return -1;
     }
     ctx->veth_created = true;
+    ctx->backend = NET_BACKEND_IP;
 
     /* 2. Move the container end into the child's netns */
     char pid_str[16];
@@ -253,7 +391,6 @@ int setup_net(net_context_t *ctx, const veth_config_t *veth,
             (const char *)NULL) < 0) {
         fprintf(stderr, "[network] Failed to move %s into netns %d\n",
                 ctx->veth_container, (int)child_pid);
-        cleanup_net(ctx, enable_debug);
         return -1;
     }
 
@@ -266,7 +403,6 @@ int setup_net(net_context_t *ctx, const veth_config_t *veth,
             (const char *)NULL) < 0) {
         fprintf(stderr, "[network] Failed to assign %s to %s\n",
                 host_addr, ctx->veth_host);
-        cleanup_net(ctx, enable_debug);
         return -1;
     }
 
@@ -274,69 +410,491 @@ int setup_net(net_context_t *ctx, const veth_config_t *veth,
             "link", "set", ctx->veth_host, "up",
             (const char *)NULL) < 0) {
         fprintf(stderr, "[network] Failed to bring up %s\n", ctx->veth_host);
-        cleanup_net(ctx, enable_debug);
         return -1;
     }
+    return 0;
+}
 
-    if (enable_debug) {
-        printf("[network] Host veth %s configured at %s\n",
-               ctx->veth_host, host_addr);
+/**
+ * Enable IPv4 forwarding. Write directly to sysctl path rather than
+ * shelling out — no external binary needed for this.
+ */
+static void enable_ip_forward(bool enable_debug) {
+    int fd = open("/proc/sys/net/ipv4/ip_forward", O_WRONLY);
+    if (fd >= 0) {
+        if (write(fd, "1", 1) != 1) {
+            fprintf(stderr, "[network] Warning: failed to enable ip_forward\n");
+        }
+        close(fd);
+    } else if (enable_debug) {
+        fprintf(stderr, "[network] Warning: cannot open ip_forward: %s\n",
+                strerror(errno));
     }
+}
 
-    /* 4. Optional NAT (so container can reach internet via host) */
-    if (veth->enable_nat) {
-        if (enable_debug) printf("[network] Enabling NAT\n");
-
-        /* Enable IPv4 forwarding. Write directly to sysctl path rather
-         * than shelling out — no external binary needed for this. */
-        int fd = open("/proc/sys/net/ipv4/ip_forward", O_WRONLY);
-        if (fd >= 0) {
-            if (write(fd, "1", 1) != 1) {
-                fprintf(stderr, "[network] Warning: failed to enable ip_forward\n");
+/**
+ * Enable IPv4 forwarding and MASQUERADE the container subnet. A failure
+ * only warns: the container still has its link to the host.
+ */
+static void setup_nat(net_context_t *ctx, const veth_config_t *veth,
+                      bool enable_debug) {
+    if (enable_debug) debug_log("[network] Enabling NAT\n");
+    enable_ip_forward(enable_debug);
+
+    /* Add MASQUERADE rule for the container subnet. Store the source
+     * CIDR in ctx so cleanup_net() can delete the same rule later
+     * without needing the original veth_config_t. */
+    snprintf(ctx->nat_source_cidr, sizeof(ctx->nat_source_cidr),
+             "%s/%s", veth->container_ip, veth->netmask);
+    char *iptables_argv[] = {
+        "iptables", "-t", "nat", "-A", "POSTROUTING",
+        "-s", ctx->nat_source_cidr, "-j", "MASQUERADE", NULL
+    };
+    if (run_iptables_command(enable_debug, iptables_argv) == 0) {
+        ctx->nat_added = true;
+    } else {
+        /* Clear nat_source_cidr if the rule failed to add — we don't
+         * want cleanup_net to try deleting a rule that doesn't exist. */
+        ctx->nat_source_cidr[0] = '\0';
+        fprintf(stderr, "[network] Warning: iptables MASQUERADE failed; "
+                "container may have no internet access\n");
+    }
+}
+
+/**
+ * NAT for a whole bridge subnet: one rule for every container on it,
+ * added by whichever NAT-enabled start finds it missing.
+ * Traffic between containers on the bridge (-o <bridge>) is left alone.
+ */
+static void setup_bridge_nat(const veth_config_t *veth, bool enable_debug) {
+    char subnet[INET_ADDRSTRLEN + 8];
+    if (net_bridge_subnet(veth, subnet, sizeof(subnet)) < 0) return;
+    if (enable_debug) debug_log("[network] Enabling NAT for %s\n", subnet);
+    enable_ip_forward(enable_debug);
+    char *check_argv[] = {
+        "iptables", "-t", "nat", "-C", "POSTROUTING", "-s", subnet,
+        "!", "-o", (char *)veth->bridge, "-j", "MASQUERADE", NULL
+    };
+    if (run_iptables_command(enable_debug, check_argv) == 0) return;
+    char *add_argv[] = {
+        "iptables", "-t", "nat", "-A", "POSTROUTING", "-s", subnet,
+        "!", "-o", (char *)veth->bridge, "-j", "MASQUERADE", NULL
+    };
+    if (run_iptables_command(enable_debug, add_argv) < 0) {
+        fprintf(stderr, "[network] Warning: iptables MASQUERADE failed; "
+                "containers on %s may have no internet access\n",
+                veth->bridge);
+    }
+}
+
+/**
+ * Format the DNAT rule of one published port on chain, as an
+ * iptables-restore line of op "-A" (add) or "-D" (delete). PREROUTING
+ * catches connections arriving from outside, OUTPUT the host's own.
+ * Loopback is excluded from OUTPUT: DNAT of 127.0.0.1 to another host
+ * would need route_localnet, so local clients use one of the host's
+ * real addresses.
+ *
+ * Returns the length appended at buf + *used, or -1 if it does not fit.
+ */
+static int publish_rule(char *buf, size_t size, size_t *used, const char *op,
+                        const char *chain, const net_publish_t *p,
+                        const char *dest) {
+    char match[INET_ADDRSTRLEN + 8] = "";
+    if (p->host_ip[0]) {
+        snprintf(match, sizeof(match), "-d %s ", p->host_ip);
+    } else if (strcmp(chain, "OUTPUT") == 0) {
+        snprintf(match, sizeof(match), "! -d 127.0.0.0/8 ");
+    }
+    int n = snprintf(buf + *used, size - *used,
+                     "%s %s %s-p %s --dport %u -m addrtype --dst-type LOCAL "
+                     "-j DNAT --to-destination %s:%u\n",
+                     op, chain, match, p->proto == IPPROTO_UDP ? "udp" : "tcp",
+                     (unsigned)p->host_port, dest,
+                     (unsigned)p->container_port);
+    if (n < 0 || (size_t)n >= size - *used) return -1;
+    *used += (size_t)n;
+    return n;
+}
+
+/**
+ * Apply rules (iptables-restore lines) to the nat table in one
+ * `iptables-restore --noflush`: one fork and one xtables lock for all of
+ * them, and the kernel takes the whole batch or none of it. The rules
+ * reach its stdin through a pipe filled before the fork (they are far
+ * below the pipe buffer), so nothing can block on a helper that died.
+ * Returns 0 on exit status 0, -1 otherwise.
+ */
+static int run_iptables_restore(const char *rules, bool enable_debug) {
+    static const char *restore_paths[] = {
+        "/sbin/iptables-restore", "/usr/sbin/iptables-restore", NULL
+    };
+    const char *restore = NULL;
+    for (int i = 0; restore_paths[i]; i++) {
+        if (access(restore_paths[i], X_OK) == 0) {
+            restore = restore_paths[i];
+            break;
+        }
+    }
+    if (!restore) {
+        fprintf(stderr, "[network] No iptables-restore binary found\n");
+        return -1;
+    }
+
+    char script[PUBLISH_RULES_MAX + 16];
+    int len = snprintf(script, sizeof(script), "*nat\n%sCOMMIT\n", rules);
+    int in[2];
+    if (len < 0 || (size_t)len >= sizeof(script) || pipe2(in, O_CLOEXEC) < 0) {
+        return -1;
+    }
+    ssize_t w = write(in[1], script, (size_t)len);
+    close(in[1]);
+    if (w != len) {
+        close(in[0]);
+        return -1;
+    }
+
+    char *const argv[] = { "iptables-restore", "--noflush", NULL };
+    if (enable_debug) debug_exec("exec", (const char *const *)argv);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        close(in[0]);
+        return -1;
+    }
+    if (pid == 0) {
+        dup2(in[0], STDIN_FILENO);
+        if (!enable_debug) {
+            int devnull = open("/dev/null", O_WRONLY);
+            if (devnull >= 0) { dup2(devnull, STDERR_FILENO); close(devnull); }
+        }
+        execv(restore, argv);
+        _exit(127);
+    }
+    close(in[0]);
+
+    int status = 0;
+    pid_t r;
+    while ((r = waitpid(pid, &status, 0)) < 0 && errno == EINTR) {}
+    if (r < 0) return -1;
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+}
+
+/* Both DNAT rules of each of n published ports, as one restore batch. */
+static int publish_rules(char *buf, size_t size, const char *op,
+                         const net_publish_t *ports, unsigned n,
+                         const char *dest) {
+    size_t used = 0;
+    buf[0] = '\0';
+    for (unsigned i = 0; i < n; i++) {
+        if (publish_rule(buf, size, &used, op, "PREROUTING", &ports[i], dest) < 0 ||
+            publish_rule(buf, size, &used, op, "OUTPUT", &ports[i], dest) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * DNAT every veth->publish entry to dest, all rules in one
+ * iptables-restore, so a start forks once however many ports it
+ * publishes and a failure leaves none of them behind. ctx->published
+ * records the rules once they are in, so cleanup_net() removes exactly
+ * those.
+ */
+static int setup_publish(net_context_t *ctx, const veth_config_t *veth,
+                         const char *dest, bool enable_debug) {
+    if (veth->publish_count == 0) return 0;
+    enable_ip_forward(enable_debug);
+
+    unsigned n = veth->publish_count < NET_PUBLISH_MAX ? veth->publish_count
+                                                       : NET_PUBLISH_MAX;
+    char rules[PUBLISH_RULES_MAX];
+    if (publish_rules(rules, sizeof(rules), "-A", veth->publish, n, dest) < 0 ||
+        run_iptables_restore(rules, enable_debug) < 0) {
+        fprintf(stderr, "[network] Cannot publish %u port%s to %s\n", n,
+                n == 1 ? "" : "s", dest);
+        return -1;
+    }
+    snprintf(ctx->publish_dest, sizeof(ctx->publish_dest), "%s", dest);
+    for (unsigned i = 0; i < n; i++) {
+        const net_publish_t *p = &veth->publish[i];
+        ctx->published[ctx->published_count++] = *p;
+        if (enable_debug) {
+            debug_log("[network] Published %s:%u/%s -> %s:%u\n",
+                   p->host_ip[0] ? p->host_ip : "*", (unsigned)p->host_port,
+                   p->proto == IPPROTO_UDP ? "udp" : "tcp", dest,
+                   (unsigned)p->container_port);
+        }
+    }
+    return 0;
+}
+
+/* Delete the recorded DNAT rules in one batch. The batch is all or
+ * nothing, so if one rule is already gone (deleted by hand, a firewall
+ * reload), each port is retried alone so the rest still go. */
+static void delete_published(net_context_t *ctx, bool enable_debug) {
+    unsigned n = ctx->published_count;
+    if (n > 0) {
+        if (enable_debug) {
+            debug_log("[network] Unpublishing %u port%s\n", n, n == 1 ? "" : "s");
+        }
+        char rules[PUBLISH_RULES_MAX];
+        if (publish_rules(rules, sizeof(rules), "-D", ctx->published, n,
+                          ctx->publish_dest) < 0 ||
+            run_iptables_restore(rules, enable_debug) < 0) {
+            for (unsigned i = 0; n > 1 && i < n; i++) {
+                if (publish_rules(rules, sizeof(rules), "-D", &ctx->published[i],
+                                  1, ctx->publish_dest) == 0) {
+                    run_iptables_restore(rules, enable_debug);
+                }
             }
-            close(fd);
-        } else if (enable_debug) {
-            fprintf(stderr, "[network] Warning: cannot open ip_forward: %s\n",
-                    strerror(errno));
         }
+    }
+    ctx->published_count = 0;
+    ctx->publish_dest[0] = '\0';
+}
 
-        /* Add MASQUERADE rule for the container subnet. Store the source
-         * CIDR in ctx so cleanup_net() can delete the same rule later
-         * without needing the original veth_config_t. */
-        snprintf(ctx->nat_source_cidr, sizeof(ctx->nat_source_cidr),
-                 "%s/%s", veth->container_ip, veth->netmask);
+/**
+ * Delete the veth, NAT and DNAT rules ctx records (cleanup_net() minus
+ * the pod reference). setup_net() also uses it to roll back a failed
+ * backend. Self-contained — uses ctx->nat_source_cidr and ctx->published
+ * stored by setup_net so it does not need the original veth_config_t.
+ *
+ * Deleting the host veth automatically destroys the container veth
+ * (kernel removes one end when the other goes). If the child's netns
+ * already exited, the container veth is already gone — deleting the
+ * host veth still works.
+ */
+static void delete_host_net(net_context_t *ctx, bool enable_debug) {
+    delete_published(ctx, enable_debug);
+    if (ctx->nat_added && ctx->nat_source_cidr[0] != '\0') {
+        if (enable_debug) {
+            debug_log("[network] Removing NAT rule for %s\n",
+                   ctx->nat_source_cidr);
+        }
         char *iptables_argv[] = {
-            "iptables", "-t", "nat", "-A", "POSTROUTING",
+            "iptables", "-t", "nat", "-D", "POSTROUTING",
             "-s", ctx->nat_source_cidr, "-j", "MASQUERADE", NULL
         };
-        if (run_iptables_command(enable_debug, iptables_argv) == 0) {
-            ctx->nat_added = true;
-        } else {
-            /* Clear nat_source_cidr if the rule failed to add — we don't
-             * want cleanup_net to try deleting a rule that doesn't exist. */
-            ctx->nat_source_cidr[0] = '\0';
-            fprintf(stderr, "[network] Warning: iptables MASQUERADE failed; "
-                    "container may have no internet access\n");
+        run_iptables_command(enable_debug, iptables_argv);
+        ctx->nat_added = false;
+        ctx->nat_source_cidr[0] = '\0';
+    }
+
+    if (ctx->pooled) {
+        net_pool_release(ctx, enable_debug);
+        return;
+    }
+
+    if (ctx->veth_created) {
+        if (enable_debug) {
+            debug_log("[network] Deleting veth: %s\n", ctx->veth_host);
         }
+        int err = -1;
+        if (ctx->backend == NET_BACKEND_NETLINK) {
+            int fd = nl_open();
+            if (fd >= 0) {
+                nl_batch_t batch;
+                nl_batch_init(&batch);
+                rtnl_del_link(&batch, ctx->veth_host);
+                err = nl_batch_exchange(fd, &batch);
+                close(fd);
+            }
+        }
+        if (err != 0) {
+            run_ip_command_ignore(enable_debug,
+                "link", "delete", ctx->veth_host,
+                (const char *)NULL);
+        }
+        ctx->veth_created = false;
+    }
+}
+
+int setup_net(net_context_t *ctx, const veth_config_t *veth,
+              pid_t child_pid, bool enable_debug) {
+    if (!ctx || !veth) return -1;
+
+    /* Rootless: a user-mode helper owns the interface, not a veth. */
+    if (veth->user_mode != NET_USER_NONE) {
+        return net_user_start(ctx, veth, child_pid, enable_debug);
+    }
+
+    /* A pod member uses the pair the pod's creator built. */
+    if (ctx->pod_member) {
+        if (enable_debug) {
+            debug_log("[network] Sharing pod %s's veth %s\n", ctx->pod_name,
+                   ctx->veth_host);
+        }
+        return 0;
+    }
+
+    /* Defensive: if the caller forgot to call generate_veth_names first,
+     * the names will be zero-init empty. Fail loudly rather than create
+     * an interface named "". */
+    if (ctx->veth_host[0] == '\0' || ctx->veth_container[0] == '\0') {
+        fprintf(stderr, "[network] setup_net: veth names not generated "
+                        "(call generate_veth_names before clone)\n");
+        return -1;
+    }
+
+    if (enable_debug && !ctx->pooled) {
+        debug_log("[network] Creating veth pair: %s <-> %s\n",
+               ctx->veth_host, ctx->veth_container);
     }
 
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    int rc = -1;
+    int bridge_ifindex = -1;
+    if (veth->bridge[0] && !ctx->pooled) {
+        bool created;
+        bridge_ifindex = net_bridge_ensure(veth, &created, enable_debug);
+        if (bridge_ifindex < 0) {
+            cleanup_net(ctx, enable_debug);
+            return -1;
+        }
+        /* Every NAT start checks: the bridge outlives the start that made
+         * it, which may have run without NAT (or the rule was flushed). */
+        (void)created;
+        if (veth->enable_nat) setup_bridge_nat(veth, enable_debug);
+    }
+    if (ctx->pooled) {
+        rc = net_pool_attach(ctx, veth, enable_debug);
+    } else if (veth->backend != NET_BACKEND_IP) {
+        rc = netlink_setup_host(ctx, veth, child_pid, bridge_ifindex,
+                                enable_debug);
+        if (rc < 0 && veth->backend == NET_BACKEND_AUTO && bridge_ifindex < 0) {
+            /* Roll back whatever the netlink attempt created so the ip(8)
+             * path starts from a clean slate with the same names (a pod
+             * creator keeps its lock). */
+            delete_host_net(ctx, enable_debug);
+            if (enable_debug) {
+                debug_log("[network] netlink setup failed, falling back to ip(8)\n");
+            }
+        }
+    }
+    if (rc < 0 && !ctx->pooled && bridge_ifindex < 0 &&
+        veth->backend != NET_BACKEND_NETLINK) {
+        rc = ip_setup_host(ctx, veth, child_pid, enable_debug);
+    }
+    if (rc < 0) {
+        cleanup_net(ctx, enable_debug);
+        return -1;
+    }
+
+    if (enable_debug && bridge_ifindex > 0) {
+        debug_log("[network] Host veth %s enslaved to %s in %ld us\n",
+               ctx->veth_host, veth->bridge, elapsed_us(&t0));
+    } else if (enable_debug) {
+        debug_log("[network] Host veth %s configured at %s/%s via %s in %ld us\n",
+               ctx->veth_host, veth->host_ip, veth->netmask,
+               ctx->pooled ? "pool" : backend_name(ctx->backend),
+               elapsed_us(&t0));
+    }
+
+    /* 4. Optional NAT (so container can reach internet via host); a
+     * bridge's one rule was added with the bridge */
+    if (veth->enable_nat && bridge_ifindex < 0) {
+        setup_nat(ctx, veth, enable_debug);
+    }
+
+    /* 5. Published ports, forwarded to the container's (leased) address */
+    if (setup_publish(ctx, veth, ctx->bridge_ip[0] ? ctx->bridge_ip
+                                                  : veth->container_ip,
+                      enable_debug) < 0) {
+        cleanup_net(ctx, enable_debug);
+        return -1;
+    }
+
+    /* 6. A pod's creator publishes the network for later members */
+    if (ctx->pod_name[0] && net_pod_register(ctx, child_pid, enable_debug) < 0) {
+        cleanup_net(ctx, enable_debug);
+        return -1;
+    }
+
+    return 0;
+}
+
+int net_adopt_host(net_context_t *ctx, const veth_config_t *veth,
+                   bool enable_debug) {
+    if (!ctx || !veth || ctx->veth_host[0] == '\0') return -1;
+    ctx->veth_created = true;   // cleanup_net() deletes it from here on
+    ctx->backend = NET_BACKEND_IP;
+
+    char host_addr[INET_ADDRSTRLEN + 8];
+    snprintf(host_addr, sizeof(host_addr), "%s/%s", veth->host_ip, veth->netmask);
+    if (run_ip_command(enable_debug,
+            "addr", "add", host_addr, "dev", ctx->veth_host,
+            (const char *)NULL) < 0 ||
+        run_ip_command(enable_debug,
+            "link", "set", ctx->veth_host, "up",
+            (const char *)NULL) < 0) {
+        fprintf(stderr, "[network] Failed to configure adopted %s\n",
+                ctx->veth_host);
+        cleanup_net(ctx, enable_debug);
+        return -1;
+    }
+    if (enable_debug) {
+        debug_log("[network] Adopted host veth %s at %s\n", ctx->veth_host,
+               host_addr);
+    }
+    if (veth->enable_nat) {
+        setup_nat(ctx, veth, enable_debug);
+    }
+    if (setup_publish(ctx, veth, veth->container_ip, enable_debug) < 0) {
+        cleanup_net(ctx, enable_debug);
+        return -1;
+    }
     return 0;
 }
 
 /**
- * Configure the container side of the veth. Runs INSIDE the child, after
- * the sync pipe unblocks.
+ * Container-side setup over rtnetlink: lo up, address, link up and the
+ * default route go out as ONE batch. The socket is opened after the
+ * sync pipe unblocks, so it is bound to the container's netns.
  */
-int configure_container_net(const net_context_t *ctx,
-                            const veth_config_t *veth,
-                            bool enable_debug) {
-    if (!ctx || !veth) return -1;
+static int netlink_configure_container(const net_context_t *ctx,
+                                       const veth_config_t *veth,
+                                       bool enable_debug) {
+    int prefix = net_parse_prefix_len(veth->netmask);
+    unsigned ifindex = if_nametoindex(ctx->veth_container);
+    if (prefix < 0 || ifindex == 0) {
+        fprintf(stderr, "[child] Cannot resolve %s/%s on %s\n",
+                veth->container_ip, veth->netmask, ctx->veth_container);
+        return -1;
+    }
 
-    if (enable_debug) {
-        printf("[child] Configuring container network: %s at %s/%s\n",
-               ctx->veth_container, veth->container_ip, veth->netmask);
+    int fd = nl_open();
+    if (fd < 0) {
+        if (enable_debug) perror("[child] socket(NETLINK_ROUTE)");
+        return -1;
     }
 
+    nl_batch_t batch;
+    nl_batch_init(&batch);
+    rtnl_set_link_up(&batch, "lo");
+    rtnl_add_addr(&batch, ifindex, veth->container_ip, (unsigned)prefix, 0);
+    rtnl_set_link_up(&batch, ctx->veth_container);
+    rtnl_add_default_route(&batch, veth->host_ip, ifindex);
+    int err = nl_batch_exchange(fd, &batch);
+    close(fd);
+    if (err < 0) {
+        fprintf(stderr, "[child] rtnetlink configure of %s: %s\n",
+                ctx->veth_container, strerror(-err));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Container-side setup via ip(8) — the Phase 6 sequence.
+ */
+static int ip_configure_container(const net_context_t *ctx,
+                                  const veth_config_t *veth,
+                                  bool enable_debug) {
     /* 1. Bring up loopback. Many programs assume 127.0.0.1 works. */
     if (run_ip_command(enable_debug,
             "link", "set", "lo", "up",
@@ -373,48 +931,78 @@ int configure_container_net(const net_context_t *ctx,
                 veth->host_ip);
         return -1;
     }
-
-    if (enable_debug) {
-        printf("[child] Container network configured: %s, default via %s\n",
-               container_addr, veth->host_ip);
-    }
-
     return 0;
 }
 
 /**
- * Cleanup veth and NAT rule. Self-contained — uses ctx->nat_source_cidr
- * stored by setup_net so it does not need the original veth_config_t.
+ * Configure the container side of the veth. Runs INSIDE the child, after
+ * the sync pipe unblocks.
  *
- * Deleting the host veth automatically destroys the container veth
- * (kernel removes one end when the other goes). If the child's netns
- * already exited, the container veth is already gone — deleting the
- * host veth still works.
+ * In AUTO mode a netlink failure falls through to ip(8). The netlink
+ * batch is not transactional, so the fallback may see "File exists"
+ * for steps that already landed; ip(8) failures are still fatal.
  */
-void cleanup_net(net_context_t *ctx, bool enable_debug) {
-    if (!ctx) return;
+int configure_container_net(const net_context_t *ctx,
+                            const veth_config_t *veth,
+                            bool enable_debug) {
+    if (!ctx || !veth) return -1;
 
-    if (ctx->nat_added && ctx->nat_source_cidr[0] != '\0') {
-        if (enable_debug) {
-            printf("[network] Removing NAT rule for %s\n",
-                   ctx->nat_source_cidr);
-        }
-        char *iptables_argv[] = {
-            "iptables", "-t", "nat", "-D", "POSTROUTING",
-            "-s", ctx->nat_source_cidr, "-j", "MASQUERADE", NULL
-        };
-        run_iptables_command(enable_debug, iptables_argv);
-        ctx->nat_added = false;
-        ctx->nat_source_cidr[0] = '\0';
+    /* Pooled: the netns was configured by the refiller; just join it. */
+    if (ctx->pooled) return net_pool_enter(ctx, enable_debug);
+    /* Pod member: the creator configured the shared netns. */
+    if (ctx->pod_member) return net_pod_enter(ctx, enable_debug);
+    /* User-mode helper: it configures the tap from outside. */
+    if (ctx->user_mode != NET_USER_NONE) return net_user_enter(ctx, enable_debug);
+
+    /* Bridged: the address is the lease, not the configured one. */
+    veth_config_t leased;
+    if (ctx->bridge_ip[0]) {
+        leased = *veth;
+        snprintf(leased.container_ip, sizeof(leased.container_ip), "%s",
+                 ctx->bridge_ip);
+        veth = &leased;
     }
 
-    if (ctx->veth_created) {
-        if (enable_debug) {
-            printf("[network] Deleting veth: %s\n", ctx->veth_host);
+    if (enable_debug) {
+        debug_log("[child] Configuring container network: %s at %s/%s\n",
+               ctx->veth_container, veth->container_ip, veth->netmask);
+    }
+
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    net_backend_t used = NET_BACKEND_NETLINK;
+    int rc = -1;
+    if (veth->backend != NET_BACKEND_IP) {
+        rc = netlink_configure_container(ctx, veth, enable_debug);
+        if (rc < 0 && veth->backend == NET_BACKEND_AUTO && enable_debug) {
+            debug_log("[child] netlink configure failed, falling back to ip(8)\n");
         }
-        run_ip_command_ignore(enable_debug,
-            "link", "delete", ctx->veth_host,
-            (const char *)NULL);
-        ctx->veth_created = false;
     }
+    if (rc < 0 && veth->backend != NET_BACKEND_NETLINK) {
+        used = NET_BACKEND_IP;
+        rc = ip_configure_container(ctx, veth, enable_debug);
+    }
+    if (rc < 0) return -1;
+
+    if (enable_debug) {
+        debug_log("[child] Container network configured: %s/%s, default via %s "
+               "(%s, %ld us)\n",
+               veth->container_ip, veth->netmask, veth->host_ip,
+               backend_name(used), elapsed_us(&t0));
+    }
+
+    return 0;
+}
+
+void cleanup_net(net_context_t *ctx, bool enable_debug) {
+    if (!ctx) return;
+
+    net_user_stop(ctx, enable_debug);
+
+    /* Pod: only the last member deletes the shared pair and NAT rule. */
+    if (ctx->pod_name[0] && !net_pod_leave(ctx, enable_debug)) return;
+
+    delete_host_net(ctx, enable_debug);
+    net_bridge_release(ctx);   // After the veth: the address is free now
 }
@@ -0,0 +1,262 @@
+// Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include "net_pod.h"
+#include "events.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/file.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
+
+#define POD_STATE_MAX 256
+
+typedef struct {
+    unsigned refs;
+    char veth_host[IFNAMSIZ];
+    net_backend_t backend;
+    char nat_cidr[INET_ADDRSTRLEN + 8];
+} pod_state_t;
+
+static void pod_path(const char *name, const char *suffix, char *buf,
+                     size_t size) {
+    snprintf(buf, size, "%s/%s.%s", NET_POD_DIR, name, suffix);
+}
+
+bool net_pod_name_valid(const char *name) {
+    if (!name || !name[0] || name[0] == '.') return false;
+    size_t len = strlen(name);
+    if (len >= NET_POD_NAME_MAX) return false;
+    return strspn(name, "abcdefghijklmnopqrstuvwxyz"
+                        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                        "0123456789_.-") == len;
+}
+
+static int ensure_pod_dir(void) {
+    if (mkdir("/run/minicontainer", 0755) < 0 && errno != EEXIST) return -1;
+    if (mkdir(NET_POD_DIR, 0755) < 0 && errno != EEXIST) return -1;
+    return 0;
+}
+
+/* Open the pod's lock file and wait for the lock: joins and leaves only
+ * hold it for a few file operations, a creator for its network setup. */
+static int lock_pod(const char *name) {
+    char path[64];
+    pod_path(name, "lock", path, sizeof(path));
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return -1;
+    while (flock(fd, LOCK_EX) < 0) {
+        if (errno != EINTR) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+/* Missing or unparsable state reads as refs 0: no live pod. */
+static void read_pod_state(int fd, pod_state_t *st) {
+    char buf[POD_STATE_MAX] = {0};
+    memset(st, 0, sizeof(*st));
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return;
+    for (char *line = strtok(buf, "\n"); line; line = strtok(NULL, "\n")) {
+        char *val = strchr(line, ' ');
+        if (!val) continue;
+        *val++ = '\0';
+        if (strcmp(line, "refs") == 0) {
+            st->refs = (unsigned)strtoul(val, NULL, 10);
+        } else if (strcmp(line, "veth") == 0) {
+            snprintf(st->veth_host, sizeof(st->veth_host), "%s", val);
+        } else if (strcmp(line, "backend") == 0) {
+            st->backend = (net_backend_t)atoi(val);
+        } else if (strcmp(line, "nat") == 0) {
+            snprintf(st->nat_cidr, sizeof(st->nat_cidr), "%s", val);
+        }
+    }
+}
+
+/* st == NULL clears the state. */
+static int write_pod_state(int fd, const pod_state_t *st) {
+    if (ftruncate(fd, 0) < 0) return -1;
+    if (!st) return 0;
+    char buf[POD_STATE_MAX];
+    int len = snprintf(buf, sizeof(buf), "refs %u\nveth %s\nbackend %d\n",
+                       st->refs, st->veth_host, (int)st->backend);
+    if (st->nat_cidr[0]) {
+        len += snprintf(buf + len, sizeof(buf) - (size_t)len, "nat %s\n",
+                        st->nat_cidr);
+    }
+    return pwrite(fd, buf, (size_t)len, 0) == len ? 0 : -1;
+}
+
+/* The pin, if it really is a mounted nsfs file (see net_pool.c). */
+static int open_pod_netns(const char *name) {
+    char path[64];
+    pod_path(name, "ns", path, sizeof(path));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct statfs st;
+    if (fstatfs(fd, &st) < 0 || st.f_type != NSFS_MAGIC) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void unpin_pod_netns(const char *name) {
+    char path[64];
+    pod_path(name, "ns", path, sizeof(path));
+    umount2(path, MNT_DETACH);   // EINVAL when not mounted is fine
+    unlink(path);
+}
+
+int net_pod_join(net_context_t *ctx, const char *name, bool enable_debug) {
+    if (!ctx || !net_pod_name_valid(name)) return -1;
+    if (ensure_pod_dir() < 0) {
+        perror("[pod] mkdir " NET_POD_DIR);
+        return -1;
+    }
+    int fd = lock_pod(name);
+    if (fd < 0) {
+        perror("[pod] lock");
+        return -1;
+    }
+    snprintf(ctx->pod_name, sizeof(ctx->pod_name), "%s", name);
+
+    pod_state_t st;
+    read_pod_state(fd, &st);
+    int ns_fd = st.refs > 0 ? open_pod_netns(name) : -1;
+    if (ns_fd >= 0) {
+        st.refs++;
+        if (write_pod_state(fd, &st) < 0) {
+            perror("[pod] write state");
+            close(ns_fd);
+            close(fd);
+            ctx->pod_name[0] = '\0';
+            return -1;
+        }
+        close(fd);
+        ctx->pod_member = true;
+        ctx->pod_refs = st.refs;
+        ctx->netns_fd = ns_fd;
+        snprintf(ctx->veth_host, sizeof(ctx->veth_host), "%s", st.veth_host);
+        if (enable_debug) {
+            debug_log("[pod] Joined pod %s (%u members, veth %s)\n",
+                   name, st.refs, st.veth_host);
+        }
+        return 0;
+    }
+
+    /* No live pod: whatever a crashed one left behind goes first. */
+    if (st.refs > 0 && enable_debug) {
+        debug_log("[pod] Pod %s has no netns pin; recreating it\n", name);
+    }
+    unpin_pod_netns(name);
+    write_pod_state(fd, NULL);
+    ctx->pod_member = false;
+    ctx->pod_refs = 0;
+    ctx->pod_lock_fd = fd;
+    if (enable_debug) debug_log("[pod] Creating pod %s\n", name);
+    return 1;
+}
+
+int net_pod_register(net_context_t *ctx, pid_t child_pid, bool enable_debug) {
+    if (!ctx || !ctx->pod_name[0] || ctx->pod_member || ctx->pod_refs) {
+        return -1;
+    }
+    char path[64], src[64];
+    pod_path(ctx->pod_name, "ns", path, sizeof(path));
+    snprintf(src, sizeof(src), "/proc/%d/ns/net", (int)child_pid);
+    int fd = open(path, O_RDONLY | O_CREAT | O_CLOEXEC, 0444);
+    if (fd < 0 || close(fd) < 0 ||
+        mount(src, path, NULL, MS_BIND, NULL) < 0) {
+        perror("[pod] pin netns");
+        unlink(path);
+        return -1;
+    }
+
+    pod_state_t st = { .refs = 1, .backend = ctx->backend };
+    snprintf(st.veth_host, sizeof(st.veth_host), "%s", ctx->veth_host);
+    if (ctx->nat_added) {
+        snprintf(st.nat_cidr, sizeof(st.nat_cidr), "%s", ctx->nat_source_cidr);
+    }
+    if (write_pod_state(ctx->pod_lock_fd, &st) < 0) {
+        perror("[pod] write state");
+        unpin_pod_netns(ctx->pod_name);
+        return -1;
+    }
+    close(ctx->pod_lock_fd);   // drops the flock: members may join now
+    ctx->pod_lock_fd = -1;
+    ctx->pod_refs = 1;
+    if (enable_debug) {
+        debug_log("[pod] Registered pod %s: netns of PID %d pinned at %s\n",
+               ctx->pod_name, (int)child_pid, path);
+    }
+    return 0;
+}
+
+int net_pod_enter(const net_context_t *ctx, bool enable_debug) {
+    if (!ctx || !ctx->pod_member || ctx->netns_fd < 0) return -1;
+
+    if (setns(ctx->netns_fd, CLONE_NEWNET) < 0) {
+        perror("[child] setns(pod netns)");
+        return -1;
+    }
+    close(ctx->netns_fd);
+    if (enable_debug) debug_log("[child] Joined pod %s netns\n", ctx->pod_name);
+    return 0;
+}
+
+bool net_pod_leave(net_context_t *ctx, bool enable_debug) {
+    if (!ctx || !ctx->pod_name[0]) return true;
+
+    bool creating = !ctx->pod_member && ctx->pod_refs == 0;
+    int fd = creating ? ctx->pod_lock_fd : lock_pod(ctx->pod_name);
+    if (ctx->pod_member && ctx->netns_fd >= 0) close(ctx->netns_fd);
+    ctx->netns_fd = -1;
+    ctx->pod_lock_fd = -1;
+
+    pod_state_t st = {0};
+    if (fd >= 0 && !creating) read_pod_state(fd, &st);
+    bool last = creating || st.refs <= 1;
+    if (fd < 0) {
+        /* Without the lock we cannot tell who is last; leave it all up. */
+        perror("[pod] lock");
+        last = false;
+    } else if (!last) {
+        st.refs--;
+        write_pod_state(fd, &st);
+    } else {
+        unpin_pod_netns(ctx->pod_name);
+        write_pod_state(fd, NULL);
+    }
+    if (fd >= 0) close(fd);
+
+    if (enable_debug) {
+        debug_log("[pod] Left pod %s (%u members left)\n", ctx->pod_name,
+               last ? 0 : st.refs);
+    }
+    if (last && !creating && st.veth_host[0]) {
+        /* Whoever created the pair, this member deletes it. */
+        snprintf(ctx->veth_host, sizeof(ctx->veth_host), "%s", st.veth_host);
+        ctx->backend = st.backend;
+        ctx->veth_created = true;
+        snprintf(ctx->nat_source_cidr, sizeof(ctx->nat_source_cidr), "%s",
+                 st.nat_cidr);
+        ctx->nat_added = st.nat_cidr[0] != '\0';
+    } else if (!last) {
+        ctx->veth_created = false;
+        ctx->nat_added = false;
+    }
+    ctx->pod_name[0] = '\0';
+    ctx->pod_member = false;
+    ctx->pod_refs = 0;
+    return last;
+}
@@ -0,0 +1,458 @@
+// Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include "net_pool.h"
+#include "netlink.h"
+#include "events.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/file.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <linux/if_addr.h>
+#include <linux/magic.h>
+
+/* Lock files carry one line, "ready <host-ip>/<prefix> <container-ip>",
+ * written once the slot is fully built. Anything else (empty, stale)
+ * means the slot is empty. */
+#define SLOT_READY_TAG "ready "
+#define SLOT_KEY_LEN   (2 * INET_ADDRSTRLEN + 8)
+
+static void slot_names(unsigned slot, char *host, char *peer) {
+    snprintf(host, IFNAMSIZ, "mcp_h_%u", slot);
+    snprintf(peer, IFNAMSIZ, "mcp_c_%u", slot);
+}
+
+static void slot_path(unsigned slot, const char *suffix, char *buf,
+                      size_t size) {
+    snprintf(buf, size, "%s/slot%u.%s", NET_POOL_DIR, slot, suffix);
+}
+
+static void slot_key(const veth_config_t *veth, char *key) {
+    snprintf(key, SLOT_KEY_LEN, "%s/%s %s",
+             veth->host_ip, veth->netmask, veth->container_ip);
+}
+
+static int ensure_pool_dir(void) {
+    if (mkdir("/run/minicontainer", 0755) < 0 && errno != EEXIST) return -1;
+    if (mkdir(NET_POOL_DIR, 0755) < 0 && errno != EEXIST) return -1;
+    return 0;
+}
+
+/* Open and try-lock a slot. Returns the locked fd, or -1 if the slot
+ * is held by someone else (or the lock file cannot be opened). */
+static int lock_slot(unsigned slot) {
+    char path[64];
+    slot_path(slot, "lock", path, sizeof(path));
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return -1;
+    if (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void read_slot_state(int fd, char *key) {
+    char buf[SLOT_KEY_LEN + 8] = {0};
+    key[0] = '\0';
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return;
+    buf[strcspn(buf, "\n")] = '\0';
+    if (strncmp(buf, SLOT_READY_TAG, strlen(SLOT_READY_TAG)) != 0) return;
+    snprintf(key, SLOT_KEY_LEN, "%s", buf + strlen(SLOT_READY_TAG));
+}
+
+/* key == NULL marks the slot empty. A failed write also leaves the slot
+ * looking empty, which only costs a rebuild. */
+static void write_slot_state(int fd, const char *key) {
+    char buf[SLOT_KEY_LEN + 8];
+    if (ftruncate(fd, 0) < 0 || !key) return;
+    int len = snprintf(buf, sizeof(buf), SLOT_READY_TAG "%s\n", key);
+    if (pwrite(fd, buf, (size_t)len, 0) != len) {
+        if (ftruncate(fd, 0) < 0) { /* nothing more to do */ }
+    }
+}
+
+/* Open the slot's netns pin. Returns -1 unless the path really is a
+ * mounted nsfs file — a bare placeholder left by a crashed refiller
+ * would otherwise make the child's setns() fail mid-start. */
+static int open_slot_netns(unsigned slot) {
+    char path[64];
+    slot_path(slot, "ns", path, sizeof(path));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct statfs st;
+    if (fstatfs(fd, &st) < 0 || st.f_type != NSFS_MAGIC) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* A "ready" slot whose host end or netns pin has vanished (manual
+ * `ip link del`, reboot of /run's contents) is rebuilt. */
+static bool slot_is_intact(unsigned slot) {
+    char host[IFNAMSIZ], peer[IFNAMSIZ];
+    slot_names(slot, host, peer);
+    if (if_nametoindex(host) == 0) return false;
+    int fd = open_slot_netns(slot);
+    if (fd < 0) return false;
+    close(fd);
+    return true;
+}
+
+static void unpin_slot_netns(unsigned slot) {
+    char path[64];
+    slot_path(slot, "ns", path, sizeof(path));
+    umount2(path, MNT_DETACH);   // EINVAL when not mounted is fine
+}
+
+/* Delete a pair by its host end (either end takes the other with it). */
+static void delete_pair(int nl_fd, const char *host) {
+    nl_batch_t batch;
+    nl_batch_init(&batch);
+    rtnl_del_link(&batch, host);
+    nl_batch_exchange(nl_fd, &batch);
+}
+
+/* Add or remove the connected route the host address would normally
+ * bring with it (suppressed by IFA_F_NOPREFIXROUTE while idle). */
+static int host_subnet_route(bool add, const char *host_ip,
+                             const char *netmask, const char *host_if) {
+    int prefix = net_parse_prefix_len(netmask);
+    unsigned ifindex = if_nametoindex(host_if);
+    if (prefix < 0 || ifindex == 0) return -ENODEV;
+
+    int fd = nl_open();
+    if (fd < 0) return -errno;
+    nl_batch_t batch;
+    nl_batch_init(&batch);
+    rtnl_subnet_route(&batch, add, host_ip, (unsigned)prefix, ifindex);
+    int err = nl_batch_exchange(fd, &batch);
+    close(fd);
+    return err;
+}
+
+int net_pool_claim(net_context_t *ctx, const veth_config_t *veth,
+                   bool *needs_refill, bool enable_debug) {
+    if (!ctx || !veth || veth->pool.size == 0) return -1;
+    if (needs_refill) *needs_refill = false;
+
+    char want[SLOT_KEY_LEN], key[SLOT_KEY_LEN];
+    slot_key(veth, want);
+
+    int claimed = -1;
+    unsigned idle_after = 0;
+    for (unsigned slot = 0; slot < NET_POOL_MAX_SLOTS; slot++) {
+        int fd = lock_slot(slot);
+        if (fd < 0) continue;
+        read_slot_state(fd, key);
+        if (strcmp(key, want) != 0) {
+            close(fd);
+            continue;
+        }
+        if (claimed >= 0) {
+            /* Only count far enough to answer "below low-water?" — the
+             * scan is on the start path. */
+            close(fd);
+            if (++idle_after >= veth->pool.low_water) break;
+            continue;
+        }
+
+        char host[IFNAMSIZ], peer[IFNAMSIZ];
+        slot_names(slot, host, peer);
+        int ns_fd = if_nametoindex(host) != 0 ? open_slot_netns(slot) : -1;
+        if (ns_fd < 0) {
+            /* Broken slot (host end deleted, pin unmounted): mark it
+             * empty so the refiller rebuilds it. */
+            write_slot_state(fd, NULL);
+            close(fd);
+            continue;
+        }
+        claimed = (int)slot;
+        ctx->pool_lock_fd = fd;    // held until net_pool_release()
+        ctx->netns_fd = ns_fd;
+    }
+
+    if (claimed < 0) {
+        if (enable_debug) debug_log("[netpool] No idle slot for %s\n", want);
+        if (needs_refill) *needs_refill = true;
+        return -1;
+    }
+    if (needs_refill) *needs_refill = idle_after < veth->pool.low_water;
+
+    slot_names((unsigned)claimed, ctx->veth_host, ctx->veth_container);
+    snprintf(ctx->pool_cidr, sizeof(ctx->pool_cidr), "%s/%s",
+             veth->host_ip, veth->netmask);
+    ctx->pooled = true;
+    ctx->pool_slot = (unsigned)claimed;
+    ctx->veth_created = true;
+    ctx->backend = NET_BACKEND_NETLINK;
+
+    if (enable_debug) {
+        debug_log("[netpool] Claimed slot %d: %s <-> %s (%s%u idle left)\n",
+               claimed, ctx->veth_host, ctx->veth_container,
+               idle_after >= veth->pool.low_water ? ">=" : "", idle_after);
+    }
+    return 0;
+}
+
+int net_pool_attach(net_context_t *ctx, const veth_config_t *veth,
+                    bool enable_debug) {
+    if (!ctx || !ctx->pooled) return -1;
+
+    int err = host_subnet_route(true, veth->host_ip, veth->netmask,
+                                ctx->veth_host);
+    if (err < 0) {
+        fprintf(stderr, "[netpool] Route %s via %s: %s\n",
+                ctx->pool_cidr, ctx->veth_host, strerror(-err));
+        return -1;
+    }
+    if (enable_debug) {
+        debug_log("[netpool] Routed %s via %s\n", ctx->pool_cidr, ctx->veth_host);
+    }
+    return 0;
+}
+
+int net_pool_enter(const net_context_t *ctx, bool enable_debug) {
+    if (!ctx || !ctx->pooled || ctx->netns_fd < 0) return -1;
+
+    if (setns(ctx->netns_fd, CLONE_NEWNET) < 0) {
+        perror("[child] setns(pooled netns)");
+        return -1;
+    }
+    close(ctx->netns_fd);
+    if (enable_debug) {
+        debug_log("[child] Joined pooled netns (slot %u, %s)\n",
+               ctx->pool_slot, ctx->veth_container);
+    }
+    return 0;
+}
+
+void net_pool_release(net_context_t *ctx, bool enable_debug) {
+    if (!ctx || !ctx->pooled) return;
+
+    /* The route must go explicitly: the host end outlives the netns
+     * pin until the kernel's async netns cleanup deletes the pair. */
+    char host_ip[INET_ADDRSTRLEN];
+    const char *slash = strchr(ctx->pool_cidr, '/');
+    if (slash) {
+        snprintf(host_ip, sizeof(host_ip), "%.*s",
+                 (int)(slash - ctx->pool_cidr), ctx->pool_cidr);
+        host_subnet_route(false, host_ip, slash + 1, ctx->veth_host);
+    }
+
+    /* A used netns is never handed out again — the container may have
+     * left routes, sockets or sysctls behind. Unpinning it lets the
+     * kernel destroy it (and the veth pair) once its last task is gone;
+     * the refiller rebuilds the slot from scratch. */
+    unpin_slot_netns(ctx->pool_slot);
+    write_slot_state(ctx->pool_lock_fd, NULL);
+    if (enable_debug) debug_log("[netpool] Released slot %u\n", ctx->pool_slot);
+
+    if (ctx->netns_fd >= 0) close(ctx->netns_fd);
+    close(ctx->pool_lock_fd);   // drops the flock
+    ctx->netns_fd = -1;
+    ctx->pool_lock_fd = -1;
+    ctx->pooled = false;
+    ctx->veth_created = false;
+}
+
+/* Create a fresh netns and pin it at the slot's .ns path. The calling
+ * process is back in its own netns when this returns. */
+static int create_slot_netns(unsigned slot, int self_ns) {
+    char path[64];
+    slot_path(slot, "ns", path, sizeof(path));
+    int fd = open(path, O_RDONLY | O_CREAT | O_CLOEXEC, 0444);
+    if (fd < 0) return -1;
+    close(fd);
+
+    if (unshare(CLONE_NEWNET) < 0) return -1;
+    int rc = mount("/proc/self/ns/net", path, NULL, MS_BIND, NULL);
+    if (setns(self_ns, CLONE_NEWNET) < 0) {
+        /* Stuck in the new netns, every later host-side step would act
+         * on the wrong namespace. */
+        perror("[netpool] setns(back to host)");
+        abort();
+    }
+    return rc < 0 ? -1 : open_slot_netns(slot);
+}
+
+/* Build one slot under its lock. */
+static int fill_slot(int nl_fd, int lock_fd, int self_ns, unsigned slot,
+                     const veth_config_t *veth, const char *key,
+                     bool enable_debug) {
+    char host[IFNAMSIZ], peer[IFNAMSIZ];
+    slot_names(slot, host, peer);
+
+    /* Leftovers from a released or half-built slot go first. */
+    write_slot_state(lock_fd, NULL);
+    unpin_slot_netns(slot);
+    if (if_nametoindex(host) != 0) delete_pair(nl_fd, host);
+
+    int ns_fd = create_slot_netns(slot, self_ns);
+    if (ns_fd < 0) {
+        if (enable_debug) perror("[netpool] create netns");
+        return -1;
+    }
+
+    /* Host side: pair with the peer born inside the slot netns, host end
+     * up and addressed without a prefix route. */
+    nl_batch_t batch;
+    nl_batch_init(&batch);
+    rtnl_add_veth(&batch, host, peer, 0, ns_fd, true);
+    int err = nl_batch_exchange(nl_fd, &batch);
+    unsigned ifindex = err == 0 ? if_nametoindex(host) : 0;
+    if (ifindex != 0) {
+        nl_batch_init(&batch);
+        rtnl_add_addr(&batch, ifindex, veth->host_ip,
+                      (unsigned)net_parse_prefix_len(veth->netmask),
+                      IFA_F_NOPREFIXROUTE);
+        err = nl_batch_exchange(nl_fd, &batch);
+    }
+
+    /* Container side: the same batch a non-pooled child sends itself,
+     * run from inside the slot netns. */
+    if (ifindex != 0 && err == 0) {
+        net_context_t slot_ctx = {0};
+        slot_names(slot, slot_ctx.veth_host, slot_ctx.veth_container);
+        veth_config_t slot_veth = *veth;
+        slot_veth.backend = NET_BACKEND_NETLINK;
+        if (setns(ns_fd, CLONE_NEWNET) < 0) {
+            err = -errno;
+        } else {
+            err = configure_container_net(&slot_ctx, &slot_veth, false);
+            if (setns(self_ns, CLONE_NEWNET) < 0) {
+                perror("[netpool] setns(back to host)");
+                abort();
+            }
+        }
+    }
+    close(ns_fd);
+
+    if (ifindex == 0 || err != 0) {
+        if (enable_debug) {
+            fprintf(stderr, "[netpool] Failed to build slot %u (%s)\n",
+                    slot, host);
+        }
+        unpin_slot_netns(slot);        // takes the peer (and pair) along
+        if (if_nametoindex(host) != 0) delete_pair(nl_fd, host);
+        return -1;
+    }
+
+    write_slot_state(lock_fd, key);
+    if (enable_debug) debug_log("[netpool] Built slot %u (%s)\n", slot, host);
+    return 0;
+}
+
+int net_pool_refill(const veth_config_t *veth, bool enable_debug) {
+    if (!veth || veth->pool.size == 0) return 0;
+    if (net_parse_prefix_len(veth->netmask) < 0) return -1;
+    if (ensure_pool_dir() < 0) {
+        perror("[netpool] mkdir(" NET_POOL_DIR ")");
+        return -1;
+    }
+    int self_ns = open("/proc/self/ns/net", O_RDONLY | O_CLOEXEC);
+    if (self_ns < 0) return -1;
+    int nl_fd = nl_open();
+    if (nl_fd < 0) {
+        close(self_ns);
+        return -1;
+    }
+
+    char want[SLOT_KEY_LEN], key[SLOT_KEY_LEN];
+    slot_key(veth, want);
+
+    /* Pass 1: count idle slots and note empty ones. Intact slots built
+     * for other addresses belong to another configuration and are left
+     * alone; locked slots are claimed or being built elsewhere. */
+    unsigned idle = 0;
+    bool empty[NET_POOL_MAX_SLOTS] = {0};
+    for (unsigned slot = 0; slot < NET_POOL_MAX_SLOTS; slot++) {
+        int fd = lock_slot(slot);
+        if (fd < 0) continue;
+        read_slot_state(fd, key);
+        if (key[0] != '\0' && !slot_is_intact(slot)) {
+            write_slot_state(fd, NULL);
+            key[0] = '\0';
+        }
+        if (key[0] == '\0') empty[slot] = true;
+        else if (strcmp(key, want) == 0) idle++;
+        close(fd);
+    }
+
+    /* Pass 2: build empty slots until the high-water mark. */
+    for (unsigned slot = 0; slot < NET_POOL_MAX_SLOTS && idle < veth->pool.size;
+         slot++) {
+        if (!empty[slot]) continue;
+        int fd = lock_slot(slot);
+        if (fd < 0) continue;
+        read_slot_state(fd, key);
+        if (key[0] == '\0' &&
+            fill_slot(nl_fd, fd, self_ns, slot, veth, want, enable_debug) == 0) {
+            idle++;
+        }
+        close(fd);
+    }
+
+    close(nl_fd);
+    close(self_ns);
+    return (int)idle;
+}
+
+void net_pool_drain(bool enable_debug) {
+    int nl_fd = nl_open();
+    if (nl_fd < 0) return;
+    for (unsigned slot = 0; slot < NET_POOL_MAX_SLOTS; slot++) {
+        int fd = lock_slot(slot);
+        if (fd < 0) continue;
+        char key[SLOT_KEY_LEN], host[IFNAMSIZ], peer[IFNAMSIZ];
+        read_slot_state(fd, key);
+        slot_names(slot, host, peer);
+        write_slot_state(fd, NULL);
+        unpin_slot_netns(slot);
+        if (if_nametoindex(host) != 0) delete_pair(nl_fd, host);
+        if (enable_debug && key[0] != '\0') {
+            debug_log("[netpool] Drained slot %u\n", slot);
+        }
+        close(fd);
+    }
+    close(nl_fd);
+}
+
+void net_pool_refill_async(const veth_config_t *veth, bool enable_debug) {
+    fflush(NULL);   // don't let the grandchild replay our buffered output
+    debug_flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        if (enable_debug) perror("[netpool] fork(refill)");
+        return;
+    }
+    if (pid == 0) {
+        if (fork() == 0) {
+            /* Grandchild: drop every inherited fd — a copy of a claimed
+             * slot's lock fd would keep that slot locked after its owner
+             * releases it, and a copy of a pipe end would hold the pipe
+             * open. */
+            if (syscall(SYS_close_range, 3U, ~0U, 0U) < 0) {
+                for (int fd = 3; fd < 1024; fd++) close(fd);
+            }
+            setsid();   // outlive the caller's terminal session (SIGHUP)
+            int idle = net_pool_refill(veth, enable_debug);
+            if (enable_debug) debug_log("[netpool] Refill done: %d idle\n", idle);
+            fflush(NULL);
+            debug_flush();
+            _exit(idle < 0 ? 1 : 0);
+        }
+        _exit(0);
+    }
+    waitpid(pid, NULL, 0);
+}
@@ -0,0 +1,304 @@
+// Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include "net_user.h"
+#include "netlink.h"
+#include "events.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
+#endif
+
+static const char *first_executable(const char *a, const char *b) {
+    if (access(a, X_OK) == 0) return a;
+    if (access(b, X_OK) == 0) return b;
+    return NULL;
+}
+
+const char *net_user_find(net_user_mode_t want, net_user_mode_t *got) {
+    const char *path = NULL;
+    if (want == NET_USER_AUTO || want == NET_USER_PASTA) {
+        path = first_executable(PASTA_USR_BIN, PASTA_USR_LOCAL_BIN);
+        if (path) *got = NET_USER_PASTA;
+    }
+    if (!path && (want == NET_USER_AUTO || want == NET_USER_SLIRP4NETNS)) {
+        path = first_executable(SLIRP4NETNS_USR_BIN, SLIRP4NETNS_USR_LOCAL_BIN);
+        if (path) *got = NET_USER_SLIRP4NETNS;
+    }
+    return path;
+}
+
+const char *net_user_mode_name(net_user_mode_t mode) {
+    switch (mode) {
+        case NET_USER_NONE:        return "none";
+        case NET_USER_AUTO:        return "auto";
+        case NET_USER_PASTA:       return "pasta";
+        case NET_USER_SLIRP4NETNS: return "slirp4netns";
+    }
+    return "?";
+}
+
+static long elapsed_us(const struct timespec *t0) {
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) * 1000000L +
+           (t1.tv_nsec - t0->tv_nsec) / 1000L;
+}
+
+/* fork + execv the helper. keep[] are moved to fds 3, 4, ... in the
+ * helper and every other inherited fd is closed — in particular the
+ * container's sync pipe, whose EOF the child must be able to see. */
+static pid_t spawn_helper(const char *path, char *const argv[],
+                          const int *keep, int nkeep, bool enable_debug) {
+    if (enable_debug) {
+        char args[1024] = "";
+        size_t used = 0;
+        for (int i = 0; argv[i] && used < sizeof(args); i++) {
+            used += (size_t)snprintf(args + used, sizeof(args) - used, " %s",
+                                     argv[i]);
+        }
+        debug_log("[netuser] exec:%s\n", args);
+    }
+    fflush(NULL);
+    debug_flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("[netuser] fork");
+        return -1;
+    }
+    if (pid == 0) {
+        int moved[4];
+        for (int i = 0; i < nkeep; i++) moved[i] = fcntl(keep[i], F_DUPFD, 16);
+        for (int i = 0; i < nkeep; i++) dup2(moved[i], 3 + i);   // no CLOEXEC
+        if (syscall(SYS_close_range, 3U + (unsigned)nkeep, ~0U, 0U) < 0) {
+            for (int fd = 3 + nkeep; fd < 1024; fd++) close(fd);
+        }
+        if (!enable_debug) {
+            int devnull = open("/dev/null", O_WRONLY);
+            if (devnull >= 0) {
+                dup2(devnull, STDOUT_FILENO);
+                dup2(devnull, STDERR_FILENO);
+                close(devnull);
+            }
+        }
+        setsid();   // Not in our terminal's process group (^C)
+        execv(path, argv);
+        _exit(127);
+    }
+    return pid;
+}
+
+/* pasta daemonizes once the namespace is configured: its first process
+ * exiting 0 is the ready signal, and --pid names the daemon. Published
+ * ports become -t/-u forwards, which pasta splices between its host and
+ * namespace sockets. */
+static int start_pasta(net_context_t *ctx, const veth_config_t *veth,
+                       const char *path, pid_t child_pid, bool enable_debug) {
+    const char *tmp = getenv("TMPDIR");
+    char dir[PATH_MAX], pidfile[PATH_MAX + 8];
+    snprintf(dir, sizeof(dir), "%s/mcpasta-XXXXXX", tmp && tmp[0] ? tmp : "/tmp");
+    if (!mkdtemp(dir)) {
+        perror("[netuser] mkdtemp");
+        return -1;
+    }
+    snprintf(pidfile, sizeof(pidfile), "%s/pid", dir);
+
+    char target[16];
+    snprintf(target, sizeof(target), "%d", (int)child_pid);
+    char forwards[NET_PUBLISH_MAX][INET_ADDRSTRLEN + 16];
+    char *argv[8 + 2 * NET_PUBLISH_MAX];
+    int n = 0;
+    argv[n++] = "pasta";
+    argv[n++] = "--config-net";
+    argv[n++] = "--quiet";
+    argv[n++] = "--pid";
+    argv[n++] = pidfile;
+    for (unsigned i = 0; i < veth->publish_count && i < NET_PUBLISH_MAX; i++) {
+        const net_publish_t *p = &veth->publish[i];
+        snprintf(forwards[i], sizeof(forwards[i]), "%s%s%u:%u", p->host_ip,
+                 p->host_ip[0] ? "/" : "", (unsigned)p->host_port,
+                 (unsigned)p->container_port);
+        argv[n++] = p->proto == IPPROTO_UDP ? "-u" : "-t";
+        argv[n++] = forwards[i];
+    }
+    argv[n++] = target;
+    argv[n] = NULL;
+    int rc = -1;
+    pid_t pid = spawn_helper(path, argv, NULL, 0, enable_debug);
+    if (pid > 0) {
+        int status = 0;
+        pid_t w;
+        while ((w = waitpid(pid, &status, 0)) < 0 && errno == EINTR) {}
+        if (w < 0) {
+            perror("[netuser] waitpid(pasta)");
+        } else if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            rc = 0;
+        } else {
+            fprintf(stderr, "[netuser] pasta failed (status %d)\n",
+                    WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+        }
+    }
+
+    char buf[16] = "";
+    int fd = open(pidfile, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        ssize_t n = read(fd, buf, sizeof(buf) - 1);
+        buf[n > 0 ? n : 0] = '\0';
+        close(fd);
+    }
+    unlink(pidfile);
+    rmdir(dir);
+
+    pid_t daemon = (pid_t)atoi(buf);
+    int pidfd = daemon > 0 ? (int)syscall(SYS_pidfd_open, daemon, 0) : -1;
+    if (rc < 0) {
+        if (pidfd >= 0) {
+            syscall(SYS_pidfd_send_signal, pidfd, SIGTERM, NULL, 0);
+            close(pidfd);
+        }
+        return -1;
+    }
+    if (pidfd < 0) {
+        /* Still serving; it exits by itself with the namespace. */
+        fprintf(stderr, "[netuser] pasta left no pid; cannot stop it\n");
+    }
+    ctx->user_helper_pid = daemon > 0 ? daemon : -1;
+    ctx->user_helper_fd = pidfd;
+    return 0;
+}
+
+/* slirp4netns stays in the foreground: it writes "1" to --ready-fd once
+ * tap0 is configured, and exits when --exit-fd reaches EOF. */
+static int start_slirp4netns(net_context_t *ctx, const char *path,
+                             pid_t child_pid, bool enable_debug) {
+    int ready[2], exitp[2];
+    if (pipe2(ready, O_CLOEXEC) < 0) {
+        perror("[netuser] pipe");
+        return -1;
+    }
+    if (pipe2(exitp, O_CLOEXEC) < 0) {
+        perror("[netuser] pipe");
+        close(ready[0]);
+        close(ready[1]);
+        return -1;
+    }
+
+    char target[16];
+    snprintf(target, sizeof(target), "%d", (int)child_pid);
+    char *argv[] = { "slirp4netns", "--configure", "--mtu=" NET_USER_SLIRP_MTU,
+                     "--disable-host-loopback", "--ready-fd=3", "--exit-fd=4",
+                     target, "tap0", NULL };
+    int keep[] = { ready[1], exitp[0] };
+    pid_t pid = spawn_helper(path, argv, keep, 2, enable_debug);
+    close(ready[1]);
+    close(exitp[0]);
+    if (pid < 0) {
+        close(ready[0]);
+        close(exitp[1]);
+        return -1;
+    }
+
+    struct pollfd pfd = { .fd = ready[0], .events = POLLIN };
+    char c = 0;
+    int n = poll(&pfd, 1, NET_USER_READY_MS);
+    bool ok = n > 0 && read(ready[0], &c, 1) == 1 && c == '1';
+    close(ready[0]);
+    if (!ok) {
+        fprintf(stderr, "[netuser] slirp4netns %s\n",
+                n == 0 ? "did not become ready" : "failed to start");
+        close(exitp[1]);   // EOF: exits if it is still up
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+    ctx->user_helper_pid = pid;
+    ctx->user_helper_fd = exitp[1];
+    return 0;
+}
+
+int net_user_start(net_context_t *ctx, const veth_config_t *veth,
+                   pid_t child_pid, bool enable_debug) {
+    net_user_mode_t mode = NET_USER_NONE;
+    const char *path = net_user_find(veth->user_mode, &mode);
+    if (!path) {
+        fprintf(stderr, "[netuser] No %s binary in /usr/bin or /usr/local/bin\n",
+                veth->user_mode == NET_USER_AUTO ? "pasta or slirp4netns"
+                : net_user_mode_name(veth->user_mode));
+        return -1;
+    }
+    /* slirp4netns forwards only through its API socket, with a proxy in
+     * its own loop; pasta does it directly. */
+    if (veth->publish_count > 0 && mode != NET_USER_PASTA) {
+        fprintf(stderr, "[netuser] --publish needs pasta, not %s\n",
+                net_user_mode_name(mode));
+        return -1;
+    }
+
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int rc = mode == NET_USER_PASTA
+           ? start_pasta(ctx, veth, path, child_pid, enable_debug)
+           : start_slirp4netns(ctx, path, child_pid, enable_debug);
+    if (rc < 0) return -1;
+    ctx->user_mode = mode;
+    if (enable_debug) {
+        debug_log("[netuser] %s serving PID %d's network namespace (%ld us)\n",
+               net_user_mode_name(mode), (int)child_pid, elapsed_us(&t0));
+    }
+    return 0;
+}
+
+int net_user_enter(const net_context_t *ctx, bool enable_debug) {
+    (void)ctx;
+    int fd = nl_open();
+    if (fd < 0) {
+        perror("[child] socket(NETLINK_ROUTE)");
+        return -1;
+    }
+    nl_batch_t batch;
+    nl_batch_init(&batch);
+    rtnl_set_link_up(&batch, "lo");
+    int err = nl_batch_exchange(fd, &batch);
+    close(fd);
+    if (err < 0) {
+        fprintf(stderr, "[child] lo up: %s\n", strerror(-err));
+        return -1;
+    }
+    if (enable_debug) {
+        debug_log("[child] User-mode network: tap configured by the helper, lo up\n");
+    }
+    return 0;
+}
+
+void net_user_stop(net_context_t *ctx, bool enable_debug) {
+    if (!ctx || ctx->user_helper_pid == 0) return;
+    if (ctx->user_mode == NET_USER_PASTA) {
+        if (ctx->user_helper_fd >= 0) {
+            syscall(SYS_pidfd_send_signal, ctx->user_helper_fd, SIGTERM, NULL, 0);
+            close(ctx->user_helper_fd);
+        }
+    } else {
+        close(ctx->user_helper_fd);   // EOF on --exit-fd
+        waitpid(ctx->user_helper_pid, NULL, 0);
+    }
+    if (enable_debug) {
+        debug_log("[netuser] Stopped %s\n", net_user_mode_name(ctx->user_mode));
+    }
+    ctx->user_helper_pid = 0;
+    ctx->user_helper_fd = -1;
+}
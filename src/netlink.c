@@ -0,0 +1,334 @@
+// Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include "netlink.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+#include <linux/veth.h>
+
+/* Attribute helpers. Nested attributes are opened with nl_nest_begin()
+ * (which returns the rtattr whose length we patch later) and closed
+ * with nl_nest_end(). All helpers are no-ops once the batch overflows,
+ * so callers check b->overflow once at the end instead of after every
+ * append. */
+
+static struct nlmsghdr *nl_msg_begin(nl_batch_t *b, unsigned short type,
+                                     unsigned short flags, size_t hdr_len) {
+    size_t need = NLMSG_SPACE(hdr_len);
+    if (b->overflow || b->len + need > sizeof(b->buf)) {
+        b->overflow = true;
+        return NULL;
+    }
+    struct nlmsghdr *nlh = (struct nlmsghdr *)(b->buf + b->len);
+    memset(nlh, 0, need);
+    nlh->nlmsg_len   = NLMSG_LENGTH(hdr_len);
+    nlh->nlmsg_type  = type;
+    nlh->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK | flags;
+    nlh->nlmsg_seq   = ++b->count;
+    return nlh;
+}
+
+static void nl_msg_end(nl_batch_t *b, struct nlmsghdr *nlh) {
+    if (!nlh || b->overflow) return;
+    b->len += NLMSG_ALIGN(nlh->nlmsg_len);
+}
+
+static struct rtattr *nl_attr(nl_batch_t *b, struct nlmsghdr *nlh,
+                              unsigned short type, const void *data,
+                              size_t len) {
+    if (!nlh || b->overflow) return NULL;
+    size_t off = (size_t)((char *)nlh - b->buf);
+    size_t need = RTA_SPACE(len);
+    if (off + NLMSG_ALIGN(nlh->nlmsg_len) + need > sizeof(b->buf)) {
+        b->overflow = true;
+        return NULL;
+    }
+    struct rtattr *rta = (struct rtattr *)((char *)nlh +
+                                           NLMSG_ALIGN(nlh->nlmsg_len));
+    rta->rta_type = type;
+    rta->rta_len  = RTA_LENGTH(len);
+    if (len) memcpy(RTA_DATA(rta), data, len);
+    nlh->nlmsg_len = NLMSG_ALIGN(nlh->nlmsg_len) + RTA_ALIGN(rta->rta_len);
+    return rta;
+}
+
+/* Append raw (unframed) bytes — used for the ifinfomsg that heads the
+ * VETH_INFO_PEER payload. */
+static void nl_raw(nl_batch_t *b, struct nlmsghdr *nlh, const void *data,
+                   size_t len) {
+    if (!nlh || b->overflow) return;
+    size_t off = (size_t)((char *)nlh - b->buf);
+    if (off + NLMSG_ALIGN(nlh->nlmsg_len) + NLMSG_ALIGN(len) > sizeof(b->buf)) {
+        b->overflow = true;
+        return;
+    }
+    char *dst = (char *)nlh + NLMSG_ALIGN(nlh->nlmsg_len);
+    memset(dst, 0, NLMSG_ALIGN(len));
+    memcpy(dst, data, len);
+    nlh->nlmsg_len = NLMSG_ALIGN(nlh->nlmsg_len) + NLMSG_ALIGN(len);
+}
+
+static struct rtattr *nl_nest_begin(nl_batch_t *b, struct nlmsghdr *nlh,
+                                    unsigned short type) {
+    return nl_attr(b, nlh, type, NULL, 0);
+}
+
+static void nl_nest_end(struct nlmsghdr *nlh, struct rtattr *nest) {
+    if (!nlh || !nest) return;
+    nest->rta_len = (unsigned short)((char *)nlh + nlh->nlmsg_len -
+                                     (char *)nest);
+}
+
+static int nl_attr_str(nl_batch_t *b, struct nlmsghdr *nlh,
+                       unsigned short type, const char *s) {
+    return nl_attr(b, nlh, type, s, strlen(s) + 1) ? 0 : -1;
+}
+
+int nl_open(void) {
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) return -1;
+
+    struct sockaddr_nl sa = { .nl_family = AF_NETLINK };
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+void nl_batch_init(nl_batch_t *b) {
+    b->len = 0;
+    b->count = 0;
+    b->overflow = false;
+}
+
+int nl_batch_exchange(int fd, const nl_batch_t *b) {
+    if (b->overflow) return -EMSGSIZE;
+    if (b->count == 0) return 0;
+
+    struct sockaddr_nl kernel = { .nl_family = AF_NETLINK };
+    struct iovec iov = { .iov_base = (void *)b->buf, .iov_len = b->len };
+    struct msghdr msg = {
+        .msg_name = &kernel, .msg_namelen = sizeof(kernel),
+        .msg_iov = &iov, .msg_iovlen = 1
+    };
+    if (sendmsg(fd, &msg, 0) < 0) return -errno;
+
+    /* One ACK (an NLMSG_ERROR with error 0, or a real error) comes back
+     * per request. Keep reading until every sequence number is
+     * accounted for; the first non-zero error wins. */
+    int first_err = 0;
+    unsigned acked = 0;
+    char rbuf[8192] __attribute__((aligned(NLMSG_ALIGNTO)));
+    while (acked < b->count) {
+        ssize_t n = recv(fd, rbuf, sizeof(rbuf), 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -errno;
+        }
+        int len = (int)n;
+        for (struct nlmsghdr *h = (struct nlmsghdr *)rbuf;
+             NLMSG_OK(h, len); h = NLMSG_NEXT(h, len)) {
+            if (h->nlmsg_type != NLMSG_ERROR) continue;
+            const struct nlmsgerr *e = NLMSG_DATA(h);
+            acked++;
+            if (e->error != 0 && first_err == 0) first_err = e->error;
+        }
+    }
+    return first_err;
+}
+
+int rtnl_add_veth(nl_batch_t *b, const char *host_name,
+                  const char *peer_name, pid_t peer_ns_pid, int peer_ns_fd,
+                  bool up) {
+    struct nlmsghdr *nlh = nl_msg_begin(b, RTM_NEWLINK,
+                                        NLM_F_CREATE | NLM_F_EXCL,
+                                        sizeof(struct ifinfomsg));
+    if (!nlh) return -1;
+    struct ifinfomsg *ifi = NLMSG_DATA(nlh);
+    ifi->ifi_family = AF_UNSPEC;
+    if (up) {
+        ifi->ifi_flags  = IFF_UP;
+        ifi->ifi_change = IFF_UP;
+    }
+    nl_attr_str(b, nlh, IFLA_IFNAME, host_name);
+
+    struct rtattr *linkinfo = nl_nest_begin(b, nlh, IFLA_LINKINFO);
+    nl_attr_str(b, nlh, IFLA_INFO_KIND, "veth");
+    struct rtattr *data = nl_nest_begin(b, nlh, IFLA_INFO_DATA);
+    struct rtattr *peer = nl_nest_begin(b, nlh, VETH_INFO_PEER);
+    /* The peer attribute payload starts with its own ifinfomsg. */
+    struct ifinfomsg peer_ifi = { .ifi_family = AF_UNSPEC };
+    nl_raw(b, nlh, &peer_ifi, sizeof(peer_ifi));
+    nl_attr_str(b, nlh, IFLA_IFNAME, peer_name);
+    if (peer_ns_pid > 0) {
+        unsigned int ns_pid = (unsigned int)peer_ns_pid;
+        nl_attr(b, nlh, IFLA_NET_NS_PID, &ns_pid, sizeof(ns_pid));
+    } else if (peer_ns_fd >= 0) {
+        unsigned int ns_fd = (unsigned int)peer_ns_fd;
+        nl_attr(b, nlh, IFLA_NET_NS_FD, &ns_fd, sizeof(ns_fd));
+    }
+    nl_nest_end(nlh, peer);
+    nl_nest_end(nlh, data);
+    nl_nest_end(nlh, linkinfo);
+
+    nl_msg_end(b, nlh);
+    return b->overflow ? -1 : 0;
+}
+
+int rtnl_add_bridge(nl_batch_t *b, const char *name, bool up) {
+    struct nlmsghdr *nlh = nl_msg_begin(b, RTM_NEWLINK,
+                                        NLM_F_CREATE | NLM_F_EXCL,
+                                        sizeof(struct ifinfomsg));
+    if (!nlh) return -1;
+    struct ifinfomsg *ifi = NLMSG_DATA(nlh);
+    ifi->ifi_family = AF_UNSPEC;
+    if (up) {
+        ifi->ifi_flags  = IFF_UP;
+        ifi->ifi_change = IFF_UP;
+    }
+    nl_attr_str(b, nlh, IFLA_IFNAME, name);
+    struct rtattr *linkinfo = nl_nest_begin(b, nlh, IFLA_LINKINFO);
+    nl_attr_str(b, nlh, IFLA_INFO_KIND, "bridge");
+    nl_nest_end(nlh, linkinfo);
+    nl_msg_end(b, nlh);
+    return b->overflow ? -1 : 0;
+}
+
+int rtnl_set_master(nl_batch_t *b, const char *ifname, unsigned master_ifindex) {
+    struct nlmsghdr *nlh = nl_msg_begin(b, RTM_NEWLINK, 0,
+                                        sizeof(struct ifinfomsg));
+    if (!nlh) return -1;
+    struct ifinfomsg *ifi = NLMSG_DATA(nlh);
+    ifi->ifi_family = AF_UNSPEC;
+    nl_attr_str(b, nlh, IFLA_IFNAME, ifname);
+    nl_attr(b, nlh, IFLA_MASTER, &master_ifindex, sizeof(master_ifindex));
+    nl_msg_end(b, nlh);
+    return b->overflow ? -1 : 0;
+}
+
+int rtnl_set_link_up(nl_batch_t *b, const char *ifname) {
+    struct nlmsghdr *nlh = nl_msg_begin(b, RTM_NEWLINK, 0,
+                                        sizeof(struct ifinfomsg));
+    if (!nlh) return -1;
+    struct ifinfomsg *ifi = NLMSG_DATA(nlh);
+    ifi->ifi_family = AF_UNSPEC;
+    ifi->ifi_flags  = IFF_UP;
+    ifi->ifi_change = IFF_UP;
+    nl_attr_str(b, nlh, IFLA_IFNAME, ifname);
+    nl_msg_end(b, nlh);
+    return b->overflow ? -1 : 0;
+}
+
+int rtnl_add_addr(nl_batch_t *b, unsigned ifindex, const char *ip,
+                  unsigned prefix_len, unsigned ifa_flags) {
+    struct in_addr addr;
+    if (inet_pton(AF_INET, ip, &addr) != 1 || prefix_len > 32) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct nlmsghdr *nlh = nl_msg_begin(b, RTM_NEWADDR,
+                                        NLM_F_CREATE | NLM_F_EXCL,
+                                        sizeof(struct ifaddrmsg));
+    if (!nlh) return -1;
+    struct ifaddrmsg *ifa = NLMSG_DATA(nlh);
+    ifa->ifa_family    = AF_INET;
+    ifa->ifa_prefixlen = (unsigned char)prefix_len;
+    ifa->ifa_scope     = RT_SCOPE_UNIVERSE;
+    ifa->ifa_index     = ifindex;
+
+    /* IFA_LOCAL is the interface address; IFA_ADDRESS is the peer
+     * address, which equals IFA_LOCAL on broadcast links — same pair
+     * `ip addr add` sends. */
+    nl_attr(b, nlh, IFA_LOCAL, &addr, sizeof(addr));
+    nl_attr(b, nlh, IFA_ADDRESS, &addr, sizeof(addr));
+    if (prefix_len < 31) {
+        uint32_t mask = prefix_len ? htonl(~0u << (32 - prefix_len)) : 0;
+        struct in_addr brd = { .s_addr = addr.s_addr | ~mask };
+        nl_attr(b, nlh, IFA_BROADCAST, &brd, sizeof(brd));
+    }
+    if (ifa_flags) {
+        uint32_t flags = ifa_flags;
+        nl_attr(b, nlh, IFA_FLAGS, &flags, sizeof(flags));
+    }
+    nl_msg_end(b, nlh);
+    return b->overflow ? -1 : 0;
+}
+
+int rtnl_add_default_route(nl_batch_t *b, const char *gateway,
+                           unsigned ifindex) {
+    struct in_addr gw;
+    if (inet_pton(AF_INET, gateway, &gw) != 1) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct nlmsghdr *nlh = nl_msg_begin(b, RTM_NEWROUTE,
+                                        NLM_F_CREATE | NLM_F_EXCL,
+                                        sizeof(struct rtmsg));
+    if (!nlh) return -1;
+    struct rtmsg *rtm = NLMSG_DATA(nlh);
+    rtm->rtm_family   = AF_INET;
+    rtm->rtm_dst_len  = 0;
+    rtm->rtm_table    = RT_TABLE_MAIN;
+    rtm->rtm_protocol = RTPROT_BOOT;
+    rtm->rtm_scope    = RT_SCOPE_UNIVERSE;
+    rtm->rtm_type     = RTN_UNICAST;
+
+    nl_attr(b, nlh, RTA_GATEWAY, &gw, sizeof(gw));
+    uint32_t oif = ifindex;
+    nl_attr(b, nlh, RTA_OIF, &oif, sizeof(oif));
+    nl_msg_end(b, nlh);
+    return b->overflow ? -1 : 0;
+}
+
+int rtnl_subnet_route(nl_batch_t *b, bool add, const char *ip,
+                      unsigned prefix_len, unsigned ifindex) {
+    struct in_addr src;
+    if (inet_pton(AF_INET, ip, &src) != 1 || prefix_len > 32) {
+        errno = EINVAL;
+        return -1;
+    }
+    uint32_t mask = prefix_len ? htonl(~0u << (32 - prefix_len)) : 0;
+    struct in_addr dst = { .s_addr = src.s_addr & mask };
+
+    struct nlmsghdr *nlh = nl_msg_begin(b, add ? RTM_NEWROUTE : RTM_DELROUTE,
+                                        add ? NLM_F_CREATE | NLM_F_APPEND : 0,
+                                        sizeof(struct rtmsg));
+    if (!nlh) return -1;
+    struct rtmsg *rtm = NLMSG_DATA(nlh);
+    rtm->rtm_family   = AF_INET;
+    rtm->rtm_dst_len  = (unsigned char)prefix_len;
+    rtm->rtm_table    = RT_TABLE_MAIN;
+    rtm->rtm_protocol = RTPROT_KERNEL;
+    rtm->rtm_scope    = RT_SCOPE_LINK;
+    rtm->rtm_type     = RTN_UNICAST;
+
+    nl_attr(b, nlh, RTA_DST, &dst, sizeof(dst));
+    nl_attr(b, nlh, RTA_PREFSRC, &src, sizeof(src));
+    uint32_t oif = ifindex;
+    nl_attr(b, nlh, RTA_OIF, &oif, sizeof(oif));
+    nl_msg_end(b, nlh);
+    return b->overflow ? -1 : 0;
+}
+
+int rtnl_del_link(nl_batch_t *b, const char *ifname) {
+    struct nlmsghdr *nlh = nl_msg_begin(b, RTM_DELLINK, 0,
+                                        sizeof(struct ifinfomsg));
+    if (!nlh) return -1;
+    struct ifinfomsg *ifi = NLMSG_DATA(nlh);
+    ifi->ifi_family = AF_UNSPEC;
+    nl_attr_str(b, nlh, IFLA_IFNAME, ifname);
+    nl_msg_end(b, nlh);
+    return b->overflow ? -1 : 0;
+}
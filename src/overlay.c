@@ -1,4 +1,10 @@
 #include "overlay.h"
+#include "mount.h"
+#include "id.h"
+#include "fs_batch.h"
+#include "intern.h"
+#include "events.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -9,62 +15,172 @@
 #include <limits.h>
 #include <time.h>
 #include <ftw.h>
-
-/**
- * Generate a 12-character hex container ID.
- */
-static void generate_container_id(char *id){
-    
-    // This will generate randomness in the id
-    struct timespec ts;
-    clock_gettime(CLOCK_REALTIME, &ts);
-
-    unsigned long hash = ts.tv_sec ^ ts.tv_nsec ^ getpid();
-    snprintf(id, 13, "%012lx", hash & 0xFFFFFFFFFFFF);
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+/* remove_directory()'s batch. nftw() callbacks take no user pointer,
+ * and concurrent setup stages can tear down at once, so thread-local. */
+static _Thread_local fs_batch_t *remove_batch;
+
+/* Run the queued removals; perror() each failure. */
+static int flush_removals(void) {
+    fs_batch_t *b = remove_batch;
+    int rv = 0;
+    if (b->count > 0 && fs_batch_run(b, false) < 0) {
+        for (unsigned i = 0; i < b->count; i++) {
+            if (b->ops[i].res < 0) {
+                errno = -b->ops[i].res;
+                perror(fs_batch_path(b, i));
+            }
+        }
+        rv = -1;
+    }
+    fs_batch_init(b);
+    return rv;
 }
 
 /**
- * Callback for nftw() to remove directory tree.
+ * Callback for nftw() to remove directory tree. Entries arrive children
+ * first (FTW_DEPTH); each directory's rmdir waits for everything queued
+ * before it (its contents), while the unlinks within one directory run
+ * unordered. A full batch is flushed, which stops the walk on failure.
  */
 static int remove_cb(const char *path, const struct stat *sb, int typeflag, struct FTW *ftwbuf) {
     (void)sb;
-    (void)typeflag;
     (void)ftwbuf;
 
-    int rv = remove(path);
-    if (rv) {
-        perror(path);
+    bool is_dir = typeflag == FTW_DP || typeflag == FTW_DNR;
+    int flags = is_dir ? AT_REMOVEDIR : 0;
+    unsigned order = is_dir ? FS_OP_BARRIER : 0;
+    if (fs_batch_unlink(remove_batch, AT_FDCWD, path, flags, order) >= 0) {
+        return 0;
     }
-    return rv;
+    if (flush_removals() < 0) return -1;
+    return fs_batch_unlink(remove_batch, AT_FDCWD, path, flags, order) < 0;
 }
 
 /**
- * Recursively remove a directory tree.
+ * Recursively remove a directory tree, FS_BATCH_MAX entries per batch.
+ * Stays on path's filesystem (FTW_MOUNT): a mount left below it, such as
+ * a merged dir whose umount failed, is not descended into.
  */
 static int remove_directory(const char *path) {
-    return nftw(path, remove_cb, 64, FTW_DEPTH | FTW_PHYS);
+    fs_batch_t batch;
+    fs_batch_init(&batch);
+    remove_batch = &batch;
+    int rv = nftw(path, remove_cb, 64, FTW_DEPTH | FTW_PHYS | FTW_MOUNT);
+    if (flush_removals() < 0) rv = -1;
+    remove_batch = NULL;
+    return rv;
+}
+
+/**
+ * Resolve a lowerdir spec — one directory, or a colon-separated layer
+ * list with the topmost first (image_resolve() output) — to absolute
+ * paths joined the same way.
+ *
+ * @param rootfs_path  "dir" or "top:...:base"
+ * @param out          PATH_MAX buffer for the resolved list
+ * @return             0 on success, -1 on failure
+ */
+static int resolve_lowerdirs(const char *rootfs_path, char *out) {
+    char spec[PATH_MAX];
+    if (snprintf(spec, sizeof(spec), "%s", rootfs_path) >= (int)sizeof(spec)) {
+        fprintf(stderr, "init_overlay_paths: lowerdir list truncated\n");
+        return -1;
+    }
+
+    size_t used = 0;
+    char *save = NULL;
+    out[0] = '\0';
+    for (char *dir = strtok_r(spec, ":", &save); dir;
+         dir = strtok_r(NULL, ":", &save)) {
+        char resolved[PATH_MAX];
+        if (!realpath(dir, resolved)) {
+            perror("realpath(rootfs)");
+            return -1;
+        }
+        int n = snprintf(out + used, PATH_MAX - used, "%s%s",
+                         used ? ":" : "", resolved);
+        if (n < 0 || (size_t)n >= PATH_MAX - used) {
+            fprintf(stderr, "init_overlay_paths: lowerdir list truncated\n");
+            return -1;
+        }
+        used += (size_t)n;
+    }
+    if (used == 0) {
+        fprintf(stderr, "init_overlay_paths: empty rootfs path\n");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Point ctx's workspace paths at base: one block holding base,
+ * base/upper, base/work and base/merged back to back.
+ *
+ * @return  0 on success, -1 if a path would not fit PATH_MAX or on ENOMEM
+ */
+static int set_workspace_paths(overlay_context_t *ctx, const char *base) {
+    size_t len = strlen(base);
+    if (len + sizeof("/merged") > PATH_MAX) {
+        fprintf(stderr, "init_overlay_paths: container_base path truncated\n");
+        return -1;
+    }
+    char *p = malloc(4 * len + 1 + sizeof("/upper") + sizeof("/work") +
+                     sizeof("/merged"));
+    if (!p) {
+        perror("malloc(overlay paths)");
+        return -1;
+    }
+    ctx->container_base = p;
+    p += sprintf(p, "%s", base) + 1;
+    ctx->upper_path = p;
+    p += sprintf(p, "%s/upper", base) + 1;
+    ctx->work_path = p;
+    p += sprintf(p, "%s/work", base) + 1;
+    ctx->merged_path = p;
+    sprintf(p, "%s/merged", base);
+    return 0;
+}
+
+/**
+ * Free ctx's workspace paths. Idempotent.
+ */
+static void free_workspace_paths(overlay_context_t *ctx) {
+    free(ctx->container_base);
+    ctx->container_base = NULL;
+    ctx->upper_path = NULL;
+    ctx->work_path = NULL;
+    ctx->merged_path = NULL;
 }
 
 /**
  * Initialize overlay paths in context.
  *
- * Generates a container ID, resolves absolute paths, and populates
- * the upper/work/merged path fields in ctx.
+ * Generates a container ID, resolves absolute paths, interns the lower
+ * and cache paths and allocates the upper/work/merged ones.
  *
  * @param ctx            Overlay context to populate
- * @param rootfs_path    Path to base image (lowerdir)
+ * @param rootfs_path    Path to base image (lowerdir), or a colon-separated
+ *                       layer list, topmost first
  * @param container_dir  Parent directory for overlay data (NULL = "./containers")
  * @param enable_debug   Print resolved paths
  * @return               0 on success, -1 on failure
  */
 static int init_overlay_paths(overlay_context_t *ctx, const char *rootfs_path,
                               const char *container_dir, bool enable_debug) {
-    // Generate container ID
-    generate_container_id(ctx->container_id);
-
-    // Resolve rootfs to absolute path
-    if (!realpath(rootfs_path, ctx->lower_path)) {
-        perror("realpath(rootfs)");
+    // Container ID: the low 48 bits of the container's shared ID
+    if (ctx->id == 0) ctx->id = id_next();
+    snprintf(ctx->container_id, sizeof(ctx->container_id), "%012" PRIx64,
+             ctx->id & UINT64_C(0xFFFFFFFFFFFF));
+
+    // Resolve rootfs to absolute path(s)
+    char lower[PATH_MAX];
+    if (resolve_lowerdirs(rootfs_path, lower) < 0) {
         return -1;
     }
 
@@ -90,33 +206,36 @@ static int init_overlay_paths(overlay_context_t *ctx, const char *rootfs_path,
     // Each snprintf return value is checked against PATH_MAX to detect
     // truncation — a silently truncated path would cause mkdir/mount to
     // operate on the wrong location.
-    if (snprintf(ctx->container_base, PATH_MAX, "%s/%s",
+    char base[PATH_MAX], cache[PATH_MAX];
+    if (snprintf(base, PATH_MAX, "%s/%s",
                  abs_container_dir, ctx->container_id) >= PATH_MAX) {
         fprintf(stderr, "init_overlay_paths: container_base path truncated\n");
         return -1;
     }
 
-    if (snprintf(ctx->upper_path, PATH_MAX, "%s/upper", ctx->container_base) >= PATH_MAX) {
-        fprintf(stderr, "init_overlay_paths: upper_path truncated\n");
+    if (snprintf(cache, PATH_MAX, "%s/" OVERLAY_CACHE_DIR,
+                 abs_container_dir) >= PATH_MAX) {
+        fprintf(stderr, "init_overlay_paths: cache_path truncated\n");
         return -1;
     }
 
-    if (snprintf(ctx->work_path, PATH_MAX, "%s/work", ctx->container_base) >= PATH_MAX) {
-        fprintf(stderr, "init_overlay_paths: work_path truncated\n");
+    ctx->lower_path = str_intern(lower);
+    ctx->cache_path = str_intern(cache);
+    if (!ctx->lower_path || !ctx->cache_path) {
+        fprintf(stderr, "init_overlay_paths: out of memory\n");
         return -1;
     }
-
-    if (snprintf(ctx->merged_path, PATH_MAX, "%s/merged", ctx->container_base) >= PATH_MAX) {
-        fprintf(stderr, "init_overlay_paths: merged_path truncated\n");
+    if (set_workspace_paths(ctx, base) < 0) {
         return -1;
     }
+    ctx->from_cache = false;
 
     if (enable_debug) {
-        printf("[overlay] Container ID: %s\n", ctx->container_id);
-        printf("[overlay] Lower: %s\n", ctx->lower_path);
-        printf("[overlay] Upper: %s\n", ctx->upper_path);
-        printf("[overlay] Work:  %s\n", ctx->work_path);
-        printf("[overlay] Merged: %s\n", ctx->merged_path);
+        debug_log("[overlay] Container ID: %s\n", ctx->container_id);
+        debug_log("[overlay] Lower: %s\n", ctx->lower_path);
+        debug_log("[overlay] Upper: %s\n", ctx->upper_path);
+        debug_log("[overlay] Work:  %s\n", ctx->work_path);
+        debug_log("[overlay] Merged: %s\n", ctx->merged_path);
     }
 
     return 0;
@@ -132,56 +251,335 @@ static int init_overlay_paths(overlay_context_t *ctx, const char *rootfs_path,
  * @return     0 on success, -1 on failure
  */
 static int create_overlay_dirs(overlay_context_t *ctx) {
+    /* The base on its own first: its three children must never be made
+     * inside a directory that turned out not to be ours. */
     if (mkdir(ctx->container_base, 0755) < 0) {
         perror("mkdir(container_base)");
         return -1;
     }
 
-    if (mkdir(ctx->upper_path, 0755) < 0) {
-        perror("mkdir(upper)");
-        goto cleanup_base;
+    static const char *const names[] = { "upper", "work", "merged" };
+    const char *paths[] = { ctx->upper_path, ctx->work_path, ctx->merged_path };
+    fs_batch_t batch;
+    fs_batch_init(&batch);
+    for (int i = 0; i < 3; i++) fs_batch_mkdir(&batch, AT_FDCWD, paths[i], 0755, 0);
+    if (fs_batch_run(&batch, false) == 0) {
+        return 0;
     }
 
-    if (mkdir(ctx->work_path, 0755) < 0) {
-        perror("mkdir(work)");
-        goto cleanup_upper;
+    for (int i = 2; i >= 0; i--) {
+        if (batch.ops[i].res < 0) {
+            fs_batch_perror(&batch, (unsigned)i, names[i]);
+        } else {
+            rmdir(paths[i]);
+        }
     }
+    rmdir(ctx->container_base);
+    return -1;
+}
 
-    if (mkdir(ctx->merged_path, 0755) < 0) {
-        perror("mkdir(merged)");
-        goto cleanup_work;
+/**
+ * True if path is a directory with no entries.
+ */
+static bool dir_is_empty(const char *path) {
+    DIR *dir = opendir(path);
+    if (!dir) return false;
+
+    bool empty = true;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+            empty = false;
+            break;
+        }
     }
+    closedir(dir);
+    return empty;
+}
 
-    return 0;
+/**
+ * Claim a free triple from the workspace cache: rename the first
+ * cache/free entry to ctx->container_base. A concurrent claimer that
+ * wins an entry makes our rename fail with ENOENT; try the next one.
+ *
+ * @return  0 if a triple was claimed, -1 if the cache is empty or absent
+ */
+static int claim_cached_dirs(overlay_context_t *ctx) {
+    char free_dir[PATH_MAX];
+    if (snprintf(free_dir, PATH_MAX, "%s/free", ctx->cache_path) >= PATH_MAX) {
+        return -1;
+    }
+    DIR *dir = opendir(free_dir);
+    if (!dir) return -1;
+
+    int rc = -1;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        char src[PATH_MAX];
+        if (snprintf(src, PATH_MAX, "%s/%s", free_dir, entry->d_name) >= PATH_MAX) {
+            continue;
+        }
+        if (rename(src, ctx->container_base) == 0) {
+            rc = 0;
+            break;
+        }
+    }
+    closedir(dir);
+    return rc;
+}
 
-cleanup_work:
-    rmdir(ctx->work_path);
-cleanup_upper:
-    rmdir(ctx->upper_path);
-cleanup_base:
-    rmdir(ctx->container_base);
+/**
+ * Move ctx->container_base into cache/<sub>/<container_id>, creating the
+ * cache directories on first use.
+ *
+ * @return  0 on success, -1 on failure
+ */
+static int cache_move(const overlay_context_t *ctx, const char *sub) {
+    char sub_dir[PATH_MAX], dst[PATH_MAX];
+    if (snprintf(sub_dir, PATH_MAX, "%s/%s", ctx->cache_path, sub) >= PATH_MAX ||
+        snprintf(dst, PATH_MAX, "%s/%s", sub_dir, ctx->container_id) >= PATH_MAX) {
+        return -1;
+    }
+    if (rename(ctx->container_base, dst) == 0) return 0;
+    if (errno != ENOENT) return -1;
+
+    // First use: cache/ or cache/<sub> missing
+    if (mkdir(ctx->cache_path, 0755) < 0 && errno != EEXIST) return -1;
+    if (mkdir(sub_dir, 0755) < 0 && errno != EEXIST) return -1;
+    return rename(ctx->container_base, dst);
+}
+
+/**
+ * Return an unmounted triple to its freshly-created state: drop the
+ * work/work (and work/index) directories overlayfs leaves behind, then
+ * require upper/ and work/ to be empty.
+ *
+ * @return  0 if the triple can be reused, -1 if the container wrote to it
+ */
+static int reset_overlay_dirs(const overlay_context_t *ctx) {
+    char path[PATH_MAX];
+    if (snprintf(path, PATH_MAX, "%s/work", ctx->work_path) < PATH_MAX) {
+        rmdir(path);
+    }
+    if (snprintf(path, PATH_MAX, "%s/index", ctx->work_path) < PATH_MAX) {
+        rmdir(path);
+    }
+    return dir_is_empty(ctx->upper_path) && dir_is_empty(ctx->work_path) &&
+           dir_is_empty(ctx->merged_path) ? 0 : -1;
+}
+
+/**
+ * Reaper body: delete everything in cache/trash, then build fresh
+ * triples until cache/free holds OVERLAY_CACHE_WARM. A triple is built
+ * under cache/ and renamed into free/ complete, so a claimer never sees
+ * a half-made one. Another reaper already holding the lock does the work.
+ */
+static void reap_overlay_cache(const char *cache_path, bool enable_debug) {
+    char path[PATH_MAX];
+    if (snprintf(path, PATH_MAX, "%s/.lock", cache_path) >= PATH_MAX) return;
+    int lock_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (lock_fd < 0) return;
+    if (flock(lock_fd, LOCK_EX | LOCK_NB) < 0) {
+        close(lock_fd);
+        return;
+    }
+
+    int removed = 0;
+    char trash_dir[PATH_MAX];
+    snprintf(trash_dir, PATH_MAX, "%s/trash", cache_path);
+    DIR *dir = opendir(trash_dir);
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] == '.') continue;
+            if (snprintf(path, PATH_MAX, "%s/%s", trash_dir,
+                         entry->d_name) >= PATH_MAX) {
+                continue;
+            }
+            if (remove_directory(path) == 0) removed++;
+        }
+        closedir(dir);
+    }
+
+    char free_dir[PATH_MAX];
+    snprintf(free_dir, PATH_MAX, "%s/free", cache_path);
+    mkdir(free_dir, 0755);
+    int idle = 0;
+    dir = opendir(free_dir);
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] != '.') idle++;
+        }
+        closedir(dir);
+    }
+
+    int built = 0;
+    for (int i = 0; idle + built < OVERLAY_CACHE_WARM; i++) {
+        overlay_context_t tmp = {0};
+        char base[PATH_MAX], dst[PATH_MAX];
+        if (snprintf(base, PATH_MAX, "%s/new_%d_%d", cache_path,
+                     (int)getpid(), i) >= PATH_MAX ||
+            snprintf(dst, PATH_MAX, "%s/w%d_%d", free_dir, (int)getpid(), i) >= PATH_MAX ||
+            set_workspace_paths(&tmp, base) < 0) {
+            break;
+        }
+        int rc = create_overlay_dirs(&tmp);
+        if (rc == 0 && rename(base, dst) < 0) {
+            remove_directory(base);
+            rc = -1;
+        }
+        free_workspace_paths(&tmp);
+        if (rc < 0) break;
+        built++;
+    }
+
+    if (enable_debug) {
+        debug_log("[overlay] Cache reaper: removed %d, built %d, %d free\n",
+               removed, built, idle + built);
+    }
+    close(lock_fd);
+}
+
+/**
+ * Run reap_overlay_cache() in a detached grandchild (the same shape as
+ * net_pool_refill_async()), so teardown never waits for a delete walk.
+ */
+static void reap_overlay_cache_async(const char *cache_path, bool enable_debug) {
+    fflush(NULL);   // don't let the grandchild replay our buffered output
+    debug_flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        if (enable_debug) perror("[overlay] fork(reaper)");
+        return;
+    }
+    if (pid == 0) {
+        if (fork() == 0) {
+            /* Drop inherited fds: a copy of a pipe end or a lock fd must
+             * not outlive its owner in here. */
+            if (syscall(SYS_close_range, 3U, ~0U, 0U) < 0) {
+                for (int fd = 3; fd < 1024; fd++) close(fd);
+            }
+            setsid();
+            reap_overlay_cache(cache_path, enable_debug);
+            fflush(NULL);
+            debug_flush();
+            _exit(0);
+        }
+        _exit(0);
+    }
+    waitpid(pid, NULL, 0);
+}
+
+/**
+ * Build the overlay with fsconfig() and return it as a detached mount.
+ *
+ * Each layer is its own "lowerdir+" call (Linux 6.8+), so the layer list
+ * is not bounded by mount(2)'s one-page option string. Older kernels
+ * reject the key with EINVAL on the first layer; the whole list then
+ * goes in one "lowerdir" value.
+ */
+int overlay_fsmount(overlay_context_t *ctx, bool enable_debug) {
+    int fs_fd = fsopen_compat("overlay", FSOPEN_CLOEXEC);
+    if (fs_fd < 0) {
+        return -1;
+    }
+
+    char layers[PATH_MAX];
+    snprintf(layers, sizeof(layers), "%s", ctx->lower_path);
+    bool per_layer = true;
+    int nlayers = 0;
+    char *save = NULL;
+    for (char *layer = strtok_r(layers, ":", &save); layer;
+         layer = strtok_r(NULL, ":", &save)) {
+        if (fsconfig_compat(fs_fd, FSCONFIG_SET_STRING, "lowerdir+",
+                            layer, 0) < 0) {
+            if (errno == EINVAL && nlayers == 0) {
+                per_layer = false;
+                break;
+            }
+            goto fail;
+        }
+        nlayers++;
+    }
+    if (!per_layer && fsconfig_compat(fs_fd, FSCONFIG_SET_STRING, "lowerdir",
+                                      ctx->lower_path, 0) < 0) {
+        goto fail;
+    }
+
+    if (fsconfig_compat(fs_fd, FSCONFIG_SET_STRING, "upperdir",
+                        ctx->upper_path, 0) < 0 ||
+        fsconfig_compat(fs_fd, FSCONFIG_SET_STRING, "workdir",
+                        ctx->work_path, 0) < 0 ||
+        fsconfig_compat(fs_fd, FSCONFIG_CMD_CREATE, NULL, NULL, 0) < 0) {
+        goto fail;
+    }
+
+    // MOUNT_ATTR_NODEV | MOUNT_ATTR_NOSUID: same hardening as the
+    // mount(2) path (§3.6)
+    int mnt_fd = fsmount_compat(fs_fd, FSMOUNT_CLOEXEC,
+                                MOUNT_ATTR_NODEV | MOUNT_ATTR_NOSUID);
+    if (mnt_fd < 0) {
+        goto fail;
+    }
+    close(fs_fd);
+
+    if (enable_debug) {
+        debug_log("[overlay] Built detached overlay (%s lowerdir%s)\n",
+               per_layer ? "per-layer" : "single", per_layer ? "+" : "");
+    }
+    return mnt_fd;
+
+fail:
+    perror("fsconfig(overlay)");
+    fs_log_dump(fs_fd, "[overlay]");
+    close(fs_fd);
+    errno = EINVAL;   // Not ENOSYS: mount(2) would fail the same way
     return -1;
 }
 
 /**
  * Mount the overlay filesystem.
  *
- * Builds the mount options string and calls mount(2) with
+ * Attaches an overlay_fsmount() mount at merged_path; on kernels without
+ * the fd API, builds the mount options string and calls mount(2) with
  * MS_NODEV | MS_NOSUID (§3.6).
- *
- * @param ctx           Overlay context with paths initialized and dirs created
- * @param enable_debug  Print mount options
- * @return              0 on success, -1 on failure
  */
-static int mount_overlay(overlay_context_t *ctx, bool enable_debug) {
+int mount_overlay(overlay_context_t *ctx, bool enable_debug) {
+    int mnt_fd = overlay_fsmount(ctx, enable_debug);
+    if (mnt_fd >= 0) {
+        if (move_mount_compat(mnt_fd, "", AT_FDCWD, ctx->merged_path,
+                              MOVE_MOUNT_F_EMPTY_PATH) < 0) {
+            perror("move_mount(overlay)");
+            close(mnt_fd);
+            return -1;
+        }
+        close(mnt_fd);
+        ctx->is_mounted = true;
+        if (enable_debug) {
+            debug_log("[overlay] Overlay mounted at %s\n", ctx->merged_path);
+        }
+        return 0;
+    }
+    if (errno != ENOSYS) {
+        return -1;
+    }
+
     // Build mount options string
+    // mount(2) takes at most one page of options; a long layer list is
+    // the realistic way to exceed it
     char mount_opts[PATH_MAX * 4];
-    snprintf(mount_opts, sizeof(mount_opts),
-             "lowerdir=%s,upperdir=%s,workdir=%s",
-             ctx->lower_path, ctx->upper_path, ctx->work_path);
+    int len = snprintf(mount_opts, sizeof(mount_opts),
+                       "lowerdir=%s,upperdir=%s,workdir=%s",
+                       ctx->lower_path, ctx->upper_path, ctx->work_path);
+    if (len < 0 || len >= sysconf(_SC_PAGESIZE)) {
+        fprintf(stderr, "mount_overlay: options exceed one page (%d bytes)\n", len);
+        return -1;
+    }
 
     if (enable_debug) {
-        printf("[overlay] Mount options: %s\n", mount_opts);
+        debug_log("[overlay] Mount options: %s\n", mount_opts);
     }
 
     // Mount overlay — MS_NODEV | MS_NOSUID blocks device nodes and
@@ -195,23 +593,23 @@ static int mount_overlay(overlay_context_t *ctx, bool enable_debug) {
     ctx->is_mounted = true;
 
     if (enable_debug) {
-        printf("[overlay] Overlay mounted at %s\n", ctx->merged_path);
+        debug_log("[overlay] Overlay mounted at %s\n", ctx->merged_path);
     }
 
     return 0;
 }
 
 /**
- * Setup overlay filesystem.
+ * Prepare overlay directories without mounting.
  *
- * Public wrapper that initializes paths, creates directories, and mounts
- * overlayfs. On failure, partially created state is cleaned up by each
- * sub-function independently.
+ * Initializes paths, then claims a cached triple or creates the
+ * directories. On failure, partially created state is cleaned up by
+ * each sub-function independently.
  */
-int setup_overlay(overlay_context_t *ctx, const char *rootfs_path,
-                  const char *container_dir, bool enable_debug) {
+int prepare_overlay(overlay_context_t *ctx, const char *rootfs_path,
+                    const char *container_dir, bool enable_debug) {
     if (!ctx || !rootfs_path) {
-        fprintf(stderr, "setup_overlay: invalid arguments\n");
+        fprintf(stderr, "prepare_overlay: invalid arguments\n");
         return -1;
     }
 
@@ -219,7 +617,36 @@ int setup_overlay(overlay_context_t *ctx, const char *rootfs_path,
         return -1;
     }
 
+    if (claim_cached_dirs(ctx) == 0) {
+        ctx->from_cache = true;
+        if (enable_debug) debug_log("[overlay] Claimed cached workspace\n");
+        return 0;
+    }
     if (create_overlay_dirs(ctx) < 0) {
+        free_workspace_paths(ctx);
+        return -1;
+    }
+    return 0;
+}
+
+int overlay_context_adopt(overlay_context_t *ctx, const char *lower,
+                          const char *base) {
+    ctx->lower_path = str_intern(lower);
+    if (!ctx->lower_path) {
+        fprintf(stderr, "overlay_context_adopt: out of memory\n");
+        return -1;
+    }
+    return set_workspace_paths(ctx, base);
+}
+
+/**
+ * Setup overlay filesystem.
+ *
+ * Public wrapper: prepare_overlay() followed by mount_overlay().
+ */
+int setup_overlay(overlay_context_t *ctx, const char *rootfs_path,
+                  const char *container_dir, bool enable_debug) {
+    if (prepare_overlay(ctx, rootfs_path, container_dir, enable_debug) < 0) {
         return -1;
     }
 
@@ -228,6 +655,7 @@ int setup_overlay(overlay_context_t *ctx, const char *rootfs_path,
         rmdir(ctx->work_path);
         rmdir(ctx->upper_path);
         rmdir(ctx->container_base);
+        free_workspace_paths(ctx);
         return -1;
     }
 
@@ -236,7 +664,9 @@ int setup_overlay(overlay_context_t *ctx, const char *rootfs_path,
 
 /**
  * Teardown overlay filesystem.
- * Unmounts overlay and removes all container directories.
+ * Unmounts overlay and returns the container directories to the
+ * workspace cache. Falls back to deleting them in place only if the
+ * cache cannot take them.
  */
 int teardown_overlay(overlay_context_t *ctx, bool enable_debug){
     
@@ -245,57 +675,65 @@ int teardown_overlay(overlay_context_t *ctx, bool enable_debug){
     }
 
     int ret = 0;
+    bool reusable = true;
 
-    // Unmount the overlay
+    // Unmount the overlay. A lazy unmount means something still holds
+    // the mount: its upper/work must not be handed to another container.
     if(ctx->is_mounted){
         if(enable_debug){
-            printf("[overlay] Unmounting: %s\n", ctx->merged_path);
+            debug_log("[overlay] Unmounting: %s\n", ctx->merged_path);
         }
 
-        if(umount2(ctx->merged_path, MNT_DETACH) < 0){
+        if(umount2(ctx->merged_path, 0) == 0){
+            ctx->is_mounted = false;
+        }else if(errno == EBUSY && umount2(ctx->merged_path, MNT_DETACH) == 0){
+            ctx->is_mounted = false;
+            reusable = false;
+        }else{
             perror("umount2(overlay)");
+            reusable = false;
             ret = -1;
-        }else{
-            ctx->is_mounted = false;
         }
     }
 
-    // Remove upper directory tree (contains container's writes)
-    if(ctx->upper_path[0]){
-        if(enable_debug){
-            printf("[overlay] Removing upper layer: %s\n", ctx->upper_path);
-        }
-        remove_directory(ctx->upper_path);
+    if(!ctx->container_base){
+        return ret;
+    }
+    if(ctx->is_mounted){
+        // Still mounted: deleting the base would walk into the live
+        // overlay (and through it, a writable lower). Leave it for a retry.
+        fprintf(stderr, "[overlay] %s still mounted, keeping %s\n",
+                ctx->merged_path, ctx->container_base);
+        return ret;
     }
 
-    // Remove work directory tree (kernel bookkeeping)
-    if(ctx->work_path[0]){
+    bool kick_reaper = !ctx->from_cache;   // Cache ran dry: warm it up
+    if(reusable && reset_overlay_dirs(ctx) == 0 && cache_move(ctx, "free") == 0){
         if(enable_debug){
-            printf("[overlay] Removing work dir: %s\n", ctx->work_path);
+            debug_log("[overlay] Recycled clean workspace %s\n", ctx->container_id);
         }
-        remove_directory(ctx->work_path);
-    }
-
-    // Remove merged directory (mount point)
-    if(ctx->merged_path[0]){
+    }else if(cache_move(ctx, "trash") == 0){
         if(enable_debug){
-            printf("[overlay] Removing merged dir: %s\n", ctx->merged_path);
+            debug_log("[overlay] Queued %s for the cache reaper\n", ctx->container_id);
         }
-        rmdir(ctx->merged_path);
-    }
-
-    // Remove container base directory
-    if(ctx->container_base[0]){
+        kick_reaper = true;
+    }else{
+        // No cache: delete in place (upper holds the container's writes,
+        // work the kernel's bookkeeping)
         if(enable_debug){
-            printf("[overlay] Removing container base: %s\n", ctx->container_base);
+            debug_log("[overlay] Removing container base: %s\n", ctx->container_base);
         }
-        rmdir(ctx->container_base);
+        remove_directory(ctx->container_base);
+    }
+    free_workspace_paths(ctx);
+
+    if(kick_reaper){
+        reap_overlay_cache_async(ctx->cache_path, enable_debug);
     }
 
     if (enable_debug) {
-        printf("[overlay] Cleanup complete\n");
+        debug_log("[overlay] Cleanup complete\n");
     }
 
     return ret;
 }
-
@@ -0,0 +1,342 @@
+// Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include "seccomp.h"
+#include "seccomp_syscalls.h"
+#include "events.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/audit.h>
+#include <linux/seccomp.h>
+
+#if defined(__x86_64__)
+#define SECCOMP_AUDIT_ARCH AUDIT_ARCH_X86_64
+#elif defined(__aarch64__)
+#define SECCOMP_AUDIT_ARCH AUDIT_ARCH_AARCH64
+#elif defined(__riscv) && __riscv_xlen == 64
+#define SECCOMP_AUDIT_ARCH AUDIT_ARCH_RISCV64
+#endif
+
+#ifndef __X32_SYSCALL_BIT
+#define __X32_SYSCALL_BIT 0x40000000
+#endif
+
+#define SECCOMP_NR_LIMIT 1024   // Above every syscall number we know
+
+/* Everything but the calls a container has no business making: kernel,
+ * module, clock and swap administration, mounts and namespace changes
+ * (the runtime made those already), tracing and other processes'
+ * memory, keyrings, BPF and perf. */
+static const char default_profile[] =
+    "default allow\n"
+    "errno kexec_load kexec_file_load init_module finit_module "
+    "delete_module ?create_module ?get_kernel_syms ?query_module\n"
+    "errno reboot swapon swapoff acct quotactl ?nfsservctl ?uselib "
+    "?_sysctl ?sysfs ?ustat ?vm86 ?vm86old ?ioperm ?iopl\n"
+    "errno settimeofday clock_settime clock_adjtime adjtimex ?stime\n"
+    "errno mount umount2 ?umount pivot_root unshare setns fsopen fsconfig "
+    "fsmount fspick move_mount open_tree mount_setattr open_by_handle_at\n"
+    "errno ptrace process_vm_readv process_vm_writev kcmp "
+    "?lookup_dcookie\n"
+    "errno add_key request_key keyctl bpf perf_event_open userfaultfd\n";
+
+typedef struct cached_program {
+    struct cached_program *next;
+    char *text;                   // Profile text it was compiled from
+    uint64_t hash;
+    seccomp_program_t prog;
+} cached_program_t;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static cached_program_t *cache;
+
+static uint64_t hash_str(const char *s) {
+    uint64_t h = 0xcbf29ce484222325ULL;   // FNV-1a
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static long elapsed_us(const struct timespec *t0) {
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) * 1000000L +
+           (t1.tv_nsec - t0->tv_nsec) / 1000L;
+}
+
+static int parse_action(const char *word, uint32_t *action) {
+    if (strcmp(word, "allow") == 0)      *action = SECCOMP_RET_ALLOW;
+    else if (strcmp(word, "errno") == 0) *action = SECCOMP_RET_ERRNO | EPERM;
+    else if (strcmp(word, "log") == 0)   *action = SECCOMP_RET_LOG;
+    else if (strcmp(word, "kill") == 0)  *action = SECCOMP_RET_KILL_PROCESS;
+    else return -1;
+    return 0;
+}
+
+static int syscall_nr(const char *name) {
+    for (size_t i = 0; i < sizeof(seccomp_syscalls) / sizeof(seccomp_syscalls[0]); i++) {
+        if (strcmp(seccomp_syscalls[i].name, name) == 0) return seccomp_syscalls[i].nr;
+    }
+    return -1;
+}
+
+/* Fill act[] (one action per syscall number) from the profile text.
+ * Destroys text. Returns the number of syscalls named, or -1. */
+static int parse_profile(char *text, const char *what, uint32_t *act) {
+    uint32_t dflt = SECCOMP_RET_ALLOW;
+    bool have_default = false;
+    bool named[SECCOMP_NR_LIMIT] = {false};
+    uint32_t listed[SECCOMP_NR_LIMIT];
+    int count = 0;
+
+    char *save_line;
+    unsigned lineno = 0;
+    for (char *line = strtok_r(text, "\n", &save_line); line;
+         line = strtok_r(NULL, "\n", &save_line)) {
+        lineno++;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        char *save;
+        char *word = strtok_r(line, " \t\r", &save);
+        if (!word) continue;
+
+        uint32_t action;
+        if (strcmp(word, "default") == 0) {
+            char *a = strtok_r(NULL, " \t\r", &save);
+            if (!a || parse_action(a, &dflt) < 0 || strtok_r(NULL, " \t\r", &save)) {
+                fprintf(stderr, "[seccomp] %s:%u: expected 'default "
+                                "allow|errno|log|kill'\n", what, lineno);
+                return -1;
+            }
+            have_default = true;
+            continue;
+        }
+        if (parse_action(word, &action) < 0) {
+            fprintf(stderr, "[seccomp] %s:%u: unknown action '%s'\n",
+                    what, lineno, word);
+            return -1;
+        }
+        for (char *name = strtok_r(NULL, " \t\r", &save); name;
+             name = strtok_r(NULL, " \t\r", &save)) {
+            bool optional = name[0] == '?';
+            int nr = syscall_nr(optional ? name + 1 : name);
+            if (nr < 0 || nr >= SECCOMP_NR_LIMIT) {
+                if (optional) continue;
+                fprintf(stderr, "[seccomp] %s:%u: unknown syscall '%s'\n",
+                        what, lineno, name);
+                return -1;
+            }
+            if (!named[nr]) count++;
+            named[nr] = true;
+            listed[nr] = action;
+        }
+    }
+    if (!have_default) {
+        fprintf(stderr, "[seccomp] %s: no 'default' rule\n", what);
+        return -1;
+    }
+    for (int nr = 0; nr < SECCOMP_NR_LIMIT; nr++) {
+        act[nr] = named[nr] ? listed[nr] : dflt;
+    }
+    act[SECCOMP_NR_LIMIT] = dflt;   // Everything above
+    return count;
+}
+
+typedef struct {
+    uint32_t start;    // First syscall number of the run
+    uint32_t action;
+} run_t;
+
+/* Instructions emit_tree() uses for n runs. */
+static unsigned tree_size(unsigned n, bool far) {
+    return far ? 3 * n - 2 : 2 * n - 1;
+}
+
+/* Binary search over runs, the accumulator holding the syscall number:
+ * each node is "nr >= start of the right half?", each leaf a return.
+ * Jump offsets are 8 bits; a tree too big for that routes every true
+ * branch through a BPF_JA (32-bit offset) instead. */
+static void emit_tree(seccomp_program_t *p, const run_t *runs, unsigned n,
+                      bool far) {
+    if (n == 1) {
+        p->insns[p->len++] = (struct sock_filter)
+            BPF_STMT(BPF_RET | BPF_K, runs[0].action);
+        return;
+    }
+    unsigned nl = n / 2;
+    unsigned left = tree_size(nl, far);
+    if (far) {
+        p->insns[p->len++] = (struct sock_filter)
+            BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, runs[nl].start, 0, 1);
+        p->insns[p->len++] = (struct sock_filter)
+            BPF_JUMP(BPF_JMP | BPF_JA, left, 0, 0);
+    } else {
+        p->insns[p->len++] = (struct sock_filter)
+            BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, runs[nl].start, left, 0);
+    }
+    emit_tree(p, runs, nl, far);
+    emit_tree(p, runs + nl, n - nl, far);
+}
+
+static int build_program(const uint32_t *act, seccomp_program_t *p,
+                         const char *what, unsigned *nruns) {
+#ifndef SECCOMP_AUDIT_ARCH
+    (void)act; (void)p; (void)nruns;
+    fprintf(stderr, "[seccomp] %s: unsupported architecture\n", what);
+    return -1;
+#else
+    static run_t runs[SECCOMP_NR_LIMIT + 1];
+    unsigned n = 0;
+    for (uint32_t nr = 0; nr <= SECCOMP_NR_LIMIT; nr++) {
+        if (n == 0 || runs[n - 1].action != act[nr]) {
+            runs[n].start = nr;
+            runs[n].action = act[nr];
+            n++;
+        }
+    }
+    *nruns = n;
+
+    p->len = 0;
+    p->insns[p->len++] = (struct sock_filter)
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch));
+    p->insns[p->len++] = (struct sock_filter)
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, SECCOMP_AUDIT_ARCH, 1, 0);
+    p->insns[p->len++] = (struct sock_filter)
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS);
+    p->insns[p->len++] = (struct sock_filter)
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr));
+#if defined(__x86_64__)
+    /* x32 shares the x86_64 audit arch: its numbers would miss every
+     * rule and take the default. */
+    p->insns[p->len++] = (struct sock_filter)
+        BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, __X32_SYSCALL_BIT, 0, 1);
+    p->insns[p->len++] = (struct sock_filter)
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS);
+#endif
+    bool far = n > 1 && tree_size(n / 2, false) > 255;
+    if (p->len + tree_size(n, far) > SECCOMP_MAX_INSNS) {
+        fprintf(stderr, "[seccomp] %s: %u runs need more than %d "
+                        "instructions\n", what, n, SECCOMP_MAX_INSNS);
+        return -1;
+    }
+    emit_tree(p, runs, n, far);
+    return 0;
+#endif
+}
+
+/* The profile's text: the built-in one, or the file's contents. */
+static char *load_profile(const char *profile) {
+    if (strcmp(profile, SECCOMP_PROFILE_DEFAULT) == 0) {
+        return strdup(default_profile);
+    }
+    int fd = open(profile, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "[seccomp] %s: %s\n", profile, strerror(errno));
+        return NULL;
+    }
+    char *text = malloc(SECCOMP_PROFILE_MAX + 1);
+    size_t used = 0;
+    ssize_t n = 0;
+    while (text && used < SECCOMP_PROFILE_MAX &&
+           (n = read(fd, text + used, SECCOMP_PROFILE_MAX - used)) > 0) {
+        used += (size_t)n;
+    }
+    close(fd);
+    if (!text || n < 0 || used == SECCOMP_PROFILE_MAX) {
+        fprintf(stderr, "[seccomp] %s: %s\n", profile,
+                !text || n < 0 ? strerror(errno) : "profile too large");
+        free(text);
+        return NULL;
+    }
+    text[used] = '\0';
+    return text;
+}
+
+const seccomp_program_t *seccomp_compile(const char *profile,
+                                         bool enable_debug) {
+    if (!profile) return NULL;
+    char *text = load_profile(profile);
+    if (!text) return NULL;
+    uint64_t hash = hash_str(text);
+
+    pthread_mutex_lock(&cache_lock);
+    for (cached_program_t *c = cache; c; c = c->next) {
+        if (c->hash == hash && strcmp(c->text, text) == 0) {
+            pthread_mutex_unlock(&cache_lock);
+            free(text);
+            if (enable_debug) {
+                debug_log("[seccomp] %s: cached (%u insns)\n", profile,
+                       (unsigned)c->prog.len);
+            }
+            return &c->prog;
+        }
+    }
+
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    cached_program_t *c = calloc(1, sizeof(*c));
+    char *scratch = strdup(text);
+    static uint32_t act[SECCOMP_NR_LIMIT + 1];
+    unsigned nruns = 0;
+    int listed = -1;
+    if (c && scratch) listed = parse_profile(scratch, profile, act);
+    free(scratch);
+    if (listed < 0 || build_program(act, &c->prog, profile, &nruns) < 0) {
+        pthread_mutex_unlock(&cache_lock);
+        free(c);
+        free(text);
+        return NULL;
+    }
+    c->text = text;
+    c->hash = hash;
+    c->next = cache;
+    cache = c;
+    pthread_mutex_unlock(&cache_lock);
+
+    if (enable_debug) {
+        debug_log("[seccomp] %s: %d syscalls listed, %u runs, %u insns "
+               "(compiled in %ld us)\n", profile, listed, nruns,
+               (unsigned)c->prog.len, elapsed_us(&t0));
+    }
+    return &c->prog;
+}
+
+int seccomp_install(const seccomp_program_t *prog, bool enable_debug) {
+    struct sock_fprog fprog = {
+        .len = prog->len,
+        .filter = (struct sock_filter *)prog->insns,
+    };
+    if (enable_debug) {
+        debug_log("[child] Installing seccomp filter (%u insns)\n",
+               (unsigned)prog->len);
+    }
+    long rc = syscall(SYS_seccomp, SECCOMP_SET_MODE_FILTER,
+                      SECCOMP_FILTER_FLAG_TSYNC, &fprog);
+    if (rc < 0 && errno == EACCES) {
+        /* Not CAP_SYS_ADMIN in our user namespace: the kernel only
+         * accepts a filter from a task that cannot gain privileges. */
+        if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) < 0) {
+            perror("[child] prctl(PR_SET_NO_NEW_PRIVS)");
+            return -1;
+        }
+        rc = syscall(SYS_seccomp, SECCOMP_SET_MODE_FILTER,
+                     SECCOMP_FILTER_FLAG_TSYNC, &fprog);
+    }
+    if (rc != 0) {
+        /* A positive result is the thread TSYNC could not move over. */
+        if (rc > 0) fprintf(stderr, "[child] seccomp: TSYNC failed on %ld\n", rc);
+        else perror("[child] seccomp(SECCOMP_SET_MODE_FILTER)");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,630 @@
+// Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include "serve.h"
+#include "spec.h"
+#include "events.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <libgen.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/signalfd.h>
+
+/* One client connection: waiting for its request, then owning the
+ * container launched for it until that container is reaped. */
+typedef enum { SLOT_FREE = 0, SLOT_CONNECTED, SLOT_RUNNING } slot_state_t;
+
+typedef struct {
+    slot_state_t state;
+    int      client_fd;     // -1 once the client hung up
+    int      ctl_fd;        // Zygote channel until the exec signal; then -1
+    bool     debug;
+    bool     warm;
+    uint64_t t0_ns;         // Request receipt
+    uint64_t start_ns;
+    container_result_t result;
+} serve_slot_t;
+
+typedef struct {
+    bool enable_debug;
+    unsigned zygote_target;
+    container_zygote_t zygotes[SERVE_MAX_ZYGOTES];
+    serve_slot_t *slots;    // SERVE_MAX_CLIENTS; each embeds a
+                            // container_result_t, so heap rather than stack
+    uint64_t samples[SERVE_STATS_WINDOW];
+    uint64_t count;
+    uint64_t zygote_hits;
+    bool refill_pending;    // Replenish for refill_key once starts settle
+    container_config_t refill_key;
+} serve_state_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void send_reply(int fd, serve_reply_t *reply, serve_msg_type_t type) {
+    if (fd < 0) return;
+    reply->hdr.magic = SERVE_MAGIC;
+    reply->hdr.type = type;
+    if (send(fd, reply, sizeof(*reply), MSG_NOSIGNAL) < 0 && errno != EPIPE) {
+        perror("[serve] send");
+    }
+}
+
+static void send_error(int fd) {
+    serve_reply_t reply = {0};
+    send_reply(fd, &reply, SERVE_MSG_ERROR);
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentiles over the sample ring. */
+static void compute_stats(const serve_state_t *st, serve_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->count = st->count;
+    out->zygote_hits = st->zygote_hits;
+    size_t n = st->count < SERVE_STATS_WINDOW ? (size_t)st->count
+                                              : SERVE_STATS_WINDOW;
+    if (n == 0) return;
+
+    uint64_t sorted[SERVE_STATS_WINDOW];
+    memcpy(sorted, st->samples, n * sizeof(sorted[0]));
+    qsort(sorted, n, sizeof(sorted[0]), cmp_u64);
+    out->window = (uint32_t)n;
+    out->p50_ns = sorted[(n * 50 + 99) / 100 - 1];
+    out->p90_ns = sorted[(n * 90 + 99) / 100 - 1];
+    out->p99_ns = sorted[(n * 99 + 99) / 100 - 1];
+    out->max_ns = sorted[n - 1];
+}
+
+static void close_slot(serve_slot_t *slot) {
+    if (slot->client_fd >= 0) close(slot->client_fd);
+    if (slot->ctl_fd >= 0) close(slot->ctl_fd);
+    memset(slot, 0, sizeof(*slot));
+    slot->client_fd = -1;
+    slot->ctl_fd = -1;
+}
+
+/* After a launch, keep zygotes warm for the namespace set just used:
+ * fill empty entries, and evict another set's zygote only if none of
+ * this set is left — alternating workloads then share the pool instead
+ * of thrashing it. */
+static void replenish_zygotes(serve_state_t *st, const container_config_t *config) {
+    container_config_t tmpl = *config;
+    tmpl.enable_debug = st->enable_debug;
+
+    unsigned matching = 0;
+    for (unsigned i = 0; i < st->zygote_target; i++) {
+        if (container_zygote_matches(&st->zygotes[i], config)) matching++;
+    }
+    for (unsigned i = 0; i < st->zygote_target; i++) {
+        container_zygote_t *z = &st->zygotes[i];
+        if (z->pid > 0) {
+            if (matching > 0 || container_zygote_matches(z, config)) continue;
+            container_zygote_discard(z);
+        }
+        if (container_zygote_spawn(z, &tmpl) < 0) return;
+        matching++;
+    }
+}
+
+static void handle_run(serve_state_t *st, serve_slot_t *slot,
+                       void *spec, size_t spec_len, const int fds[3]) {
+    uint64_t t0 = now_ns();
+    container_config_t config;
+    if (spec_decode(spec, spec_len, &config) < 0) {
+        fprintf(stderr, "[serve] Malformed request\n");
+        send_error(slot->client_fd);
+        close_slot(slot);
+        return;
+    }
+
+    /* Warm: a parked zygote for this namespace set. Cold: clone one now —
+     * same launch path, just without the head start. */
+    container_zygote_t cold = { .ctl_fd = -1, .pidfd = -1 };
+    container_zygote_t *z = NULL;
+    for (unsigned i = 0; i < st->zygote_target && !z; i++) {
+        if (container_zygote_matches(&st->zygotes[i], &config)) {
+            z = &st->zygotes[i];
+        }
+    }
+    bool warm = z != NULL;
+    if (!z) {
+        if (container_zygote_spawn(&cold, &config) < 0) {
+            send_error(slot->client_fd);
+            close_slot(slot);
+            return;
+        }
+        z = &cold;
+    }
+
+    int ctl_fd = container_zygote_launch(z, &config, fds, &slot->result);
+    if (ctl_fd < 0) {
+        send_error(slot->client_fd);
+        close_slot(slot);
+        return;
+    }
+
+    slot->state = SLOT_RUNNING;
+    slot->ctl_fd = ctl_fd;
+    slot->debug = config.enable_debug;
+    slot->warm = warm;
+    slot->t0_ns = t0;
+    if (warm) st->zygote_hits++;
+    if (st->enable_debug) {
+        debug_log("[serve] PID %d launched (%s)\n", slot->result.child_pid,
+               warm ? "warm" : "cold");
+    }
+
+    /* Cloning the replacement would sit on this start's latency (a mount
+     * namespace copy alone is ~1 ms), so it waits for the exec signal. */
+    st->refill_key = config;
+    st->refill_key.program = NULL;
+    st->refill_key.argv = NULL;
+    st->refill_key.envp = NULL;
+    st->refill_key.rootfs_path = NULL;
+    st->refill_key.container_dir = NULL;
+    st->refill_key.hostname = NULL;
+    st->refill_pending = true;
+}
+
+/* First message on a connection: RUN (spec + 3 fds) or STATS. */
+static void handle_request(serve_state_t *st, serve_slot_t *slot) {
+    static uint64_t spec_buf[SPEC_MAX_SIZE / sizeof(uint64_t)];
+    serve_msg_hdr_t hdr;
+    struct iovec iov[2] = {
+        { .iov_base = &hdr,     .iov_len = sizeof(hdr) },
+        { .iov_base = spec_buf, .iov_len = sizeof(spec_buf) },
+    };
+    union {
+        char buf[CMSG_SPACE(3 * sizeof(int))];
+        struct cmsghdr align;
+    } cmsg_buf;
+    struct msghdr msg = {
+        .msg_iov = iov, .msg_iovlen = 2,
+        .msg_control = cmsg_buf.buf, .msg_controllen = sizeof(cmsg_buf.buf),
+    };
+    ssize_t n = recvmsg(slot->client_fd, &msg, MSG_CMSG_CLOEXEC | MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) return;
+
+    int fds[3] = {-1, -1, -1};
+    size_t nfds = 0;
+    struct cmsghdr *cm = n > 0 ? CMSG_FIRSTHDR(&msg) : NULL;
+    if (cm && cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS) {
+        nfds = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        if (nfds > 3) nfds = 3;
+        memcpy(fds, CMSG_DATA(cm), nfds * sizeof(int));
+    }
+
+    if (n < (ssize_t)sizeof(hdr) || hdr.magic != SERVE_MAGIC ||
+        (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))) {
+        if (n > 0) send_error(slot->client_fd);
+        close_slot(slot);
+    } else if (hdr.type == SERVE_MSG_STATS) {
+        serve_reply_t reply = {0};
+        compute_stats(st, &reply.stats);
+        send_reply(slot->client_fd, &reply, SERVE_MSG_STATS_REPLY);
+        close_slot(slot);
+    } else if (hdr.type == SERVE_MSG_RUN && nfds == 3) {
+        handle_run(st, slot, spec_buf, (size_t)n - sizeof(hdr), fds);
+    } else {
+        send_error(slot->client_fd);
+        close_slot(slot);
+    }
+
+    /* The zygote holds its own copies now. */
+    for (size_t i = 0; i < nfds; i++) close(fds[i]);
+}
+
+/* Zygote closed its end of the channel: the container is at execve(). */
+static void handle_started(serve_state_t *st, serve_slot_t *slot) {
+    char c;
+    if (read(slot->ctl_fd, &c, 1) > 0) return;
+    close(slot->ctl_fd);
+    slot->ctl_fd = -1;
+
+    uint64_t elapsed = now_ns() - slot->t0_ns;
+    st->samples[st->count % SERVE_STATS_WINDOW] = elapsed;
+    st->count++;
+    slot->start_ns = elapsed;
+    event_emit(EVENT_STARTED, slot->result.ctx.id, slot->result.child_pid, 0,
+               elapsed);
+
+    serve_reply_t reply = { .start_ns = elapsed, .warm = slot->warm };
+    send_reply(slot->client_fd, &reply, SERVE_MSG_STARTED);
+}
+
+static void reap_slot(serve_slot_t *slot, int status) {
+    container_reap(&slot->result, status, slot->debug);
+    container_cleanup(&slot->result);
+
+    serve_reply_t reply = {
+        .exit_status     = slot->result.exit_status,
+        .signal          = slot->result.signal,
+        .exited_normally = slot->result.exited_normally,
+        .warm            = slot->warm,
+        .start_ns        = slot->start_ns,
+    };
+    send_reply(slot->client_fd, &reply, SERVE_MSG_EXITED);
+    close_slot(slot);
+}
+
+static void reap_children(serve_state_t *st) {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        bool found = false;
+        for (int i = 0; i < SERVE_MAX_CLIENTS && !found; i++) {
+            serve_slot_t *slot = &st->slots[i];
+            if (slot->state == SLOT_RUNNING && slot->result.child_pid == pid) {
+                reap_slot(slot, status);
+                found = true;
+            }
+        }
+        for (unsigned i = 0; i < st->zygote_target && !found; i++) {
+            if (st->zygotes[i].pid == pid) {
+                st->zygotes[i].pid = 0;   // Already reaped
+                container_zygote_discard(&st->zygotes[i]);
+                found = true;
+            }
+        }
+    }
+}
+
+static void accept_client(serve_state_t *st, int listen_fd) {
+    int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0) return;
+
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0 ||
+        cred.uid != geteuid()) {
+        close(fd);
+        return;
+    }
+    for (int i = 0; i < SERVE_MAX_CLIENTS; i++) {
+        if (st->slots[i].state == SLOT_FREE) {
+            st->slots[i].state = SLOT_CONNECTED;
+            st->slots[i].client_fd = fd;
+            st->slots[i].ctl_fd = -1;
+            return;
+        }
+    }
+    send_error(fd);
+    close(fd);
+}
+
+static int open_listen_socket(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "[serve] Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", path);
+    if (mkdir(dirname(dir), 0755) < 0 && errno != EEXIST) {
+        perror("[serve] mkdir");
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("[serve] socket");
+        return -1;
+    }
+    /* A socket file nobody answers on is left over from a dead daemon. */
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+        fprintf(stderr, "[serve] A daemon is already listening on %s\n", path);
+        close(fd);
+        return -1;
+    }
+    unlink(path);
+
+    mode_t old = umask(077);
+    int rc = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old);
+    if (rc < 0 || listen(fd, 64) < 0) {
+        perror("[serve] bind/listen");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int serve_run(const serve_config_t *config) {
+    const char *path = config && config->socket_path ? config->socket_path
+                                                     : SERVE_SOCKET_PATH;
+    serve_state_t *st = calloc(1, sizeof(*st));
+    if (!st || !(st->slots = calloc(SERVE_MAX_CLIENTS, sizeof(serve_slot_t)))) {
+        perror("calloc");
+        free(st);
+        return -1;
+    }
+    st->enable_debug = config && config->enable_debug;
+    st->zygote_target = config ? config->zygotes : 0;
+    if (st->zygote_target > SERVE_MAX_ZYGOTES) st->zygote_target = SERVE_MAX_ZYGOTES;
+    for (unsigned i = 0; i < SERVE_MAX_ZYGOTES; i++) {
+        st->zygotes[i].ctl_fd = -1;
+        st->zygotes[i].pidfd = -1;
+    }
+    for (int i = 0; i < SERVE_MAX_CLIENTS; i++) {
+        st->slots[i].client_fd = -1;
+        st->slots[i].ctl_fd = -1;
+    }
+
+    int listen_fd = open_listen_socket(path);
+    if (listen_fd < 0) {
+        free(st->slots);
+        free(st);
+        return -1;
+    }
+    event_ring_t *ring = NULL;
+    if (config && config->events_path) {
+        ring = event_ring_create(config->events_path, 0);
+        if (!ring) {
+            fprintf(stderr, "[serve] %s: %s\n", config->events_path,
+                    strerror(errno));
+            close(listen_fd);
+            unlink(path);
+            free(st->slots);
+            free(st);
+            return -1;
+        }
+        events_attach(ring);
+    }
+
+    /* Signals arrive through the poll loop; zygotes unblock them again
+     * before exec (zygote_receive). */
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    int sig_fd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+    if (sig_fd < 0) {
+        perror("[serve] signalfd");
+        events_attach(NULL);
+        event_ring_close(ring);
+        close(listen_fd);
+        unlink(path);
+        free(st->slots);
+        free(st);
+        return -1;
+    }
+
+    if (st->enable_debug) {
+        debug_log("[serve] Listening on %s (%u zygotes)\n", path, st->zygote_target);
+        debug_flush();
+    }
+
+    /* poll set: [0] signals, [1] listener, then per slot client and ctl
+     * fds; owner[] maps entries back to slots. */
+    struct pollfd pfds[2 + 2 * SERVE_MAX_CLIENTS];
+    int owner[2 + 2 * SERVE_MAX_CLIENTS];
+    bool running = true;
+    while (running) {
+        nfds_t n = 0;
+        pfds[n++] = (struct pollfd){ .fd = sig_fd, .events = POLLIN };
+        pfds[n++] = (struct pollfd){ .fd = listen_fd, .events = POLLIN };
+        for (int i = 0; i < SERVE_MAX_CLIENTS; i++) {
+            serve_slot_t *slot = &st->slots[i];
+            if (slot->state == SLOT_FREE) continue;
+            if (slot->client_fd >= 0) {
+                owner[n] = i;
+                pfds[n++] = (struct pollfd){ .fd = slot->client_fd, .events = POLLIN };
+            }
+            if (slot->ctl_fd >= 0) {
+                owner[n] = i;
+                pfds[n++] = (struct pollfd){ .fd = slot->ctl_fd, .events = POLLIN };
+            }
+        }
+
+        if (poll(pfds, n, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("[serve] poll");
+            break;
+        }
+
+        /* Slots before signals: a short-lived container's exec signal and
+         * SIGCHLD often arrive together, and the start must be recorded
+         * before the reap closes the channel. */
+        for (nfds_t k = 2; k < n; k++) {
+            if (!pfds[k].revents) continue;
+            serve_slot_t *slot = &st->slots[owner[k]];
+            if (pfds[k].fd == slot->ctl_fd) {
+                handle_started(st, slot);
+            } else if (pfds[k].fd == slot->client_fd) {
+                if (slot->state == SLOT_CONNECTED) {
+                    handle_request(st, slot);
+                } else {
+                    /* Anything but a hangup is a protocol violation;
+                     * either way the container goes. */
+                    char c;
+                    if (recv(slot->client_fd, &c, 1, MSG_DONTWAIT) < 0 &&
+                        errno == EAGAIN) continue;
+                    close(slot->client_fd);
+                    slot->client_fd = -1;
+                    container_signal(&slot->result, SIGKILL);
+                }
+            }
+        }
+        if (pfds[0].revents & POLLIN) {
+            struct signalfd_siginfo si;
+            while (read(sig_fd, &si, sizeof(si)) == sizeof(si)) {
+                if (si.ssi_signo != SIGCHLD) running = false;
+            }
+            reap_children(st);
+        }
+        if (pfds[1].revents & POLLIN) accept_client(st, listen_fd);
+
+        if (st->refill_pending) {
+            bool starting = false;
+            for (int i = 0; i < SERVE_MAX_CLIENTS && !starting; i++) {
+                starting = st->slots[i].ctl_fd >= 0;
+            }
+            if (!starting) {
+                replenish_zygotes(st, &st->refill_key);
+                st->refill_pending = false;
+            }
+        }
+        debug_flush();
+    }
+
+    if (st->enable_debug) debug_log("[serve] Shutting down\n");
+    for (int i = 0; i < SERVE_MAX_CLIENTS; i++) {
+        serve_slot_t *slot = &st->slots[i];
+        if (slot->state == SLOT_RUNNING) {
+            int status = 0;
+            container_signal(&slot->result, SIGKILL);
+            waitpid(slot->result.child_pid, &status, 0);
+            reap_slot(slot, status);
+        } else if (slot->state == SLOT_CONNECTED) {
+            close_slot(slot);
+        }
+    }
+    for (unsigned i = 0; i < st->zygote_target; i++) {
+        container_zygote_discard(&st->zygotes[i]);
+    }
+    close(sig_fd);
+    close(listen_fd);
+    unlink(path);
+    debug_flush();
+    events_attach(NULL);
+    event_ring_close(ring);
+    sigprocmask(SIG_UNBLOCK, &mask, NULL);
+    free(st->slots);
+    free(st);
+    return 0;
+}
+
+static int serve_connect(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (!path) path = SERVE_SOCKET_PATH;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+/* Read replies until one of type want (or ERROR / hangup). */
+static int await_reply(int fd, serve_msg_type_t want, serve_reply_t *reply) {
+    for (;;) {
+        ssize_t n = recv(fd, reply, sizeof(*reply), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n != (ssize_t)sizeof(*reply) || reply->hdr.magic != SERVE_MAGIC ||
+            reply->hdr.type == SERVE_MSG_ERROR) {
+            return -1;
+        }
+        if (reply->hdr.type == want) return 0;
+    }
+}
+
+int serve_client_exec(const char *socket_path, const container_config_t *config,
+                      serve_reply_t *reply) {
+    if (!config || !reply) return -1;
+    uint64_t *spec = malloc(SPEC_MAX_SIZE);
+    size_t spec_len = spec ? spec_encode(config, spec, SPEC_MAX_SIZE) : 0;
+    if (spec_len == 0) {
+        fprintf(stderr, "[serve] Container spec too large\n");
+        free(spec);
+        return -1;
+    }
+    int rc = serve_client_exec_spec(socket_path, spec, spec_len, reply);
+    free(spec);
+    return rc;
+}
+
+int serve_client_exec_spec(const char *socket_path, const void *spec,
+                           size_t spec_len, serve_reply_t *reply) {
+    if (!spec || !reply) return -1;
+    int fd = serve_connect(socket_path);
+    if (fd < 0) {
+        fprintf(stderr, "[serve] connect(%s): %s\n",
+                socket_path ? socket_path : SERVE_SOCKET_PATH, strerror(errno));
+        return -1;
+    }
+
+    serve_msg_hdr_t hdr = { .magic = SERVE_MAGIC, .type = SERVE_MSG_RUN };
+    int fds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    struct iovec iov[2] = {
+        { .iov_base = &hdr, .iov_len = sizeof(hdr) },
+        { .iov_base = (void *)spec, .iov_len = spec_len },
+    };
+    union {
+        char buf[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } cmsg_buf;
+    memset(&cmsg_buf, 0, sizeof(cmsg_buf));
+    struct msghdr msg = {
+        .msg_iov = iov, .msg_iovlen = 2,
+        .msg_control = cmsg_buf.buf, .msg_controllen = sizeof(cmsg_buf.buf),
+    };
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+
+    /* Flush before the container starts writing to the same fds. */
+    fflush(NULL);
+    debug_flush();
+    int rc = -1;
+    if (sendmsg(fd, &msg, MSG_NOSIGNAL) < 0) {
+        perror("[serve] sendmsg");
+    } else if (await_reply(fd, SERVE_MSG_EXITED, reply) < 0) {
+        fprintf(stderr, "[serve] Daemon failed to run the container\n");
+    } else {
+        rc = 0;
+    }
+    close(fd);
+    return rc;
+}
+
+int serve_client_stats(const char *socket_path, serve_stats_t *stats) {
+    if (!stats) return -1;
+    int fd = serve_connect(socket_path);
+    if (fd < 0) {
+        fprintf(stderr, "[serve] connect(%s): %s\n",
+                socket_path ? socket_path : SERVE_SOCKET_PATH, strerror(errno));
+        return -1;
+    }
+
+    serve_msg_hdr_t hdr = { .magic = SERVE_MAGIC, .type = SERVE_MSG_STATS };
+    serve_reply_t reply;
+    int rc = -1;
+    if (send(fd, &hdr, sizeof(hdr), MSG_NOSIGNAL) == (ssize_t)sizeof(hdr) &&
+        await_reply(fd, SERVE_MSG_STATS_REPLY, &reply) == 0) {
+        *stats = reply.stats;
+        rc = 0;
+    }
+    close(fd);
+    return rc;
+}
@@ -0,0 +1,287 @@
+// Note: _GNU_SOURCE is provided by the Makefile via -D_GNU_SOURCE.
+// Do NOT redefine it here (Error #8 from decisions.md).
+#include "spec.h"
+#include "net_pod.h"  // net_pod_name_valid
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SPEC_ALIGN(n) (((n) + 7u) & ~(size_t)7u)
+
+/* Append a NUL-terminated string; returns its offset, 0 for NULL, or
+ * (uint32_t)-1 when it does not fit. */
+static uint32_t put_str(char *base, size_t *used, size_t size,
+                        const char *s) {
+    if (!s) return 0;
+    size_t n = strlen(s) + 1;
+    if (*used + n > size) return (uint32_t)-1;
+    memcpy(base + *used, s, n);
+    uint32_t off = (uint32_t)*used;
+    *used += n;
+    return off;
+}
+
+static size_t count_vec(char *const *vec) {
+    size_t n = 0;
+    if (vec) while (vec[n]) n++;
+    return n;
+}
+
+size_t spec_encode(const container_config_t *config, void *buf, size_t size) {
+    if (!config || !config->program || !config->argv || !buf) {
+        errno = EINVAL;
+        return 0;
+    }
+    if (size > SPEC_MAX_SIZE) size = SPEC_MAX_SIZE;
+
+    char *base = buf;
+    spec_header_t *hdr = buf;
+    size_t argc = count_vec(config->argv);
+    size_t envc = count_vec(config->envp);
+    size_t used = SPEC_ALIGN(sizeof(*hdr));
+    size_t argv_off = used;
+    used += (argc + 1) * sizeof(uintptr_t);
+    size_t envp_off = config->envp ? used : 0;
+    if (config->envp) used += (envc + 1) * sizeof(uintptr_t);
+    if (used > size) {
+        errno = E2BIG;
+        return 0;
+    }
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic   = SPEC_MAGIC;
+    hdr->version = SPEC_VERSION;
+    hdr->argc    = (uint32_t)argc;
+    hdr->envc    = (uint32_t)envc;
+    hdr->argv    = (uint32_t)argv_off;
+    hdr->envp    = (uint32_t)envp_off;
+
+    hdr->config = *config;
+    hdr->config.program       = NULL;
+    hdr->config.argv          = NULL;
+    hdr->config.envp          = NULL;
+    hdr->config.rootfs_path   = NULL;
+    hdr->config.container_dir = NULL;
+    hdr->config.hostname      = NULL;
+    hdr->config.restore_dir   = NULL;
+    hdr->config.seccomp_profile = NULL;
+
+    uint32_t fail = (uint32_t)-1;
+    if ((hdr->program       = put_str(base, &used, size, config->program)) == fail ||
+        (hdr->rootfs_path   = put_str(base, &used, size, config->rootfs_path)) == fail ||
+        (hdr->container_dir = put_str(base, &used, size, config->container_dir)) == fail ||
+        (hdr->hostname      = put_str(base, &used, size, config->hostname)) == fail ||
+        (hdr->seccomp_profile = put_str(base, &used, size, config->seccomp_profile)) == fail) {
+        errno = E2BIG;
+        return 0;
+    }
+
+    uintptr_t *slots = (uintptr_t *)(base + argv_off);
+    for (size_t i = 0; i < argc; i++) {
+        if ((slots[i] = put_str(base, &used, size, config->argv[i])) == fail) {
+            errno = E2BIG;
+            return 0;
+        }
+    }
+    slots[argc] = 0;
+
+    if (config->envp) {
+        slots = (uintptr_t *)(base + envp_off);
+        for (size_t i = 0; i < envc; i++) {
+            if ((slots[i] = put_str(base, &used, size, config->envp[i])) == fail) {
+                errno = E2BIG;
+                return 0;
+            }
+        }
+        slots[envc] = 0;
+    }
+
+    hdr->size = (uint32_t)used;
+    return used;
+}
+
+/* A valid string offset points past the header and slot tables, inside
+ * the blob, and its string is terminated before the end of the blob. */
+static int check_str(const char *base, size_t len, size_t strings_start,
+                     uintptr_t off, bool nullable) {
+    if (off == 0) return nullable ? 0 : -1;
+    if (off < strings_start || off >= len) return -1;
+    return memchr(base + off, '\0', len - off) ? 0 : -1;
+}
+
+static int fix_str(char *base, size_t len, size_t start, uint32_t off,
+                   bool nullable, const char **out) {
+    if (check_str(base, len, start, off, nullable) < 0) return -1;
+    *out = off ? base + off : NULL;
+    return 0;
+}
+
+/* Validate every slot first, then rewrite — a bad entry halfway through
+ * must not leave a half-pointer, half-offset table behind. */
+static int fix_vec(char *base, size_t len, size_t start, uint32_t table,
+                   uint32_t count, char *const **out) {
+    uintptr_t *slots = (uintptr_t *)(base + table);
+    for (uint32_t i = 0; i < count; i++) {
+        if (check_str(base, len, start, slots[i], false) < 0) return -1;
+    }
+    if (slots[count] != 0) return -1;
+    for (uint32_t i = 0; i < count; i++) {
+        slots[i] = (uintptr_t)(base + slots[i]);
+    }
+    *out = (char *const *)slots;
+    return 0;
+}
+
+int spec_decode(void *buf, size_t len, container_config_t *config) {
+    char *base = buf;
+    spec_header_t *hdr = buf;
+    if (!buf || !config || ((uintptr_t)buf & 7u) || len < sizeof(*hdr) ||
+        hdr->magic != SPEC_MAGIC || hdr->version != SPEC_VERSION ||
+        hdr->size > len || hdr->size > SPEC_MAX_SIZE) {
+        errno = EINVAL;
+        return -1;
+    }
+    len = hdr->size;
+
+    /* The slot tables sit between the header and the strings, at the
+     * offsets spec_encode() uses; anything else is malformed. */
+    size_t argv_off = SPEC_ALIGN(sizeof(*hdr));
+    size_t strings = argv_off + ((size_t)hdr->argc + 1) * sizeof(uintptr_t);
+    size_t envp_off = 0;
+    if (hdr->envp) {
+        envp_off = strings;
+        strings += ((size_t)hdr->envc + 1) * sizeof(uintptr_t);
+    }
+    if (hdr->argc == 0 || hdr->argc > SPEC_MAX_SIZE ||
+        hdr->envc > SPEC_MAX_SIZE || strings > len ||
+        hdr->argv != argv_off || hdr->envp != envp_off) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (hdr->config.veth.publish_count > NET_PUBLISH_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    container_config_t out = hdr->config;
+    if (fix_str(base, len, strings, hdr->program, false, &out.program) < 0 ||
+        fix_str(base, len, strings, hdr->rootfs_path, true, &out.rootfs_path) < 0 ||
+        fix_str(base, len, strings, hdr->container_dir, true, &out.container_dir) < 0 ||
+        fix_str(base, len, strings, hdr->hostname, true, &out.hostname) < 0 ||
+        fix_str(base, len, strings, hdr->seccomp_profile, true,
+                &out.seccomp_profile) < 0 ||
+        fix_vec(base, len, strings, hdr->argv, hdr->argc, &out.argv) < 0 ||
+        (hdr->envp &&
+         fix_vec(base, len, strings, hdr->envp, hdr->envc, &out.envp) < 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!hdr->envp) out.envp = NULL;
+    out.restore_dir = NULL;   // Never encoded: whatever is here is the peer's
+
+    /* Fixed-size strings inside the scalar part come from the peer too. */
+    out.veth.host_ip[sizeof(out.veth.host_ip) - 1] = '\0';
+    out.veth.container_ip[sizeof(out.veth.container_ip) - 1] = '\0';
+    out.veth.netmask[sizeof(out.veth.netmask) - 1] = '\0';
+    for (unsigned i = 0; i < out.veth.publish_count; i++) {
+        char *ip = out.veth.publish[i].host_ip;
+        ip[INET_ADDRSTRLEN - 1] = '\0';
+    }
+    /* The pod name becomes state/lock paths: held to the --pod rules. */
+    if (!memchr(out.veth.pod, '\0', sizeof(out.veth.pod)) ||
+        (out.veth.pod[0] && !net_pod_name_valid(out.veth.pod))) {
+        errno = EINVAL;
+        return -1;
+    }
+    /* The bridge name reaches if_nametoindex(), lease paths and iptables
+     * argv: held to the --net-bridge rule (fewer than IFNAMSIZ chars). */
+    if (!memchr(out.veth.bridge, '\0', sizeof(out.veth.bridge))) {
+        errno = EINVAL;
+        return -1;
+    }
+    cgroup_limits_t *lim = &out.cgroup_limits;
+    lim->cpuset_cpus[sizeof(lim->cpuset_cpus) - 1] = '\0';
+    lim->cpuset_mems[sizeof(lim->cpuset_mems) - 1] = '\0';
+    lim->io_max[sizeof(lim->io_max) - 1] = '\0';
+
+    /* Mark the blob consumed so a second decode fails instead of
+     * treating pointers as offsets. */
+    hdr->magic = 0;
+    *config = out;
+    return 0;
+}
+
+int spec_save(const container_config_t *config, const char *path) {
+    uint64_t *blob = malloc(SPEC_MAX_SIZE);
+    if (!blob) return -1;
+    size_t len = spec_encode(config, blob, SPEC_MAX_SIZE);
+    if (len == 0) {
+        free(blob);
+        return -1;
+    }
+
+    char tmp[PATH_MAX];
+    if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path) >= (int)sizeof(tmp)) {
+        free(blob);
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = mkostemp(tmp, O_CLOEXEC);
+    if (fd < 0) {
+        free(blob);
+        return -1;
+    }
+    ssize_t n = write(fd, blob, len);
+    int err = n == (ssize_t)len ? 0 : n < 0 ? errno : EIO;
+    free(blob);
+    if (!err && fchmod(fd, 0644) < 0) err = errno;
+    if (close(fd) < 0 && !err) err = errno;
+    if (!err && rename(tmp, path) < 0) err = errno;
+    if (err) {
+        unlink(tmp);
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+void *spec_map(const char *path, size_t *len) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(spec_header_t) ||
+        st.st_size > SPEC_MAX_SIZE) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    const spec_header_t *hdr = map;
+    if (hdr->magic != SPEC_MAGIC || hdr->version != SPEC_VERSION ||
+        hdr->size != size) {
+        munmap(map, size);
+        errno = EINVAL;
+        return NULL;
+    }
+    *len = hdr->size;
+    return map;
+}
+
+void spec_unmap(void *map, size_t len) {
+    if (map) munmap(map, len);
+}
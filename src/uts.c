@@ -1,9 +1,11 @@
 #include "uts.h"
+#include "fs_batch.h"
+#include "events.h"
 #include <stdio.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
-#include <fcntl.h>         // open(), O_WRONLY for /proc/<pid>/{uid_map,gid_map,setgroups}
+#include <fcntl.h>         // AT_FDCWD for the /proc/<pid>/{uid_map,gid_map,setgroups} batch
 
 /**
  * Setup hostname inside UTS namespace.
@@ -16,7 +18,7 @@ int setup_uts(const char *hostname, bool enable_debug) {
         }
 
         if (enable_debug) {
-            printf("[child] Set hostname: %s\n", hostname);
+            debug_log("[child] Set hostname: %s\n", hostname);
         }
     }
 
@@ -27,75 +29,45 @@ int setup_uts(const char *hostname, bool enable_debug) {
  * Setup UID/GID mapping for user namespace.
  *
  * Called from the PARENT process after clone(). Writes to
- * /proc/<child_pid>/setgroups, uid_map, and gid_map.
+ * /proc/<child_pid>/setgroups, uid_map, and gid_map as one batch
+ * (fs_batch.h), each write ordered after the previous one: setgroups
+ * must read "deny" before an unprivileged gid_map write is allowed.
  */
 int setup_user_namespace_mapping(pid_t child_pid, const user_ns_mapping_t *config) {
+    static const char *const files[] = { "setgroups", "uid_map", "gid_map" };
     char path[256];
-    char mapping[256];
-    int fd;
+    char uid_mapping[256], gid_mapping[256];
 
-    // Step 1: Disable setgroups (required before gid_map for unprivileged users)
-    snprintf(path, sizeof(path), "/proc/%d/setgroups", child_pid);
-    fd = open(path, O_WRONLY);
-    if (fd < 0) {
-        perror("open(setgroups)");
-        return -1;
-    }
-    if (write(fd, "deny", 4) < 0) {
-        perror("write(setgroups)");
-        close(fd);
-        return -1;
-    }
-    close(fd);
-
-    if (config->enable_debug) {
-        printf("[parent] Disabled setgroups for PID %d\n", child_pid);
-    }
-
-    // Step 2: Write UID map
-    snprintf(path, sizeof(path), "/proc/%d/uid_map", child_pid);
-    snprintf(mapping, sizeof(mapping), "%u %u %zu",
+    snprintf(uid_mapping, sizeof(uid_mapping), "%u %u %zu",
              config->uid_map_inside, config->uid_map_outside,
              config->uid_map_range);
-
-    fd = open(path, O_WRONLY);
-    if (fd < 0) {
-        perror("open(uid_map)");
-        return -1;
-    }
-    if (write(fd, mapping, strlen(mapping)) < 0) {
-        perror("write(uid_map)");
-        close(fd);
-        return -1;
-    }
-    close(fd);
-
-    if (config->enable_debug) {
-        printf("[parent] UID map: %s\n", mapping);
-    }
-
-    // Step 3: Write GID map
-    snprintf(path, sizeof(path), "/proc/%d/gid_map", child_pid);
-    snprintf(mapping, sizeof(mapping), "%u %u %zu",
+    snprintf(gid_mapping, sizeof(gid_mapping), "%u %u %zu",
              config->gid_map_inside, config->gid_map_outside,
              config->gid_map_range);
+    const char *contents[] = { "deny", uid_mapping, gid_mapping };
 
-    fd = open(path, O_WRONLY);
-    if (fd < 0) {
-        perror("open(gid_map)");
-        return -1;
+    fs_batch_t batch;
+    fs_batch_init(&batch);
+    for (int i = 0; i < 3; i++) {
+        snprintf(path, sizeof(path), "/proc/%d/%s", child_pid, files[i]);
+        fs_batch_write_file(&batch, AT_FDCWD, path, contents[i],
+                            i ? FS_OP_AFTER_PREV : 0);
     }
-    if (write(fd, mapping, strlen(mapping)) < 0) {
-        perror("write(gid_map)");
-        close(fd);
+    if (fs_batch_run(&batch, config->enable_debug) < 0) {
+        for (unsigned i = 0; i < batch.count; i++) {
+            if (batch.ops[i].res < 0) {
+                fs_batch_perror(&batch, i, files[i]);
+                break;   // Later writes fail for the same reason
+            }
+        }
         return -1;
     }
-    close(fd);
 
     if (config->enable_debug) {
-        printf("[parent] GID map: %s\n", mapping);
+        debug_log("[parent] Disabled setgroups for PID %d\n", child_pid);
+        debug_log("[parent] UID map: %s\n", uid_mapping);
+        debug_log("[parent] GID map: %s\n", gid_mapping);
     }
 
     return 0;
 }
-
@@ -0,0 +1,260 @@
+// Note: _GNU_SOURCE is provided by the Makefile.
+// Start/stop throughput benchmark. For each isolation feature, K launcher
+// processes each run N container_exec() calls back to back; one JSON
+// object per (case, K) goes to stdout:
+//
+//   {"case":"pid","launchers":4,"n":200,"ok":200,"failures":0,
+//    "wall_s":0.41,"containers_per_s":487.8,
+//    "latency_us":{"p50":..,"p90":..,"p99":..,"max":..},
+//    "start_us":{"p50":..,"p99":..},
+//    "peak_rss_kb":..,"child_peak_rss_kb":..}
+//
+// latency_us is one whole container_exec() (setup, run, reap, teardown);
+// start_us is its request -> execve part (container_timings_t). peak_rss_kb
+// is the largest launcher's own peak, child_peak_rss_kb the largest
+// container's. Run via `make bench` (BENCH_N, BENCH_K).
+#include "core.h"
+#include "env.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define ROOTFS "./rootfs"
+
+typedef struct {
+    const char *name;
+    void (*apply)(container_config_t *cfg, int launcher);
+} bench_case_t;
+
+/* Per-launcher results, in a MAP_SHARED page the parent reads back. */
+typedef struct {
+    int  ok;
+    int  failures;
+    long peak_rss_kb;
+    long child_peak_rss_kb;
+} launcher_stats_t;
+
+static void bare(container_config_t *c, int l)     { (void)c; (void)l; }
+static void with_pid(container_config_t *c, int l) {
+    (void)l;
+    c->enable_pid_namespace = true;
+}
+static void with_overlay(container_config_t *c, int l) {
+    with_pid(c, l);
+    c->enable_mount_namespace = true;
+    c->enable_overlay = true;
+    c->rootfs_path = ROOTFS;
+}
+static void with_cgroup(container_config_t *c, int l) {
+    with_pid(c, l);
+    c->enable_cgroup = true;
+    c->cgroup_limits.pid_limit = 64;
+}
+/* One /24 per launcher: concurrent containers must not share a subnet. */
+static void with_net(container_config_t *c, int l) {
+    with_pid(c, l);
+    c->enable_network = true;
+    snprintf(c->veth.host_ip, sizeof(c->veth.host_ip), "10.201.%d.1", l);
+    snprintf(c->veth.container_ip, sizeof(c->veth.container_ip),
+             "10.201.%d.2", l);
+    strcpy(c->veth.netmask, "24");
+    c->veth.enable_nat = false;
+}
+static void with_user(container_config_t *c, int l) {
+    with_pid(c, l);
+    c->enable_user_namespace = true;
+}
+
+static const bench_case_t cases[] = {
+    { "bare",        bare },
+    { "pid",         with_pid },
+    { "pid+overlay", with_overlay },
+    { "pid+cgroup",  with_cgroup },
+    { "pid+net",     with_net },
+    { "pid+user",    with_user },
+};
+
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of a sorted array, in microseconds. */
+static double pct_us(const uint64_t *sorted, int n, int p) {
+    int idx = (n * p + 99) / 100 - 1;
+    return sorted[idx < 0 ? 0 : idx] / 1000.0;
+}
+
+/* One launcher: n sequential starts. A failed start records 0. */
+static void launcher(const bench_case_t *bc, int id, int n, char **env,
+                     uint64_t *lat, uint64_t *start, launcher_stats_t *st) {
+    static char *argv[] = {"/bin/sh", "-c", "exit 0", NULL};
+    for (int i = 0; i < n; i++) {
+        container_config_t cfg = {
+            .program = "/bin/sh",
+            .argv = argv,
+            .envp = env,
+            .uid_map_inside = 0,
+            .uid_map_outside = getuid(),
+            .uid_map_range = 1,
+            .gid_map_inside = 0,
+            .gid_map_outside = getgid(),
+            .gid_map_range = 1,
+            .enable_timings = true,
+        };
+        bc->apply(&cfg, id);
+
+        uint64_t t0 = mono_ns();
+        container_result_t r = container_exec(&cfg);
+        container_cleanup(&r);
+        uint64_t t1 = mono_ns();
+
+        if (r.child_pid < 0 || !r.exited_normally || r.exit_status != 0) {
+            st->failures++;
+            continue;
+        }
+        lat[i] = t1 - t0;
+        if (r.timings.valid && r.timings.exec_ns > r.timings.start_ns) {
+            start[i] = r.timings.exec_ns - r.timings.start_ns;
+        }
+        st->ok++;
+    }
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    st->peak_rss_kb = ru.ru_maxrss;
+    getrusage(RUSAGE_CHILDREN, &ru);
+    st->child_peak_rss_kb = ru.ru_maxrss;
+}
+
+/* Drop the zero (failed) entries and sort what is left. */
+static int compact_sorted(uint64_t *v, int n) {
+    int m = 0;
+    for (int i = 0; i < n; i++) {
+        if (v[i] != 0) v[m++] = v[i];
+    }
+    qsort(v, m, sizeof(v[0]), cmp_u64);
+    return m;
+}
+
+static int run_case(const bench_case_t *bc, int k, int n, char **env) {
+    size_t total = (size_t)k * n;
+    size_t bytes = total * 2 * sizeof(uint64_t) + k * sizeof(launcher_stats_t);
+    void *mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    uint64_t *lat = mem;
+    uint64_t *start = lat + total;
+    launcher_stats_t *st = (launcher_stats_t *)(start + total);
+
+    fflush(stdout);
+    uint64_t t0 = mono_ns();
+    for (int l = 0; l < k; l++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            break;
+        }
+        if (pid == 0) {
+            launcher(bc, l, n, env, lat + (size_t)l * n,
+                     start + (size_t)l * n, &st[l]);
+            _exit(0);
+        }
+    }
+    while (wait(NULL) > 0) {}
+    double wall = (mono_ns() - t0) / 1e9;
+
+    int ok = 0, failures = 0;
+    long rss = 0, child_rss = 0;
+    for (int l = 0; l < k; l++) {
+        ok += st[l].ok;
+        failures += st[l].failures;
+        if (st[l].peak_rss_kb > rss) rss = st[l].peak_rss_kb;
+        if (st[l].child_peak_rss_kb > child_rss) {
+            child_rss = st[l].child_peak_rss_kb;
+        }
+    }
+
+    printf("{\"case\":\"%s\",\"launchers\":%d,\"n\":%d,\"ok\":%d,"
+           "\"failures\":%d", bc->name, k, n, ok, failures);
+    if (ok == 0) {
+        printf(",\"skipped\":true}\n");
+        munmap(mem, bytes);
+        return 0;
+    }
+
+    int nl = compact_sorted(lat, (int)total);
+    int ns = compact_sorted(start, (int)total);
+    printf(",\"wall_s\":%.3f,\"containers_per_s\":%.1f", wall, ok / wall);
+    printf(",\"latency_us\":{\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,"
+           "\"max\":%.1f}", pct_us(lat, nl, 50), pct_us(lat, nl, 90),
+           pct_us(lat, nl, 99), lat[nl - 1] / 1000.0);
+    if (ns > 0) {
+        printf(",\"start_us\":{\"p50\":%.1f,\"p99\":%.1f}",
+               pct_us(start, ns, 50), pct_us(start, ns, 99));
+    }
+    printf(",\"peak_rss_kb\":%ld,\"child_peak_rss_kb\":%ld}\n",
+           rss, child_rss);
+    fflush(stdout);
+    munmap(mem, bytes);
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-n starts] [-k launchers] [case...]\n"
+                    "Cases:", prog);
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        fprintf(stderr, " %s", cases[i].name);
+    }
+    fprintf(stderr, "\nEach case runs with 1 launcher, then with k (if k > 1).\n");
+}
+
+int main(int argc, char *argv[]) {
+    int n = 100, k = 4, opt;
+    while ((opt = getopt(argc, argv, "n:k:h")) != -1) {
+        switch (opt) {
+        case 'n': n = atoi(optarg); break;
+        case 'k': k = atoi(optarg); break;
+        default:  usage(argv[0]); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (n < 1 || k < 1 || k > 250) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (geteuid() != 0) {
+        fprintf(stderr, "bench requires root\n");
+        return 1;
+    }
+
+    char **env = build_container_env(NULL, false);
+    if (!env) return 1;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        if (optind < argc) {
+            bool wanted = false;
+            for (int a = optind; a < argc; a++) {
+                if (strcmp(argv[a], cases[i].name) == 0) wanted = true;
+            }
+            if (!wanted) continue;
+        }
+        run_case(&cases[i], 1, n, env);
+        if (k > 1) run_case(&cases[i], k, n, env);
+    }
+    free(env);
+    return 0;
+}
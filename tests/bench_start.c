@@ -0,0 +1,159 @@
+// Note: _GNU_SOURCE is provided by the Makefile.
+// Start-latency benchmark: N container_exec() runs per flag combination
+// with enable_timings, then p50/p99 per phase. Run via `make bench_start`
+// (BENCH_N=<iterations>).
+#include "core.h"
+#include "env.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ROOTFS "./rootfs"
+
+typedef struct {
+    const char *name;
+    void (*apply)(container_config_t *cfg);
+} bench_case_t;
+
+static void with_pid(container_config_t *c)    { c->enable_pid_namespace = true; }
+static void with_rootfs(container_config_t *c) {
+    with_pid(c);
+    c->enable_mount_namespace = true;
+    c->rootfs_path = ROOTFS;
+}
+static void with_uts(container_config_t *c)    {
+    with_rootfs(c);
+    c->enable_uts_namespace = true;
+    c->hostname = "bench";
+}
+static void with_overlay(container_config_t *c) {
+    with_rootfs(c);
+    c->enable_overlay = true;
+}
+static void with_cgroup(container_config_t *c) {
+    with_pid(c);
+    c->enable_cgroup = true;
+    c->cgroup_limits.pid_limit = 64;
+}
+static void with_user(container_config_t *c)   {
+    with_pid(c);
+    c->enable_user_namespace = true;
+}
+static void with_net(container_config_t *c)    {
+    with_pid(c);
+    c->enable_network = true;
+    strcpy(c->veth.host_ip, "10.0.0.1");
+    strcpy(c->veth.container_ip, "10.0.0.2");
+    strcpy(c->veth.netmask, "24");
+    c->veth.enable_nat = false;
+}
+static void bare(container_config_t *c)        { (void)c; }
+
+static const bench_case_t cases[] = {
+    { "bare",          bare },
+    { "pid",           with_pid },
+    { "pid+rootfs",    with_rootfs },
+    { "pid+rootfs+uts", with_uts },
+    { "pid+overlay",   with_overlay },
+    { "pid+cgroup",    with_cgroup },
+    { "pid+user",      with_user },
+    { "pid+net",       with_net },
+};
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of a sorted array. */
+static uint64_t pct(const uint64_t *sorted, int n, int p) {
+    int idx = (n * p + 99) / 100 - 1;
+    return sorted[idx < 0 ? 0 : idx];
+}
+
+static void report(const char *label, uint64_t *samples, int n) {
+    qsort(samples, n, sizeof(samples[0]), cmp_u64);
+    if (samples[n - 1] == 0) return;   // Phase never ran
+    printf("  %-14s %10.1f %10.1f\n", label,
+           pct(samples, n, 50) / 1000.0, pct(samples, n, 99) / 1000.0);
+}
+
+static void run_case(const bench_case_t *bc, char **env, int n) {
+    static char *argv[] = {"/bin/sh", "-c", "true", NULL};
+    uint64_t *total = calloc(n, sizeof(uint64_t));
+    uint64_t *phase = calloc((size_t)n * CONTAINER_PHASE_COUNT, sizeof(uint64_t));
+    if (!total || !phase) {
+        perror("calloc");
+        exit(1);
+    }
+
+    for (int i = 0; i < n; i++) {
+        container_config_t cfg = {
+            .program = "/bin/sh",
+            .argv = argv,
+            .envp = env,
+            .uid_map_inside = 0,
+            .uid_map_outside = getuid(),
+            .uid_map_range = 1,
+            .gid_map_inside = 0,
+            .gid_map_outside = getgid(),
+            .gid_map_range = 1,
+            .enable_timings = true,
+        };
+        bc->apply(&cfg);
+
+        container_result_t r = container_exec(&cfg);
+        container_cleanup(&r);
+        if (r.child_pid < 0 || !r.exited_normally || r.exit_status != 0 ||
+            !r.timings.valid || r.timings.exec_ns == 0) {
+            printf("== %s: skipped (start failed on iteration %d)\n\n",
+                   bc->name, i);
+            free(total);
+            free(phase);
+            return;
+        }
+        total[i] = r.timings.exec_ns - r.timings.start_ns;
+        for (int p = 0; p < CONTAINER_PHASE_COUNT; p++) {
+            phase[(size_t)p * n + i] = r.timings.phase_ns[p];
+        }
+    }
+
+    printf("== %s (N=%d)\n", bc->name, n);
+    printf("  %-14s %10s %10s\n", "phase", "p50_us", "p99_us");
+    report("total", total, n);
+    for (int p = 0; p < CONTAINER_PHASE_COUNT; p++) {
+        report(container_phase_name((container_phase_t)p),
+               &phase[(size_t)p * n], n);
+    }
+    printf("\n");
+    free(total);
+    free(phase);
+}
+
+int main(int argc, char *argv[]) {
+    if (geteuid() != 0) {
+        fprintf(stderr, "bench_start requires root\n");
+        return 1;
+    }
+    int n = argc > 1 ? atoi(argv[1]) : 50;
+    if (n < 1) {
+        fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    char **env = build_container_env(NULL, false);
+    if (!env) return 1;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        /* Only the rootfs cases need the image. */
+        container_config_t probe = {0};
+        cases[i].apply(&probe);
+        if (probe.rootfs_path && access(ROOTFS "/bin/sh", X_OK) < 0) {
+            printf("== %s: skipped (no %s/bin/sh)\n\n", cases[i].name, ROOTFS);
+            continue;
+        }
+        run_case(&cases[i], env, n);
+    }
+    free(env);
+    return 0;
+}
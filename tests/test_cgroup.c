@@ -4,6 +4,7 @@
 #include "core.h"
 #include "env.h"
 #include "cgroup.h"
+#include "monitor.h"
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -36,7 +37,7 @@ void test_cgroup_creation_and_cleanup(void) {
     };
 
     // Create cgroup
-    int rc = setup_cgroup(&ctx, &limits, true);
+    int rc = setup_cgroup(&ctx, &limits, NULL, true);
     assert(rc == 0);
     assert(ctx.created);
 
@@ -45,12 +46,12 @@ void test_cgroup_creation_and_cleanup(void) {
     assert(stat(ctx.cgroup_path, &st) == 0);
     assert(S_ISDIR(st.st_mode));
 
-    // Remove cgroup
+    // Release cgroup
     remove_cgroup(&ctx, true);
     assert(!ctx.created);
 
-    // Verify directory is gone
-    assert(stat(ctx.cgroup_path, &st) < 0);
+    // A pool slot stays for the next container; a one-off is gone
+    assert((stat(ctx.cgroup_path, &st) == 0) == ctx.pooled);
 
     printf("PASS: test_cgroup_creation_and_cleanup\n");
 }
@@ -73,6 +74,31 @@ void test_memory_limit(void) {
     printf("PASS: test_memory_limit\n");
 }
 
+/* Overrunning memory.max with the guard armed: the OOM kill and the
+ * "max" events that preceded it are both counted. */
+void test_memory_guard_oom(void) {
+    char **env = build_container_env(NULL, false);
+    // tail buffers its whole (newline-free) input
+    char *argv[] = {"/bin/sh", "-c", "head -c 200M /dev/zero | tail", NULL};
+    container_config_t cfg = make_cfg(env, argv);
+    cfg.enable_pid_namespace = true;
+    cfg.enable_cgroup        = true;
+    cfg.cgroup_limits.memory_limit = 32 * 1024 * 1024;
+    cfg.cgroup_limits.swap_limit   = CGROUP_SWAP_NONE;
+    cfg.memory_guard.enable = true;
+
+    container_result_t result = container_exec(&cfg);
+    assert(result.ctx.cgroup_ctx.guard.active);
+    container_cleanup(&result);
+    assert(!result.ctx.cgroup_ctx.guard.active);
+    free(env);
+
+    const cgroup_guard_t *g = &result.ctx.cgroup_ctx.guard;
+    assert(g->counts[MEMORY_EVENT_MAX] > 0);
+    assert(g->counts[MEMORY_EVENT_OOM_KILL] > 0);
+    printf("PASS: test_memory_guard_oom\n");
+}
+
 void test_pid_limit(void) {
     char **env = build_container_env(NULL, false);
     // Try to spawn more processes than allowed
@@ -128,6 +154,171 @@ void test_cgroup_with_ipc_namespace(void) {
     printf("PASS: test_cgroup_with_ipc_namespace\n");
 }
 
+/* The child is a member of its cgroup by the time it runs — directly via
+ * clone3(CLONE_INTO_CGROUP), or via cgroup.procs before the sync. */
+void test_child_starts_in_cgroup(void) {
+    char **env = build_container_env(NULL, false);
+    char *argv[] = {"/bin/sh", "-c",
+        "grep -q '^0::/minicontainer/' /proc/self/cgroup", NULL};
+    container_config_t cfg = make_cfg(env, argv);
+    cfg.enable_cgroup = true;
+    cfg.cgroup_limits.pid_limit = 10;
+
+    container_result_t result = container_exec(&cfg);
+    container_cleanup(&result);
+    free(env);
+
+    assert(result.exited_normally);
+    assert(result.exit_status == 0);
+    printf("PASS: test_child_starts_in_cgroup\n");
+}
+
+static void read_limit(const cgroup_context_t *ctx, const char *file,
+                       char *buf, size_t size) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", ctx->cgroup_path, file);
+    FILE *f = fopen(path, "r");
+    assert(f);
+    assert(fgets(buf, (int)size, f));
+    buf[strcspn(buf, "\n")] = '\0';
+    fclose(f);
+}
+
+/* A released slot is claimed again, with the previous tenant's limits
+ * reset; a slot in use is never handed out twice. */
+void test_cgroup_pool_reuse(void) {
+    cgroup_limits_t limited = { .pid_limit = 10 };
+    cgroup_limits_t unlimited = {0};
+    cgroup_context_t a = {0}, b = {0};
+
+    assert(setup_cgroup(&a, &limited, NULL, false) == 0);
+    assert(a.pooled);
+    char path[sizeof(a.cgroup_path)];
+    strcpy(path, a.cgroup_path);
+    char buf[64];
+    read_limit(&a, "pids.max", buf, sizeof(buf));
+    assert(strcmp(buf, "10") == 0);
+    remove_cgroup(&a, false);
+
+    assert(setup_cgroup(&b, &unlimited, NULL, false) == 0);
+    assert(strcmp(b.cgroup_path, path) == 0);
+    read_limit(&b, "pids.max", buf, sizeof(buf));
+    assert(strcmp(buf, "max") == 0);
+
+    assert(setup_cgroup(&a, &unlimited, NULL, false) == 0);
+    assert(strcmp(a.cgroup_path, b.cgroup_path) != 0);
+    remove_cgroup(&a, false);
+    remove_cgroup(&b, false);
+
+    printf("PASS: test_cgroup_pool_reuse\n");
+}
+
+void test_cgroup_extended_limits(void) {
+    cgroup_limits_t tuned = {
+        .memory_high = 64 * 1024 * 1024,
+        .cpu_weight = 50,
+    };
+    cgroup_limits_t unlimited = {0};
+    cgroup_context_t ctx = {0};
+    char buf[64];
+
+    assert(setup_cgroup(&ctx, &tuned, NULL, false) == 0);
+    read_limit(&ctx, "memory.high", buf, sizeof(buf));
+    assert(strcmp(buf, "67108864") == 0);
+    read_limit(&ctx, "cpu.weight", buf, sizeof(buf));
+    assert(strcmp(buf, "50") == 0);
+    remove_cgroup(&ctx, false);
+
+    // The next tenant of the same slot gets the defaults back
+    assert(setup_cgroup(&ctx, &unlimited, NULL, false) == 0);
+    read_limit(&ctx, "memory.high", buf, sizeof(buf));
+    assert(strcmp(buf, "max") == 0);
+    read_limit(&ctx, "cpu.weight", buf, sizeof(buf));
+    assert(strcmp(buf, "100") == 0);
+    remove_cgroup(&ctx, false);
+
+    printf("PASS: test_cgroup_extended_limits\n");
+}
+
+void test_monitor_sample(void) {
+    cgroup_limits_t unlimited = {0};
+    cgroup_context_t ctx = {0};
+    static container_monitor_t mon;
+    char buf[2048], want[128];
+
+    assert(setup_cgroup(&ctx, &unlimited, NULL, false) == 0);
+    assert(monitor_open(&mon, ctx.dir_fd, ctx.cgroup_name, getpid()) == 0);
+    const monitor_sample_t *s = monitor_sample(&mon);
+    assert(s->present != 0);
+    monitor_sample(&mon);
+
+    snprintf(want, sizeof(want), "{\"cgroup\":\"%s\",", ctx.cgroup_name);
+    monitor_format(&mon, s, MONITOR_FORMAT_JSON, buf, sizeof(buf));
+    assert(strncmp(buf, want, strlen(want)) == 0);
+    assert(buf[strlen(buf) - 1] == '\n');
+    snprintf(want, sizeof(want), "minicontainer,cgroup=%s ", ctx.cgroup_name);
+    monitor_format(&mon, s, MONITOR_FORMAT_LINE, buf, sizeof(buf));
+    assert(strncmp(buf, want, strlen(want)) == 0);
+    monitor_summary(&mon, MONITOR_FORMAT_JSON, buf, sizeof(buf));
+    assert(strstr(buf, "\"samples\":2,"));
+
+    monitor_close(&mon);
+    monitor_close(&mon);
+    remove_cgroup(&ctx, false);
+    printf("PASS: test_monitor_sample\n");
+}
+
+/* What the loop delivered for one guarded handle that frees itself. */
+typedef struct {
+    int exits;
+    int exit_status;
+    int oom_kills;
+} guard_loop_seen_t;
+
+static void count_memory_event(container_handle_t *h,
+                               const memory_event_t *ev, void *user) {
+    (void)h;
+    guard_loop_seen_t *seen = user;
+    if (ev->kind == MEMORY_EVENT_OOM_KILL) seen->oom_kills++;
+}
+
+static void free_on_exit(container_handle_t *h, void *user) {
+    guard_loop_seen_t *seen = user;
+    seen->exits++;
+    seen->exit_status = h->result.exit_status;
+    container_handle_free(h);
+}
+
+/* An OOM kill through the event loop: the pidfd and memory.events
+ * usually land in one epoll batch, and the on_exit callback frees the
+ * handle — the batch's guard event must not touch it afterwards. */
+void test_memory_guard_loop_free(void) {
+    char **env = build_container_env(NULL, false);
+    char *argv[] = {"/bin/sh", "-c", "head -c 200M /dev/zero | tail", NULL};
+    container_config_t cfg = make_cfg(env, argv);
+    cfg.enable_pid_namespace = true;
+    cfg.enable_cgroup        = true;
+    cfg.cgroup_limits.memory_limit = 32 * 1024 * 1024;
+    cfg.cgroup_limits.swap_limit   = CGROUP_SWAP_NONE;
+    cfg.memory_guard.enable = true;
+
+    guard_loop_seen_t seen = {0};
+    container_loop_t *loop = container_loop_create();
+    assert(loop);
+    container_handle_t *h = container_spawn(loop, &cfg, free_on_exit, &seen);
+    assert(h && h->result.ctx.cgroup_ctx.guard.active);
+    h->on_memory = count_memory_event;
+    while (container_loop_running(loop) > 0) {
+        assert(container_poll(loop, 1000) >= 0);
+    }
+    container_loop_destroy(loop);
+    free(env);
+
+    assert(seen.exits == 1 && seen.exit_status != 0);
+    assert(seen.oom_kills > 0);
+    printf("PASS: test_memory_guard_loop_free\n");
+}
+
 int main(void) {
     if (geteuid() != 0) {
         fprintf(stderr, "Cgroup tests must run as root (sudo)\n");
@@ -135,10 +326,16 @@ int main(void) {
     }
 
     test_cgroup_creation_and_cleanup();
+    test_cgroup_pool_reuse();
+    test_cgroup_extended_limits();
+    test_monitor_sample();
     test_memory_limit();
+    test_memory_guard_oom();
+    test_memory_guard_loop_free();
     test_pid_limit();
     test_no_cgroup_backward_compat();
     test_cgroup_with_ipc_namespace();
+    test_child_starts_in_cgroup();
 
     printf("\nAll cgroup tests passed!\n");
     return 0;
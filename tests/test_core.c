@@ -1,11 +1,30 @@
 // Note: _GNU_SOURCE is provided by the Makefile.
 #include "core.h"
 #include "env.h"
+#include "spec.h"
+#include "checkpoint.h"
+#include "id.h"
+#include "intern.h"
+#include "seccomp.h"
+#include "seccomp_syscalls.h"
+#include "attach.h"
+#include "events.h"
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <net/if.h>
 
 static container_config_t base_config(char **env, const char *cmd) {
     static char *argv_buf[] = {"/bin/sh", "-c", NULL, NULL};
@@ -53,6 +72,539 @@ void test_pid_only(void) {
     printf("PASS: test_pid_only\n");
 }
 
+static void count_exit(container_handle_t *h, void *user) {
+    int *sum = user;
+    assert(h->reaped && h->result.exited_normally);
+    *sum += h->result.exit_status;
+    container_handle_free(h);
+}
+
+/* Many containers on one loop: all run concurrently and are reaped (with
+ * teardown) from the exit callback / wait_any. */
+void test_spawn_concurrent(void) {
+    enum { N = 16 };
+    char **env = build_container_env(NULL, false);
+    char cmds[N][32];
+    static char *argvs[N][4];
+    container_loop_t *loop = container_loop_create();
+    assert(loop);
+
+    int sum = 0, expected = 0;
+    for (int i = 0; i < N; i++) {
+        snprintf(cmds[i], sizeof(cmds[i]), "sleep 0.2; exit %d", i);
+        argvs[i][0] = "/bin/sh";
+        argvs[i][1] = "-c";
+        argvs[i][2] = cmds[i];
+        argvs[i][3] = NULL;
+        container_config_t cfg = base_config(env, cmds[i]);
+        cfg.argv = argvs[i];
+        cfg.enable_pid_namespace = true;
+        assert(container_spawn(loop, &cfg, count_exit, &sum));
+        expected += i;
+    }
+    assert(container_loop_running(loop) == N);
+
+    /* All N sleep in parallel: well under N * 0.2 s. */
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    while (container_loop_running(loop) > 0) {
+        assert(container_poll(loop, -1) >= 0);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    assert(sum == expected);
+    assert(t1.tv_sec - t0.tv_sec < 2);
+
+    container_config_t cfg = base_config(env, "exit 5");
+    container_handle_t *h = container_spawn(loop, &cfg, NULL, NULL);
+    assert(h);
+    assert(container_wait_any(loop) == h);
+    assert(h->reaped && h->result.exit_status == 5);
+    container_handle_free(h);
+    assert(container_wait_any(loop) == NULL);
+
+    container_loop_destroy(loop);
+    free(env);
+    printf("PASS: test_spawn_concurrent\n");
+}
+
+/* CLONE_PIDFD: the result's pidfd signals the child and becomes
+ * readable when it exits; a reaped child can no longer be signalled. */
+void test_pidfd_lifecycle(void) {
+    char **env = build_container_env(NULL, false);
+    container_config_t cfg = base_config(env, "sleep 10");
+    container_loop_t *loop = container_loop_create();
+    assert(loop);
+
+    container_handle_t *h = container_spawn(loop, &cfg, NULL, NULL);
+    assert(h && h->result.has_pidfd);
+    struct pollfd pfd = { .fd = h->result.pidfd, .events = POLLIN };
+    assert(poll(&pfd, 1, 0) == 0);   // Still running
+
+    assert(container_signal(&h->result, SIGTERM) == 0);
+    assert(poll(&pfd, 1, 5000) == 1);
+    assert(container_wait_any(loop) == h);
+    assert(!h->result.exited_normally && h->result.signal == SIGTERM);
+    assert(!h->result.has_pidfd);   // Closed by the reap's cleanup
+    assert(container_signal(&h->result, SIGKILL) < 0 && errno == ESRCH);
+
+    container_handle_free(h);
+    container_loop_destroy(loop);
+    free(env);
+    printf("PASS: test_pidfd_lifecycle\n");
+}
+
+/* enable_timings: the child's phases land in result.timings. */
+void test_start_timings(void) {
+    char **env = build_container_env(NULL, false);
+    container_config_t cfg = base_config(env, "exit 0");
+    cfg.enable_pid_namespace = true;
+    cfg.enable_timings = true;
+
+    container_result_t r = container_exec(&cfg);
+    container_cleanup(&r);
+    free(env);
+
+    assert(r.exited_normally && r.exit_status == 0);
+    assert(r.timings.valid);
+    assert(r.timings.exec_ns > r.timings.start_ns);
+    assert(r.timings.phase_ns[CONTAINER_PHASE_CLONE] > 0);
+    assert(r.timings.phase_ns[CONTAINER_PHASE_CLOSE_FDS] > 0);
+    assert(r.timings.phase_ns[CONTAINER_PHASE_UID_MAP] == 0);   // No userns
+    assert(strcmp(container_phase_name(CONTAINER_PHASE_PIVOT_ROOT),
+                  "pivot_root") == 0);
+    printf("PASS: test_start_timings\n");
+}
+
+/* No fd above stderr survives into the container, however high. */
+void test_inherited_fds_closed(void) {
+    char **env = build_container_env(NULL, false);
+    int fd = open("/dev/null", O_RDONLY);
+    assert(fd >= 0);
+    assert(dup2(fd, 50) == 50 && dup2(fd, 1000) == 1000);
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "[ ! -e /proc/self/fd/50 ] && "
+             "[ ! -e /proc/self/fd/1000 ] && [ ! -e /proc/self/fd/%d ]", fd);
+    container_config_t cfg = base_config(env, cmd);
+
+    container_result_t r = container_exec(&cfg);
+    container_cleanup(&r);
+    close(fd);
+    close(50);
+    close(1000);
+    free(env);
+
+    assert(r.exited_normally && r.exit_status == 0);
+    printf("PASS: test_inherited_fds_closed\n");
+}
+
+/* A snapshot's config.spec loads back into the config it was taken
+ * with. With criu installed, a warmed shell is dumped and restored and
+ * finishes its work in the restored copy; without it, the dump fails and
+ * leaves the container running. */
+void test_checkpoint_restore(void) {
+    char dir[] = "/tmp/mc_checkpoint_XXXXXX";
+    assert(mkdtemp(dir));
+    char **env = build_container_env(NULL, false);
+    container_config_t cfg = base_config(env,
+        "for i in 1 2 3 4 5 6 7 8 9 10; do sleep 0.1; done; exit 7");
+    cfg.enable_pid_namespace = true;
+    cfg.hostname = "snap";
+
+    static char blob[SPEC_MAX_SIZE] __attribute__((aligned(8)));
+    size_t len = spec_encode(&cfg, blob, sizeof(blob));
+    assert(len > 0);
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, CHECKPOINT_SPEC);
+    FILE *f = fopen(path, "w");
+    assert(f && fwrite(blob, 1, len, f) == len);
+    fclose(f);
+
+    static char buf[SPEC_MAX_SIZE] __attribute__((aligned(8)));
+    container_config_t loaded;
+    assert(checkpoint_load_config(dir, &loaded, buf, sizeof(buf)) == 0);
+    assert(strcmp(loaded.program, "/bin/sh") == 0);
+    assert(strcmp(loaded.argv[2], cfg.argv[2]) == 0 && !loaded.argv[3]);
+    assert(strcmp(loaded.hostname, "snap") == 0);
+    assert(loaded.enable_pid_namespace && !loaded.restore_dir);
+
+    container_loop_t *loop = container_loop_create();
+    container_handle_t *h = container_spawn(loop, &cfg, NULL, NULL);
+    assert(h);
+    usleep(200000);
+    int rc = container_checkpoint(&h->result, &cfg, dir);
+    if (!find_criu_binary()) {
+        assert(rc < 0);
+        assert(container_signal(&h->result, 0) == 0);   // Still running
+    } else {
+        assert(rc == 0);
+    }
+    assert(container_wait_any(loop) == h);
+    container_handle_free(h);
+    container_loop_destroy(loop);
+
+    if (rc == 0) {
+        loaded.restore_dir = dir;
+        container_result_t r = container_exec(&loaded);
+        container_cleanup(&r);
+        assert(r.exited_normally && r.exit_status == 7);
+    }
+    free(env);
+    char cmd[PATH_MAX + 16];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    assert(system(cmd) == 0);
+    printf("PASS: test_checkpoint_restore%s\n",
+           rc == 0 ? "" : " (criu not installed: dump refused)");
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* IDs drawn by a parent and its forked children never share their low
+ * 32 bits (the veth suffix), and one container's names share one ID. */
+static void test_container_ids(void) {
+    enum { PROCS = 8, PER_PROC = 4096 };
+    static uint32_t ids[(PROCS + 1) * PER_PROC];
+    for (int i = 0; i < PER_PROC; i++) ids[i] = (uint32_t)id_next();
+
+    int fds[2];
+    assert(pipe(fds) == 0);
+    for (int p = 0; p < PROCS; p++) {
+        pid_t pid = fork();
+        assert(pid >= 0);
+        if (pid == 0) {
+            close(fds[0]);
+            uint32_t mine[PER_PROC];
+            for (int i = 0; i < PER_PROC; i++) mine[i] = (uint32_t)id_next();
+            _exit(write(fds[1], mine, sizeof(mine)) == sizeof(mine) ? 0 : 1);
+        }
+    }
+    close(fds[1]);
+    size_t got = PER_PROC * sizeof(uint32_t), want = sizeof(ids);
+    ssize_t n;
+    while (got < want &&
+           (n = read(fds[0], (char *)ids + got, want - got)) > 0) {
+        got += (size_t)n;
+    }
+    close(fds[0]);
+    assert(got == want);
+    for (int p = 0; p < PROCS; p++) {
+        int status;
+        assert(wait(&status) > 0 && WIFEXITED(status) &&
+               WEXITSTATUS(status) == 0);
+    }
+    qsort(ids, (PROCS + 1) * PER_PROC, sizeof(ids[0]), cmp_u32);
+    for (int i = 1; i < (PROCS + 1) * PER_PROC; i++) assert(ids[i] != ids[i - 1]);
+
+    container_context_t ctx = {0};
+    container_context_assign_id(&ctx);
+    assert(ctx.id != 0 && ctx.cgroup_ctx.id == ctx.id &&
+           ctx.overlay_ctx.id == ctx.id);
+    generate_veth_names(&ctx.net_ctx, ctx.id);
+    char want_host[IFNAMSIZ];
+    snprintf(want_host, sizeof(want_host), "veth_h_%08x", (unsigned)(uint32_t)ctx.id);
+    assert(strcmp(ctx.net_ctx.veth_host, want_host) == 0);
+    assert(strlen(ctx.net_ctx.veth_container) == IFNAMSIZ - 1);
+    printf("PASS: test_container_ids\n");
+}
+
+/* Equal strings share one copy across table growth and arena blocks. */
+static void test_str_intern(void) {
+    const char *a = str_intern("/var/lib/minicontainer/rootfs");
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s", "/var/lib/minicontainer/rootfs");
+    assert(a && str_intern(buf) == a && a != buf);
+    assert(str_intern("/other") != a);
+
+    static const char *seen[5000];
+    for (int i = 0; i < 5000; i++) {
+        snprintf(buf, sizeof(buf), "/containers/%d/.cache", i);
+        seen[i] = str_intern(buf);
+        assert(seen[i] && strcmp(seen[i], buf) == 0);
+    }
+    for (int i = 0; i < 5000; i++) {
+        snprintf(buf, sizeof(buf), "/containers/%d/.cache", i);
+        assert(str_intern(buf) == seen[i]);
+    }
+    assert(str_intern("/var/lib/minicontainer/rootfs") == a);
+
+    static char big[INTERN_CHUNK];
+    memset(big, 'x', sizeof(big) - 1);
+    const char *b = str_intern(big);
+    assert(b && b != big && str_intern(big) == b);
+    printf("PASS: test_str_intern\n");
+}
+
+/* A profile's rules hold in the container; programs are cached per
+ * profile text; a profile big enough to need the BPF_JA tree still
+ * sends each syscall number to its own rule. */
+static void test_seccomp(void) {
+    const char *prof = "/tmp/minicontainer_test.seccomp";
+    const char *dir = "/tmp/minicontainer_seccomp_dir";
+    FILE *f = fopen(prof, "w");
+    assert(f && fputs("default allow\nerrno mkdir ?mkdirat\n", f) >= 0);
+    assert(fclose(f) == 0);
+    rmdir(dir);
+
+    char **env = build_container_env(NULL, false);
+    container_config_t cfg = base_config(env,
+        "! mkdir /tmp/minicontainer_seccomp_dir 2>/dev/null");
+    cfg.seccomp_profile = prof;
+    container_result_t r = container_exec(&cfg);
+    container_cleanup(&r);
+    free(env);
+    assert(r.exited_normally && r.exit_status == 0);
+    assert(access(dir, F_OK) < 0);
+
+    const seccomp_program_t *d = seccomp_compile(SECCOMP_PROFILE_DEFAULT, false);
+    assert(d && seccomp_compile(SECCOMP_PROFILE_DEFAULT, false) == d);
+    assert(seccomp_compile(prof, false) != d);
+
+    /* Deny every number below 256 with getpid's parity: ~250 runs. */
+    f = fopen(prof, "w");
+    assert(f && fputs("default allow\nerrno", f) >= 0);
+    for (size_t i = 0; i < sizeof(seccomp_syscalls) / sizeof(seccomp_syscalls[0]); i++) {
+        int nr = seccomp_syscalls[i].nr;
+        if (nr < 256 && nr % 2 == SYS_getpid % 2 && nr != SYS_exit_group) {
+            fprintf(f, " %s", seccomp_syscalls[i].name);
+        }
+    }
+    assert(fputs("\n", f) >= 0 && fclose(f) == 0);
+    const seccomp_program_t *big = seccomp_compile(prof, false);
+    assert(big && big->len > 256);
+    long other = SYS_getppid % 2 != SYS_getpid % 2 ? SYS_getppid
+               : SYS_getuid % 2 != SYS_getpid % 2 ? SYS_getuid : SYS_geteuid;
+    assert(other % 2 != SYS_getpid % 2);
+
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        if (seccomp_install(big, false) < 0) _exit(2);
+        errno = 0;
+        bool denied = syscall(SYS_getpid) < 0 && errno == EPERM;
+        bool allowed = syscall(other) >= 0;
+        _exit(denied && allowed ? 0 : 1);
+    }
+    int status;
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    unlink(prof);
+    printf("PASS: test_seccomp (%u-insn tree)\n", (unsigned)big->len);
+}
+
+/* exec into a running container: its namespaces (hostname, a pid
+ * other than 1) and its environment, several times over one pinned
+ * handle; a failed execvp is an error, not an exit status. */
+static void test_attach(void) {
+    char *custom[] = { "ATTACH_TEST=1", NULL };
+    char **env = build_container_env(custom, false);
+    container_config_t cfg = base_config(env, "sleep 10");
+    cfg.enable_pid_namespace = true;
+    cfg.enable_uts_namespace = true;
+    cfg.enable_ipc_namespace = true;
+    cfg.hostname = "attached";
+    container_loop_t *loop = container_loop_create();
+    assert(loop);
+    container_handle_t *h = container_spawn(loop, &cfg, NULL, NULL);
+    assert(h);
+
+    /* Until execve, /proc/<pid>/environ is still the runtime's. */
+    char target[16], comm[64] = "";
+    snprintf(target, sizeof(target), "%d", (int)h->result.child_pid);
+    snprintf(comm, sizeof(comm), "/proc/%s/comm", target);
+    for (int i = 0; i < 500; i++) {
+        FILE *f = fopen(comm, "r");
+        char name[32] = "";
+        bool started = f && fgets(name, sizeof(name), f) &&
+                       strcmp(name, "sleep\n") == 0;
+        if (f) fclose(f);
+        if (started) break;
+        usleep(1000);
+    }
+    container_attach_t a;
+    assert(container_attach_open(&a, target, false) == 0);
+    assert(a.ns_flags & CLONE_NEWPID);
+    assert(a.ns_flags & CLONE_NEWUTS);
+
+    char *check[] = { "/bin/sh", "-c",
+        "[ \"$(hostname)\" = attached ] && [ $$ -gt 1 ] && "
+        "[ -n \"$ATTACH_TEST\" ] && exit 3", NULL };
+    for (int i = 0; i < 3; i++) {
+        int status = -1;
+        assert(container_attach_exec(&a, check, NULL, &status, false) == 0);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 3);
+    }
+    char *missing[] = { "/nonexistent", NULL };
+    int status;
+    assert(container_attach_exec(&a, missing, NULL, &status, false) < 0);
+    container_attach_close(&a);
+    container_attach_close(&a);
+
+    assert(container_signal(&h->result, SIGKILL) == 0);
+    assert(container_wait_any(loop) == h);
+    assert(container_attach_open(&a, target, false) < 0);
+    assert(container_attach_open(&a, "no-such-container", false) < 0);
+    container_handle_free(h);
+    container_loop_destroy(loop);
+    free(env);
+    printf("PASS: test_attach\n");
+}
+
+/* Workspaces left in ./test_containers (the overlay cache is dot-named),
+ * and whether any of them is still mounted. */
+static int leftover_workspaces(void) {
+    int n = 0;
+    DIR *d = opendir("./test_containers");
+    struct dirent *de;
+    while (d && (de = readdir(d))) n += de->d_name[0] != '.';
+    if (d) closedir(d);
+    char line[1024];
+    FILE *f = fopen("/proc/self/mountinfo", "r");
+    while (f && fgets(line, sizeof(line), f)) n += strstr(line, "test_containers") != NULL;
+    if (f) fclose(f);
+    return n;
+}
+
+/* The pre-clone stages (cgroup, rootfs, veth) run as one concurrent wave.
+ * Both complete for a start; when one fails, the ones that succeeded
+ * alongside it are rolled back. */
+static void test_start_stages(void) {
+    char **env = build_container_env(NULL, false);
+    container_config_t cfg = base_config(env, "[ -d /proc/self ] && exit 6");
+    cfg.rootfs_path = "./rootfs";
+    cfg.enable_overlay = true;
+    cfg.container_dir = "./test_containers";
+    cfg.enable_mount_namespace = true;
+    cfg.enable_pid_namespace = true;
+    cfg.enable_network = true;
+    strcpy(cfg.veth.host_ip, "10.99.9.1");
+    strcpy(cfg.veth.container_ip, "10.99.9.2");
+    strcpy(cfg.veth.netmask, "24");
+    cfg.veth.backend = NET_BACKEND_NETLINK;
+    int before = leftover_workspaces();
+
+    container_result_t r = container_exec(&cfg);
+    assert(r.exited_normally && r.exit_status == 6);
+    container_cleanup(&r);
+    assert(leftover_workspaces() == before);
+
+    /* The veth stage fails (no subnet to lease from) while the overlay
+     * stage beside it succeeds: the overlay must be torn down again. */
+    strcpy(cfg.veth.bridge, "mc-stagetest");
+    strcpy(cfg.veth.netmask, "bogus");
+    r = container_exec(&cfg);
+    assert(r.child_pid == -1);
+    container_cleanup(&r);
+    assert(leftover_workspaces() == before);
+    assert(if_nametoindex("mc-stagetest") == 0);
+
+    free(env);
+    printf("PASS: test_start_stages\n");
+}
+
+static void *emit_many(void *arg) {
+    (void)arg;
+    for (int i = 0; i < 20000; i++) {
+        event_emit(EVENT_OOM, 9, 0, i, (uint64_t)i * 3);
+    }
+    return NULL;
+}
+
+static void test_events(void) {
+    event_ring_t *ring = event_ring_create(NULL, 16);
+    assert(ring);
+    events_attach(ring);
+    event_cursor_t cur;
+    event_cursor_init(&cur, ring, false);
+
+    char **env = build_container_env(NULL, false);
+    container_config_t cfg = base_config(env, "exit 5");
+    cfg.enable_pid_namespace = true;
+    container_result_t r = container_exec(&cfg);
+    assert(r.child_pid > 0);
+    container_cleanup(&r);
+    container_cleanup(&r);   // Idempotent: one cleanup event
+
+    static const event_kind_t want[] = {
+        EVENT_CREATED, EVENT_STARTED, EVENT_EXITED, EVENT_CLEANUP,
+    };
+    size_t seen = 0;
+    event_t ev;
+    while (event_next(&cur, &ev)) {
+        if (ev.kind == EVENT_LOG) continue;
+        assert(seen < 4 && ev.kind == want[seen]);
+        assert(ev.id == r.ctx.id && ev.pid == r.child_pid);
+        if (ev.kind == EVENT_STARTED) assert(ev.value > 0);
+        if (ev.kind == EVENT_EXITED) assert(ev.status == 5 && ev.value == 0);
+        seen++;
+    }
+    assert(seen == 4 && cur.dropped == 0);
+
+    /* A debug line is a log event, newline trimmed. */
+    debug_log("[test] event ring %s\n", "ok");
+    debug_flush();
+    assert(event_next(&cur, &ev) == 1 && ev.kind == EVENT_LOG);
+    assert(ev.pid == getpid() && ev.id == 0);
+    assert(ev.len == 20 && memcmp(ev.text, "[test] event ring ok", 20) == 0);
+
+    /* A reader lapped by 40 events on 16 slots skips the 24 it lost. */
+    event_cursor_t late;
+    event_cursor_init(&late, ring, false);
+    for (int i = 0; i < 40; i++) event_emit(EVENT_OOM, 7, 0, i, 0);
+    int got = 0;
+    while (event_next(&late, &ev)) {
+        assert(ev.status == 24 + got);
+        got++;
+    }
+    assert(got == 16 && late.dropped == 24);
+    char json[512];
+    assert(event_format_json(&ev, json, sizeof(json)) > 0);
+    assert(strstr(json, "\"kind\":\"oom\"") && strstr(json, "\"status\":39"));
+
+    /* Writers lapping each other on 16 slots: every event a reader
+     * accepts is whole (value mirrors status, seq matches its place). */
+    pthread_t writers[4];
+    for (int i = 0; i < 4; i++) {
+        assert(pthread_create(&writers[i], NULL, emit_many, NULL) == 0);
+    }
+    event_cursor_init(&late, ring, false);
+    uint64_t read = 0;
+    for (int spins = 0; spins < 200000; spins++) {
+        while (event_next(&late, &ev)) {
+            assert(ev.seq + 1 == late.next);
+            assert(ev.kind == EVENT_OOM && ev.value == (uint64_t)ev.status * 3);
+            read++;
+        }
+    }
+    for (int i = 0; i < 4; i++) pthread_join(writers[i], NULL);
+    while (event_next(&late, &ev)) read++;
+    assert(read + late.dropped == 4 * 20000 && read > 0);
+
+    /* File ring: another process maps it read-only. */
+    events_attach(NULL);
+    event_ring_close(ring);
+    const char *path = "/tmp/test_core.events";
+    ring = event_ring_create(path, 0);
+    assert(ring);
+    events_attach(ring);
+    event_emit(EVENT_CLEANUP, 42, 1, 0, 0);
+    const event_ring_t *ro = event_ring_open(path);
+    assert(ro);
+    event_cursor_init(&cur, ro, true);
+    assert(event_next(&cur, &ev) == 1);
+    assert(ev.kind == EVENT_CLEANUP && ev.id == 42 && ev.seq == 0);
+    assert(event_next(&cur, &ev) == 0);
+    event_ring_close(ro);
+    events_attach(NULL);
+    event_ring_close(ring);
+    unlink(path);
+    assert(event_ring_open("/proc/self/stat") == NULL && errno == EINVAL);
+
+    free(env);
+    printf("PASS: test_events\n");
+}
+
 int main(void) {
     if (geteuid() != 0) {
         fprintf(stderr, "test_core requires root\n");
@@ -60,6 +612,17 @@ int main(void) {
     }
     test_bare_exec();
     test_pid_only();
+    test_spawn_concurrent();
+    test_pidfd_lifecycle();
+    test_start_timings();
+    test_start_stages();
+    test_inherited_fds_closed();
+    test_checkpoint_restore();
+    test_container_ids();
+    test_str_intern();
+    test_seccomp();
+    test_attach();
+    test_events();
     printf("\nAll core tests passed!\n");
     return 0;
 }
\ No newline at end of file
@@ -4,7 +4,10 @@
 // container_exec() with container_config_t — same semantics, unified API.
 #include "core.h"
 #include "env.h"
+#include "mount.h"
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -71,6 +74,43 @@ void test_proc_mount(void) {
     printf("PASS: test_proc_mount\n");
 }
 
+void test_detached_rootfs(void) {
+    // The parent's half of setup_rootfs_fd(): a detached clone of the
+    // rootfs, reachable through the fd without being attached anywhere
+    int fd = mount_tree_clone("./rootfs");
+    if (fd < 0 && errno == ENOSYS) {
+        printf("SKIP: test_detached_rootfs (no open_tree)\n");
+        return;
+    }
+    assert(fd >= 0);
+    struct stat st;
+    assert(fstatat(fd, "bin/sh", &st, 0) == 0);
+    assert(fcntl(fd, F_GETFD) & FD_CLOEXEC);
+    close(fd);
+
+    // container_exec() takes that path without a user namespace
+    char *argv[] = {"/bin/sh", "-c", "test -x /bin/sh && test ! -d /old_root", NULL};
+    char **env = build_container_env(NULL, false);
+
+    container_config_t cfg = {
+        .program = "/bin/sh",
+        .argv = argv,
+        .envp = env,
+        .enable_pid_namespace = true,
+        .enable_mount_namespace = true,
+        .rootfs_path = "./rootfs",
+    };
+
+    container_result_t result = container_exec(&cfg);
+    container_cleanup(&result);
+    free(env);
+
+    assert(result.exited_normally);
+    assert(result.exit_status == 0);
+
+    printf("PASS: test_detached_rootfs\n");
+}
+
 int main(void) {
     if (geteuid() != 0) {
         fprintf(stderr, "Tests must run as root\n");
@@ -87,6 +127,7 @@ int main(void) {
 
     test_rootfs_isolation();
     test_proc_mount();
+    test_detached_rootfs();
 
     printf("\nAll mount tests passed!\n");
     return 0;
@@ -3,11 +3,16 @@
 // Local build_container_env() stub removed — we #include "env.h" instead.
 #include "core.h"
 #include "env.h"
+#include "net_pool.h"
+#include "net_pod.h"
+#include "net_bridge.h"
+#include "net_user.h"
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <net/if.h>
 
 static container_config_t base_config(char **env, const char *cmd) {
     static char *argv_buf[] = {"/bin/sh", "-c", NULL, NULL};
@@ -46,6 +51,280 @@ void test_network_creates_namespace(void) {
     printf("PASS: test_network_creates_namespace\n");
 }
 
+/* Netlink only — no ip(8) fallback, so a netlink regression fails here
+ * instead of being masked by AUTO's fallback. The container checks its
+ * own default route to prove the child-side batch landed. */
+void test_network_netlink_backend(void) {
+    char **env = build_container_env(NULL, false);
+    /* /proc/net/route prints the gateway little-endian: 10.99.2.1 is
+     * 0102630A. /proc/net follows the reader's netns, so the host /proc
+     * still shows the container's table. */
+    container_config_t cfg = base_config(env,
+        "grep -q 0102630A /proc/net/route");
+    cfg.enable_network = true;
+    strcpy(cfg.veth.host_ip, "10.99.2.1");
+    strcpy(cfg.veth.container_ip, "10.99.2.2");
+    strcpy(cfg.veth.netmask, "24");
+    cfg.veth.enable_nat = false;
+    cfg.veth.backend = NET_BACKEND_NETLINK;
+
+    container_result_t r = container_exec(&cfg);
+    assert(r.ctx.net_ctx.backend == NET_BACKEND_NETLINK);
+    container_cleanup(&r);
+    free(env);
+
+    assert(r.exited_normally);
+    assert(r.exit_status == 0);
+    printf("PASS: test_network_netlink_backend\n");
+}
+
+/* ip(8) only — the Phase 6 path, kept as the fallback backend. */
+void test_network_ip_backend(void) {
+    char **env = build_container_env(NULL, false);
+    container_config_t cfg = base_config(env, "true");
+    cfg.enable_network = true;
+    strcpy(cfg.veth.host_ip, "10.99.3.1");
+    strcpy(cfg.veth.container_ip, "10.99.3.2");
+    strcpy(cfg.veth.netmask, "24");
+    cfg.veth.enable_nat = false;
+    cfg.veth.backend = NET_BACKEND_IP;
+
+    container_result_t r = container_exec(&cfg);
+    assert(r.ctx.net_ctx.backend == NET_BACKEND_IP);
+    container_cleanup(&r);
+    free(env);
+
+    assert(r.exited_normally);
+    assert(r.exit_status == 0);
+    printf("PASS: test_network_ip_backend\n");
+}
+
+/* Pooled start: the child joins a netns the refiller built ahead of
+ * time, with its route table already in place. */
+void test_network_pool(void) {
+    char **env = build_container_env(NULL, false);
+    container_config_t cfg = base_config(env,
+        "grep -q 0104630A /proc/net/route");
+    cfg.enable_network = true;
+    strcpy(cfg.veth.host_ip, "10.99.4.1");
+    strcpy(cfg.veth.container_ip, "10.99.4.2");
+    strcpy(cfg.veth.netmask, "24");
+    cfg.veth.enable_nat = false;
+    cfg.veth.pool.size = 2;
+    cfg.veth.pool.low_water = 0;   // no async refill racing the drain
+
+    assert(net_pool_refill(&cfg.veth, false) == 2);
+
+    container_result_t r = container_exec(&cfg);
+    assert(r.ctx.net_ctx.pooled);
+    assert(strncmp(r.ctx.net_ctx.veth_host, "mcp_h_", 6) == 0);
+    container_cleanup(&r);
+    assert(!r.ctx.net_ctx.pooled);
+
+    /* The used slot is rebuilt, the untouched one still counts. */
+    assert(net_pool_refill(&cfg.veth, false) == 2);
+    net_pool_drain(false);
+    free(env);
+
+    assert(r.exited_normally);
+    assert(r.exit_status == 0);
+    printf("PASS: test_network_pool\n");
+}
+
+/* Pod mode: the second container joins the first one's netns (its
+ * route is there without any setup of its own), and only the last one
+ * out deletes the shared pair. */
+void test_network_pod(void) {
+    char **env = build_container_env(NULL, false);
+    container_config_t cfg = base_config(env, "sleep 1");
+    cfg.enable_network = true;
+    strcpy(cfg.veth.host_ip, "10.99.5.1");
+    strcpy(cfg.veth.container_ip, "10.99.5.2");
+    strcpy(cfg.veth.netmask, "24");
+    cfg.veth.enable_nat = false;
+    strcpy(cfg.veth.pod, "test_pod");
+
+    container_loop_t *loop = container_loop_create();
+    container_handle_t *first = container_spawn(loop, &cfg, NULL, NULL);
+    assert(first && !first->result.ctx.net_ctx.pod_member);
+    assert(first->result.ctx.net_ctx.pod_refs == 1);
+    char veth_host[IFNAMSIZ];
+    strcpy(veth_host, first->result.ctx.net_ctx.veth_host);
+
+    container_config_t member = base_config(env,
+        "grep -q 0105630A /proc/net/route");
+    member.enable_network = true;
+    member.veth = cfg.veth;
+    container_result_t r = container_exec(&member);
+    assert(r.ctx.net_ctx.pod_member && r.ctx.net_ctx.pod_refs == 2);
+    assert(strcmp(r.ctx.net_ctx.veth_host, veth_host) == 0);
+    container_cleanup(&r);
+    assert(if_nametoindex(veth_host) != 0);   // First member still up
+
+    assert(container_wait_any(loop) == first);
+    container_handle_free(first);
+    container_loop_destroy(loop);
+    assert(if_nametoindex(veth_host) == 0);
+    assert(access(NET_POD_DIR "/test_pod.ns", F_OK) < 0);
+    free(env);
+
+    assert(r.exited_normally);
+    assert(r.exit_status == 0);
+    printf("PASS: test_network_pod\n");
+}
+
+/* Bridge mode: two containers on one bridge get distinct leased
+ * addresses, their host ends are bridge ports with no address of their
+ * own, and a lease is free again once its container is cleaned up. */
+void test_network_bridge(void) {
+    char **env = build_container_env(NULL, false);
+    container_config_t cfg = base_config(env,
+        "sleep 0.3; grep -q 0106630A /proc/net/route");
+    cfg.enable_network = true;
+    strcpy(cfg.veth.host_ip, "10.99.6.1");
+    strcpy(cfg.veth.netmask, "24");
+    cfg.veth.enable_nat = false;
+    strcpy(cfg.veth.bridge, "mctest_br0");
+
+    container_loop_t *loop = container_loop_create();
+    container_handle_t *a = container_spawn(loop, &cfg, NULL, NULL);
+    container_handle_t *b = container_spawn(loop, &cfg, NULL, NULL);
+    assert(a && b);
+    assert(strcmp(a->result.ctx.net_ctx.bridge_ip, "10.99.6.2") == 0);
+    assert(strcmp(b->result.ctx.net_ctx.bridge_ip, "10.99.6.3") == 0);
+    char path[128], master[64];
+    snprintf(path, sizeof(path), "/sys/class/net/%s/master",
+             a->result.ctx.net_ctx.veth_host);
+    ssize_t n = readlink(path, master, sizeof(master) - 1);
+    assert(n > 0);
+    master[n] = '\0';
+    assert(strstr(master, "mctest_br0"));
+
+    for (int i = 0; i < 2; i++) {
+        container_handle_t *h = container_wait_any(loop);
+        assert(h && h->result.exited_normally && h->result.exit_status == 0);
+        container_handle_free(h);
+    }
+    container_loop_destroy(loop);
+
+    /* Both leases released: the next start gets the lowest one again. */
+    net_context_t ctx = {0};
+    cfg.veth.container_ip[0] = '\0';
+    assert(net_bridge_lease(&ctx, &cfg.veth, false) == 0);
+    assert(strcmp(ctx.bridge_ip, "10.99.6.2") == 0);
+    net_bridge_release(&ctx);
+    assert(system("ip link del mctest_br0") == 0);
+    free(env);
+    printf("PASS: test_network_bridge\n");
+}
+
+/* NAT on a bridge that an earlier start created without it: the NAT
+ * start still gets the subnet's MASQUERADE rule. */
+void test_network_bridge_nat(void) {
+    char **env = build_container_env(NULL, false);
+    container_config_t cfg = base_config(env, "true");
+    cfg.enable_network = true;
+    strcpy(cfg.veth.host_ip, "10.99.8.1");
+    strcpy(cfg.veth.netmask, "24");
+    strcpy(cfg.veth.bridge, "mctest_br1");
+    cfg.veth.enable_nat = false;
+    container_result_t r = container_exec(&cfg);
+    assert(r.exited_normally && r.exit_status == 0);
+    container_cleanup(&r);
+
+    cfg.veth.enable_nat = true;
+    r = container_exec(&cfg);
+    assert(r.exited_normally && r.exit_status == 0);
+    container_cleanup(&r);
+
+    bool have_iptables = access("/sbin/iptables", X_OK) == 0 ||
+                         access("/usr/sbin/iptables", X_OK) == 0;
+    if (have_iptables) {
+        assert(system("iptables -t nat -C POSTROUTING -s 10.99.8.0/24 "
+                      "! -o mctest_br1 -j MASQUERADE 2>/dev/null") == 0);
+        assert(system("iptables -t nat -D POSTROUTING -s 10.99.8.0/24 "
+                      "! -o mctest_br1 -j MASQUERADE") == 0);
+    }
+    assert(system("ip link del mctest_br1") == 0);
+    free(env);
+    printf("PASS: test_network_bridge_nat%s\n",
+           have_iptables ? "" : " (no iptables: rule not checked)");
+}
+
+/* Rootless: user namespace plus a user-mode helper, no veth. Without
+ * pasta or slirp4netns installed the start must fail cleanly. */
+void test_network_user_mode(void) {
+    char **env = build_container_env(NULL, false);
+    container_config_t cfg = base_config(env,
+        "grep -q 'lo:' /proc/net/dev && ! grep -q veth_c /proc/net/dev");
+    cfg.enable_user_namespace = true;
+    cfg.enable_network = true;
+    cfg.veth.user_mode = NET_USER_AUTO;
+
+    net_user_mode_t mode;
+    bool installed = net_user_find(NET_USER_AUTO, &mode) != NULL;
+    container_result_t r = container_exec(&cfg);
+    assert(r.ctx.net_ctx.veth_host[0] == '\0');
+    container_cleanup(&r);
+    assert(r.ctx.net_ctx.user_helper_pid == 0);
+    free(env);
+
+    if (installed) {
+        assert(r.exited_normally && r.exit_status == 0);
+        printf("PASS: test_network_user_mode (%s)\n", net_user_mode_name(mode));
+    } else {
+        assert(r.child_pid == -1);
+        printf("PASS: test_network_user_mode (no helper installed: refused)\n");
+    }
+}
+
+/* --publish: the parser, then DNAT rules that are in place while the
+ * container runs and gone after cleanup. Without iptables the start is
+ * refused. */
+void test_network_publish(void) {
+    net_publish_t p;
+    assert(net_parse_publish("8080:80", &p) == 0);
+    assert(p.host_ip[0] == '\0' && p.host_port == 8080 &&
+           p.container_port == 80 && p.proto == IPPROTO_TCP);
+    assert(net_parse_publish("127.0.0.1:53:5353/udp", &p) == 0);
+    assert(strcmp(p.host_ip, "127.0.0.1") == 0 && p.host_port == 53 &&
+           p.container_port == 5353 && p.proto == IPPROTO_UDP);
+    assert(net_parse_publish("80", &p) < 0);
+    assert(net_parse_publish("0:80", &p) < 0);
+    assert(net_parse_publish("8080:65536", &p) < 0);
+    assert(net_parse_publish("8080:80/sctp", &p) < 0);
+    assert(net_parse_publish("host:8080:80", &p) < 0);
+
+    char **env = build_container_env(NULL, false);
+    container_config_t cfg = base_config(env, "true");
+    cfg.enable_network = true;
+    strcpy(cfg.veth.host_ip, "10.99.6.1");
+    strcpy(cfg.veth.container_ip, "10.99.6.2");
+    strcpy(cfg.veth.netmask, "24");
+    assert(net_parse_publish("18080:80", &cfg.veth.publish[0]) == 0);
+    cfg.veth.publish_count = 1;
+
+    bool have_iptables = access("/sbin/iptables", X_OK) == 0 ||
+                         access("/usr/sbin/iptables", X_OK) == 0;
+    container_result_t r = container_exec(&cfg);
+    unsigned published = r.ctx.net_ctx.published_count;
+    container_cleanup(&r);
+    assert(r.ctx.net_ctx.published_count == 0);
+    free(env);
+
+    if (have_iptables) {
+        assert(r.exited_normally && r.exit_status == 0);
+        assert(published == 1);
+        assert(system("iptables -t nat -C PREROUTING -p tcp --dport 18080 "
+                      "-m addrtype --dst-type LOCAL -j DNAT --to-destination "
+                      "10.99.6.2:80 2>/dev/null") != 0);
+        printf("PASS: test_network_publish\n");
+    } else {
+        assert(r.child_pid == -1);
+        printf("PASS: test_network_publish (no iptables: refused)\n");
+    }
+}
+
 void test_no_network_backward_compat(void) {
     char **env = build_container_env(NULL, false);
     container_config_t cfg = base_config(env, "true");
@@ -87,6 +366,14 @@ int main(void) {
         return 1;
     }
     test_network_creates_namespace();
+    test_network_netlink_backend();
+    test_network_ip_backend();
+    test_network_pool();
+    test_network_pod();
+    test_network_bridge();
+    test_network_bridge_nat();
+    test_network_user_mode();
+    test_network_publish();
     test_no_network_backward_compat();
     test_network_with_cgroup();
     printf("\nAll network tests passed!\n");
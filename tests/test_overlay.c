@@ -1,12 +1,20 @@
 // Phase 7a: was overlay_exec/overlay_config_t — now container_exec.
 #include "core.h"
 #include "env.h"
+#include "image.h"
+#include "fs_batch.h"
 #include <assert.h>
 #include <stdio.h>
 #include <sys/stat.h>
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <stdint.h>
+#include <sys/mount.h>
+#include <fcntl.h>
+#include <errno.h>
 
 static container_config_t base_overlay_config(char **env, char *const *argv) {
     container_config_t cfg = {
@@ -96,6 +104,224 @@ void test_no_overlay_backward_compat(void) {
     printf("PASS: test_no_overlay_backward_compat\n");
 }
 
+/* Workspaces are recycled through ./test_containers/.cache: a reused
+ * triple never carries a previous container's writes, and no per-run
+ * directory is left behind. */
+void test_overlay_workspace_reuse(void) {
+    char **env = build_container_env(NULL, false);
+    char *argv[] = {"/bin/sh", "-c",
+                    "[ ! -e /tmp/cache_leak ] && echo x > /tmp/cache_leak", NULL};
+    char *clean_argv[] = {"/bin/sh", "-c", "[ ! -e /tmp/cache_leak ]", NULL};
+
+    for (int i = 0; i < 3; i++) {
+        container_config_t cfg = base_overlay_config(env, i % 2 ? clean_argv : argv);
+        container_result_t result = container_exec(&cfg);
+        container_cleanup(&result);
+        assert(result.exited_normally && result.exit_status == 0);
+    }
+    free(env);
+
+    DIR *dir = opendir("./test_containers");
+    assert(dir);
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        assert(entry->d_name[0] == '.');   // Only ., .. and .cache
+    }
+    closedir(dir);
+
+    struct stat st;
+    assert(stat("./test_containers/.cache/free", &st) == 0);
+    printf("PASS: test_overlay_workspace_reuse\n");
+}
+
+#define TEST_STORE "/tmp/minicontainer_test_store"
+#define TOP_HEX  "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+
+/* A two-layer image from a scratch store: the top layer's file shows
+ * through, the base (./rootfs) supplies the rest, and a manifest naming
+ * anything but a well-formed digest is refused. */
+void test_overlay_image_layers(void) {
+    struct stat st;
+    char base[PATH_MAX], base_link[PATH_MAX];
+    assert(realpath("./rootfs", base));
+    mkdir(TEST_STORE, 0755);
+    mkdir(TEST_STORE "/images", 0755);
+    mkdir(TEST_STORE "/layers", 0755);
+    mkdir(TEST_STORE "/layers/sha256", 0755);
+    mkdir(TEST_STORE "/layers/sha256/" TOP_HEX, 0755);
+    mkdir(TEST_STORE "/layers/sha256/" TOP_HEX "/etc", 0755);
+    FILE *f = fopen(TEST_STORE "/layers/sha256/" TOP_HEX "/etc/layer", "w");
+    assert(f);
+    fputs("top\n", f);
+    fclose(f);
+    /* The base layer is ./rootfs itself, linked in under a digest name. */
+    snprintf(base_link, sizeof(base_link),
+             TEST_STORE "/layers/sha256/%064d", 0);
+    unlink(base_link);
+    assert(symlink(base, base_link) == 0);
+
+    f = fopen(TEST_STORE "/images/app", "w");
+    assert(f);
+    fprintf(f, "# top first\nsha256:" TOP_HEX "\nsha256:%064d\n", 0);
+    fclose(f);
+    f = fopen(TEST_STORE "/images/evil", "w");
+    assert(f);
+    fputs("sha256:../../../../etc\n", f);
+    fclose(f);
+
+    char lowerdirs[PATH_MAX];
+    assert(image_resolve(TEST_STORE, "evil", lowerdirs, sizeof(lowerdirs), false) < 0);
+    assert(image_resolve(TEST_STORE, "missing", lowerdirs, sizeof(lowerdirs), false) < 0);
+    assert(image_resolve(TEST_STORE, "app", lowerdirs, sizeof(lowerdirs), false) == 2);
+    assert(strchr(lowerdirs, ':'));
+
+    char **env = build_container_env(NULL, false);
+    char *argv[] = {"/bin/sh", "-c",
+                    "[ \"$(cat /etc/layer)\" = top ] && echo x > /etc/layer && ls /bin/sh",
+                    NULL};
+    container_config_t cfg = base_overlay_config(env, argv);
+    cfg.rootfs_path = lowerdirs;
+    container_result_t result = container_exec(&cfg);
+    container_cleanup(&result);
+    free(env);
+    assert(result.exited_normally && result.exit_status == 0);
+
+    /* The write went to the upper layer, not into the store. */
+    f = fopen(TEST_STORE "/layers/sha256/" TOP_HEX "/etc/layer", "r");
+    char buf[8] = {0};
+    assert(f && fgets(buf, sizeof(buf), f));
+    fclose(f);
+    assert(strcmp(buf, "top\n") == 0);
+    assert(stat("./rootfs/etc/layer", &st) < 0);
+    printf("PASS: test_overlay_image_layers\n");
+}
+
+#define TEST_EROFS "/tmp/minicontainer_test_layer.erofs"
+
+/* Smallest useful erofs image: /etc/layer = "erofs\n". Block size 4096;
+ * block 0 the superblock (at 1024), block 1 three compact inodes (root,
+ * etc, layer), blocks 2-4 their flat-plain data. */
+static void write_test_erofs(const char *path) {
+    enum { B = 4096 };
+    static uint8_t img[5 * B];
+    memset(img, 0, sizeof(img));
+    uint8_t *sb = img + 1024;
+    uint32_t u32; uint16_t u16; uint64_t u64;
+    u32 = 0xE0F5E1E2; memcpy(sb, &u32, 4);           // magic
+    sb[12] = 12;                                      // blkszbits
+    u64 = 3;  memcpy(sb + 16, &u64, 8);              // inos
+    u32 = 5;  memcpy(sb + 36, &u32, 4);              // blocks
+    u32 = 1;  memcpy(sb + 40, &u32, 4);              // meta_blkaddr
+
+    struct { uint16_t format, xattr, mode, nlink; uint32_t size, res, blk, ino;
+             uint16_t uid, gid; uint32_t res2; } ino[3] = {
+        { 0, 0, 040755, 3, 0, 0, 2, 1, 0, 0, 0 },
+        { 0, 0, 040755, 2, 0, 0, 3, 2, 0, 0, 0 },
+        { 0, 0, 0100644, 1, 6, 0, 4, 3, 0, 0, 0 },
+    };
+    /* Directory blocks: 12-byte dirents sorted by name, then the names. */
+    struct { const char *name; uint64_t nid; uint8_t type; } dirs[2][3] = {
+        { { ".", 0, 2 }, { "..", 0, 2 }, { "etc", 1, 2 } },
+        { { ".", 1, 2 }, { "..", 0, 2 }, { "layer", 2, 1 } },
+    };
+    for (int d = 0; d < 2; d++) {
+        uint8_t *blk = img + (2 + d) * B;
+        u16 = 36;
+        for (int e = 0; e < 3; e++) {
+            memcpy(blk + e * 12, &dirs[d][e].nid, 8);
+            memcpy(blk + e * 12 + 8, &u16, 2);
+            blk[e * 12 + 10] = dirs[d][e].type;
+            size_t len = strlen(dirs[d][e].name);
+            memcpy(blk + u16, dirs[d][e].name, len);
+            u16 += (uint16_t)len;
+        }
+        ino[d].size = u16;
+    }
+    memcpy(img + 4 * B, "erofs\n", 6);
+    memcpy(img + B, ino, sizeof(ino));
+
+    FILE *f = fopen(path, "w");
+    assert(f && fwrite(img, sizeof(img), 1, f) == 1);
+    fclose(f);
+}
+
+/* An erofs image file as the top layer over ./rootfs: mounted once under
+ * IMAGE_MOUNT_DIR and shared by later containers. */
+void test_overlay_erofs_layer(void) {
+    write_test_erofs(TEST_EROFS);
+    const char *fstype;
+    assert(image_file_fstype(TEST_EROFS, &fstype) == 1);
+    assert(strcmp(fstype, "erofs") == 0);
+    assert(image_file_fstype("./rootfs", &fstype) == 0);
+
+    char **env = build_container_env(NULL, false);
+    char *argv[] = {"/bin/sh", "-c", "[ \"$(cat /etc/layer)\" = erofs ]", NULL};
+    char mnt[2][PATH_MAX];
+    for (int i = 0; i < 2; i++) {
+        container_config_t cfg = base_overlay_config(env, argv);
+        cfg.rootfs_path = TEST_EROFS ":./rootfs";
+        container_result_t result = container_exec(&cfg);
+        container_cleanup(&result);
+        assert(result.exited_normally && result.exit_status == 0);
+        assert(image_mount_file(TEST_EROFS, mnt[i], PATH_MAX, false) == 0);
+    }
+    free(env);
+    assert(strcmp(mnt[0], mnt[1]) == 0);   // One cached mount
+
+    umount2(mnt[0], MNT_DETACH);
+    rmdir(mnt[0]);
+    unlink(TEST_EROFS);
+    printf("PASS: test_overlay_erofs_layer\n");
+}
+
+/* One batch of mkdirs and writes, then one of unlinks, under a backend. */
+static void fs_batch_round_trip(fs_backend_t backend) {
+    const char *base = "./test_containers/fsbatch";
+    fs_batch_set_backend(backend);
+    assert(mkdir(base, 0755) == 0 || errno == EEXIST);
+    int dfd = open(base, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    assert(dfd >= 0);
+
+    fs_batch_t b;
+    fs_batch_init(&b);
+    assert(fs_batch_mkdir(&b, dfd, "a", 0755, 0) == 0);
+    assert(fs_batch_mkdir(&b, dfd, "b", 0755, 0) == 1);
+    assert(fs_batch_run(&b, false) == 0);
+
+    /* Writes never create (cgroup knobs and id maps already exist), and
+     * one failing op leaves the rest of the batch alone. */
+    int fd = openat(dfd, "a/f", O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    assert(fd >= 0);
+    close(fd);
+    fs_batch_init(&b);
+    fs_batch_write_file(&b, dfd, "missing/f", "x", 0);
+    fs_batch_write_file(&b, dfd, "a/f", "hello", 0);
+    assert(fs_batch_run(&b, false) == -1);
+    assert(b.ops[0].res == -ENOENT && strcmp(b.ops[0].failed_call, "open") == 0);
+    assert(b.ops[1].res == 0);
+
+    char buf[16] = {0};
+    FILE *fp = fopen("./test_containers/fsbatch/a/f", "r");
+    assert(fp && fread(buf, 1, sizeof(buf) - 1, fp) == 5);
+    fclose(fp);
+    assert(strcmp(buf, "hello") == 0);
+
+    fs_batch_init(&b);
+    fs_batch_unlink(&b, dfd, "a/f", 0, 0);
+    fs_batch_unlink(&b, dfd, "a", AT_REMOVEDIR, FS_OP_BARRIER);
+    fs_batch_unlink(&b, dfd, "b", AT_REMOVEDIR, 0);
+    assert(fs_batch_run(&b, false) == 0);
+    close(dfd);
+    assert(rmdir(base) == 0);
+}
+
+void test_fs_batch_backends(void) {
+    fs_batch_round_trip(FS_BACKEND_AUTO);
+    fs_batch_round_trip(FS_BACKEND_SYSCALL);
+    fs_batch_set_backend(FS_BACKEND_AUTO);
+    printf("PASS: test_fs_batch_backends\n");
+}
+
 int main(void) {
     if (geteuid() != 0) {
         fprintf(stderr, "Tests must run as root (sudo)\n");
@@ -113,6 +339,10 @@ int main(void) {
     test_overlay_base_image_untouched();
     test_overlay_cleanup();
     test_no_overlay_backward_compat();
+    test_overlay_workspace_reuse();
+    test_overlay_image_layers();
+    test_overlay_erofs_layer();
+    test_fs_batch_backends();
 
     printf("\nAll overlay tests passed!\n");
     return 0;
@@ -0,0 +1,232 @@
+// Note: _GNU_SOURCE is provided by the Makefile.
+#include "core.h"
+#include "env.h"
+#include "spec.h"
+#include "serve.h"
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define TEST_SOCKET "/tmp/minicontainer_test_serve.sock"
+
+static container_config_t base_config(char **env, const char *cmd) {
+    static char *argv_buf[] = {"/bin/sh", "-c", NULL, NULL};
+    argv_buf[2] = (char *)cmd;
+    container_config_t cfg = {
+        .program = "/bin/sh",
+        .argv = argv_buf,
+        .envp = env,
+        .uid_map_inside = 0,
+        .uid_map_outside = getuid(),
+        .uid_map_range = 1,
+        .gid_map_inside = 0,
+        .gid_map_outside = getgid(),
+        .gid_map_range = 1,
+    };
+    return cfg;
+}
+
+/* Encode -> decode reproduces the config; a blob decodes only once and a
+ * truncated one is rejected. */
+void test_spec_roundtrip(void) {
+    static uint64_t buf[SPEC_MAX_SIZE / sizeof(uint64_t)];
+    char *env[] = {"A=1", "B=2", NULL};
+    container_config_t cfg = base_config(env, "echo hi");
+    cfg.hostname = "web";
+    cfg.enable_pid_namespace = true;
+    cfg.cgroup_limits.pid_limit = 20;
+    strcpy(cfg.cgroup_limits.cpuset_cpus, "0-1");
+    strcpy(cfg.veth.container_ip, "10.0.0.2");
+
+    size_t len = spec_encode(&cfg, buf, sizeof(buf));
+    assert(len > sizeof(spec_header_t));
+
+    container_config_t out;
+    assert(spec_decode(buf, len - 1, &out) < 0);
+    assert(spec_decode(buf, len, &out) == 0);
+    assert(strcmp(out.program, "/bin/sh") == 0);
+    assert(strcmp(out.argv[2], "echo hi") == 0 && out.argv[3] == NULL);
+    assert(strcmp(out.envp[1], "B=2") == 0 && out.envp[2] == NULL);
+    assert(strcmp(out.hostname, "web") == 0);
+    assert(out.rootfs_path == NULL);
+    assert(out.enable_pid_namespace);
+    assert(out.cgroup_limits.pid_limit == 20);
+    assert(strcmp(out.cgroup_limits.cpuset_cpus, "0-1") == 0);
+    assert(strcmp(out.veth.container_ip, "10.0.0.2") == 0);
+    assert(spec_decode(buf, len, &out) < 0);
+    printf("PASS: test_spec_roundtrip\n");
+}
+
+/* A blob is untrusted input: a pointer the peer left in it is never
+ * used, and names that end up in paths are checked like the options. */
+void test_spec_untrusted(void) {
+    static uint64_t buf[SPEC_MAX_SIZE / sizeof(uint64_t)];
+    container_config_t cfg = base_config(NULL, "true");
+    spec_header_t *hdr = (spec_header_t *)buf;
+    container_config_t out;
+
+    size_t len = spec_encode(&cfg, buf, sizeof(buf));
+    hdr->config.restore_dir = (const char *)(uintptr_t)0x1000;
+    assert(spec_decode(buf, len, &out) == 0 && out.restore_dir == NULL);
+
+    /* A pod name must be terminated and pass net_pod_name_valid(). */
+    strcpy(cfg.veth.pod, "web-1");
+    len = spec_encode(&cfg, buf, sizeof(buf));
+    assert(spec_decode(buf, len, &out) == 0 && strcmp(out.veth.pod, "web-1") == 0);
+    len = spec_encode(&cfg, buf, sizeof(buf));
+    memset(hdr->config.veth.pod, 'a', sizeof(hdr->config.veth.pod));
+    assert(spec_decode(buf, len, &out) < 0 && errno == EINVAL);
+    len = spec_encode(&cfg, buf, sizeof(buf));
+    strcpy(hdr->config.veth.pod, "../etc");
+    assert(spec_decode(buf, len, &out) < 0);
+    cfg.veth.pod[0] = '\0';
+
+    /* So must a bridge name, within IFNAMSIZ. */
+    strcpy(cfg.veth.bridge, "mcbr0");
+    len = spec_encode(&cfg, buf, sizeof(buf));
+    assert(spec_decode(buf, len, &out) == 0 && strcmp(out.veth.bridge, "mcbr0") == 0);
+    len = spec_encode(&cfg, buf, sizeof(buf));
+    memset(hdr->config.veth.bridge, 'b', sizeof(hdr->config.veth.bridge));
+    assert(spec_decode(buf, len, &out) < 0 && errno == EINVAL);
+    printf("PASS: test_spec_untrusted\n");
+}
+
+/* A compiled spec file maps back to the same config, runs as is, and
+ * the file itself is untouched by the in-place decode (MAP_PRIVATE). A
+ * file from elsewhere is refused. */
+void test_spec_file(void) {
+    const char *path = "/tmp/minicontainer_test.spec";
+    char *env[] = {"GREETING=hi", NULL};
+    container_config_t cfg = base_config(env, "test \"$GREETING\" = hi");
+    cfg.enable_pid_namespace = true;
+    assert(spec_save(&cfg, path) == 0);
+
+    for (int run = 0; run < 2; run++) {
+        size_t len;
+        void *map = spec_map(path, &len);
+        assert(map != NULL);
+        container_config_t out;
+        assert(spec_decode(map, len, &out) == 0);
+        assert(strcmp(out.envp[0], "GREETING=hi") == 0);
+        container_result_t r = container_exec(&out);
+        container_cleanup(&r);
+        assert(r.exited_normally && r.exit_status == 0);
+        spec_unmap(map, len);
+    }
+
+    FILE *f = fopen(path, "w");
+    assert(f && fputs("not a spec", f) >= 0 && fclose(f) == 0);
+    size_t len;
+    errno = 0;
+    assert(spec_map(path, &len) == NULL && errno == EINVAL);
+    unlink(path);
+    assert(spec_map(path, &len) == NULL && errno == ENOENT);
+    printf("PASS: test_spec_file\n");
+}
+
+/* A parked zygote runs the request it is handed. */
+void test_zygote_launch(void) {
+    char **env = build_container_env(NULL, false);
+    container_config_t cfg = base_config(env, "[ $$ -eq 1 ] && exit 7");
+    cfg.enable_pid_namespace = true;
+
+    container_zygote_t z;
+    assert(container_zygote_spawn(&z, &cfg) == 0);
+    assert(container_zygote_matches(&z, &cfg));
+    container_config_t other = cfg;
+    other.enable_ipc_namespace = true;
+    assert(!container_zygote_matches(&z, &other));
+
+    int stdio_fds[3] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    container_result_t r;
+    int ctl_fd = container_zygote_launch(&z, &cfg, stdio_fds, &r);
+    assert(ctl_fd >= 0);
+    assert(z.pid == 0);   // Consumed
+
+    char c;
+    assert(read(ctl_fd, &c, 1) == 0);   // EOF at execve
+    close(ctl_fd);
+
+    int status;
+    assert(waitpid(r.child_pid, &status, 0) == r.child_pid);
+    container_reap(&r, status, false);
+    container_cleanup(&r);
+    container_zygote_discard(&z);
+    free(env);
+
+    assert(r.exited_normally);
+    assert(r.exit_status == 7);
+    printf("PASS: test_zygote_launch\n");
+}
+
+/* Daemon round trip: two runs (the second on a parked zygote), then the
+ * latency report counts both. */
+void test_serve_roundtrip(void) {
+    pid_t daemon = fork();
+    assert(daemon >= 0);
+    if (daemon == 0) {
+        serve_config_t sc = { .socket_path = TEST_SOCKET, .zygotes = 1 };
+        _exit(serve_run(&sc) < 0 ? 1 : 0);
+    }
+
+    char **env = build_container_env(NULL, false);
+    container_config_t cfg = base_config(env, "exit 3");
+    cfg.enable_pid_namespace = true;
+
+    /* Wait for the socket. */
+    int tries = 0;
+    while (access(TEST_SOCKET, F_OK) < 0) {
+        assert(++tries < 100);
+        usleep(10000);
+    }
+    serve_stats_t stats;
+    assert(serve_client_stats(TEST_SOCKET, &stats) == 0);
+    assert(stats.count == 0);
+
+    serve_reply_t reply;
+    assert(serve_client_exec(TEST_SOCKET, &cfg, &reply) == 0);
+    assert(reply.exited_normally && reply.exit_status == 3);
+    assert(!reply.warm);
+
+    /* The replacement zygote is cloned after the first start settles. */
+    tries = 0;
+    do {
+        assert(serve_client_exec(TEST_SOCKET, &cfg, &reply) == 0);
+        assert(reply.exited_normally && reply.exit_status == 3);
+        assert(++tries < 50);
+    } while (!reply.warm);
+
+    assert(serve_client_stats(TEST_SOCKET, &stats) == 0);
+    assert(stats.count == (uint64_t)tries + 1);
+    assert(stats.zygote_hits >= 1);
+    assert(stats.window == stats.count);
+    assert(stats.p50_ns > 0 && stats.p50_ns <= stats.p99_ns &&
+           stats.p99_ns <= stats.max_ns);
+
+    kill(daemon, SIGTERM);
+    int status;
+    assert(waitpid(daemon, &status, 0) == daemon);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    assert(access(TEST_SOCKET, F_OK) < 0 && errno == ENOENT);
+    free(env);
+    printf("PASS: test_serve_roundtrip\n");
+}
+
+int main(void) {
+    if (geteuid() != 0) {
+        fprintf(stderr, "test_serve requires root\n");
+        return 1;
+    }
+    test_spec_roundtrip();
+    test_spec_file();
+    test_spec_untrusted();
+    test_zygote_launch();
+    test_serve_roundtrip();
+    printf("\nAll serve tests passed!\n");
+    return 0;
+}